@@ -1,6 +1,6 @@
 #!/usr/bin/env python3
 """
-GZ302 Command Center — Strix Halo Edition (v6.3.6)
+GZ302 Command Center — Strix Halo Edition (v6.28.1)
 Unified Dashboard and System Tray Controller.
 Inspired by G-Helper and Strix-Halo-Control.
 """
@@ -35,9 +35,10 @@ from modules.config import ConfigManager
 from modules.notifications import NotificationManager
 from modules.rgb_controller import RGBController
 from modules.power_controller import PowerController
+from modules.gpu_telemetry import GPUTelemetry
 
 TRAY_ICON_SIZE = 24
-VERSION = "6.3.6"
+VERSION = "6.28.1"
 DASHBOARD_WINDOW_TITLE = "GZ302 Dashboard"
 DASHBOARD_WINDOW_ROLE = "gz302-dashboard"
 KWIN_DASHBOARD_SCRIPT_NAME = "gz302_dashboard_anchor"
@@ -63,6 +64,7 @@ class DashboardWindow(QWidget):
         self.rgb = rgb_controller
         self.config = config
         self.notifier = notifier
+        self.gpu = GPUTelemetry()
         self._profile_btns = {}
 
         self.setWindowTitle(DASHBOARD_WINDOW_TITLE)
@@ -124,12 +126,13 @@ class DashboardWindow(QWidget):
         hbox.setSpacing(16)
 
         self.stat_temp  = self._stat_widget("APU", "--°C")
+        self.stat_gpu   = self._stat_widget("GPU", "--%")
         self.stat_fans  = self._stat_widget("FANS", "-- RPM")
         self.stat_pwr   = self._stat_widget("MODE", "Balanced")
         self.stat_bat   = self._stat_widget("BATTERY", "--%")
         self.stat_cpu   = self._stat_widget("CPU", "0%")
 
-        for w in (self.stat_temp, self.stat_fans, self.stat_pwr, self.stat_bat, self.stat_cpu):
+        for w in (self.stat_temp, self.stat_gpu, self.stat_fans, self.stat_pwr, self.stat_bat, self.stat_cpu):
             hbox.addWidget(w)
         return bar
 
@@ -471,6 +474,13 @@ class DashboardWindow(QWidget):
                 if "Fans:" in line:
                     fans = re.sub(r",\s*mode:.*", "", line.split(":", 1)[1].strip())
 
+            gpu = self.gpu.snapshot()
+            if gpu:
+                # APU falls back to the GFX sensor when z13ctl has no reading
+                if temp == "--°C" and gpu["temp_gfx_c"] is not None:
+                    temp = f"{gpu['temp_gfx_c']:.0f}°C"
+                self._update_gpu_stat(gpu)
+
             self.stat_temp._value_lbl.setText(temp)
             self.stat_fans._value_lbl.setText(fans)
             self.stat_pwr._value_lbl.setText(self.power.current_profile.title())
@@ -488,6 +498,35 @@ class DashboardWindow(QWidget):
         self._update_profile_buttons()
         self._auto_btn.setChecked(self.power.is_auto_enabled())
 
+    def _update_gpu_stat(self, gpu):
+        def fmt(val, unit):
+            return f"{val}{unit}" if val is not None else "--"
+
+        activity = gpu["gfx_activity_pct"]
+        clock = gpu["gfxclk_mhz"]
+        text = fmt(activity, "%")
+        if clock is not None:
+            text += f" · {clock / 1000:.1f}G"
+        self.stat_gpu._value_lbl.setText(text)
+
+        def watts(mw):
+            return f"{mw / 1000:.1f} W" if mw is not None else "--"
+
+        temp_gfx, temp_soc = gpu["temp_gfx_c"], gpu["temp_soc_c"]
+        lines = [
+            f"GFX clock: {fmt(clock, ' MHz')}, SoC clock: {fmt(gpu['socclk_mhz'], ' MHz')}",
+            f"Socket power: {watts(gpu['socket_power_mw'])} (STAPM limit {watts(gpu['stapm_limit_mw'])})",
+            f"GFX power: {watts(gpu['gfx_power_mw'])}",
+            "Temperature: GFX {}, SoC {}".format(
+                f"{temp_gfx:.1f}°C" if temp_gfx is not None else "--",
+                f"{temp_soc:.1f}°C" if temp_soc is not None else "--",
+            ),
+        ]
+        if gpu["verdict"]:
+            lines.append(f"Limit: {gpu['verdict']}")
+        lines.append(f"Source: {gpu['source']}")
+        self.stat_gpu.setToolTip("\n".join(lines))
+
 class CommandCenterApp(QSystemTrayIcon):
     def __init__(self, app):
         super().__init__()
@@ -0,0 +1,122 @@
+import struct
+from pathlib import Path
+
+# Mirrors the telemetry section of gz302-lib/gpu-manager.sh: gpu_metrics
+# format 3.0 (Strix Point/Halo SMU 14.0.x) with the amdgpu hwmon sensors
+# filling any gaps. Reading sysfs directly keeps the 3 s poll free of
+# subprocesses.
+_DRM_ROOT = Path("/sys/class/drm")
+
+# field: (byte offset, struct format); 0xFFFF/0xFFFFFFFF mean "not reported"
+_METRICS_V3_0 = {
+    "temp_gfx_centi":   (4,   "<H"),
+    "temp_soc_centi":   (6,   "<H"),
+    "gfx_activity_pct": (42,  "<H"),
+    "socket_power_mw":  (112, "<I"),
+    "gfx_power_mw":     (124, "<I"),
+    "stapm_limit_mw":   (172, "<H"),
+    "gfxclk_mhz":       (174, "<H"),
+    "socclk_mhz":       (176, "<H"),
+    "fclk_mhz":         (182, "<H"),
+    "uclk_mhz":         (186, "<H"),
+}
+_UNAVAILABLE = (0xFFFF, 0xFFFFFFFF)
+
+
+class GPUTelemetry:
+    """Reads GPU clocks, activity, power and temperatures from sysfs."""
+
+    def __init__(self):
+        self._device = None
+
+    def _find_device(self):
+        if self._device and (self._device / "gpu_metrics").exists():
+            return self._device
+        self._device = None
+        for dev in sorted(_DRM_ROOT.glob("card*/device")):
+            if (dev / "gpu_metrics").exists():
+                self._device = dev
+                break
+        return self._device
+
+    @staticmethod
+    def _read_int(path):
+        try:
+            return int(path.read_text().strip())
+        except (OSError, ValueError):
+            return None
+
+    def _read_metrics(self, dev, snap):
+        try:
+            data = (dev / "gpu_metrics").read_bytes()
+        except OSError:
+            return False
+        if len(data) < 4:
+            return False
+        fmt = f"{data[2]}.{data[3]}"
+        if fmt != "3.0" or len(data) < 188:
+            return False
+        snap["source"] = f"gpu_metrics-{fmt}"
+        for key, (off, layout) in _METRICS_V3_0.items():
+            (val,) = struct.unpack_from(layout, data, off)
+            snap[key] = None if val in _UNAVAILABLE else val
+        return True
+
+    def _read_hwmon(self, dev):
+        hw = {}
+        busy = self._read_int(dev / "gpu_busy_percent")
+        if busy is not None:
+            hw["gfx_activity_pct"] = busy
+        for mon in dev.glob("hwmon/hwmon*"):
+            try:
+                if (mon / "name").read_text().strip() != "amdgpu":
+                    continue
+            except OSError:
+                continue
+            temp = self._read_int(mon / "temp1_input")
+            if temp is not None:
+                hw["temp_gfx_centi"] = temp // 10
+            power = self._read_int(mon / "power1_average")
+            if power is None:
+                power = self._read_int(mon / "power1_input")
+            if power is not None:
+                hw["socket_power_mw"] = power // 1000
+            sclk = self._read_int(mon / "freq1_input")
+            if sclk is not None:
+                hw["gfxclk_mhz"] = sclk // 1000000
+            break
+        return hw
+
+    def snapshot(self):
+        """Return a dict of telemetry values (None = not reported), or None."""
+        dev = self._find_device()
+        if dev is None:
+            return None
+        snap = {key: None for key in _METRICS_V3_0}
+        snap["source"] = None
+        has_metrics = self._read_metrics(dev, snap)
+        hw = self._read_hwmon(dev)
+        if not has_metrics and not hw:
+            return None
+        if not has_metrics:
+            snap["source"] = "hwmon"
+        for key, val in hw.items():
+            if snap.get(key) is None:
+                snap[key] = val
+
+        temp = snap.pop("temp_gfx_centi")
+        snap["temp_gfx_c"] = temp / 100 if temp is not None else None
+        temp = snap.pop("temp_soc_centi")
+        snap["temp_soc_c"] = temp / 100 if temp is not None else None
+        snap["verdict"] = self._verdict(snap)
+        return snap
+
+    @staticmethod
+    def _verdict(snap):
+        power, limit = snap.get("socket_power_mw"), snap.get("stapm_limit_mw")
+        activity = snap.get("gfx_activity_pct")
+        if power is not None and limit and power * 100 >= limit * 95:
+            return "power-limited"
+        if activity is not None:
+            return "gpu-bound" if activity >= 90 else "headroom"
+        return None
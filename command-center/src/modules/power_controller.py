@@ -1,10 +1,13 @@
 import re
+import shutil
 import subprocess
 from pathlib import Path
 
 # z13ctl valid profiles: quiet, balanced, performance, custom
 # We map our 7 tray profiles to z13ctl profiles + explicit TDP overrides.
 # tdp=None means let the firmware manage TDP for that stock profile.
+# Mirrors ENVELOPE_POWER in gz302-lib/envelope-manager.sh; only used directly
+# when gz302-envelope (power + refresh + frame cap in one step) is missing.
 POWER_PROFILES = {
     "emergency":   {"z13ctl_profile": "quiet",       "tdp": 10},
     "battery":     {"z13ctl_profile": "quiet",       "tdp": 18},
@@ -174,7 +177,42 @@ class PowerController:
         tdp = spec.get("tdp") or 40
         return tdp, tdp, tdp
 
+    def _apply_envelope(self, profile):
+        """Apply the profile's whole performance envelope (rolled back on failure)."""
+        try:
+            return subprocess.run(
+                ["gz302-envelope", "apply", profile],
+                capture_output=True,
+                text=True,
+                timeout=60,
+            )
+        except Exception:
+            return None
+
+    def _save_profile(self, profile):
+        self.current_profile = profile
+        # Persist tray-level profile name (survives restarts)
+        try:
+            _PROFILE_CACHE_FILE.parent.mkdir(parents=True, exist_ok=True)
+            _PROFILE_CACHE_FILE.write_text(profile + '\n')
+        except Exception:
+            pass
+
     def set_profile(self, profile):
+        if profile in POWER_PROFILES and shutil.which("gz302-envelope"):
+            result = self._apply_envelope(profile)
+            if result and result.returncode == 0:
+                # One line per applied step, without the "Applying envelope" header
+                steps = [line.strip() for line in result.stdout.splitlines()[1:]]
+                self.notifier.notify_profile_change(profile, "\n".join(steps))
+                self._save_profile(profile)
+                return True
+            if result is None:
+                detail = "Unable to execute gz302-envelope"
+            else:
+                detail = result.stderr.strip() or result.stdout.strip() or "Unknown error"
+            self.notifier.notify_error("Profile Change Failed", detail)
+            return False
         try:
             spec = POWER_PROFILES.get(profile)
             if spec:
@@ -187,13 +225,7 @@ class PowerController:
             result = self._run_z13ctl(["z13ctl", "profile", "--set", z13_profile], timeout=30)
             if result and result.returncode == 0:
                 self.notifier.notify_profile_change(profile, result.stdout.strip())
-                self.current_profile = profile
-                # Persist tray-level profile name (survives restarts)
-                try:
-                    _PROFILE_CACHE_FILE.parent.mkdir(parents=True, exist_ok=True)
-                    _PROFILE_CACHE_FILE.write_text(profile + '\n')
-                except Exception:
-                    pass
+                self._save_profile(profile)
                 # Apply TDP override if specified (TDP requires elevated privileges)
                 if spec and spec.get("tdp"):
                     tdp_val = spec["tdp"]
@@ -4,7 +4,7 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 Audio Manager Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library manages audio configuration for the GZ302, including:
 # - Sound Open Firmware (SOF) installation
@@ -210,6 +210,18 @@ EOF
 
 # --- SOF Firmware Installation (Distribution-Specific) ---
 
+# SOF firmware and UCM packages for a distribution
+# Args: $1 = distribution (arch, ubuntu, fedora, opensuse)
+# Output: Package names (empty for unsupported distributions)
+audio_packages() {
+    case "$1" in
+        arch) echo "sof-firmware alsa-ucm-conf" ;;
+        debian|ubuntu) echo "sof-firmware alsa-ucm-conf" ;;
+        fedora) echo "sof-firmware alsa-sof-firmware alsa-ucm" ;;
+        opensuse) echo "sof-firmware alsa-ucm-conf" ;;
+    esac
+}
+
 # Install SOF firmware for given distribution
 # Args: $1 = distribution (arch, ubuntu, fedora, opensuse)
 # Returns: 0 on success, 1 on failure
@@ -227,55 +239,45 @@ audio_install_sof_firmware() {
         echo "SOF firmware and UCM already installed"
         return 0
     fi
+
+    # Installed by gz302-setup.sh's batched package transaction
+    if declare -f pkg_plan_has >/dev/null 2>&1 && pkg_plan_has audio; then
+        echo "SOF firmware installed by the package plan"
+        return 0
+    fi
+
+    local -a packages
+    read -ra packages <<< "$(audio_packages "$distro")"
+    if [[ ${#packages[@]} -eq 0 ]]; then
+        echo "ERROR: Unsupported distribution: $distro"
+        return 1
+    fi
     
     echo "Installing Sound Open Firmware (SOF) for GZ302EA audio..."
     
+    local status=0
     case "$distro" in
         arch)
             # Install SOF firmware from official Arch repos
-            if pacman -S --noconfirm --needed sof-firmware alsa-ucm-conf 2>/dev/null; then
-                echo "SOF firmware installed from official repositories"
-                return 0
-            else
-                echo "WARNING: SOF firmware installation failed - audio may not work optimally"
-                return 1
-            fi
+            pacman -S --noconfirm --needed "${packages[@]}" 2>/dev/null || status=$?
             ;;
         debian|ubuntu)
-            # Install SOF firmware from Ubuntu repos
-            if apt-get install -y sof-firmware alsa-ucm-conf 2>/dev/null; then
-                echo "SOF firmware installed"
-                return 0
-            else
-                echo "WARNING: SOF firmware installation failed - audio may not work optimally"
-                return 1
-            fi
+            apt-get install -y "${packages[@]}" 2>/dev/null || status=$?
             ;;
         fedora)
-            # Install SOF firmware from Fedora repos
-            if dnf install -y sof-firmware alsa-sof-firmware alsa-ucm 2>/dev/null; then
-                echo "SOF firmware installed"
-                return 0
-            else
-                echo "WARNING: SOF firmware installation failed - audio may not work optimally"
-                return 1
-            fi
+            dnf install -y "${packages[@]}" 2>/dev/null || status=$?
             ;;
         opensuse)
-            # Install SOF firmware from OpenSUSE repos
-            if zypper install -y sof-firmware alsa-ucm-conf 2>/dev/null; then
-                echo "SOF firmware installed"
-                return 0
-            else
-                echo "WARNING: SOF firmware installation failed - audio may not work optimally"
-                return 1
-            fi
-            ;;
-        *)
-            echo "ERROR: Unsupported distribution: $distro"
-            return 1
+            zypper install -y "${packages[@]}" 2>/dev/null || status=$?
             ;;
     esac
+
+    if [[ $status -ne 0 ]]; then
+        echo "WARNING: SOF firmware installation failed - audio may not work optimally"
+        return 1
+    fi
+    echo "SOF firmware installed"
+    return 0
 }
 
 # --- Configuration Application (Idempotent) ---
@@ -295,6 +297,7 @@ audio_apply_cs35l41_config() {
     fi
     
     # Apply configuration
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/modprobe.d/cs35l41.conf audio
     cat > /etc/modprobe.d/cs35l41.conf <<'EOF'
 # Cirrus Logic CS35L41 amplifiers - ASUS ROG Flow Z13 GZ302
 # Subsystem ID: 1043:1fb3
@@ -338,8 +341,8 @@ audio_apply_configuration() {
     
     # Check kernel version for CS35L41 native support
     local kver=0
-    if declare -f kernel_get_version_num >/dev/null; then
-        kver=$(kernel_get_version_num)
+    if declare -f kernel_caps_init >/dev/null && kernel_caps_init; then
+        kver="${KERNEL_CAPS[version_num]}"
     fi
 
     if [[ $kver -ge 619 ]]; then
@@ -461,7 +464,7 @@ audio_print_status() {
 # --- Library Information ---
 
 audio_lib_version() {
-    echo "3.0.0"
+    echo "3.1.0"
 }
 
 audio_lib_help() {
@@ -480,6 +483,7 @@ Firmware Functions:
   audio_sof_firmware_installed  - Check if SOF firmware installed
   audio_ucm_installed           - Check if ALSA UCM installed
   audio_install_sof_firmware <distro> - Install SOF firmware
+  audio_packages <distro>       - SOF/UCM package names (for the package plan)
 
 State Check Functions:
   audio_cs35l41_config_applied  - Check if CS35L41 config applied
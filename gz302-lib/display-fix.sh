@@ -4,7 +4,7 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 Display Fix Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library provides display-specific fixes for OLED panels on GZ302.
 # Focuses on all eDP power-saving features that can cause display artifacts.
@@ -32,6 +32,14 @@ set -euo pipefail
 #   display_apply_psr_su_fix
 # ==============================================================================
 
+# --- Kernel Capability Table ---
+# Kernel checks come from kernel-compat.sh; load it when this library is
+# sourced on its own.
+if ! declare -f kernel_caps_init >/dev/null 2>&1; then
+    # shellcheck source=gz302-lib/kernel-compat.sh
+    source "$(dirname "${BASH_SOURCE[0]}")/kernel-compat.sh"
+fi
+
 display_merge_dcdebugmask_file() {
     local file="$1"
     local current
@@ -190,6 +198,21 @@ display_regenerate_boot_artifacts() {
 # Returns: 0 on success
 display_apply_psr_su_fix() {
     info "Applying PSR-SU disable fix for OLED panel scrolling artifacts..."
+
+    local dcdebugmask_cap=0
+    kernel_cap amdgpu_dcdebugmask || dcdebugmask_cap=$?
+    if [[ $dcdebugmask_cap -eq 1 ]]; then
+        warning "amdgpu does not list a dcdebugmask parameter on this kernel; the boot parameter may be ignored"
+    fi
+
+    # Record every bootloader file this fix may touch before editing any
+    local boot_file
+    for boot_file in /etc/default/grub /etc/kernel/cmdline /boot/loader/entries/*.conf \
+                     /etc/limine/limine.conf /boot/limine/limine.conf /boot/limine.cfg \
+                     /boot/refind_linux.conf /boot/EFI/refind/refind.conf \
+                     /boot/efi/EFI/refind/refind.conf /efi/EFI/refind/refind.conf; do
+        [[ -f "$boot_file" ]] && backup_config_file "$boot_file" display
+    done
     
     # Add to GRUB if present
     if [[ -f /etc/default/grub ]]; then
@@ -242,7 +265,7 @@ display_apply_psr_su_fix() {
 
         if [[ "$cmdline_updated" == "true" ]]; then
             info "Regenerating boot artifacts for updated systemd-boot cmdline..."
-            if display_regenerate_boot_artifacts; then
+            if trace_span "display_regenerate_boot_artifacts" boot display_regenerate_boot_artifacts; then
                 success "Boot artifacts regenerated"
             fi
         fi
@@ -315,7 +338,7 @@ display_apply_psr_su_fix() {
     done
     
     # Apply runtime fix (if possible)
-    if [[ -d /sys/kernel/debug/dri ]]; then
+    if kernel_cap amdgpu_runtime_debug_mask; then
         for dri_dir in /sys/kernel/debug/dri/*/; do
             if [[ -d "$dri_dir" ]]; then
                 local debug_mask="${dri_dir}amdgpu_dm_debug_mask"
@@ -349,14 +372,7 @@ display_verify_psr_su_fix() {
     fi
     
     # Check kernel version
-    local kver
-    kver=$(uname -r | cut -d. -f1,2)
-    local major minor
-    major=$(echo "$kver" | cut -d. -f1)
-    minor=$(echo "$kver" | cut -d. -f2)
-    local version_num=$((major * 100 + minor))
-    
-    if [[ $version_num -ge 612 ]]; then
+    if kernel_has_psr_su_fixes; then
         echo "  ✓ Kernel 6.12+ has native PSR-SU disable on eDP panels"
     else
         echo "  ⚠️  Kernel < 6.12 - manual PSR-SU disable recommended"
@@ -366,6 +382,64 @@ display_verify_psr_su_fix() {
     return $status
 }
 
+# --- Runtime Debug Mask ---
+# Some kernels expose the amdgpu display debug mask in debugfs (root only, see
+# kernel_cap amdgpu_runtime_debug_mask). A new value takes effect the next
+# time the panel is modeset, not immediately.
+
+# Read the display debug mask the running kernel was booted with
+# Output: mask in hex (0x0 if amdgpu.dcdebugmask is not set)
+display_get_boot_debug_mask() {
+    local token mask=0
+    local -a cmdline=()
+    read -ra cmdline 2>/dev/null < /proc/cmdline || true
+    for token in "${cmdline[@]}"; do
+        [[ "$token" =~ ^amdgpu\.dcdebugmask=(0x[0-9A-Fa-f]+|[0-9]+)$ ]] && mask="${BASH_REMATCH[1]}"
+    done
+    printf '0x%x\n' "$((mask))"
+}
+
+# Read the runtime display debug mask (first GPU that exposes one)
+# Output: mask in hex, nothing if unavailable
+display_get_runtime_debug_mask() {
+    local node value
+    for node in /sys/kernel/debug/dri/*/amdgpu_dm_debug_mask; do
+        [[ -r "$node" ]] || continue
+        read -r value 2>/dev/null < "$node" || continue
+        [[ "$value" =~ ^(0x[0-9A-Fa-f]+|[0-9]+)$ ]] || continue
+        printf '0x%x\n' "$((value))"
+        return 0
+    done
+}
+
+# Set the runtime display debug mask on every GPU that exposes one
+# Args: $1 = mask (hex or decimal)
+# Returns: 0 if at least one node was written, 1 otherwise
+display_set_runtime_debug_mask() {
+    local mask node written=1
+    printf -v mask '0x%x' "$(($1))"
+    for node in /sys/kernel/debug/dri/*/amdgpu_dm_debug_mask; do
+        [[ -w "$node" ]] || continue
+        if echo "$mask" > "$node" 2>/dev/null; then
+            written=0
+        fi
+    done
+    return $written
+}
+
+# Read the internal panel's PSR state from debugfs
+# Output: state as reported by amdgpu (0 = PSR inactive), or "unknown"
+display_get_psr_state() {
+    local node value
+    for node in /sys/kernel/debug/dri/*/eDP-*/psr_state; do
+        [[ -r "$node" ]] || continue
+        read -r value 2>/dev/null < "$node" || continue
+        echo "$value"
+        return 0
+    done
+    echo "unknown"
+}
+
 # --- Status Functions ---
 
 # Print PSR-SU status
@@ -408,6 +482,9 @@ display_print_psr_su_status() {
     echo "  amdgpu.dcdebugmask=0xe12 (disables PSR/PSR-SU/Replay/IPS/stutter)"
     echo "  amdgpu.sg_display=0 (disables scatter-gather display for APU)"
     echo ""
+    echo "Power cost on this kernel:"
+    echo "  scripts/benchmark/gz302-panel-power.sh (A/B, battery power_now)"
+    echo ""
     echo "To apply fix:"
     echo "  source gz302-lib/display-fix.sh"
     echo "  display_apply_psr_su_fix"
@@ -417,12 +494,12 @@ display_print_psr_su_status() {
 # --- Library Information ---
 
 display_fix_lib_version() {
-    echo "6.2.1"
+    echo "6.3.0"
 }
 
 display_fix_lib_help() {
     cat <<'HELP'
-GZ302 Display Fix Library v6.2.1
+GZ302 Display Fix Library v6.3.0
 
 PSR/Replay/IPS Detection Functions:
   display_psr_su_enabled        - Check if display fix bits are set
@@ -431,6 +508,12 @@ PSR/Replay/IPS Detection Functions:
 Fix Application Functions:
   display_apply_psr_su_fix      - Apply display fix (idempotent, all bootloaders)
 
+Runtime Debug Mask Functions:
+  display_get_boot_debug_mask   - dcdebugmask the kernel was booted with
+  display_get_runtime_debug_mask - Current debugfs display debug mask
+  display_set_runtime_debug_mask - Set the debugfs mask (next modeset)
+  display_get_psr_state         - eDP PSR state from debugfs
+
 Verification Functions:
   display_verify_psr_su_fix     - Verify fix is working
 
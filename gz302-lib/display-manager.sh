@@ -4,7 +4,7 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 Display Manager Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library provides refresh rate management and display control for the
 # ASUS ROG Flow Z13 (GZ302) with its 180Hz display.
@@ -13,6 +13,7 @@ set -euo pipefail
 # - Detection functions (read-only, no system changes)
 # - Configuration functions (idempotent, check before apply)
 # - VRR (Variable Refresh Rate) control
+# - Adaptive refresh daemon (idle/activity driven rate switching)
 # - Status functions (display current state)
 #
 # Supported Environments:
@@ -32,6 +33,7 @@ declare -gA DISPLAY_REFRESH_PROFILES
 DISPLAY_REFRESH_PROFILES[emergency]="30"         # Emergency battery extension
 DISPLAY_REFRESH_PROFILES[battery]="30"           # Maximum battery life
 DISPLAY_REFRESH_PROFILES[efficient]="60"         # Efficient with good performance
+DISPLAY_REFRESH_PROFILES[quiet]="60"             # Low fan noise
 DISPLAY_REFRESH_PROFILES[balanced]="90"          # Balanced performance/power
 DISPLAY_REFRESH_PROFILES[performance]="120"      # High performance applications
 DISPLAY_REFRESH_PROFILES[gaming]="180"           # Gaming optimized
@@ -42,6 +44,7 @@ declare -gA DISPLAY_FRAME_LIMITS
 DISPLAY_FRAME_LIMITS[emergency]="30"             # Cap at 30fps
 DISPLAY_FRAME_LIMITS[battery]="30"               # Cap at 30fps
 DISPLAY_FRAME_LIMITS[efficient]="60"             # Cap at 60fps
+DISPLAY_FRAME_LIMITS[quiet]="60"                 # Cap at 60fps
 DISPLAY_FRAME_LIMITS[balanced]="90"              # Cap at 90fps
 DISPLAY_FRAME_LIMITS[performance]="120"          # Cap at 120fps
 DISPLAY_FRAME_LIMITS[gaming]="0"                 # No frame limiting
@@ -53,19 +56,22 @@ declare -gA DISPLAY_VRR_MAX
 DISPLAY_VRR_MIN[emergency]="20";  DISPLAY_VRR_MAX[emergency]="30"
 DISPLAY_VRR_MIN[battery]="20";    DISPLAY_VRR_MAX[battery]="30"
 DISPLAY_VRR_MIN[efficient]="30";  DISPLAY_VRR_MAX[efficient]="60"
+DISPLAY_VRR_MIN[quiet]="30";      DISPLAY_VRR_MAX[quiet]="60"
 DISPLAY_VRR_MIN[balanced]="30";   DISPLAY_VRR_MAX[balanced]="90"
 DISPLAY_VRR_MIN[performance]="48"; DISPLAY_VRR_MAX[performance]="120"
 DISPLAY_VRR_MIN[gaming]="48";     DISPLAY_VRR_MAX[gaming]="180"
 DISPLAY_VRR_MIN[maximum]="48";    DISPLAY_VRR_MAX[maximum]="180"
 
 # Profile order for iteration
-DISPLAY_PROFILE_ORDER="emergency battery efficient balanced performance gaming maximum"
+DISPLAY_PROFILE_ORDER="emergency battery efficient quiet balanced performance gaming maximum"
 
 # Configuration paths
 DISPLAY_CONFIG_DIR="/etc/gz302/rrcfg"
 DISPLAY_CURRENT_PROFILE_FILE="$DISPLAY_CONFIG_DIR/current-profile"
 DISPLAY_VRR_ENABLED_FILE="$DISPLAY_CONFIG_DIR/vrr-enabled"
 DISPLAY_VRR_RANGES_FILE="$DISPLAY_CONFIG_DIR/vrr-ranges"
+# Last performance envelope applied by this user (envelope-manager.sh)
+DISPLAY_ENVELOPE_STATE_FILE="${XDG_CONFIG_HOME:-${HOME:-/root}/.config}/gz302/envelope.state"
 
 # GZ302 built-in display info
 GZ302_INTERNAL_DISPLAY="eDP-1"
@@ -105,21 +111,226 @@ display_has_kscreen() {
     command -v kscreen-doctor >/dev/null 2>&1
 }
 
+# --- Backend Cache ---
+# The tool that controls this session's outputs and each output's mode list
+# are detected once per session and kept in XDG_RUNTIME_DIR, so a profile
+# change costs a single backend call instead of probing every tool per
+# output. The cache is keyed on the session (type, WAYLAND_DISPLAY, DISPLAY,
+# desktop) and on the connected DRM connectors, so a hotplug or a new
+# session re-detects. Without XDG_RUNTIME_DIR (sudo rrcfg, the main path)
+# it goes to /run/gz302; where that is not writable either, the cache lives
+# only as long as the calling process.
+DISPLAY_CACHE_FILE="${XDG_RUNTIME_DIR:+${XDG_RUNTIME_DIR}/gz302-display.cache}"
+DISPLAY_CACHE_FILE="${DISPLAY_CACHE_FILE:-/run/gz302/display.cache}"
+DISPLAY_BACKEND=""
+DISPLAY_BACKEND_KEY=""
+DISPLAY_SESSION_KEY=""
+DISPLAY_OUTPUT_ORDER=""
+declare -gA DISPLAY_OUTPUT_RES=()      # output -> preferred resolution
+declare -gA DISPLAY_OUTPUT_MODES=()    # output -> "WxH@rate ..."
+declare -gA DISPLAY_OUTPUT_RATE=()     # output -> current rate
+
+# Build the cache key for the current session and connected outputs
+# Sets: DISPLAY_SESSION_KEY
+display_session_key() {
+    local conn status connected=""
+    for conn in /sys/class/drm/card*-*; do
+        [[ -r "$conn/status" ]] || continue
+        read -r status < "$conn/status"
+        [[ "$status" == "connected" ]] && connected+="${conn##*/card[0-9]-},"
+    done
+    DISPLAY_SESSION_KEY="${XDG_SESSION_TYPE:-}|${WAYLAND_DISPLAY:-}|${DISPLAY:-}|${XDG_CURRENT_DESKTOP:-}|${connected}"
+}
+
+# Forget the detected backend and modes (memory and session cache)
+display_cache_invalidate() {
+    DISPLAY_BACKEND=""
+    DISPLAY_BACKEND_KEY=""
+    [[ -n "$DISPLAY_CACHE_FILE" ]] && rm -f "$DISPLAY_CACHE_FILE"
+    return 0
+}
+
+# Parse a backend's output listing into the output/mode tables
+# Args: $1 = backend, $2 = listing (xrandr, wlr-randr or kscreen-doctor -o)
+display_parse_listing() {
+    local backend="$1"
+    local line out="" res rate word flags
+    local -a words disconnected=()
+    DISPLAY_OUTPUT_ORDER=""
+    DISPLAY_OUTPUT_RES=()
+    DISPLAY_OUTPUT_MODES=()
+    DISPLAY_OUTPUT_RATE=()
+
+    while IFS= read -r line; do
+        case "$backend" in
+            xrandr)
+                # "eDP-1 connected ..." then "   2560x1600  180.00*+ 120.00 ..."
+                if [[ "$line" =~ ^([^[:space:]]+)\ connected ]]; then
+                    out="${BASH_REMATCH[1]}"
+                    DISPLAY_OUTPUT_ORDER+="${DISPLAY_OUTPUT_ORDER:+ }$out"
+                elif [[ "$line" =~ ^[^[:space:]] ]]; then
+                    out=""
+                elif [[ -n "$out" && "$line" =~ ^[[:space:]]+([0-9]+x[0-9]+)[^[:space:]]*[[:space:]]+(.*)$ ]]; then
+                    res="${BASH_REMATCH[1]}"
+                    [[ -n "${DISPLAY_OUTPUT_RES[$out]:-}" ]] || DISPLAY_OUTPUT_RES[$out]="$res"
+                    read -ra words <<< "${BASH_REMATCH[2]}"
+                    for word in "${words[@]}"; do
+                        rate="${word%%.*}"
+                        [[ "$rate" =~ ^[0-9]+$ ]] || continue
+                        DISPLAY_OUTPUT_MODES[$out]+="${res}@${rate} "
+                        [[ "$word" == *"*"* ]] && DISPLAY_OUTPUT_RATE[$out]="$rate"
+                    done
+                fi
+                ;;
+            wlr-randr)
+                # 'eDP-1 "Panel"' then "    2560x1600 px, 180.000000 Hz (preferred, current)"
+                if [[ "$line" =~ ^([^[:space:]]+)\  ]]; then
+                    out="${BASH_REMATCH[1]}"
+                    DISPLAY_OUTPUT_ORDER+="${DISPLAY_OUTPUT_ORDER:+ }$out"
+                elif [[ -n "$out" && "$line" =~ ^[[:space:]]+([0-9]+x[0-9]+)\ px,\ ([0-9]+)[^[:space:]]*\ Hz(.*)$ ]]; then
+                    res="${BASH_REMATCH[1]}"
+                    rate="${BASH_REMATCH[2]}"
+                    flags="${BASH_REMATCH[3]}"
+                    DISPLAY_OUTPUT_MODES[$out]+="${res}@${rate} "
+                    if [[ "$flags" == *preferred* || -z "${DISPLAY_OUTPUT_RES[$out]:-}" ]]; then
+                        DISPLAY_OUTPUT_RES[$out]="$res"
+                    fi
+                    [[ "$flags" == *current* ]] && DISPLAY_OUTPUT_RATE[$out]="$rate"
+                fi
+                ;;
+            kscreen-doctor)
+                # "Output: 1 eDP-1 ..." and mode words "0:2560x1600@180*!"
+                # (* = current, ! = preferred); colour codes are stripped
+                while [[ "$line" =~ $'\e'\[[0-9\;]*m ]]; do
+                    line="${line/"${BASH_REMATCH[0]}"/}"
+                done
+                if [[ "$line" =~ ^Output:\ [0-9]+\ ([^[:space:]]+) ]]; then
+                    out="${BASH_REMATCH[1]}"
+                    DISPLAY_OUTPUT_ORDER+="${DISPLAY_OUTPUT_ORDER:+ }$out"
+                fi
+                [[ -n "$out" ]] || continue
+                read -ra words <<< "$line"
+                for word in "${words[@]}"; do
+                    if [[ "$word" == "disconnected" ]]; then
+                        disconnected+=("$out")
+                    elif [[ "$word" =~ ^[0-9]+:([0-9]+x[0-9]+)@([0-9]+)\.?([0-9]?)[0-9]*([*!]*)$ ]]; then
+                        # kscreen names modes by the rounded rate (59.95 -> 60)
+                        res="${BASH_REMATCH[1]}"
+                        rate="${BASH_REMATCH[2]}"
+                        [[ "${BASH_REMATCH[3]:-0}" -ge 5 ]] && rate=$(( rate + 1 ))
+                        flags="${BASH_REMATCH[4]}"
+                        DISPLAY_OUTPUT_MODES[$out]+="${res}@${rate} "
+                        if [[ "$flags" == *"!"* || -z "${DISPLAY_OUTPUT_RES[$out]:-}" ]]; then
+                            DISPLAY_OUTPUT_RES[$out]="$res"
+                        fi
+                        [[ "$flags" == *"*"* ]] && DISPLAY_OUTPUT_RATE[$out]="$rate"
+                    fi
+                done
+                ;;
+        esac
+    done <<< "$2"
+
+    for out in "${disconnected[@]}"; do
+        DISPLAY_OUTPUT_ORDER=" $DISPLAY_OUTPUT_ORDER "
+        DISPLAY_OUTPUT_ORDER="${DISPLAY_OUTPUT_ORDER/ $out / }"
+        DISPLAY_OUTPUT_ORDER="${DISPLAY_OUTPUT_ORDER# }"
+        DISPLAY_OUTPUT_ORDER="${DISPLAY_OUTPUT_ORDER% }"
+    done
+    return 0
+}
+
+# Run the backend's output listing
+# Args: $1 = backend
+# Output: Listing text
+# Returns: 1 if the tool failed or printed nothing
+display_backend_listing() {
+    local listing=""
+    case "$1" in
+        xrandr) listing=$(xrandr 2>/dev/null) || return 1 ;;
+        wlr-randr) listing=$(wlr-randr 2>/dev/null) || return 1 ;;
+        kscreen-doctor) listing=$(kscreen-doctor -o 2>/dev/null) || return 1 ;;
+        *) return 1 ;;
+    esac
+    [[ -n "$listing" ]] || return 1
+    echo "$listing"
+}
+
+# Restore the backend and modes from the session cache
+# Returns: 1 if there is no cache for the current key
+display_cache_load() {
+    [[ -n "$DISPLAY_CACHE_FILE" && -r "$DISPLAY_CACHE_FILE" ]] || return 1
+    local line out res modes backend=""
+    {
+        IFS= read -r line || return 1
+        [[ "$line" == "key=${DISPLAY_SESSION_KEY}" ]] || return 1
+        IFS= read -r line || return 1
+        backend="${line#backend=}"
+        DISPLAY_OUTPUT_ORDER=""
+        DISPLAY_OUTPUT_RES=()
+        DISPLAY_OUTPUT_MODES=()
+        DISPLAY_OUTPUT_RATE=()
+        while read -r out res modes; do
+            [[ -n "$out" ]] || continue
+            DISPLAY_OUTPUT_ORDER+="${DISPLAY_OUTPUT_ORDER:+ }$out"
+            # "-" stands for an unknown resolution (GZ302_RESOLUTION applies)
+            [[ "$res" == "-" ]] && res=""
+            DISPLAY_OUTPUT_RES[$out]="$res"
+            DISPLAY_OUTPUT_MODES[$out]="$modes "
+        done
+    } < "$DISPLAY_CACHE_FILE"
+    DISPLAY_BACKEND="$backend"
+    DISPLAY_BACKEND_KEY="$DISPLAY_SESSION_KEY"
+}
+
+# Write the backend and modes to the session cache
+display_cache_save() {
+    [[ -n "$DISPLAY_CACHE_FILE" ]] || return 0
+    [[ -d "${DISPLAY_CACHE_FILE%/*}" ]] || mkdir -p "${DISPLAY_CACHE_FILE%/*}" 2>/dev/null || return 0
+    local out
+    {
+        echo "key=${DISPLAY_SESSION_KEY}"
+        echo "backend=${DISPLAY_BACKEND}"
+        for out in $DISPLAY_OUTPUT_ORDER; do
+            echo "$out ${DISPLAY_OUTPUT_RES[$out]:--} ${DISPLAY_OUTPUT_MODES[$out]:-}"
+        done
+    } > "$DISPLAY_CACHE_FILE" 2>/dev/null || true
+}
+
+# Work out which tool controls this session's outputs (once per session).
+# Native Wayland tools win over xrandr, which only reaches XWayland there.
+# Sets: DISPLAY_BACKEND (xrandr, wlr-randr, kscreen-doctor or "none") and
+#       the output/mode tables
+display_detect_backend() {
+    display_session_key
+    [[ -n "$DISPLAY_BACKEND" && "$DISPLAY_BACKEND_KEY" == "$DISPLAY_SESSION_KEY" ]] && return 0
+    display_cache_load && return 0
+
+    local candidates="" backend listing
+    if display_is_wayland; then
+        display_has_wlr_randr && candidates+=" wlr-randr"
+        display_has_kscreen && candidates+=" kscreen-doctor"
+    fi
+    display_is_x11 && candidates+=" xrandr"
+
+    DISPLAY_BACKEND="none"
+    DISPLAY_OUTPUT_ORDER=""
+    for backend in $candidates; do
+        if listing=$(display_backend_listing "$backend"); then
+            DISPLAY_BACKEND="$backend"
+            display_parse_listing "$backend" "$listing"
+            break
+        fi
+    done
+    DISPLAY_BACKEND_KEY="$DISPLAY_SESSION_KEY"
+    display_cache_save
+}
+
 # Detect connected displays
 # Returns: Space-separated list of display names
 display_detect_outputs() {
+    display_detect_backend
     local displays=()
-    
-    if display_is_x11; then
-        # X11 environment
-        mapfile -t displays < <(xrandr --listmonitors 2>/dev/null | grep -E "^ [0-9]:" | awk '{print $4}' | cut -d'/' -f1)
-    elif display_has_wlr_randr; then
-        # Wayland with wlr-randr
-        mapfile -t displays < <(wlr-randr 2>/dev/null | grep -E "^[A-Za-z]" | awk '{print $1}')
-    elif display_has_kscreen; then
-        # KDE Plasma on Wayland
-        mapfile -t displays < <(kscreen-doctor -o 2>/dev/null | grep -E "^Output:" | awk '{print $2}' | cut -d: -f1)
-    fi
+    read -ra displays <<< "$DISPLAY_OUTPUT_ORDER"
     
     # Fallback to DRM
     if [[ ${#displays[@]} -eq 0 && -d /sys/class/drm ]]; then
@@ -149,58 +360,51 @@ display_get_primary() {
     done
     
     # Return first display
-    echo "$displays" | awk '{print $1}'
+    echo "${displays%% *}"
 }
 
 # --- Refresh Rate Detection ---
 
-# Get current refresh rate for a display
+# Get current refresh rate for a display (one live backend query)
 # Args: $1 = display (optional, defaults to primary)
 # Returns: Refresh rate in Hz
 display_get_current_refresh() {
+    display_detect_backend
     local display="${1:-$(display_get_primary)}"
-    local rate=""
+    local listing
     
-    if display_is_x11; then
-        # X11: Parse current mode from xrandr
-        rate=$(xrandr 2>/dev/null | grep -A20 "^${display}" | grep -E "^\s+" | grep "\*" | head -1 | grep -oP '\d+\.\d+(?=\*?)' | cut -d. -f1)
-    elif display_has_wlr_randr; then
-        # Wayland with wlr-randr
-        rate=$(wlr-randr 2>/dev/null | grep -A5 "^${display}" | grep -oP '\d+(?=\.\d+ Hz)' | head -1)
-    elif display_has_kscreen; then
-        # KDE Plasma
-        rate=$(kscreen-doctor -o 2>/dev/null | grep -A5 "$display" | grep "Refresh:" | grep -oP '\d+(?=Hz)')
+    if listing=$(display_backend_listing "$DISPLAY_BACKEND"); then
+        # Mode lists are re-parsed too; refresh the cache if they changed
+        local before="${DISPLAY_OUTPUT_MODES[$display]:-}"
+        display_parse_listing "$DISPLAY_BACKEND" "$listing"
+        [[ "${DISPLAY_OUTPUT_MODES[$display]:-}" == "$before" ]] || display_cache_save
     fi
     
     # Fallback
-    if [[ -z "$rate" ]]; then
-        rate="60"
-    fi
-    
-    echo "$rate"
+    echo "${DISPLAY_OUTPUT_RATE[$display]:-60}"
 }
 
-# Get supported refresh rates for a display
+# Get supported refresh rates for a display at its preferred resolution
 # Args: $1 = display (optional)
 # Returns: Newline-separated list of rates
 display_get_supported_rates() {
+    display_detect_backend
     local display="${1:-$(display_get_primary)}"
-    local rates=""
+    local res="${DISPLAY_OUTPUT_RES[$display]:-$GZ302_RESOLUTION}"
+    local -a rates=()
+    local mode
     
-    if display_is_x11; then
-        # X11: Extract all refresh rates from current resolution mode
-        rates=$(xrandr 2>/dev/null | grep -A20 "^${display}" | grep -E "^\s+${GZ302_RESOLUTION}" | grep -oP '\d+\.\d+' | cut -d. -f1 | sort -nu)
-    elif display_has_wlr_randr; then
-        rates=$(wlr-randr 2>/dev/null | grep -A30 "^${display}" | grep -oP '\d+(?=\.\d+ Hz)' | sort -nu)
-    fi
+    for mode in ${DISPLAY_OUTPUT_MODES[$display]:-}; do
+        [[ "${mode%@*}" == "$res" ]] && rates+=("${mode#*@}")
+    done
     
     # Fallback: Common GZ302 rates
-    if [[ -z "$rates" ]]; then
+    if [[ ${#rates[@]} -eq 0 ]]; then
         printf '%s\n' 30 48 60 90 120 180
         return
     fi
     
-    echo "$rates"
+    printf '%s\n' "${rates[@]}" | sort -nu
 }
 
 # --- VRR (Variable Refresh Rate) ---
@@ -317,35 +521,64 @@ display_set_rate_xrandr() {
 }
 
 # Set refresh rate using wlr-randr (wlroots Wayland)
-# Args: $1 = display, $2 = rate
+# Args: $1 = display, $2 = rate, $3 = resolution (optional)
 # Returns: 0 on success, 1 on failure
 display_set_rate_wlr() {
     local display="$1"
     local rate="$2"
+    local res="${3:-$GZ302_RESOLUTION}"
     
     # wlr-randr requires full mode spec, try different formats
-    if wlr-randr --output "$display" --custom-mode "${GZ302_RESOLUTION}@${rate}Hz" 2>/dev/null; then
+    if wlr-randr --output "$display" --mode "${res}@${rate}Hz" 2>/dev/null; then
         return 0
     fi
-    if wlr-randr --output "$display" --mode "${GZ302_RESOLUTION}@${rate}Hz" 2>/dev/null; then
+    if wlr-randr --output "$display" --custom-mode "${res}@${rate}Hz" 2>/dev/null; then
         return 0
     fi
     return 1
 }
 
 # Set refresh rate using kscreen-doctor (KDE Wayland)
-# Args: $1 = display, $2 = rate  
+# Args: $1 = display, $2 = rate, $3 = resolution (optional)
 # Returns: 0 on success, 1 on failure
 display_set_rate_kscreen() {
     local display="$1"
     local rate="$2"
+    local res="${3:-$GZ302_RESOLUTION}"
     
-    if kscreen-doctor "output.${display}.mode.${GZ302_RESOLUTION}@${rate}" 2>/dev/null; then
+    if kscreen-doctor "output.${display}.mode.${res}@${rate}" 2>/dev/null; then
         return 0
     fi
     return 1
 }
 
+# Set the refresh rate of one display with the session's backend
+# A failure re-detects the backend once in case the cache went stale.
+# Runs in the caller's shell (no output) so the cache stays in memory;
+# DISPLAY_BACKEND names the tool that set the rate.
+# Args: $1 = display, $2 = rate
+# Returns: 0 on success, 1 if the rate could not be set
+display_set_rate() {
+    local display="$1"
+    local rate="$2"
+    local attempt res
+    
+    for attempt in cached fresh; do
+        [[ "$attempt" == "fresh" ]] && display_cache_invalidate
+        display_detect_backend
+        res="${DISPLAY_OUTPUT_RES[$display]:-$GZ302_RESOLUTION}"
+        case "$DISPLAY_BACKEND" in
+            xrandr) display_set_rate_xrandr "$display" "$rate" ;;
+            wlr-randr) display_set_rate_wlr "$display" "$rate" "$res" ;;
+            kscreen-doctor) display_set_rate_kscreen "$display" "$rate" "$res" ;;
+            *) false ;;
+        esac || continue
+        DISPLAY_OUTPUT_RATE[$display]="$rate"
+        return 0
+    done
+    return 1
+}
+
 # Apply a display profile (sets refresh rate)
 # Args: $1 = profile name
 # Returns: 0 on success, 1 on failure
@@ -359,6 +592,7 @@ display_apply_profile() {
     
     local target_rate="${DISPLAY_REFRESH_PROFILES[$profile]}"
     local displays
+    display_detect_backend
     displays=$(display_detect_outputs)
     
     echo "Setting refresh rate profile: $profile (${target_rate}Hz)"
@@ -369,34 +603,12 @@ display_apply_profile() {
     for display in $displays; do
         echo "Configuring display: $display"
         
-        # Try X11 first
-        if display_is_x11; then
-            if display_set_rate_xrandr "$display" "$target_rate"; then
-                echo "  ✓ Set ${target_rate}Hz using xrandr"
-                success=true
-                continue
-            fi
-        fi
-        
-        # Try wlr-randr
-        if display_has_wlr_randr; then
-            if display_set_rate_wlr "$display" "$target_rate"; then
-                echo "  ✓ Set ${target_rate}Hz using wlr-randr"
-                success=true
-                continue
-            fi
+        if display_set_rate "$display" "$target_rate"; then
+            echo "  ✓ Set ${target_rate}Hz using $DISPLAY_BACKEND"
+            success=true
+        else
+            echo "  ⚠ Could not set refresh rate for $display"
         fi
-        
-        # Try kscreen
-        if display_has_kscreen; then
-            if display_set_rate_kscreen "$display" "$target_rate"; then
-                echo "  ✓ Set ${target_rate}Hz using kscreen-doctor"
-                success=true
-                continue
-            fi
-        fi
-        
-        echo "  ⚠ Could not set refresh rate for $display"
     done
     
     if [[ "$success" == true ]]; then
@@ -412,11 +624,8 @@ display_apply_profile() {
             echo "${min_range}:${max_range}" > "$DISPLAY_VRR_RANGES_FILE"
         fi
         
-        # Apply frame limit if applicable
-        local frame_limit="${DISPLAY_FRAME_LIMITS[$profile]:-0}"
-        if [[ "$frame_limit" != "0" ]]; then
-            display_set_frame_limit "$frame_limit"
-        fi
+        # Per-game frame limits follow the profile (uncapped ones too)
+        display_set_frame_limit "${DISPLAY_FRAME_LIMITS[$profile]:-0}" "$profile"
         
         echo "Display profile '$profile' applied"
         return 0
@@ -426,51 +635,519 @@ display_apply_profile() {
     fi
 }
 
-# Set frame rate limit via MangoHUD config
-# Args: $1 = fps limit (0 = no limit)
+# Home directory of the user the display tools act for (SUDO_USER under rrcfg)
+# Sets: DISPLAY_USER_HOME
+display_user_home() {
+    DISPLAY_USER_HOME="${HOME:-/root}"
+    if [[ -n "${SUDO_USER:-}" ]]; then
+        DISPLAY_USER_HOME=$(getent passwd "$SUDO_USER" | cut -d: -f6)
+    fi
+}
+
+# Apply a profile's frame limits (per game, see Per-Game Frame Limits)
+# The global MangoHud.conf is never edited: games listed by executable get
+# generated per-app configs, everything launched through gz302-game gets its
+# cap from the environment.
+# Args: $1 = default fps limit (0 = no limit), $2 = profile (optional)
 display_set_frame_limit() {
     local limit="$1"
-    
-    # Find user's home directory
-    local user_home
-    if [[ -n "${SUDO_USER:-}" ]]; then
-        user_home=$(getent passwd "$SUDO_USER" | cut -d: -f6)
+    local profile="${2:-}"
+
+    display_write_game_configs "$profile" "$limit"
+    if [[ "$limit" == "0" ]]; then
+        echo "Frame limit: none by default"
     else
-        user_home="$HOME"
+        echo "Frame limit: ${limit}fps by default"
     fi
-    
-    local mangohud_dir="$user_home/.config/MangoHud"
-    local mangohud_config="$mangohud_dir/MangoHud.conf"
-    
-    mkdir -p "$mangohud_dir" 2>/dev/null || true
-    
-    if [[ "$limit" == "0" ]]; then
-        # Remove FPS limit
-        if [[ -f "$mangohud_config" ]]; then
-            sed -i '/^fps_limit=/d' "$mangohud_config" 2>/dev/null
+    if [[ $DISPLAY_GAME_CONFIGS -gt 0 ]]; then
+        echo "  ${DISPLAY_GAME_CONFIGS} per-game MangoHud config(s) updated"
+    fi
+}
+
+# --- Per-Game Frame Limits ---
+# ~/.config/gz302/game-profiles.conf keys games by Steam AppID or executable
+# and gives each its own cap per profile:
+#
+#   appid:1145360       battery=30 efficient=45 *=0
+#   exe:eldenring.exe   battery=40 *=0 gamescope=on vrr=on
+#
+# "<profile>=<fps>" applies while that profile is active, "*=<fps>" to every
+# other profile and 0 means uncapped; games without a rule for the active
+# profile get the profile's DISPLAY_FRAME_LIMITS cap. gamescope=on runs the
+# game nested in gamescope (cap via -r, vrr=on adds --adaptive-sync).
+#
+# Executable keys become MangoHud per-app configs (<exe>.conf, and
+# wine-<name>.conf for .exe games) regenerated on every profile change. AppID
+# keys and the default cap need the launcher: Steam launch options
+# "gz302-game %command%".
+
+DISPLAY_GAME_PROFILES=""               # Default: ~/.config/gz302/game-profiles.conf
+DISPLAY_GAME_MARKER="# Generated by gz302-game for the active profile - edit ~/.config/gz302/game-profiles.conf instead"
+
+DISPLAY_USER_HOME=""
+DISPLAY_ACTIVE_PROFILE=""
+DISPLAY_ACTIVE_REFRESH=""
+DISPLAY_ACTIVE_FPS="0"
+DISPLAY_GAME_KEY=""
+DISPLAY_GAME_FPS="0"
+DISPLAY_GAME_VRR=""
+DISPLAY_GAME_GAMESCOPE=""
+DISPLAY_GAME_CONFIGS=0
+declare -ga DISPLAY_GAME_KEYS=()
+declare -gA DISPLAY_GAME_RULES=()      # key -> "profile=fps ... vrr=on gamescope=on"
+
+# Work out which profile is active: the envelope or rrcfg profile applied
+# most recently
+# Sets: DISPLAY_ACTIVE_PROFILE (empty if none), DISPLAY_ACTIVE_REFRESH,
+#       DISPLAY_ACTIVE_FPS
+display_active_profile() {
+    local key value
+    DISPLAY_ACTIVE_PROFILE=""
+    DISPLAY_ACTIVE_REFRESH=""
+    DISPLAY_ACTIVE_FPS="0"
+    if [[ -r "$DISPLAY_ENVELOPE_STATE_FILE" && ! "$DISPLAY_CURRENT_PROFILE_FILE" -nt "$DISPLAY_ENVELOPE_STATE_FILE" ]]; then
+        while IFS='=' read -r key value; do
+            case "$key" in
+                PROFILE) DISPLAY_ACTIVE_PROFILE="$value" ;;
+                REFRESH) [[ "$value" =~ ^[0-9]+$ ]] && DISPLAY_ACTIVE_REFRESH="$value" ;;
+                FPS) [[ "$value" =~ ^[0-9]+$ ]] && DISPLAY_ACTIVE_FPS="$value" ;;
+            esac
+        done < "$DISPLAY_ENVELOPE_STATE_FILE"
+        return 0
+    fi
+    if [[ -r "$DISPLAY_CURRENT_PROFILE_FILE" ]]; then
+        read -r DISPLAY_ACTIVE_PROFILE < "$DISPLAY_CURRENT_PROFILE_FILE" || true
+        DISPLAY_ACTIVE_REFRESH="${DISPLAY_REFRESH_PROFILES[${DISPLAY_ACTIVE_PROFILE:-none}]:-}"
+        DISPLAY_ACTIVE_FPS="${DISPLAY_FRAME_LIMITS[${DISPLAY_ACTIVE_PROFILE:-none}]:-0}"
+    fi
+}
+
+# Load the game profiles (once per process)
+# Sets: DISPLAY_GAME_KEYS (file order), DISPLAY_GAME_RULES
+display_game_profiles_load() {
+    local key rules
+    [[ ${#DISPLAY_GAME_KEYS[@]} -gt 0 ]] && return 0
+    display_user_home
+    local file="${DISPLAY_GAME_PROFILES:-$DISPLAY_USER_HOME/.config/gz302/game-profiles.conf}"
+    [[ -r "$file" ]] || return 0
+    while read -r key rules || [[ -n "$key" ]]; do
+        [[ -z "$key" || "$key" == \#* ]] && continue
+        [[ "$key" =~ ^(appid:[0-9]+|exe:[^/[:space:]]+)$ ]] || continue
+        DISPLAY_GAME_KEYS+=("$key")
+        DISPLAY_GAME_RULES[$key]="${rules%%#*}"
+    done < "$file"
+}
+
+# Resolve a game's frame cap, VRR and gamescope settings for a profile
+# The first listed key with a rule wins; AppID keys should come first.
+# Args: $1 = profile, $2 = default fps, remaining = candidate keys
+# Sets: DISPLAY_GAME_KEY (empty if no rule matched), DISPLAY_GAME_FPS,
+#       DISPLAY_GAME_VRR, DISPLAY_GAME_GAMESCOPE
+display_game_resolve() {
+    local profile="$1"
+    local default="$2"
+    shift 2
+    local key token fps_profile fps_any
+    local -a tokens
+    DISPLAY_GAME_KEY=""
+    DISPLAY_GAME_FPS="$default"
+    DISPLAY_GAME_VRR=""
+    DISPLAY_GAME_GAMESCOPE=""
+    display_game_profiles_load
+
+    for key in "$@"; do
+        [[ -n "${DISPLAY_GAME_RULES[$key]+set}" ]] || continue
+        DISPLAY_GAME_KEY="$key"
+        fps_profile=""
+        fps_any=""
+        read -ra tokens <<< "${DISPLAY_GAME_RULES[$key]}"
+        for token in "${tokens[@]}"; do
+            case "$token" in
+                vrr=on|vrr=off) DISPLAY_GAME_VRR="${token#vrr=}" ;;
+                gamescope=on|gamescope=off) DISPLAY_GAME_GAMESCOPE="${token#gamescope=}" ;;
+                "${profile:-none}="*) fps_profile="${token#*=}" ;;
+                "*="*) fps_any="${token#*=}" ;;
+            esac
+        done
+        DISPLAY_GAME_FPS="${fps_profile:-${fps_any:-$default}}"
+        [[ "$DISPLAY_GAME_FPS" =~ ^[0-9]+$ ]] || DISPLAY_GAME_FPS="$default"
+        return 0
+    done
+}
+
+# Regenerate the MangoHud per-app configs of executable-keyed games
+# Each is a copy of the user's MangoHud.conf with the game's cap; configs the
+# user wrote by hand (no marker line) are left alone, and generated configs
+# for games no longer listed are removed.
+# Args: $1 = profile, $2 = profile's default fps
+# Sets: DISPLAY_GAME_CONFIGS (number written)
+display_write_game_configs() {
+    local profile="$1"
+    local default="$2"
+    local key name file first line
+    local -a base=()
+    local -A wanted=()
+    DISPLAY_GAME_CONFIGS=0
+
+    display_game_profiles_load
+    local dir="$DISPLAY_USER_HOME/.config/MangoHud"
+
+    for key in "${DISPLAY_GAME_KEYS[@]}"; do
+        [[ "$key" == exe:* ]] || continue
+        name="${key#exe:}"
+        wanted["$name.conf"]="$key"
+        [[ "${name,,}" == *.exe ]] && wanted["wine-${name%.*}.conf"]="$key"
+    done
+    [[ ${#wanted[@]} -gt 0 || -d "$dir" ]] || return 0
+
+    if [[ -r "$dir/MangoHud.conf" ]]; then
+        while IFS= read -r line || [[ -n "$line" ]]; do
+            [[ "$line" == fps_limit=* ]] || base+=("$line")
+        done < "$dir/MangoHud.conf"
+    fi
+    # Directories made here under sudo must belong to the user, or they
+    # cannot add their own configs later
+    local created="" parent="$dir"
+    while [[ ! -d "$parent" && "$parent" == "$DISPLAY_USER_HOME"/* ]]; do
+        created="$parent"
+        parent="${parent%/*}"
+    done
+    mkdir -p "$dir" 2>/dev/null || return 0
+    [[ -n "$created" && -n "${SUDO_USER:-}" ]] && chown -R "$SUDO_USER": "$created" 2>/dev/null
+
+    for file in "$dir"/*.conf; do
+        [[ -f "$file" && -z "${wanted[${file##*/}]:-}" ]] || continue
+        first=""
+        read -r first < "$file" || true
+        [[ "$first" == "$DISPLAY_GAME_MARKER" ]] && rm -f "$file"
+    done
+
+    for name in "${!wanted[@]}"; do
+        file="$dir/$name"
+        if [[ -f "$file" ]]; then
+            first=""
+            read -r first < "$file" || true
+            [[ "$first" == "$DISPLAY_GAME_MARKER" ]] || continue
         fi
-        echo "Frame rate limit removed"
-    else
-        # Set FPS limit
-        if [[ -f "$mangohud_config" ]]; then
-            sed -i '/^fps_limit=/d' "$mangohud_config" 2>/dev/null
+        display_game_resolve "$profile" "$default" "${wanted[$name]}"
+        {
+            echo "$DISPLAY_GAME_MARKER"
+            if [[ ${#base[@]} -gt 0 ]]; then
+                printf '%s\n' "${base[@]}"
+            fi
+            if [[ "$DISPLAY_GAME_FPS" != "0" ]]; then
+                echo "fps_limit=$DISPLAY_GAME_FPS"
+            fi
+        } > "$file" || continue
+        [[ -n "${SUDO_USER:-}" ]] && chown "$SUDO_USER": "$file" 2>/dev/null
+        DISPLAY_GAME_CONFIGS=$((DISPLAY_GAME_CONFIGS + 1))
+    done
+    return 0
+}
+
+# Print the per-game rules resolved for the active profile
+display_game_print_status() {
+    local key
+    display_active_profile
+    display_game_profiles_load
+    echo "Per-Game Frame Limits:"
+    echo "  Profile:    ${DISPLAY_ACTIVE_PROFILE:-none} (default cap: $([[ "$DISPLAY_ACTIVE_FPS" == "0" ]] && echo none || echo "${DISPLAY_ACTIVE_FPS}fps"))"
+    echo "  Rules:      ${DISPLAY_GAME_PROFILES:-$DISPLAY_USER_HOME/.config/gz302/game-profiles.conf}"
+    if [[ ${#DISPLAY_GAME_KEYS[@]} -eq 0 ]]; then
+        echo "  (no games listed)"
+    fi
+    for key in "${DISPLAY_GAME_KEYS[@]}"; do
+        display_game_resolve "$DISPLAY_ACTIVE_PROFILE" "$DISPLAY_ACTIVE_FPS" "$key"
+        printf "  %-28s %s%s%s\n" "$key" \
+            "$([[ "$DISPLAY_GAME_FPS" == "0" ]] && echo uncapped || echo "${DISPLAY_GAME_FPS}fps")" \
+            "${DISPLAY_GAME_GAMESCOPE:+, gamescope=$DISPLAY_GAME_GAMESCOPE}" "${DISPLAY_GAME_VRR:+, vrr=$DISPLAY_GAME_VRR}"
+    done
+    if grep -q '^fps_limit=' "$DISPLAY_USER_HOME/.config/MangoHud/MangoHud.conf" 2>/dev/null; then
+        echo "  ⚠ MangoHud.conf still sets fps_limit (written by older versions); remove it so per-game caps apply"
+    fi
+}
+
+# --- Adaptive Refresh ---
+# gz302-adaptive-refresh runs per user and drops the internal panel to a low
+# rate while the session is idle or static, and returns it to the current
+# profile's rate on keyboard/pointer input, a running game, a fullscreen
+# window (X11) or video playback. Going up is immediate; going down waits
+# for LOW_HOLD_S seconds of continuous inactivity so the panel does not flap.
+# By default it only adapts on battery.
+
+# Settings (overridable in DISPLAY_ADAPTIVE_CONFIG without the prefix)
+DISPLAY_ADAPTIVE_CONFIG="${XDG_CONFIG_HOME:-${HOME:-/root}/.config}/gz302/adaptive-refresh.conf"
+DISPLAY_ADAPTIVE_LOW_HZ="60"         # Rate while idle
+DISPLAY_ADAPTIVE_HIGH_HZ=""          # Rate while active (empty: current profile)
+DISPLAY_ADAPTIVE_ACTIVE_MS="1500"    # Input this recent (or since the last check) is activity
+DISPLAY_ADAPTIVE_LOW_HOLD_S="10"     # Inactivity required before going low
+DISPLAY_ADAPTIVE_POLL_S="2"          # Seconds between checks
+DISPLAY_ADAPTIVE_ON_AC="false"       # Also adapt while on AC power
+DISPLAY_ADAPTIVE_VIDEO_PLAYERS="firefox chromium chrome brave vivaldi mpv vlc celluloid totem haruna smplayer plasma-browser-integration"
+
+# Daemon state
+DISPLAY_ADAPTIVE_IDLE_PROBE=""
+DISPLAY_ADAPTIVE_IDLE_MS=""
+DISPLAY_ADAPTIVE_LAST_EVAL_MS=""
+DISPLAY_ADAPTIVE_HIGH=""
+DISPLAY_ADAPTIVE_WANT=""
+DISPLAY_ADAPTIVE_REASON=""
+
+# Load the user's adaptive refresh settings (KEY=value)
+display_adaptive_load_config() {
+    local key value
+    [[ -r "$DISPLAY_ADAPTIVE_CONFIG" ]] || return 0
+    while IFS='=' read -r key value || [[ -n "$key" ]]; do
+        key="${key//[[:space:]]/}"
+        [[ -z "$key" || "$key" == \#* ]] && continue
+        value="${value%%#*}"
+        value="${value//\"/}"
+        value="${value#"${value%%[![:space:]]*}"}"
+        value="${value%"${value##*[![:space:]]}"}"
+        # Numbers end up in (( )) under errexit: a typo would abort the daemon
+        # or be evaluated as an expression, so it keeps the default instead
+        case "$key" in
+            LOW_HZ|POLL_S)
+                [[ "$value" =~ ^[1-9][0-9]*$ ]] || { display_adaptive_bad_value "$key" "$value"; continue; }
+                ;;
+            HIGH_HZ)
+                [[ -z "$value" || "$value" =~ ^[1-9][0-9]*$ ]] || { display_adaptive_bad_value "$key" "$value"; continue; }
+                ;;
+            ACTIVE_MS|LOW_HOLD_S)
+                [[ "$value" =~ ^(0|[1-9][0-9]*)$ ]] || { display_adaptive_bad_value "$key" "$value"; continue; }
+                ;;
+            ON_AC|VIDEO_PLAYERS) ;;
+            *) continue ;;
+        esac
+        printf -v "DISPLAY_ADAPTIVE_${key}" '%s' "$value"
+    done < "$DISPLAY_ADAPTIVE_CONFIG"
+}
+
+# Report a numeric setting that is out of range or not a number
+# Args: $1 = key, $2 = value
+display_adaptive_bad_value() {
+    local var="DISPLAY_ADAPTIVE_$1"
+    echo "gz302-adaptive-refresh: ignoring $1=$2 in $DISPLAY_ADAPTIVE_CONFIG (not a valid number), using ${!var:-the current profile}" >&2
+}
+
+# Check whether a mains supply is online
+# Returns: 0 on AC power, 1 on battery
+display_on_ac_power() {
+    local psu type online
+    for psu in /sys/class/power_supply/*; do
+        [[ -r "$psu/type" && -r "$psu/online" ]] || continue
+        read -r type < "$psu/type"
+        [[ "$type" == "Mains" ]] || continue
+        read -r online < "$psu/online"
+        [[ "$online" == "1" ]] && return 0
+    done
+    return 1
+}
+
+# Pick the session's idle-time source (once per daemon start)
+# Sets: DISPLAY_ADAPTIVE_IDLE_PROBE (xprintidle, mutter, screensaver or empty)
+display_adaptive_detect_idle_probe() {
+    DISPLAY_ADAPTIVE_IDLE_PROBE=""
+    if display_is_x11 && command -v xprintidle >/dev/null 2>&1; then
+        DISPLAY_ADAPTIVE_IDLE_PROBE="xprintidle"
+    elif command -v gdbus >/dev/null 2>&1; then
+        if gdbus call --session --dest org.gnome.Mutter.IdleMonitor \
+                --object-path /org/gnome/Mutter/IdleMonitor/Core \
+                --method org.gnome.Mutter.IdleMonitor.GetIdletime >/dev/null 2>&1; then
+            DISPLAY_ADAPTIVE_IDLE_PROBE="mutter"
+        elif gdbus call --session --dest org.freedesktop.ScreenSaver \
+                --object-path /org/freedesktop/ScreenSaver \
+                --method org.freedesktop.ScreenSaver.GetSessionIdleTime >/dev/null 2>&1; then
+            DISPLAY_ADAPTIVE_IDLE_PROBE="screensaver"
         fi
-        echo "fps_limit=$limit" >> "$mangohud_config"
-        echo "MangoHUD frame limit set to ${limit}fps"
     fi
 }
 
+# Read the time since the last keyboard/pointer input
+# Sets: DISPLAY_ADAPTIVE_IDLE_MS (empty if unknown)
+display_adaptive_read_idle() {
+    local out=""
+    case "$DISPLAY_ADAPTIVE_IDLE_PROBE" in
+        xprintidle)
+            out=$(xprintidle 2>/dev/null) || out=""
+            ;;
+        mutter)
+            # "(uint64 1234,)"
+            out=$(gdbus call --session --dest org.gnome.Mutter.IdleMonitor \
+                --object-path /org/gnome/Mutter/IdleMonitor/Core \
+                --method org.gnome.Mutter.IdleMonitor.GetIdletime 2>/dev/null) || out=""
+            out="${out##* }"
+            ;;
+        screensaver)
+            # "(uint32 5,)" in seconds
+            out=$(gdbus call --session --dest org.freedesktop.ScreenSaver \
+                --object-path /org/freedesktop/ScreenSaver \
+                --method org.freedesktop.ScreenSaver.GetSessionIdleTime 2>/dev/null) || out=""
+            out="${out##* }"
+            out="${out//[^0-9]/}"
+            [[ -n "$out" ]] && out=$(( out * 1000 ))
+            ;;
+    esac
+    DISPLAY_ADAPTIVE_IDLE_MS="${out//[^0-9]/}"
+}
+
+# Returns: 0 if a game is running (Steam launch wrapper or gamescope)
+display_adaptive_game_running() {
+    pgrep -f 'SteamLaunch AppId=|gamescope' >/dev/null 2>&1
+}
+
+# Returns: 0 if the focused window is fullscreen (X11 only)
+display_adaptive_fullscreen_focused() {
+    display_is_x11 && command -v xprop >/dev/null 2>&1 || return 1
+    local active state
+    active=$(xprop -root _NET_ACTIVE_WINDOW 2>/dev/null) || return 1
+    active="${active##* }"
+    [[ "$active" == 0x* && "$active" != "0x0" ]] || return 1
+    state=$(xprop -id "$active" _NET_WM_STATE 2>/dev/null) || return 1
+    [[ "$state" == *_NET_WM_STATE_FULLSCREEN* ]]
+}
+
+# Returns: 0 if a browser or video player reports playback over MPRIS
+display_adaptive_video_playing() {
+    command -v gdbus >/dev/null 2>&1 || return 1
+    local names name player status
+    names=$(gdbus call --session --dest org.freedesktop.DBus --object-path /org/freedesktop/DBus \
+        --method org.freedesktop.DBus.ListNames 2>/dev/null) || return 1
+    # "(['org.freedesktop.DBus', ':1.2', ...],)"
+    names="${names//[\'\[\](),]/ }"
+    for name in $names; do
+        [[ "$name" == org.mpris.MediaPlayer2.* ]] || continue
+        for player in $DISPLAY_ADAPTIVE_VIDEO_PLAYERS; do
+            [[ "$name" == "org.mpris.MediaPlayer2.${player}"* ]] || continue
+            status=$(gdbus call --session --dest "$name" --object-path /org/mpris/MediaPlayer2 \
+                --method org.freedesktop.DBus.Properties.Get \
+                org.mpris.MediaPlayer2.Player PlaybackStatus 2>/dev/null) || continue
+            [[ "$status" == *Playing* ]] && return 0
+        done
+    done
+    return 1
+}
+
+# Work out the rate to use while active: HIGH_HZ, else the rate of the
+# performance envelope or rrcfg profile applied most recently
+# Sets: DISPLAY_ADAPTIVE_HIGH
+display_adaptive_update_high() {
+    if [[ -n "$DISPLAY_ADAPTIVE_HIGH_HZ" ]]; then
+        DISPLAY_ADAPTIVE_HIGH="$DISPLAY_ADAPTIVE_HIGH_HZ"
+        return 0
+    fi
+    display_active_profile
+    DISPLAY_ADAPTIVE_HIGH="${DISPLAY_ACTIVE_REFRESH:-$GZ302_MAX_REFRESH}"
+}
+
+# Decide whether the session needs the high rate right now
+# Cheapest checks first; the first activity found decides.
+# Sets: DISPLAY_ADAPTIVE_WANT (high or low), DISPLAY_ADAPTIVE_REASON
+display_adaptive_evaluate() {
+    local now window="$DISPLAY_ADAPTIVE_ACTIVE_MS"
+    # Input right after the previous check is older than ACTIVE_MS by now
+    # when POLL_S is longer: look back to the previous check at least
+    now="${EPOCHREALTIME/[.,]/}"
+    now=$(( 10#$now / 1000 ))
+    if [[ -n "$DISPLAY_ADAPTIVE_LAST_EVAL_MS" ]] && (( now - DISPLAY_ADAPTIVE_LAST_EVAL_MS > window )); then
+        window=$(( now - DISPLAY_ADAPTIVE_LAST_EVAL_MS ))
+    fi
+    DISPLAY_ADAPTIVE_LAST_EVAL_MS="$now"
+    DISPLAY_ADAPTIVE_WANT="high"
+    if [[ "$DISPLAY_ADAPTIVE_ON_AC" != "true" ]] && display_on_ac_power; then
+        DISPLAY_ADAPTIVE_REASON="on AC power"
+        return 0
+    fi
+    if [[ -z "$DISPLAY_ADAPTIVE_IDLE_PROBE" ]]; then
+        # Without an idle source input cannot be seen; never go low blind
+        DISPLAY_ADAPTIVE_REASON="no idle-time source"
+        return 0
+    fi
+    display_adaptive_read_idle
+    if [[ -n "$DISPLAY_ADAPTIVE_IDLE_MS" ]] && (( DISPLAY_ADAPTIVE_IDLE_MS < window )); then
+        DISPLAY_ADAPTIVE_REASON="input"
+    elif display_adaptive_game_running; then
+        DISPLAY_ADAPTIVE_REASON="game running"
+    elif display_adaptive_fullscreen_focused; then
+        DISPLAY_ADAPTIVE_REASON="fullscreen window"
+    elif display_adaptive_video_playing; then
+        DISPLAY_ADAPTIVE_REASON="video playing"
+    else
+        DISPLAY_ADAPTIVE_WANT="low"
+        DISPLAY_ADAPTIVE_REASON="idle"
+    fi
+    return 0
+}
+
+# Run the adaptive refresh loop until terminated (restores the high rate)
+# Args: $1 = display (optional, defaults to the internal panel)
+display_adaptive_run() {
+    local display="${1:-$GZ302_INTERNAL_DISPLAY}"
+    local current target now low_since=0
+
+    display_adaptive_load_config
+    display_adaptive_detect_idle_probe
+    display_adaptive_update_high
+    current=$(display_get_current_refresh "$display")
+    echo "Adaptive refresh on $display: ${DISPLAY_ADAPTIVE_LOW_HZ}Hz idle, profile rate active" \
+        "(idle source: ${DISPLAY_ADAPTIVE_IDLE_PROBE:-none})"
+    trap 'display_set_rate "$display" "$DISPLAY_ADAPTIVE_HIGH" || true; exit 0' TERM INT
+
+    while true; do
+        display_adaptive_update_high
+        display_adaptive_evaluate
+        now="$EPOCHSECONDS"
+        target="$current"
+        if [[ "$DISPLAY_ADAPTIVE_WANT" == "high" ]]; then
+            low_since=0
+            target="$DISPLAY_ADAPTIVE_HIGH"
+        else
+            (( low_since > 0 )) || low_since="$now"
+            (( now - low_since >= DISPLAY_ADAPTIVE_LOW_HOLD_S )) && target="$DISPLAY_ADAPTIVE_LOW_HZ"
+        fi
+        # Nothing to gain when the profile itself is at or below the low rate
+        (( DISPLAY_ADAPTIVE_LOW_HZ < DISPLAY_ADAPTIVE_HIGH )) || target="$DISPLAY_ADAPTIVE_HIGH"
+
+        if [[ "$target" != "$current" ]]; then
+            if display_set_rate "$display" "$target"; then
+                echo "${target}Hz (${DISPLAY_ADAPTIVE_REASON}) via $DISPLAY_BACKEND"
+            else
+                echo "Could not set ${target}Hz on $display" >&2
+            fi
+            # Not retried every poll if the backend refuses the rate
+            current="$target"
+        fi
+        sleep "$DISPLAY_ADAPTIVE_POLL_S"
+    done
+}
+
+# Print what the adaptive refresh daemon would do right now
+display_adaptive_print_status() {
+    display_adaptive_load_config
+    display_adaptive_detect_idle_probe
+    display_adaptive_update_high
+    display_adaptive_evaluate
+    echo "Adaptive Refresh:"
+    echo "  Display:      $GZ302_INTERNAL_DISPLAY"
+    echo "  Rates:        ${DISPLAY_ADAPTIVE_LOW_HZ}Hz idle / ${DISPLAY_ADAPTIVE_HIGH}Hz active"
+    echo "  Idle source:  ${DISPLAY_ADAPTIVE_IDLE_PROBE:-none}${DISPLAY_ADAPTIVE_IDLE_MS:+ (idle ${DISPLAY_ADAPTIVE_IDLE_MS} ms)}"
+    echo "  Decision:     ${DISPLAY_ADAPTIVE_WANT} (${DISPLAY_ADAPTIVE_REASON})"
+    echo "  Settings:     $DISPLAY_ADAPTIVE_CONFIG"
+}
+
 # --- Status Display ---
 
 # Print formatted display status
 display_print_status() {
     local displays
+    display_detect_backend
     displays=$(display_detect_outputs)
     local primary
     primary=$(display_get_primary)
     
     echo "Display Status:"
     echo "  Environments: $(display_is_x11 && echo "X11") $(display_is_wayland && echo "Wayland")"
+    echo "  Backend: ${DISPLAY_BACKEND:-none} (cached for this session)"
     echo "  Primary Display: $primary"
     echo "  Current Refresh: $(display_get_current_refresh "$primary")Hz"
     echo "  Current Profile: $(display_get_current_profile)"
@@ -538,7 +1215,7 @@ set -euo pipefail
 # Most display operations require root for DRM access
 requires_elevation() {
     case "${1:-}" in
-        status|list|help|"") return 1 ;;
+        status|list|rescan|help|"") return 1 ;;
         *) return 0 ;;
     esac
 }
@@ -564,12 +1241,17 @@ fi
 
 # CLI handling
 case "${1:-}" in
-    emergency|battery|efficient|balanced|performance|gaming|maximum)
+    emergency|battery|efficient|quiet|balanced|performance|gaming|maximum)
         display_apply_profile "$1"
         ;;
     status)
         display_print_status
         ;;
+    rescan)
+        display_cache_invalidate
+        display_detect_backend
+        echo "Display backend: $DISPLAY_BACKEND (outputs: ${DISPLAY_OUTPUT_ORDER:-none})"
+        ;;
     list)
         display_list_profiles
         ;;
@@ -592,6 +1274,7 @@ case "${1:-}" in
         echo "Commands:"
         echo "  status      - Show current display status"
         echo "  list        - List available profiles"
+        echo "  rescan      - Re-detect the display backend and modes"
         echo "  vrr [on|off] - Enable/disable VRR"
         echo "  help        - Show this help"
         ;;
@@ -604,6 +1287,141 @@ esac
 RRCFG_SCRIPT
 }
 
+# Get the gz302-adaptive-refresh daemon script for installation
+display_get_adaptive_refresh_script() {
+    cat <<'ADAPTIVE_SCRIPT'
+#!/bin/bash
+# GZ302 Adaptive Refresh (gz302-adaptive-refresh)
+# Runs the internal panel at a low refresh rate while the session is idle
+# and at the display profile's rate while it is in use. Started per user by
+# gz302-adaptive-refresh.service; settings in
+# ~/.config/gz302/adaptive-refresh.conf.
+
+set -euo pipefail
+
+LIB_PATH="/usr/local/share/gz302/gz302-lib"
+if [[ -f "$LIB_PATH/display-manager.sh" ]]; then
+    source "$LIB_PATH/display-manager.sh"
+else
+    echo "Error: display-manager.sh not found at $LIB_PATH" >&2
+    exit 1
+fi
+
+case "${1:-run}" in
+    run)
+        display_adaptive_run "${2:-}"
+        ;;
+    status)
+        display_adaptive_print_status
+        ;;
+    help|--help|-h)
+        echo "Usage: gz302-adaptive-refresh [run|status]"
+        echo ""
+        echo "  run     Adapt the refresh rate until stopped (used by the user service)"
+        echo "  status  Show the current decision"
+        echo ""
+        echo "Enable/disable: systemctl --user enable|disable --now gz302-adaptive-refresh"
+        ;;
+    *)
+        echo "Error: Unknown command '$1'" >&2
+        exit 1
+        ;;
+esac
+ADAPTIVE_SCRIPT
+}
+
+# Get the gz302-game launcher script for installation
+display_get_game_launcher_script() {
+    cat <<'GAME_SCRIPT'
+#!/bin/bash
+# GZ302 game launcher (gz302-game)
+# Applies the per-game frame cap, VRR and gamescope settings of the active
+# profile to one game. Steam launch options: gz302-game %command%
+# Rules: ~/.config/gz302/game-profiles.conf
+
+set -euo pipefail
+
+LIB_PATH="/usr/local/share/gz302/gz302-lib"
+if [[ -f "$LIB_PATH/display-manager.sh" ]]; then
+    source "$LIB_PATH/display-manager.sh"
+else
+    echo "Error: display-manager.sh not found at $LIB_PATH" >&2
+    exit 1
+fi
+
+usage() {
+    echo "Usage: gz302-game [--] COMMAND...   (Steam: gz302-game %command%)"
+    echo "       gz302-game status"
+    echo ""
+    echo "Rules in ~/.config/gz302/game-profiles.conf, one game per line:"
+    echo "  appid:1145360       battery=30 efficient=45 *=0"
+    echo "  exe:eldenring.exe   battery=40 *=0 gamescope=on vrr=on"
+}
+
+case "${1:-}" in
+    status) display_game_print_status; exit 0 ;;
+    help|--help|-h|"") usage; exit 0 ;;
+    --) shift ;;
+esac
+[[ $# -gt 0 ]] || { usage >&2; exit 1; }
+
+# Candidate keys: Steam AppID first, then the game executable (the last
+# *.exe argument under Proton, otherwise the command itself)
+keys=()
+appid="${SteamAppId:-${STEAM_COMPAT_APP_ID:-}}"
+exe="${1##*/}"
+for arg in "$@"; do
+    case "$arg" in
+        AppId=[0-9]*) appid="${appid:-${arg#AppId=}}" ;;
+        *.exe|*.EXE) exe="${arg##*[/\\]}" ;;
+    esac
+done
+[[ "$appid" =~ ^[0-9]+$ && "$appid" != "0" ]] && keys+=("appid:$appid")
+keys+=("exe:$exe")
+
+display_active_profile
+display_game_resolve "$DISPLAY_ACTIVE_PROFILE" "$DISPLAY_ACTIVE_FPS" "${keys[@]}"
+
+if [[ "$DISPLAY_GAME_GAMESCOPE" == "on" && -z "${GAMESCOPE_WAYLAND_DISPLAY:-}" ]] \
+    && command -v gamescope >/dev/null 2>&1; then
+    gamescope_args=()
+    [[ "$DISPLAY_GAME_FPS" != "0" ]] && gamescope_args+=(-r "$DISPLAY_GAME_FPS")
+    [[ "$DISPLAY_GAME_VRR" == "on" ]] && gamescope_args+=(--adaptive-sync)
+    exec gamescope "${gamescope_args[@]}" -- "$@"
+fi
+
+if [[ "$DISPLAY_GAME_FPS" != "0" ]]; then
+    if [[ -n "${MANGOHUD:-}" ]]; then
+        # HUD already wanted: keep the user's config files, add the cap
+        export MANGOHUD_CONFIG="read_cfg,fps_limit=${DISPLAY_GAME_FPS}${MANGOHUD_CONFIG:+,$MANGOHUD_CONFIG}"
+    else
+        # Limiter only, no overlay
+        export MANGOHUD=1
+        export MANGOHUD_CONFIG="no_display,fps_limit=${DISPLAY_GAME_FPS}"
+    fi
+fi
+exec "$@"
+GAME_SCRIPT
+}
+
+# Get the systemd user unit for gz302-adaptive-refresh
+display_get_adaptive_refresh_unit() {
+    cat <<'ADAPTIVE_UNIT'
+[Unit]
+Description=GZ302 adaptive refresh rate for the internal display
+PartOf=graphical-session.target
+After=graphical-session.target
+
+[Service]
+ExecStart=/usr/local/bin/gz302-adaptive-refresh run
+Restart=on-failure
+RestartSec=10
+
+[Install]
+WantedBy=graphical-session.target
+ADAPTIVE_UNIT
+}
+
 # Ensure configuration directory exists
 display_init_config() {
     mkdir -p "$DISPLAY_CONFIG_DIR"
@@ -616,7 +1434,7 @@ display_init_config() {
 
 # --- Library Info ---
 display_lib_version() {
-    echo "6.0.0"
+    echo "6.4.0"
 }
 
 display_lib_help() {
@@ -626,6 +1444,11 @@ display_lib_help() {
     echo "  display_detect_outputs      - Detect connected displays"
     echo "  display_get_current_refresh  - Get current refresh rate"
     echo "  display_apply_profile        - Apply a refresh rate profile"
+    echo "  display_set_rate             - Set one display's rate (cached session backend)"
+    echo "  display_detect_backend       - Detect/cache the backend and mode lists"
+    echo "  display_cache_invalidate     - Forget the cached backend (after changes)"
+    echo "  display_adaptive_run         - Idle-aware refresh loop (gz302-adaptive-refresh)"
+    echo "  display_game_resolve         - Per-game frame cap/VRR for a profile (gz302-game)"
     echo "  display_vrr_enable/disable   - Control Variable Refresh Rate"
     echo "  display_print_status         - Show current display state"
     echo "  display_list_profiles        - List available profiles"
@@ -4,7 +4,7 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 Distribution Manager Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library provides distribution-specific setup orchestration for the GZ302.
 # It coordinates hardware fixes across all subsystem libraries and manages
@@ -27,17 +27,15 @@ distro_apply_hardware_fixes() {
     info "Applying GZ302 hardware fixes using modular libraries..."
     
     # Use kernel-compat if available, otherwise manual check
-    local kver
-    if declare -f kernel_get_version_num >/dev/null; then
-        kver=$(kernel_get_version_num)
-    else
-        kver=0
+    local kver=0
+    if declare -f kernel_caps_init >/dev/null && kernel_caps_init; then
+        kver="${KERNEL_CAPS[version_num]}"
     fi
     
     # 1. WiFi Configuration
     info "Configuring WiFi (MediaTek MT7925)..."
     if declare -f wifi_detect_hardware >/dev/null && wifi_detect_hardware >/dev/null 2>&1; then
-        wifi_apply_configuration || warning "WiFi configuration reported issues"
+        trace_span "wifi_apply_configuration" lib wifi_apply_configuration || warning "WiFi configuration reported issues"
     else
         info "WiFi hardware not detected or library not loaded, skipping."
     fi
@@ -45,7 +43,7 @@ distro_apply_hardware_fixes() {
     # 2. GPU Configuration
     info "Configuring GPU (AMD Radeon 8060S)..."
     if declare -f gpu_detect_hardware >/dev/null && gpu_detect_hardware >/dev/null 2>&1; then
-        gpu_apply_configuration || warning "GPU configuration reported issues"
+        trace_span "gpu_apply_configuration" lib gpu_apply_configuration || warning "GPU configuration reported issues"
     else
         info "GPU hardware not detected or library not loaded, skipping."
     fi
@@ -53,7 +51,7 @@ distro_apply_hardware_fixes() {
     # 3. Input Configuration
     info "Configuring Input Devices..."
     if declare -f input_detect_hid_devices >/dev/null && input_detect_hid_devices >/dev/null 2>&1; then
-        input_apply_configuration "$kver" || warning "Input configuration reported issues"
+        trace_span "input_apply_configuration" lib input_apply_configuration "$kver" || warning "Input configuration reported issues"
     else
          info "Input devices not detected or library not loaded, skipping."
     fi
@@ -61,7 +59,7 @@ distro_apply_hardware_fixes() {
     # 4. RGB Configuration
     info "Configuring RGB Devices..."
     if declare -f rgb_install_udev_rules >/dev/null; then
-        if rgb_install_udev_rules; then
+        if trace_span "rgb_install_udev_rules" lib rgb_install_udev_rules; then
             success "RGB udev rules installed"
         else
             warning "Failed to install RGB udev rules"
@@ -70,17 +68,17 @@ distro_apply_hardware_fixes() {
 
     # 5. Keyboard Backlight Restore
     if declare -f rgb_configure_backlight_restore >/dev/null; then
-        rgb_configure_backlight_restore
+        trace_span "rgb_configure_backlight_restore" lib rgb_configure_backlight_restore
     fi
 
     # 6. Battery Limit (Optional/Fallback)
     if declare -f power_setup_battery_limit_service >/dev/null; then
-        power_setup_battery_limit_service
+        trace_span "power_setup_battery_limit_service" lib power_setup_battery_limit_service
     fi
 
     # 7. AMD P-State kernel parameter
     info "Configuring AMD P-State driver..."
-    distro_configure_amd_pstate
+    trace_span "distro_configure_amd_pstate" lib distro_configure_amd_pstate
 
     success "Hardware fixes applied via libraries"
 }
@@ -99,9 +97,7 @@ distro_configure_amd_pstate() {
             info "amd_pstate=guided already present in GRUB config"
         else
             info "Adding amd_pstate=guided to GRUB configuration..."
-            local grub_backup
-            grub_backup="/etc/default/grub.gz302.bak.$(date +%Y%m%d%H%M%S)"
-            cp /etc/default/grub "$grub_backup"
+            backup_config_file "/etc/default/grub" distro
             # Append to GRUB_CMDLINE_LINUX_DEFAULT, else GRUB_CMDLINE_LINUX, else create it
             if grep -q '^GRUB_CMDLINE_LINUX_DEFAULT=' /etc/default/grub; then
                 sed -i 's/^\(GRUB_CMDLINE_LINUX_DEFAULT="[^"]*\)"/\1 amd_pstate=guided"/' /etc/default/grub
@@ -130,9 +126,7 @@ distro_configure_amd_pstate() {
         for entry in "$loader_dir"/*.conf; do
             [[ -f "$entry" ]] || continue
             if grep -q "^options" "$entry" && ! grep -q "$param" "$entry"; then
-                local entry_backup
-                entry_backup="${entry}.gz302.bak.$(date +%Y%m%d%H%M%S)"
-                cp "$entry" "$entry_backup"
+                backup_config_file "$entry" distro
                 sed -i "s/^\(options .*\)$/\1 amd_pstate=guided/" "$entry"
                 sd_updated=1
             fi
@@ -152,9 +146,7 @@ distro_configure_amd_pstate() {
         if grep -q "$param" /boot/refind_linux.conf 2>/dev/null; then
             info "amd_pstate=guided already present in refind_linux.conf"
         else
-            local refind_kl_backup
-            refind_kl_backup="/boot/refind_linux.conf.gz302.bak.$(date +%Y%m%d%H%M%S)"
-            cp /boot/refind_linux.conf "$refind_kl_backup"
+            backup_config_file "/boot/refind_linux.conf" distro
             # Each line: "label"  "params ..."  — append to the last quoted string
             sed -i -E "s|\"([^\"]+)\"\s*$|\"\\1 ${param}\"|" /boot/refind_linux.conf
             success "rEFInd per-kernel options updated: amd_pstate=guided"
@@ -169,9 +161,7 @@ distro_configure_amd_pstate() {
             info "amd_pstate=guided already present in $(basename "$refind_conf")"
             continue
         fi
-        local refind_backup
-        refind_backup="${refind_conf}.gz302.bak.$(date +%Y%m%d%H%M%S)"
-        cp "$refind_conf" "$refind_backup"
+        backup_config_file "$refind_conf" distro
         # Append to every 'options' line (global or stanza-level)
         sed -i "s|^\(options .*\)$|\1 ${param}|" "$refind_conf"
         success "rEFInd config updated: amd_pstate=guided"
@@ -188,9 +178,7 @@ distro_configure_amd_pstate() {
             info "amd_pstate=guided already present in $(basename "$limine_cfg")"
             continue
         fi
-        local limine_backup
-        limine_backup="${limine_cfg}.gz302.bak.$(date +%Y%m%d%H%M%S)"
-        cp "$limine_cfg" "$limine_backup"
+        backup_config_file "$limine_cfg" distro
         # v5 TOML-style: "    cmdline: ..." or "cmdline: ..."
         if grep -qE '^\s*cmdline\s*:' "$limine_cfg"; then
             sed -i -E "s|^(\s*cmdline\s*:.*)$|\1 ${param}|" "$limine_cfg"
@@ -0,0 +1,644 @@
+#!/bin/bash
+# shellcheck disable=SC2034,SC1091
+set -euo pipefail
+
+# ==============================================================================
+# GZ302 Performance Envelope Library
+# Version: 6.28.1
+#
+# A performance envelope is everything one profile name implies, applied
+# together: platform profile and TDP (z13ctl), internal panel refresh rate,
+# VRR range, frame cap, GPU power policy and optionally keyboard/lightbar
+# brightness. Applied separately (pwrcfg, rrcfg, the tray) these drift apart
+# into combinations such as an 18W TDP with the panel still at 180Hz.
+#
+# Envelopes use the tray's profile names. The display columns come from the
+# display-manager profile tables and the power columns from ENVELOPE_POWER;
+# /etc/gz302/envelopes.conf overrides single values per profile.
+#
+# Steps run in a fixed order and each records what it replaced. When a step
+# fails, the completed steps are undone in reverse order, so the machine is
+# left either in the new envelope or in the one it started from.
+#
+# Usage:
+#   source gz302-lib/envelope-manager.sh
+#   envelope_apply balanced
+#   envelope_print_status
+# ==============================================================================
+
+if ! declare -f display_set_rate >/dev/null 2>&1; then
+    source "$(dirname "${BASH_SOURCE[0]}")/display-manager.sh"
+fi
+if ! declare -f gpu_set_power_policy >/dev/null 2>&1; then
+    source "$(dirname "${BASH_SOURCE[0]}")/gpu-manager.sh"
+fi
+
+# --- Envelope Definitions ---
+# Power columns: "<z13ctl platform profile> <TDP W> <RGB brightness>"
+# A TDP of "-" leaves the platform profile's firmware limits in place and an
+# RGB brightness of "-" leaves the lighting alone.
+declare -gA ENVELOPE_POWER
+ENVELOPE_POWER[emergency]="quiet 10 off"
+ENVELOPE_POWER[battery]="quiet 18 low"
+ENVELOPE_POWER[efficient]="quiet 30 -"
+ENVELOPE_POWER[quiet]="quiet - -"
+ENVELOPE_POWER[balanced]="balanced 40 -"
+ENVELOPE_POWER[performance]="performance 55 -"
+ENVELOPE_POWER[gaming]="performance 70 -"
+ENVELOPE_POWER[maximum]="performance 90 -"
+
+# GPU columns: "<power_dpm_force_performance_level> <pp_power_profile_mode>"
+# COMPUTE on maximum is for LLM serving on AC; a workload the firmware does
+# not offer is skipped and "-" leaves the current one.
+declare -gA ENVELOPE_GPU
+ENVELOPE_GPU[emergency]="low POWER_SAVING"
+ENVELOPE_GPU[battery]="auto POWER_SAVING"
+ENVELOPE_GPU[efficient]="auto POWER_SAVING"
+ENVELOPE_GPU[quiet]="auto BOOTUP_DEFAULT"
+ENVELOPE_GPU[balanced]="auto BOOTUP_DEFAULT"
+ENVELOPE_GPU[performance]="auto 3D_FULL_SCREEN"
+ENVELOPE_GPU[gaming]="auto 3D_FULL_SCREEN"
+ENVELOPE_GPU[maximum]="auto COMPUTE"
+
+# Privileged writer for the GPU policy (sudoers: gz302-gpu policy *)
+ENVELOPE_GPU_CMD="/usr/local/bin/gz302-gpu"
+
+ENVELOPE_ORDER="emergency battery efficient quiet balanced performance gaming maximum"
+
+# z13ctl refuses sustained limits above this without --force
+ENVELOPE_TDP_FORCE_ABOVE="75"
+
+# Configuration and state paths
+ENVELOPE_CONFIG="/etc/gz302/envelopes.conf"
+ENVELOPE_STATE_FILE="$DISPLAY_ENVELOPE_STATE_FILE"
+# One system-wide lock: the tray (user) and udev/pwrcfg (root) must serialise
+# on the same file; the installer creates it 0666 via tmpfiles.d
+ENVELOPE_LOCK_FILE="/run/lock/gz302-envelope.lock"
+ENVELOPE_TMPFILES_CONF="/etc/tmpfiles.d/gz302-envelope.conf"
+
+# Overrides from ENVELOPE_CONFIG: "<profile>.<key>" -> value
+declare -gA ENVELOPE_OVERRIDE=()
+ENVELOPE_CONFIG_LOADED=false
+
+# Resolved envelope (envelope_resolve)
+ENV_PROFILE=""
+ENV_PLATFORM=""
+ENV_TDP=""
+ENV_REFRESH=""
+ENV_VRR_MIN=""
+ENV_VRR_MAX=""
+ENV_FPS=""
+ENV_RGB=""
+ENV_GPU_LEVEL=""
+ENV_GPU_MODE=""
+
+# Values replaced by the steps of the running apply, for rollback
+ENVELOPE_PREV_PLATFORM=""
+ENVELOPE_PREV_TDP=""
+ENVELOPE_PREV_RGB=""
+ENVELOPE_PREV_REFRESH=""
+ENVELOPE_PREV_VRR=""
+ENVELOPE_PREV_FPS=""                   # "<default fps> <profile>"
+ENVELOPE_PREV_GPU=""                   # "<level> <workload>"
+ENVELOPE_OUTPUT=""
+ENVELOPE_ERROR=""
+declare -ga ENVELOPE_DONE=()
+
+# --- Definitions ---
+
+# Load per-profile overrides, e.g. "battery.refresh=48" or "gaming.rgb=high"
+# Keys: platform, tdp, refresh, vrr (MIN-MAX), fps, rgb, gpu_level, gpu_mode
+envelope_load_config() {
+    local key value
+    [[ "$ENVELOPE_CONFIG_LOADED" == true ]] && return 0
+    ENVELOPE_CONFIG_LOADED=true
+    [[ -r "$ENVELOPE_CONFIG" ]] || return 0
+    while IFS='=' read -r key value || [[ -n "$key" ]]; do
+        key="${key//[[:space:]]/}"
+        [[ -z "$key" || "$key" == \#* ]] && continue
+        value="${value%%#*}"
+        value="${value//[[:space:]\"]/}"
+        case "${key#*.}" in
+            platform|tdp|refresh|vrr|fps|rgb|gpu_level|gpu_mode)
+                envelope_profile_valid "${key%%.*}" && ENVELOPE_OVERRIDE[$key]="$value"
+                ;;
+        esac
+    done < "$ENVELOPE_CONFIG"
+}
+
+# Check if an envelope exists for a profile name
+# Args: $1 = profile name
+# Returns: 0 if valid, 1 if not
+envelope_profile_valid() {
+    [[ -n "${ENVELOPE_POWER[${1:-none}]:-}" ]]
+}
+
+# Resolve one profile's envelope (tables plus overrides)
+# Args: $1 = profile name
+# Sets: ENV_PROFILE, ENV_PLATFORM, ENV_TDP, ENV_REFRESH, ENV_VRR_MIN,
+#       ENV_VRR_MAX, ENV_FPS, ENV_RGB, ENV_GPU_LEVEL, ENV_GPU_MODE
+# Returns: 0 on success, 1 for an unknown profile or invalid override
+envelope_resolve() {
+    local profile="$1"
+    local vrr
+
+    envelope_profile_valid "$profile" || return 1
+    envelope_load_config
+
+    ENV_PROFILE="$profile"
+    read -r ENV_PLATFORM ENV_TDP ENV_RGB <<< "${ENVELOPE_POWER[$profile]}"
+    read -r ENV_GPU_LEVEL ENV_GPU_MODE <<< "${ENVELOPE_GPU[$profile]:-auto -}"
+    ENV_REFRESH="${DISPLAY_REFRESH_PROFILES[$profile]:-$GZ302_MAX_REFRESH}"
+    ENV_VRR_MIN="${DISPLAY_VRR_MIN[$profile]:-48}"
+    ENV_VRR_MAX="${DISPLAY_VRR_MAX[$profile]:-$ENV_REFRESH}"
+    ENV_FPS="${DISPLAY_FRAME_LIMITS[$profile]:-0}"
+
+    ENV_PLATFORM="${ENVELOPE_OVERRIDE[$profile.platform]:-$ENV_PLATFORM}"
+    ENV_TDP="${ENVELOPE_OVERRIDE[$profile.tdp]:-$ENV_TDP}"
+    ENV_REFRESH="${ENVELOPE_OVERRIDE[$profile.refresh]:-$ENV_REFRESH}"
+    ENV_FPS="${ENVELOPE_OVERRIDE[$profile.fps]:-$ENV_FPS}"
+    ENV_RGB="${ENVELOPE_OVERRIDE[$profile.rgb]:-$ENV_RGB}"
+    ENV_GPU_LEVEL="${ENVELOPE_OVERRIDE[$profile.gpu_level]:-$ENV_GPU_LEVEL}"
+    ENV_GPU_MODE="${ENVELOPE_OVERRIDE[$profile.gpu_mode]:-$ENV_GPU_MODE}"
+    vrr="${ENVELOPE_OVERRIDE[$profile.vrr]:-}"
+    if [[ -n "$vrr" ]]; then
+        ENV_VRR_MIN="${vrr%-*}"
+        ENV_VRR_MAX="${vrr#*-}"
+    fi
+
+    if [[ ! "$ENV_TDP" =~ ^([0-9]+|-)$ || ! "$ENV_REFRESH" =~ ^[0-9]+$ || ! "$ENV_FPS" =~ ^[0-9]+$ \
+        || ! "$ENV_VRR_MIN" =~ ^[0-9]+$ || ! "$ENV_VRR_MAX" =~ ^[0-9]+$ \
+        || ! "$ENV_PLATFORM" =~ ^(quiet|balanced|performance|custom)$ \
+        || ! "$ENV_RGB" =~ ^(off|low|medium|high|-)$ \
+        || " $GPU_POLICY_LEVELS " != *" $ENV_GPU_LEVEL "* || ! "$ENV_GPU_MODE" =~ ^([A-Z0-9_]+|-)$ ]]; then
+        echo "Error: invalid envelope for '$profile' (check $ENVELOPE_CONFIG)" >&2
+        return 1
+    fi
+}
+
+# --- Live State ---
+
+# Run z13ctl, elevating through the installer's sudoers rule if needed
+# Args: z13ctl arguments
+# Returns: z13ctl's exit status
+envelope_z13ctl() {
+    z13ctl "$@" >/dev/null 2>&1 || sudo -n z13ctl "$@" >/dev/null 2>&1
+}
+
+# Read the platform profile, sustained TDP and RGB brightness from z13ctl
+# Sets: ENVELOPE_PREV_PLATFORM, ENVELOPE_PREV_TDP, ENVELOPE_PREV_RGB
+#       (empty when z13ctl does not report them)
+envelope_read_power() {
+    local status line lower
+    ENVELOPE_PREV_PLATFORM=""
+    ENVELOPE_PREV_TDP=""
+    ENVELOPE_PREV_RGB=""
+    command -v z13ctl >/dev/null 2>&1 || return 0
+    status=$(z13ctl status 2>/dev/null || sudo -n z13ctl status 2>/dev/null) || return 0
+
+    while IFS= read -r line; do
+        lower="${line,,}"
+        if [[ -z "$ENVELOPE_PREV_PLATFORM" && "$lower" == *profile*:* ]]; then
+            ENVELOPE_PREV_PLATFORM="${lower#*:}"
+            ENVELOPE_PREV_PLATFORM="${ENVELOPE_PREV_PLATFORM//[[:space:]]/}"
+        elif [[ -z "$ENVELOPE_PREV_TDP" && "$lower" == *tdp* && "$lower" =~ ([0-9]+)w ]]; then
+            ENVELOPE_PREV_TDP="${BASH_REMATCH[1]}"
+        elif [[ -z "$ENVELOPE_PREV_RGB" && "$lower" == *brightness* && "$lower" =~ (off|low|medium|high) ]]; then
+            ENVELOPE_PREV_RGB="${BASH_REMATCH[1]}"
+        fi
+    done <<< "$status"
+    [[ "$ENVELOPE_PREV_PLATFORM" =~ ^(quiet|balanced|performance|custom)$ ]] || ENVELOPE_PREV_PLATFORM=""
+}
+
+# Set the GPU power policy, elevating through gz302-gpu's sudoers rule
+# Args: $1 = performance level, $2 = workload or "-"
+# Returns: 0 if the driver reads back the requested policy
+envelope_gpu_policy() {
+    if [[ $EUID -eq 0 ]]; then
+        gpu_set_power_policy "$1" "$2" >/dev/null 2>&1
+    else
+        sudo -n "$ENVELOPE_GPU_CMD" policy set "$1" "$2" >/dev/null 2>&1
+    fi
+}
+
+# Pick the output the envelope's refresh rate applies to (internal panel)
+# Sets: ENVELOPE_OUTPUT (empty without a display session)
+envelope_detect_output() {
+    local out
+    ENVELOPE_OUTPUT=""
+    [[ -n "${DISPLAY:-}${WAYLAND_DISPLAY:-}" ]] || return 0
+    display_detect_backend
+    for out in $DISPLAY_OUTPUT_ORDER; do
+        if [[ "$out" == eDP* || "$out" == *-eDP-* ]]; then
+            ENVELOPE_OUTPUT="$out"
+            return 0
+        fi
+    done
+    ENVELOPE_OUTPUT="${DISPLAY_OUTPUT_ORDER%% *}"
+}
+
+# --- Steps ---
+# Each step is envelope_step_<name> apply|undo. "apply" records the value it
+# replaces and sets ENVELOPE_ERROR on failure; "undo" puts it back. A step
+# with nothing to act on (no z13ctl, no display session) succeeds as a no-op.
+
+# Platform profile and sustained TDP
+envelope_step_power() {
+    local -a tdp
+    command -v z13ctl >/dev/null 2>&1 || return 0
+    if [[ "$1" == "apply" ]]; then
+        envelope_z13ctl profile --set "$ENV_PLATFORM" || {
+            ENVELOPE_ERROR="z13ctl could not set the ${ENV_PLATFORM} platform profile"
+            return 1
+        }
+        [[ "$ENV_TDP" == "-" ]] && return 0
+        tdp=("$ENV_TDP")
+        (( ENV_TDP > ENVELOPE_TDP_FORCE_ABOVE )) && tdp+=(--force)
+        envelope_z13ctl tdp --set "${tdp[@]}" || {
+            # A failed step is not undone by the caller: put back the profile
+            # (and the TDP it implies) here
+            envelope_step_power undo || true
+            ENVELOPE_ERROR="z13ctl could not set the TDP to ${ENV_TDP}W"
+            return 1
+        }
+        return 0
+    fi
+    if [[ -n "$ENVELOPE_PREV_PLATFORM" ]]; then
+        envelope_z13ctl profile --set "$ENVELOPE_PREV_PLATFORM" || return 1
+    fi
+    if [[ -n "$ENVELOPE_PREV_TDP" ]]; then
+        tdp=("$ENVELOPE_PREV_TDP")
+        (( ENVELOPE_PREV_TDP > ENVELOPE_TDP_FORCE_ABOVE )) && tdp+=(--force)
+        envelope_z13ctl tdp --set "${tdp[@]}" || return 1
+    fi
+    return 0
+}
+
+# GPU performance level and workload profile (verified by readback)
+envelope_step_gpu() {
+    local level mode
+    gpu_read_power_policy || return 0
+    if [[ "$1" == "apply" ]]; then
+        ENVELOPE_PREV_GPU="$GPU_POLICY_LEVEL ${GPU_POLICY_MODE:--}"
+        mode="$ENV_GPU_MODE"
+        [[ -n "${GPU_POLICY_INDEX[$mode]:-}" ]] || mode="-"
+        if [[ "$GPU_POLICY_LEVEL" == "$ENV_GPU_LEVEL" ]] \
+                && [[ "$mode" == "-" || " $GPU_POLICY_ACTIVE " == *" $mode "* ]]; then
+            return 0
+        fi
+        if ! envelope_gpu_policy "$ENV_GPU_LEVEL" "$mode"; then
+            # The level may have been written before the workload failed
+            read -r level mode <<< "$ENVELOPE_PREV_GPU"
+            envelope_gpu_policy "$level" "$mode" || true
+            ENVELOPE_ERROR="the GPU did not take ${ENV_GPU_LEVEL}/${ENV_GPU_MODE} (see: gz302 gpu policy)"
+            return 1
+        fi
+        return 0
+    fi
+    read -r level mode <<< "$ENVELOPE_PREV_GPU"
+    [[ -n "$level" ]] || return 0
+    envelope_gpu_policy "$level" "$mode"
+}
+
+# Internal panel refresh rate
+envelope_step_refresh() {
+    [[ -n "$ENVELOPE_OUTPUT" ]] || return 0
+    if [[ "$1" == "apply" ]]; then
+        ENVELOPE_PREV_REFRESH=$(display_get_current_refresh "$ENVELOPE_OUTPUT")
+        [[ "$ENVELOPE_PREV_REFRESH" == "$ENV_REFRESH" ]] && return 0
+        display_set_rate "$ENVELOPE_OUTPUT" "$ENV_REFRESH" || {
+            ENVELOPE_ERROR="${ENVELOPE_OUTPUT} does not accept ${ENV_REFRESH}Hz"
+            return 1
+        }
+        return 0
+    fi
+    [[ "$ENVELOPE_PREV_REFRESH" == "$ENV_REFRESH" ]] || display_set_rate "$ENVELOPE_OUTPUT" "$ENVELOPE_PREV_REFRESH"
+}
+
+# VRR range (recorded for rrcfg while VRR is enabled and the file is writable)
+envelope_step_vrr() {
+    display_vrr_enabled || return 0
+    [[ -w "$DISPLAY_VRR_RANGES_FILE" || -w "$DISPLAY_CONFIG_DIR" ]] || return 0
+    if [[ "$1" == "apply" ]]; then
+        ENVELOPE_PREV_VRR=""
+        [[ -r "$DISPLAY_VRR_RANGES_FILE" ]] && read -r ENVELOPE_PREV_VRR < "$DISPLAY_VRR_RANGES_FILE"
+        echo "${ENV_VRR_MIN}:${ENV_VRR_MAX}" > "$DISPLAY_VRR_RANGES_FILE" || {
+            ENVELOPE_ERROR="could not write $DISPLAY_VRR_RANGES_FILE"
+            return 1
+        }
+        return 0
+    fi
+    if [[ -n "$ENVELOPE_PREV_VRR" ]]; then
+        echo "$ENVELOPE_PREV_VRR" > "$DISPLAY_VRR_RANGES_FILE"
+    else
+        rm -f "$DISPLAY_VRR_RANGES_FILE"
+    fi
+}
+
+# Frame caps (profile default and per-game MangoHud configs)
+envelope_step_fps() {
+    local fps profile
+    if [[ "$1" == "apply" ]]; then
+        display_active_profile
+        ENVELOPE_PREV_FPS="$DISPLAY_ACTIVE_FPS $DISPLAY_ACTIVE_PROFILE"
+        display_set_frame_limit "$ENV_FPS" "$ENV_PROFILE" >/dev/null 2>&1 || {
+            ENVELOPE_ERROR="could not write the per-game frame limits"
+            return 1
+        }
+        return 0
+    fi
+    read -r fps profile <<< "$ENVELOPE_PREV_FPS"
+    display_set_frame_limit "$fps" "$profile" >/dev/null 2>&1
+}
+
+# Keyboard/lightbar brightness
+envelope_step_rgb() {
+    [[ "$ENV_RGB" != "-" ]] || return 0
+    command -v z13ctl >/dev/null 2>&1 || return 0
+    if [[ "$1" == "apply" ]]; then
+        envelope_z13ctl brightness "$ENV_RGB" || {
+            ENVELOPE_ERROR="z13ctl could not set the brightness to ${ENV_RGB}"
+            return 1
+        }
+        return 0
+    fi
+    if [[ -n "$ENVELOPE_PREV_RGB" ]]; then
+        envelope_z13ctl brightness "$ENVELOPE_PREV_RGB"
+    fi
+}
+
+# Describe a step's target for progress output
+# Args: $1 = step name
+# Output: Description
+envelope_describe_step() {
+    case "$1" in
+        power)   echo "platform ${ENV_PLATFORM}, TDP $([[ "$ENV_TDP" == "-" ]] && echo "firmware default" || echo "${ENV_TDP}W")" ;;
+        refresh) echo "${ENVELOPE_OUTPUT:-no display session} at ${ENV_REFRESH}Hz" ;;
+        vrr)     echo "VRR range ${ENV_VRR_MIN}-${ENV_VRR_MAX}Hz" ;;
+        fps)     [[ "$ENV_FPS" == "0" ]] && echo "no frame cap" || echo "frame cap ${ENV_FPS}fps" ;;
+        rgb)     [[ "$ENV_RGB" == "-" ]] && echo "lighting unchanged" || echo "RGB brightness ${ENV_RGB}" ;;
+        gpu)     echo "GPU level ${ENV_GPU_LEVEL}, workload $([[ "$ENV_GPU_MODE" == "-" ]] && echo "unchanged" || echo "$ENV_GPU_MODE")" ;;
+    esac
+}
+
+# --- Application ---
+
+# Step order for moving to the resolved envelope
+# Lowering the power budget drops the display demand first and raising it
+# raises the budget first, so no intermediate state asks for more than the
+# higher of the two TDPs allows.
+# Output: Space-separated step names
+envelope_step_order() {
+    if [[ "$ENV_TDP" != "-" && -n "$ENVELOPE_PREV_TDP" ]] && (( ENV_TDP < ENVELOPE_PREV_TDP )); then
+        echo "refresh vrr fps gpu power rgb"
+    else
+        echo "power gpu refresh vrr fps rgb"
+    fi
+}
+
+# Record the applied envelope for status and the adaptive refresh daemon
+envelope_save_state() {
+    mkdir -p "${ENVELOPE_STATE_FILE%/*}" 2>/dev/null || return 0
+    {
+        echo "PROFILE=$ENV_PROFILE"
+        echo "PLATFORM=$ENV_PLATFORM"
+        echo "TDP=$ENV_TDP"
+        echo "REFRESH=$ENV_REFRESH"
+        echo "VRR=${ENV_VRR_MIN}-${ENV_VRR_MAX}"
+        echo "FPS=$ENV_FPS"
+        echo "RGB=$ENV_RGB"
+        echo "GPU=${ENV_GPU_LEVEL}:${ENV_GPU_MODE}"
+        echo "APPLIED=$EPOCHSECONDS"
+    } > "$ENVELOPE_STATE_FILE" 2>/dev/null || true
+}
+
+# Apply a profile's envelope as one operation, rolling back on failure
+# Args: $1 = profile name, $2 = "--dry-run" to only print the plan
+# Returns: 0 when applied, 1 when rolled back or invalid, 2 if another apply
+#          holds the lock
+envelope_apply() {
+    local profile="$1"
+    local mode="${2:-}"
+    local lock_fd step i
+
+    if ! envelope_resolve "$profile"; then
+        envelope_profile_valid "$profile" || echo "Error: Unknown profile '$profile'" >&2
+        return 1
+    fi
+
+    # Tray and CLI may race (e.g. auto-switch on plug-in)
+    if ! exec {lock_fd}>>"$ENVELOPE_LOCK_FILE"; then
+        echo "Error: cannot open $ENVELOPE_LOCK_FILE (re-run the installer)" >&2
+        return 2
+    fi
+    if ! flock -w 30 "$lock_fd"; then
+        echo "Error: another envelope change is still running" >&2
+        exec {lock_fd}>&-
+        return 2
+    fi
+
+    envelope_read_power
+    envelope_detect_output
+    ENVELOPE_DONE=()
+    ENVELOPE_ERROR=""
+
+    echo "Applying envelope: $profile"
+    for step in $(envelope_step_order); do
+        if [[ "$mode" == "--dry-run" ]]; then
+            echo "  • $(envelope_describe_step "$step")"
+            continue
+        fi
+        if ! "envelope_step_${step}" apply; then
+            echo "  ✗ $(envelope_describe_step "$step"): ${ENVELOPE_ERROR:-failed}" >&2
+            echo "Rolling back to the previous state..." >&2
+            for ((i = ${#ENVELOPE_DONE[@]} - 1; i >= 0; i--)); do
+                if "envelope_step_${ENVELOPE_DONE[i]}" undo; then
+                    echo "  ↺ ${ENVELOPE_DONE[i]} restored" >&2
+                else
+                    echo "  ⚠ ${ENVELOPE_DONE[i]} could not be restored" >&2
+                fi
+            done
+            exec {lock_fd}>&-
+            return 1
+        fi
+        ENVELOPE_DONE+=("$step")
+        echo "  ✓ $(envelope_describe_step "$step")"
+    done
+
+    [[ "$mode" == "--dry-run" ]] || envelope_save_state
+    exec {lock_fd}>&-
+    return 0
+}
+
+# --- Status Display ---
+
+# List the envelopes with their resolved values
+envelope_list() {
+    local profile tdp fps
+    printf "  %-12s %-12s %6s %7s %9s %6s %6s  %s\n" "PROFILE" "PLATFORM" "TDP" "REFRESH" "VRR" "FPS" "RGB" "GPU"
+    for profile in $ENVELOPE_ORDER; do
+        envelope_resolve "$profile" 2>/dev/null || continue
+        [[ "$ENV_TDP" == "-" ]] && tdp="-" || tdp="${ENV_TDP}W"
+        [[ "$ENV_FPS" == "0" ]] && fps="-" || fps="$ENV_FPS"
+        printf "  %-12s %-12s %6s %5sHz %9s %6s %6s  %s\n" "$profile" "$ENV_PLATFORM" "$tdp" \
+            "$ENV_REFRESH" "${ENV_VRR_MIN}-${ENV_VRR_MAX}" "$fps" "$ENV_RGB" "${ENV_GPU_LEVEL}/${ENV_GPU_MODE}"
+    done
+}
+
+# Show the last applied envelope and whether the live state still matches
+envelope_print_status() {
+    local key value joined profile="" applied=""
+    local -a drift=()
+
+    if [[ -r "$ENVELOPE_STATE_FILE" ]]; then
+        while IFS='=' read -r key value; do
+            case "$key" in
+                PROFILE) profile="$value" ;;
+                APPLIED) applied="$value" ;;
+            esac
+        done < "$ENVELOPE_STATE_FILE"
+    fi
+
+    echo "Performance Envelope:"
+    if [[ -z "$profile" ]] || ! envelope_resolve "$profile" 2>/dev/null; then
+        echo "  Applied:   none (use: gz302 envelope <profile>)"
+        return 0
+    fi
+    echo "  Applied:   $profile ($(date -d "@${applied:-0}" '+%Y-%m-%d %H:%M' 2>/dev/null || echo unknown))"
+    for key in power gpu refresh vrr fps rgb; do
+        [[ "$key" == "refresh" ]] && envelope_detect_output
+        printf "  %-10s %s\n" "${key}:" "$(envelope_describe_step "$key")"
+    done
+
+    envelope_read_power
+    if [[ -n "$ENVELOPE_PREV_PLATFORM" && "$ENVELOPE_PREV_PLATFORM" != "$ENV_PLATFORM" ]]; then
+        drift+=("platform is $ENVELOPE_PREV_PLATFORM")
+    fi
+    if [[ "$ENV_TDP" != "-" && -n "$ENVELOPE_PREV_TDP" && "$ENVELOPE_PREV_TDP" != "$ENV_TDP" ]]; then
+        drift+=("TDP is ${ENVELOPE_PREV_TDP}W")
+    fi
+    if gpu_read_power_policy; then
+        if [[ "$GPU_POLICY_LEVEL" != "$ENV_GPU_LEVEL" ]]; then
+            drift+=("GPU level is $GPU_POLICY_LEVEL")
+        fi
+        if [[ -n "${GPU_POLICY_INDEX[$ENV_GPU_MODE]:-}" && " $GPU_POLICY_ACTIVE " != *" $ENV_GPU_MODE "* ]]; then
+            drift+=("GPU workload is ${GPU_POLICY_ACTIVE:-unknown}")
+        fi
+    fi
+    if [[ -n "$ENVELOPE_OUTPUT" ]]; then
+        value=$(display_get_current_refresh "$ENVELOPE_OUTPUT")
+        [[ "$value" == "$ENV_REFRESH" ]] || drift+=("${ENVELOPE_OUTPUT} is at ${value}Hz")
+    fi
+
+    if [[ ${#drift[@]} -eq 0 ]]; then
+        echo "  State:     in sync"
+    else
+        printf -v joined '%s, ' "${drift[@]}"
+        echo "  State:     drifted (${joined%, }) - re-apply with: gz302 envelope $profile"
+    fi
+}
+
+# --- Installation Support ---
+
+# Get the gz302-envelope command for installation
+envelope_get_script() {
+    cat <<'ENVELOPE_SCRIPT'
+#!/bin/bash
+# GZ302 Performance Envelope (gz302-envelope)
+# Applies a profile's TDP, GPU power policy, refresh rate, VRR range, frame
+# cap and RGB brightness together, rolling back if any part fails. Run it as
+# the desktop user: the refresh rate is set through the session's display
+# server and z13ctl and gz302-gpu are elevated through the installer's
+# sudoers rule.
+
+set -euo pipefail
+
+LIB_PATH="/usr/local/share/gz302/gz302-lib"
+if [[ -f "$LIB_PATH/envelope-manager.sh" ]]; then
+    source "$LIB_PATH/envelope-manager.sh"
+else
+    echo "Error: envelope-manager.sh not found at $LIB_PATH" >&2
+    exit 1
+fi
+
+usage() {
+    echo "Usage: gz302-envelope [apply] PROFILE [--dry-run] | list | status"
+    echo ""
+    envelope_list
+    echo ""
+    echo "Commands:"
+    echo "  PROFILE     - Apply the profile's envelope (rolled back on failure)"
+    echo "  list        - Show every envelope"
+    echo "  status      - Show the applied envelope and any drift"
+    echo ""
+    echo "Overrides: $ENVELOPE_CONFIG (e.g. battery.refresh=48, gaming.rgb=high)"
+}
+
+case "${1:-}" in
+    apply)
+        [[ -n "${2:-}" ]] || { usage >&2; exit 1; }
+        envelope_apply "$2" "${3:-}"
+        ;;
+    list)
+        envelope_list
+        ;;
+    status)
+        envelope_print_status
+        ;;
+    help|--help|-h|"")
+        usage
+        ;;
+    *)
+        if envelope_profile_valid "$1"; then
+            envelope_apply "$1" "${2:-}"
+        else
+            echo "Error: Unknown profile '$1'" >&2
+            echo "Use 'gz302-envelope help' for usage" >&2
+            exit 1
+        fi
+        ;;
+esac
+ENVELOPE_SCRIPT
+}
+
+# Get the default overrides file for installation
+envelope_get_config() {
+    cat <<'ENVELOPE_CONFIG'
+# GZ302 performance envelope overrides
+# One "<profile>.<key>=<value>" per line; anything not set here uses the
+# built-in envelope (see: gz302 envelope list).
+#
+# Keys:
+#   platform  z13ctl platform profile (quiet, balanced, performance, custom)
+#   tdp       sustained TDP in watts, or - for the platform profile's default
+#   refresh   internal panel refresh rate in Hz
+#   vrr       VRR range as MIN-MAX
+#   fps       frame cap for games without their own rule, 0 for none
+#             (per-game caps: ~/.config/gz302/game-profiles.conf)
+#   rgb       keyboard/lightbar brightness (off, low, medium, high), or -
+#   gpu_level amdgpu power_dpm_force_performance_level (auto, low, high, ...)
+#   gpu_mode  amdgpu pp_power_profile_mode workload (3D_FULL_SCREEN,
+#             POWER_SAVING, VIDEO, COMPUTE, ...), or - (see: gz302 gpu policy)
+#
+# battery.refresh=48
+# gaming.rgb=high
+# performance.gpu_mode=COMPUTE
+ENVELOPE_CONFIG
+}
+
+# --- Library Info ---
+envelope_lib_version() {
+    echo "1.1.0"
+}
+
+envelope_lib_help() {
+    echo "GZ302 Performance Envelope Library"
+    echo ""
+    echo "Functions:"
+    echo "  envelope_resolve        - Resolve a profile's envelope (tables + overrides)"
+    echo "  envelope_apply          - Apply an envelope in order, rolling back on failure"
+    echo "  envelope_list           - List every envelope"
+    echo "  envelope_print_status   - Show the applied envelope and drift"
+    echo "  envelope_lib_version    - Show library version"
+    echo "  envelope_lib_help       - Show this help"
+}
@@ -4,7 +4,7 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 GPU Manager Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library manages AMD Radeon 8060S (RDNA 3.5) integrated GPU configuration
 # for the GZ302 (Strix Halo platform).
@@ -15,6 +15,9 @@ set -euo pipefail
 # - Power feature mask configuration
 # - Kernel parameter management
 # - ROCm compatibility setup
+# - Live telemetry from gpu_metrics and hwmon
+# - Runtime power policy (performance level, workload profile)
+# - Unified memory (GTT/TTM) limits sized to LLM workloads
 #
 # Usage:
 #   source gz302-lib/gpu-manager.sh
@@ -266,6 +269,7 @@ gpu_apply_modprobe_config() {
     fi
     
     # Create modprobe configuration
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/modprobe.d/amdgpu.conf gpu
     cat > /etc/modprobe.d/amdgpu.conf <<'EOF'
 # AMD GPU configuration for Radeon 8060S (RDNA 3.5, integrated)
 # Strix Halo specific: Phoenix/Navi33 equivalent
@@ -405,7 +409,11 @@ gpu_configure_early_kms() {
     if [[ "$modules_line" != *"amdgpu"* ]]; then
         echo "Enabling Early KMS for amdgpu (fixes boot/reboot freeze)..."
         # Backup
-        cp /etc/mkinitcpio.conf /etc/mkinitcpio.conf.bak
+        if declare -f backup_config_file >/dev/null; then
+            backup_config_file /etc/mkinitcpio.conf gpu
+        else
+            cp /etc/mkinitcpio.conf /etc/mkinitcpio.conf.bak
+        fi
         
         # Add amdgpu to MODULES. Robustly handles () or (module1 module2)
         sed -i -E 's/^MODULES=\((.*)\)/MODULES=(\1 amdgpu)/' /etc/mkinitcpio.conf
@@ -516,15 +524,937 @@ gpu_print_status() {
     fi
 }
 
+# --- Telemetry (read-only, no forks) ---
+# Decodes the SMU's gpu_metrics table and the amdgpu hwmon nodes with bash
+# builtins only, so it is cheap enough to poll from a watch loop or the tray.
+
+GPU_DRM_ROOT="${GPU_DRM_ROOT:-/sys/class/drm}"
+
+# Bytes of gpu_metrics_v3_0 that are decoded (through average_uclk_frequency)
+GPU_METRICS_READ_BYTES=188
+
+# Find the amdgpu device that exposes gpu_metrics
+# Sets: GPU_DEVICE_DIR (cached after the first successful lookup)
+# Returns: 0 if found, 1 if not
+gpu_find_device() {
+    if [[ -n "${GPU_DEVICE_DIR:-}" && -r "$GPU_DEVICE_DIR/gpu_metrics" ]]; then
+        return 0
+    fi
+    GPU_DEVICE_DIR=""
+    local dev
+    for dev in "$GPU_DRM_ROOT"/card*/device; do
+        if [[ -r "$dev/gpu_metrics" ]]; then
+            GPU_DEVICE_DIR="$dev"
+            return 0
+        fi
+    done
+    return 1
+}
+
+# Little-endian field at a byte offset of GPU_METRICS_BYTES
+# Args: $1 = offset, $2 = width in bytes (2 or 4)
+# Sets: _GPU_FIELD (empty when the SMU reports the field as unavailable)
+_gpu_metrics_field() {
+    local width=$2 b=("${GPU_METRICS_BYTES[@]:$1:$2}")
+    _GPU_FIELD=""
+    ((${#b[@]} == width)) || return 0
+    if ((width == 2)); then
+        _GPU_FIELD=$((b[0] | b[1] << 8))
+        ((_GPU_FIELD != 0xFFFF)) || _GPU_FIELD=""
+    else
+        _GPU_FIELD=$((b[0] | b[1] << 8 | b[2] << 16 | b[3] << 24))
+        ((_GPU_FIELD != 0xFFFFFFFF)) || _GPU_FIELD=""
+    fi
+}
+
+# Format a centi-degree reading as degrees with one decimal
+# Args: $1 = centi-degrees (may be empty)
+# Sets: _GPU_FIELD
+_gpu_centi_to_c() {
+    _GPU_FIELD=""
+    [[ -n "$1" ]] || return 0
+    _GPU_FIELD="$(($1 / 100)).$((($1 % 100) / 10))"
+}
+
+# Decode gpu_metrics (format 3.0, Strix Point/Halo SMU 14.0.x)
+# Sets: GPU_METRICS_FORMAT, GPU_TEMP_GFX_C, GPU_TEMP_SOC_C, GPU_GFX_ACTIVITY,
+#       GPU_SOCKET_POWER_MW, GPU_GFX_POWER_MW, GPU_STAPM_LIMIT_MW,
+#       GPU_GFXCLK_MHZ, GPU_SOCCLK_MHZ, GPU_FCLK_MHZ, GPU_UCLK_MHZ
+# Returns: 0 if decoded, 1 if missing, truncated or an unknown format
+gpu_read_metrics() {
+    GPU_METRICS_FORMAT="" GPU_TEMP_GFX_C="" GPU_TEMP_SOC_C="" GPU_GFX_ACTIVITY=""
+    GPU_SOCKET_POWER_MW="" GPU_GFX_POWER_MW="" GPU_STAPM_LIMIT_MW=""
+    GPU_GFXCLK_MHZ="" GPU_SOCCLK_MHZ="" GPU_FCLK_MHZ="" GPU_UCLK_MHZ=""
+    gpu_find_device || return 1
+
+    # One read per byte; NUL comes back as an empty string. The fd stays open
+    # for the whole loop so the kernel generates the table once.
+    local LC_ALL=C ch v
+    GPU_METRICS_BYTES=()
+    while ((${#GPU_METRICS_BYTES[@]} < GPU_METRICS_READ_BYTES)) \
+            && IFS= read -r -d "" -n 1 ch; do
+        if [[ -z "$ch" ]]; then
+            GPU_METRICS_BYTES+=(0)
+        else
+            printf -v v %d "'$ch"
+            GPU_METRICS_BYTES+=($((v & 255)))
+        fi
+    done 2>/dev/null < "$GPU_DEVICE_DIR/gpu_metrics" || true
+    ((${#GPU_METRICS_BYTES[@]} >= 4)) || return 1
+
+    # Header: u16 structure_size, u8 format_revision, u8 content_revision
+    GPU_METRICS_FORMAT="${GPU_METRICS_BYTES[2]}.${GPU_METRICS_BYTES[3]}"
+    if [[ "$GPU_METRICS_FORMAT" != "3.0" ]] \
+            || ((${#GPU_METRICS_BYTES[@]} < GPU_METRICS_READ_BYTES)); then
+        return 1
+    fi
+
+    _gpu_metrics_field 4 2;   _gpu_centi_to_c "$_GPU_FIELD"; GPU_TEMP_GFX_C=$_GPU_FIELD
+    _gpu_metrics_field 6 2;   _gpu_centi_to_c "$_GPU_FIELD"; GPU_TEMP_SOC_C=$_GPU_FIELD
+    _gpu_metrics_field 42 2;  GPU_GFX_ACTIVITY=$_GPU_FIELD
+    _gpu_metrics_field 112 4; GPU_SOCKET_POWER_MW=$_GPU_FIELD
+    _gpu_metrics_field 124 4; GPU_GFX_POWER_MW=$_GPU_FIELD
+    _gpu_metrics_field 172 2; GPU_STAPM_LIMIT_MW=$_GPU_FIELD
+    _gpu_metrics_field 174 2; GPU_GFXCLK_MHZ=$_GPU_FIELD
+    _gpu_metrics_field 176 2; GPU_SOCCLK_MHZ=$_GPU_FIELD
+    _gpu_metrics_field 182 2; GPU_FCLK_MHZ=$_GPU_FIELD
+    _gpu_metrics_field 186 2; GPU_UCLK_MHZ=$_GPU_FIELD
+    return 0
+}
+
+# Read the amdgpu hwmon sensors and gpu_busy_percent
+# Sets: GPU_HWMON_TEMP_C, GPU_HWMON_POWER_MW, GPU_HWMON_SCLK_MHZ, GPU_BUSY_PERCENT
+# Returns: 0 if any sensor was read, 1 if none
+gpu_read_hwmon() {
+    GPU_HWMON_TEMP_C="" GPU_HWMON_POWER_MW="" GPU_HWMON_SCLK_MHZ="" GPU_BUSY_PERCENT=""
+    gpu_find_device || return 1
+
+    local hwmon="" dir name="" v
+    for dir in "$GPU_DEVICE_DIR"/hwmon/hwmon*; do
+        if [[ -r "$dir/name" ]] && read -r name < "$dir/name" && [[ "$name" == amdgpu ]]; then
+            hwmon="$dir"
+            break
+        fi
+    done
+
+    if [[ -r "$GPU_DEVICE_DIR/gpu_busy_percent" ]] \
+            && read -r v 2>/dev/null < "$GPU_DEVICE_DIR/gpu_busy_percent"; then
+        GPU_BUSY_PERCENT=$v
+    fi
+    if [[ -n "$hwmon" ]]; then
+        # temp1 is millidegrees, power1 microwatts, freq1 (sclk) hertz
+        if read -r v 2>/dev/null < "$hwmon/temp1_input"; then
+            _gpu_centi_to_c "$((v / 10))"; GPU_HWMON_TEMP_C=$_GPU_FIELD
+        fi
+        if read -r v 2>/dev/null < "$hwmon/power1_average" \
+                || read -r v 2>/dev/null < "$hwmon/power1_input"; then
+            GPU_HWMON_POWER_MW=$((v / 1000))
+        fi
+        if read -r v 2>/dev/null < "$hwmon/freq1_input"; then
+            GPU_HWMON_SCLK_MHZ=$((v / 1000000))
+        fi
+    fi
+    [[ -n "$GPU_BUSY_PERCENT$GPU_HWMON_TEMP_C$GPU_HWMON_POWER_MW$GPU_HWMON_SCLK_MHZ" ]]
+}
+
+# Read gpu_metrics and hwmon, filling gaps in the former from the latter
+# Sets: the gpu_read_metrics globals, GPU_TELEMETRY_SOURCE, GPU_TELEMETRY_VERDICT
+# Returns: 0 if any telemetry is available, 1 if none
+gpu_read_telemetry() {
+    GPU_TELEMETRY_SOURCE="none"
+    GPU_TELEMETRY_VERDICT=""
+    if gpu_read_metrics; then
+        GPU_TELEMETRY_SOURCE="gpu_metrics-${GPU_METRICS_FORMAT}"
+    fi
+    if gpu_read_hwmon; then
+        [[ "$GPU_TELEMETRY_SOURCE" != none ]] || GPU_TELEMETRY_SOURCE="hwmon"
+        : "${GPU_TEMP_GFX_C:=$GPU_HWMON_TEMP_C}"
+        : "${GPU_GFX_ACTIVITY:=$GPU_BUSY_PERCENT}"
+        : "${GPU_SOCKET_POWER_MW:=$GPU_HWMON_POWER_MW}"
+        : "${GPU_GFXCLK_MHZ:=$GPU_HWMON_SCLK_MHZ}"
+    fi
+    [[ "$GPU_TELEMETRY_SOURCE" != none ]] || return 1
+
+    # Which limit the current profile is hitting: the socket at its STAPM
+    # limit means more TDP would help; a saturated GFX engine below it means
+    # the workload is GPU-bound at this profile.
+    if [[ -n "$GPU_SOCKET_POWER_MW" && -n "$GPU_STAPM_LIMIT_MW" ]] \
+            && ((GPU_STAPM_LIMIT_MW > 0 && GPU_SOCKET_POWER_MW * 100 >= GPU_STAPM_LIMIT_MW * 95)); then
+        GPU_TELEMETRY_VERDICT="power-limited"
+    elif [[ -n "$GPU_GFX_ACTIVITY" ]] && ((GPU_GFX_ACTIVITY >= 90)); then
+        GPU_TELEMETRY_VERDICT="gpu-bound"
+    elif [[ -n "$GPU_GFX_ACTIVITY" ]]; then
+        GPU_TELEMETRY_VERDICT="headroom"
+    fi
+    return 0
+}
+
+# Get a telemetry snapshot
+# Output: key=value lines (empty value = not reported by this kernel/firmware)
+# Returns: 0 if any telemetry is available, 1 if none
+gpu_get_telemetry() {
+    gpu_read_telemetry || return 1
+    printf '%s=%s\n' \
+        source "$GPU_TELEMETRY_SOURCE" \
+        temp_gfx_c "$GPU_TEMP_GFX_C" \
+        temp_soc_c "$GPU_TEMP_SOC_C" \
+        gfx_activity_pct "$GPU_GFX_ACTIVITY" \
+        socket_power_mw "$GPU_SOCKET_POWER_MW" \
+        gfx_power_mw "$GPU_GFX_POWER_MW" \
+        stapm_limit_mw "$GPU_STAPM_LIMIT_MW" \
+        gfxclk_mhz "$GPU_GFXCLK_MHZ" \
+        socclk_mhz "$GPU_SOCCLK_MHZ" \
+        fclk_mhz "$GPU_FCLK_MHZ" \
+        uclk_mhz "$GPU_UCLK_MHZ" \
+        verdict "$GPU_TELEMETRY_VERDICT"
+}
+
+# Format milliwatts as watts with one decimal
+# Args: $1 = milliwatts (may be empty)
+# Sets: _GPU_FIELD ("--" when empty)
+_gpu_mw_to_w() {
+    _GPU_FIELD="--"
+    [[ -n "$1" ]] || return 0
+    _GPU_FIELD="$(($1 / 1000)).$((($1 % 1000) / 100))"
+}
+
+# Print a telemetry snapshot (for user display)
+# Returns: 0 if any telemetry is available, 1 if none
+gpu_print_telemetry() {
+    if ! gpu_read_telemetry; then
+        echo "GPU telemetry: not available (no gpu_metrics or amdgpu hwmon under $GPU_DRM_ROOT)"
+        return 1
+    fi
+    local socket gfx limit
+    _gpu_mw_to_w "$GPU_SOCKET_POWER_MW"; socket=$_GPU_FIELD
+    _gpu_mw_to_w "$GPU_GFX_POWER_MW"; gfx=$_GPU_FIELD
+    _gpu_mw_to_w "$GPU_STAPM_LIMIT_MW"; limit=$_GPU_FIELD
+
+    echo "GPU Telemetry (${GPU_TELEMETRY_SOURCE}):"
+    echo "  GFX activity:  ${GPU_GFX_ACTIVITY:---}%"
+    echo "  GFX clock:     ${GPU_GFXCLK_MHZ:---} MHz"
+    echo "  SoC clock:     ${GPU_SOCCLK_MHZ:---} MHz"
+    echo "  Fabric/memory: ${GPU_FCLK_MHZ:---} / ${GPU_UCLK_MHZ:---} MHz"
+    echo "  Socket power:  ${socket} W (STAPM limit ${limit} W)"
+    echo "  GFX power:     ${gfx} W"
+    echo "  Temperature:   GFX ${GPU_TEMP_GFX_C:---}°C, SoC ${GPU_TEMP_SOC_C:---}°C"
+    if [[ -n "$GPU_TELEMETRY_VERDICT" ]]; then
+        echo "  Limit:         ${GPU_TELEMETRY_VERDICT}"
+    fi
+    if gpu_read_power_policy; then
+        echo "  Policy:        ${GPU_POLICY_LEVEL}, workload ${GPU_POLICY_ACTIVE:-unknown}"
+    fi
+}
+
+# Get gz302-gpu CLI script content
+# Output: Script content for installation to /usr/local/bin/gz302-gpu
+gpu_get_telemetry_script() {
+    cat <<'GPU_SCRIPT'
+#!/bin/bash
+# GZ302 GPU telemetry (gz302-gpu)
+# Shows GFX/SoC clocks, GFX activity, socket power and temperatures from the
+# SMU's gpu_metrics table and the amdgpu hwmon sensors. No root needed.
+# Also sets the runtime power policy and plans the GPU-mappable memory.
+
+set -euo pipefail
+
+LIB_PATH="/usr/local/share/gz302/gz302-lib"
+if [[ -f "$LIB_PATH/gpu-manager.sh" ]]; then
+    source "$LIB_PATH/gpu-manager.sh"
+else
+    echo "Error: gpu-manager.sh not found at $LIB_PATH" >&2
+    exit 1
+fi
+
+usage() {
+    echo "Usage: gz302-gpu [status | raw | watch [SECONDS] | policy [set LEVEL WORKLOAD] |"
+    echo "                  memory [plan | apply | verify] [MODEL...]]"
+    echo ""
+    echo "Commands:"
+    echo "  status      - Show a telemetry snapshot (default)"
+    echo "  raw         - Print the snapshot as key=value lines"
+    echo "  watch [N]   - Print one line every N seconds (default: 1) until Ctrl+C"
+    echo "  policy      - Show the performance level and workload profiles"
+    echo "  policy set LEVEL WORKLOAD"
+    echo "              - Set them (e.g. auto COMPUTE; WORKLOAD - keeps the current one)."
+    echo "                Performance envelopes set them per profile."
+    echo "  memory      - Show the GPU-mappable memory limit (GTT) and its use"
+    echo "  memory plan [MODEL...]"
+    echo "              - Size the limit for the models in $GPU_GTT_MODELS_CONF"
+    echo "                or given as 'NAME size=42G ctx=32768 ...' arguments"
+    echo "  memory apply [MODEL...]"
+    echo "              - Write the plan as module options and rebuild the initramfs"
+    echo "  memory verify"
+    echo "              - Check that the running kernel uses the plan (after a reboot)"
+    echo ""
+    echo "Limit: 'power-limited' means the socket is at its STAPM limit (a higher"
+    echo "profile would help); 'gpu-bound' means GFX is saturated below it."
+}
+
+watch_loop() {
+    local interval="$1" n=0 socket
+    [[ "$interval" =~ ^[0-9]+([.][0-9]+)?$ ]] || { echo "Error: invalid interval '$interval'" >&2; exit 1; }
+    gpu_read_telemetry || { gpu_print_telemetry; exit 1; }
+    # read -t on an idle pipe sleeps without forking sleep(1)
+    local sleep_fd
+    exec {sleep_fd}<> <(:)
+    while true; do
+        if ((n % 20 == 0)); then
+            printf '%-8s %5s %6s %6s %8s %8s %6s %6s  %s\n' \
+                TIME "GFX%" GFXCLK SOCCLK "SOCKET_W" "LIMIT_W" "GFX_C" "SOC_C" LIMIT
+        fi
+        gpu_read_telemetry || true
+        _gpu_mw_to_w "$GPU_SOCKET_POWER_MW"; socket=$_GPU_FIELD
+        _gpu_mw_to_w "$GPU_STAPM_LIMIT_MW"
+        printf '%(%H:%M:%S)T %5s %6s %6s %8s %8s %6s %6s  %s\n' -1 \
+            "${GPU_GFX_ACTIVITY:---}" "${GPU_GFXCLK_MHZ:---}" "${GPU_SOCCLK_MHZ:---}" \
+            "$socket" "$_GPU_FIELD" "${GPU_TEMP_GFX_C:---}" "${GPU_TEMP_SOC_C:---}" \
+            "${GPU_TELEMETRY_VERDICT:---}"
+        n=$((n + 1))
+        read -r -t "$interval" -u "$sleep_fd" _ || true
+    done
+}
+
+memory_command() {
+    local action="${1:-status}" rc=0
+    case "$action" in
+        status)
+            if gpu_read_gtt_live; then
+                _gpu_fmt_gib $((GPU_GTT_LIVE_PAGES * GPU_PAGE_BYTES))
+                echo "GTT limit:  $_GPU_FIELD GiB ($GPU_GTT_TTM_MODULE.pages_limit=$GPU_GTT_LIVE_PAGES)"
+            else
+                echo "GTT limit:  not readable (amdgpu not loaded?)"
+            fi
+            if [[ -n "$GPU_GTT_LIVE_TOTAL" && -n "$GPU_GTT_LIVE_USED" ]]; then
+                local used
+                _gpu_fmt_gib "$GPU_GTT_LIVE_USED"; used=$_GPU_FIELD
+                _gpu_fmt_gib "$GPU_GTT_LIVE_TOTAL"
+                echo "GTT in use: $used of $_GPU_FIELD GiB"
+            fi
+            gpu_verify_unified_memory || true
+            echo "Plan:       $GPU_GTT_VERIFY - $GPU_GTT_VERIFY_DETAIL"
+            ;;
+        plan|apply)
+            if [[ "$action" == apply && $EUID -ne 0 ]]; then
+                exec sudo "$0" memory apply "${@:2}"
+            fi
+            gpu_plan_unified_memory "${@:2}" || rc=$?
+            ((rc != 1)) || exit 1
+            gpu_print_unified_memory_plan
+            [[ "$action" == apply ]] || return 0
+            echo ""
+            gpu_apply_unified_memory || exit 1
+            echo "Wrote $GPU_GTT_CONF. Reboot, then run 'gz302-gpu memory verify'"
+            echo "(it is also checked at every boot: systemctl status gz302-gtt-verify)."
+            ;;
+        verify)
+            gpu_verify_unified_memory || rc=$?
+            echo "GPU memory plan: $GPU_GTT_VERIFY - $GPU_GTT_VERIFY_DETAIL"
+            return "$rc"
+            ;;
+        *)
+            echo "Error: Unknown memory command '$action'" >&2
+            usage >&2
+            exit 1
+            ;;
+    esac
+}
+
+case "${1:-status}" in
+    status)
+        gpu_print_telemetry
+        ;;
+    raw)
+        gpu_get_telemetry
+        ;;
+    watch)
+        watch_loop "${2:-1}"
+        ;;
+    policy)
+        if [[ "${2:-}" == "set" ]]; then
+            [[ -n "${3:-}" ]] || { usage >&2; exit 1; }
+            # Writing sysfs needs root; the installer's sudoers rule covers this
+            if [[ $EUID -ne 0 ]]; then
+                exec sudo -n "$0" policy set "$3" "${4:--}"
+            fi
+            gpu_set_power_policy "$3" "${4:--}"
+            echo "GPU policy: $GPU_POLICY_LEVEL, workload ${GPU_POLICY_ACTIVE:-unknown} (verified)"
+        else
+            gpu_read_power_policy || { echo "GPU policy: not available" >&2; exit 1; }
+            echo "Performance level: $GPU_POLICY_LEVEL"
+            echo "Active workload:   ${GPU_POLICY_ACTIVE:-unknown}"
+            echo "Offered workloads: ${GPU_POLICY_MODES:-none}"
+        fi
+        ;;
+    memory)
+        memory_command "${@:2}"
+        ;;
+    help|--help|-h)
+        usage
+        ;;
+    *)
+        echo "Error: Unknown command '$1'" >&2
+        usage >&2
+        exit 1
+        ;;
+esac
+GPU_SCRIPT
+}
+
+# --- Runtime Power Policy ---
+# power_dpm_force_performance_level chooses how the SMU picks clocks (auto,
+# low, high, manual, profile_*); pp_power_profile_mode chooses the workload
+# heuristic it applies within that (3D_FULL_SCREEN, POWER_SAVING, COMPUTE...).
+# Unlike the module options above these are runtime sysfs values, reset to
+# auto/BOOTUP_DEFAULT at every boot.
+
+GPU_POLICY_LEVELS="auto low high manual profile_standard profile_min_sclk profile_min_mclk profile_peak"
+
+# Read the runtime power policy
+# Sets: GPU_POLICY_LEVEL, GPU_POLICY_MODE (first active workload),
+#       GPU_POLICY_ACTIVE (all active workloads), GPU_POLICY_MODES (offered
+#       workloads), GPU_POLICY_INDEX (workload name -> index)
+# Returns: 0 if the performance level is readable, 1 if not
+gpu_read_power_policy() {
+    local line
+    GPU_POLICY_LEVEL="" GPU_POLICY_MODE="" GPU_POLICY_ACTIVE="" GPU_POLICY_MODES=""
+    declare -gA GPU_POLICY_INDEX=()
+    gpu_find_device || return 1
+    read -r GPU_POLICY_LEVEL 2>/dev/null < "$GPU_DEVICE_DIR/power_dpm_force_performance_level" || return 1
+
+    # "  1 3D_FULL_SCREEN*" on APUs; dGPUs add a header and per-clock rows
+    # ("   0(  GFXCLK) ...") that the pattern skips
+    while IFS= read -r line; do
+        [[ "$line" =~ ^[[:space:]]*([0-9]+)[[:space:]]+([A-Z0-9_]+)[[:space:]]*(\*)? ]] || continue
+        GPU_POLICY_INDEX[${BASH_REMATCH[2]}]="${BASH_REMATCH[1]}"
+        GPU_POLICY_MODES+="${GPU_POLICY_MODES:+ }${BASH_REMATCH[2]}"
+        if [[ -n "${BASH_REMATCH[3]}" ]]; then
+            GPU_POLICY_ACTIVE+="${GPU_POLICY_ACTIVE:+ }${BASH_REMATCH[2]}"
+            : "${GPU_POLICY_MODE:=${BASH_REMATCH[2]}}"
+        fi
+    done 2>/dev/null < "$GPU_DEVICE_DIR/pp_power_profile_mode" || true
+    return 0
+}
+
+# Set the runtime power policy and verify it by reading it back (root)
+# Args: $1 = performance level, $2 = workload name or "-" to keep the current one
+# Returns: 0 if the readback matches, 1 otherwise
+gpu_set_power_policy() {
+    local level="$1" mode="${2:--}"
+
+    if [[ " $GPU_POLICY_LEVELS " != *" $level "* ]]; then
+        echo "Error: unknown performance level '$level' (one of: $GPU_POLICY_LEVELS)" >&2
+        return 1
+    fi
+    if ! gpu_read_power_policy; then
+        echo "Error: no amdgpu power_dpm_force_performance_level under $GPU_DRM_ROOT" >&2
+        return 1
+    fi
+    if [[ "$mode" != "-" && -z "${GPU_POLICY_INDEX[$mode]:-}" ]]; then
+        echo "Error: workload '$mode' not offered (one of: ${GPU_POLICY_MODES:-none})" >&2
+        return 1
+    fi
+
+    if ! echo "$level" 2>/dev/null > "$GPU_DEVICE_DIR/power_dpm_force_performance_level"; then
+        echo "Error: could not write the performance level (root required)" >&2
+        return 1
+    fi
+    if [[ "$mode" != "-" ]] \
+            && ! echo "${GPU_POLICY_INDEX[$mode]}" 2>/dev/null > "$GPU_DEVICE_DIR/pp_power_profile_mode"; then
+        echo "Error: the driver rejected workload '$mode'" >&2
+        return 1
+    fi
+
+    # The driver can accept a write and keep the old value (e.g. a level
+    # the firmware does not support), so only the readback counts
+    gpu_read_power_policy || return 1
+    if [[ "$GPU_POLICY_LEVEL" != "$level" ]]; then
+        echo "Error: performance level reads back as '$GPU_POLICY_LEVEL', not '$level'" >&2
+        return 1
+    fi
+    if [[ "$mode" != "-" && " $GPU_POLICY_ACTIVE " != *" $mode "* ]]; then
+        echo "Error: active workload reads back as '${GPU_POLICY_ACTIVE:-none}', not '$mode'" >&2
+        return 1
+    fi
+    return 0
+}
+
+# --- Unified Memory (GTT/TTM) ---
+# The 8060S has only the small BIOS carve-out as VRAM; everything else a model
+# needs lives in system RAM mapped through GTT. TTM caps the pages the GPU may
+# pin (ttm.pages_limit, default half of RAM) and amdgpu sizes GTT from it, so
+# a 70B GGUF fails to load or spills to the CPU long before RAM runs out. The
+# planner sizes the cap to the models actually run, keeps an OS reserve, and
+# writes it as module options picked up by the initramfs.
+
+GPU_MODULE_ROOT="${GPU_MODULE_ROOT:-/sys/module}"
+GPU_MEMINFO="${GPU_MEMINFO:-/proc/meminfo}"
+GPU_CMDLINE="${GPU_CMDLINE:-/proc/cmdline}"
+GPU_BOOT_ID="${GPU_BOOT_ID:-/proc/sys/kernel/random/boot_id}"
+GPU_GTT_CONF="${GPU_GTT_CONF:-/etc/modprobe.d/gz302-gtt.conf}"
+GPU_GTT_MODELS_CONF="${GPU_GTT_MODELS_CONF:-/etc/gz302/llm-models.conf}"
+GPU_GTT_STATE="${GPU_GTT_STATE:-/var/lib/gz302/gtt-plan}"
+GPU_GTT_VERIFY_UNIT="gz302-gtt-verify.service"
+
+GPU_GIB=1073741824
+GPU_PAGE_BYTES=4096
+# OS reserve: the larger of 8 GiB and 1/8 of RAM (desktop, page cache, the
+# CPU-side copy llama.cpp keeps while loading)
+GPU_GTT_RESERVE_MIN=$((8 * GPU_GIB))
+GPU_GTT_RESERVE_DIVISOR=8
+# Per-token KV cache assumed when a model gives neither kv= nor its shape:
+# Llama-3-70B class (80 layers x 8 KV heads x 128 dims, f16)
+GPU_GTT_DEFAULT_KV=327680
+GPU_GTT_DEFAULT_CTX=8192
+
+# Parse a size such as 42G, 40.5GiB, 320K or 1048576
+# Args: $1 = size (K/M/G/T are powers of 1024)
+# Sets: _GPU_FIELD (bytes)
+# Returns: 0 if valid, 1 if not
+_gpu_parse_size() {
+    local value="${1^^}" unit=1
+    [[ "$value" =~ ^([0-9]+)([.]([0-9]{1,3}))?([KMGT]?)(I?B)?$ ]] || return 1
+    case "${BASH_REMATCH[4]}" in
+        K) unit=1024 ;;
+        M) unit=1048576 ;;
+        G) unit=$GPU_GIB ;;
+        T) unit=$((GPU_GIB * 1024)) ;;
+    esac
+    _GPU_FIELD=$((10#${BASH_REMATCH[1]} * unit))
+    if [[ -n "${BASH_REMATCH[3]}" ]]; then
+        local frac="${BASH_REMATCH[3]}" scale=1
+        scale=$((10 ** ${#frac}))
+        _GPU_FIELD=$((_GPU_FIELD + 10#$frac * unit / scale))
+    fi
+    return 0
+}
+
+# Format bytes as GiB with one decimal
+# Args: $1 = bytes
+# Sets: _GPU_FIELD
+_gpu_fmt_gib() {
+    local tenths=$((($1 * 10 + GPU_GIB / 2) / GPU_GIB))
+    printf -v _GPU_FIELD '%d.%d' $((tenths / 10)) $((tenths % 10))
+}
+
+# Read total system memory (what the kernel manages, i.e. RAM minus the
+# BIOS VRAM carve-out)
+# Sets: GPU_MEM_TOTAL_BYTES
+# Returns: 0 on success, 1 if MemTotal is not readable
+gpu_read_memtotal() {
+    local key value _unit
+    GPU_MEM_TOTAL_BYTES=""
+    while read -r key value _unit; do
+        if [[ "$key" == "MemTotal:" ]]; then
+            GPU_MEM_TOTAL_BYTES=$((value * 1024))
+            return 0
+        fi
+    done 2>/dev/null < "$GPU_MEMINFO" || true
+    return 1
+}
+
+# Size one model: weights + KV cache for its context + compute buffers
+# Args: $1 = model spec, "NAME key=value...":
+#         size=42G | file=/path/model.gguf (split files are summed)
+#         ctx=32768 (tokens, default 8192)
+#         kv=320K (KV bytes per token) | layers=N kvheads=N [headdim=128]
+#         kvtype=f16|q8_0|q4_0 (KV cache type, default f16)
+# Sets: GPU_MODEL_NAME, GPU_MODEL_WEIGHTS, GPU_MODEL_KV, GPU_MODEL_NEED (bytes),
+#       GPU_MODEL_KV_ESTIMATED (true when no kv= or shape was given)
+# Returns: 0 on success, 1 on an invalid spec (message on stderr)
+gpu_model_need() {
+    local -a words
+    read -r -a words <<< "$1"
+    local word key value file="" ctx=$GPU_GTT_DEFAULT_CTX kv="" layers="" kvheads="" headdim=128 kvnum=64
+    GPU_MODEL_NAME="${words[0]:-}" GPU_MODEL_WEIGHTS="" GPU_MODEL_KV="" GPU_MODEL_NEED="" GPU_MODEL_KV_ESTIMATED=false
+
+    if [[ -z "$GPU_MODEL_NAME" || "$GPU_MODEL_NAME" == *=* ]]; then
+        echo "Error: model spec '$1' must start with a name" >&2
+        return 1
+    fi
+    for word in "${words[@]:1}"; do
+        key="${word%%=*}" value="${word#*=}"
+        case "$key" in
+            size|ctx|kv)
+                if ! _gpu_parse_size "$value"; then
+                    echo "Error: $GPU_MODEL_NAME: invalid $key '$value'" >&2
+                    return 1
+                fi
+                case "$key" in
+                    size) GPU_MODEL_WEIGHTS=$_GPU_FIELD ;;
+                    ctx) ctx=$_GPU_FIELD ;;
+                    kv) kv=$_GPU_FIELD ;;
+                esac
+                ;;
+            file) file="$value" ;;
+            layers|kvheads|headdim)
+                if [[ ! "$value" =~ ^[0-9]+$ ]]; then
+                    echo "Error: $GPU_MODEL_NAME: invalid $key '$value'" >&2
+                    return 1
+                fi
+                printf -v "$key" '%d' "$((10#$value))"
+                ;;
+            kvtype)
+                # Bytes per element x32: q8_0/q4_0 store 32 values in 34/18 bytes
+                case "$value" in
+                    f32) kvnum=128 ;;
+                    f16|bf16) kvnum=64 ;;
+                    q8_0) kvnum=34 ;;
+                    q4_0) kvnum=18 ;;
+                    *) echo "Error: $GPU_MODEL_NAME: unknown kvtype '$value' (f32, f16, bf16, q8_0, q4_0)" >&2; return 1 ;;
+                esac
+                ;;
+            *)
+                echo "Error: $GPU_MODEL_NAME: unknown key '$key'" >&2
+                return 1
+                ;;
+        esac
+    done
+
+    if [[ -n "$file" ]]; then
+        # model-00001-of-00003.gguf: count every part
+        local part total=0 size
+        local -a parts=("$file")
+        [[ "$file" == *-00001-of-*.gguf ]] && parts=("${file%-00001-of-*}"-[0-9][0-9][0-9][0-9][0-9]-of-*.gguf)
+        for part in "${parts[@]}"; do
+            if ! size=$(stat -Lc %s "$part" 2>/dev/null); then
+                echo "Error: $GPU_MODEL_NAME: cannot read '$part'" >&2
+                return 1
+            fi
+            total=$((total + size))
+        done
+        GPU_MODEL_WEIGHTS=$total
+    fi
+    if [[ -z "$GPU_MODEL_WEIGHTS" ]]; then
+        echo "Error: $GPU_MODEL_NAME: give size= or file=" >&2
+        return 1
+    fi
+
+    if [[ -z "$kv" && -n "$layers" && -n "$kvheads" ]]; then
+        # K and V, per layer, per KV head
+        kv=$((2 * layers * kvheads * headdim * kvnum / 32))
+    elif [[ -z "$kv" ]]; then
+        kv=$((GPU_GTT_DEFAULT_KV * kvnum / 64))
+        GPU_MODEL_KV_ESTIMATED=true
+    fi
+    GPU_MODEL_KV=$((kv * ctx))
+    # Compute buffers grow with the model; 1 GiB + 5% covers llama.cpp and
+    # Ollama at the usual batch sizes
+    GPU_MODEL_NEED=$((GPU_MODEL_WEIGHTS + GPU_MODEL_KV + GPU_GIB + GPU_MODEL_WEIGHTS / 20))
+    return 0
+}
+
+# Plan the GTT/TTM limit for a set of models
+# Args: model specs (see gpu_model_need); none reads GPU_GTT_MODELS_CONF, where
+#       each non-comment line is a spec and "concurrent=yes" sums the models
+#       instead of sizing for the largest
+# Sets: GPU_GTT_MODELS (name<TAB>weights<TAB>kv<TAB>need<TAB>kv-estimated),
+#       GPU_GTT_CONCURRENT, GPU_GTT_NEED_BYTES, GPU_GTT_DEFAULT_BYTES (kernel
+#       default), GPU_GTT_RESERVE_BYTES, GPU_GTT_CEILING_BYTES,
+#       GPU_GTT_PLAN_BYTES, GPU_GTT_PLAN_PAGES, GPU_GTT_FITS
+# Returns: 0 if every model fits, 2 if the plan is capped at the ceiling,
+#          1 on error
+gpu_plan_unified_memory() {
+    local -a specs=("$@")
+    local line
+    GPU_GTT_MODELS=() GPU_GTT_CONCURRENT=false GPU_GTT_NEED_BYTES=0 GPU_GTT_FITS=false
+
+    if ((${#specs[@]} == 0)); then
+        if [[ ! -r "$GPU_GTT_MODELS_CONF" ]]; then
+            echo "Error: no models given and $GPU_GTT_MODELS_CONF not found" >&2
+            return 1
+        fi
+        while IFS= read -r line || [[ -n "$line" ]]; do
+            line="${line%%#*}"
+            read -r line <<< "$line" || true
+            [[ -n "$line" ]] || continue
+            if [[ "$line" =~ ^concurrent[[:space:]]*=[[:space:]]*(yes|true|1)$ ]]; then
+                GPU_GTT_CONCURRENT=true
+            elif [[ ! "$line" =~ ^concurrent[[:space:]]*= ]]; then
+                specs+=("$line")
+            fi
+        done < "$GPU_GTT_MODELS_CONF"
+    fi
+    if ((${#specs[@]} == 0)); then
+        echo "Error: no models to plan for" >&2
+        return 1
+    fi
+    if ! gpu_read_memtotal; then
+        echo "Error: cannot read MemTotal from $GPU_MEMINFO" >&2
+        return 1
+    fi
+
+    local spec
+    for spec in "${specs[@]}"; do
+        gpu_model_need "$spec" || return 1
+        GPU_GTT_MODELS+=("$GPU_MODEL_NAME"$'\t'"$GPU_MODEL_WEIGHTS"$'\t'"$GPU_MODEL_KV"$'\t'"$GPU_MODEL_NEED"$'\t'"$GPU_MODEL_KV_ESTIMATED")
+        if [[ "$GPU_GTT_CONCURRENT" == true ]]; then
+            GPU_GTT_NEED_BYTES=$((GPU_GTT_NEED_BYTES + GPU_MODEL_NEED))
+        elif ((GPU_MODEL_NEED > GPU_GTT_NEED_BYTES)); then
+            GPU_GTT_NEED_BYTES=$GPU_MODEL_NEED
+        fi
+    done
+
+    GPU_GTT_DEFAULT_BYTES=$((GPU_MEM_TOTAL_BYTES / 2 / GPU_PAGE_BYTES * GPU_PAGE_BYTES))
+    GPU_GTT_RESERVE_BYTES=$((GPU_MEM_TOTAL_BYTES / GPU_GTT_RESERVE_DIVISOR))
+    ((GPU_GTT_RESERVE_BYTES >= GPU_GTT_RESERVE_MIN)) || GPU_GTT_RESERVE_BYTES=$GPU_GTT_RESERVE_MIN
+    # Whole GiB keep the module options readable and the amdgpu gttsize (MiB) exact
+    GPU_GTT_CEILING_BYTES=$(((GPU_MEM_TOTAL_BYTES - GPU_GTT_RESERVE_BYTES) / GPU_GIB * GPU_GIB))
+
+    # Never plan below the kernel default; lowering it only hurts
+    local floor=$(((GPU_GTT_DEFAULT_BYTES + GPU_GIB - 1) / GPU_GIB * GPU_GIB))
+    GPU_GTT_PLAN_BYTES=$(((GPU_GTT_NEED_BYTES + GPU_GIB - 1) / GPU_GIB * GPU_GIB))
+    ((GPU_GTT_PLAN_BYTES >= floor)) || GPU_GTT_PLAN_BYTES=$floor
+    GPU_GTT_FITS=true
+    if ((GPU_GTT_PLAN_BYTES > GPU_GTT_CEILING_BYTES)); then
+        GPU_GTT_FITS=false
+        GPU_GTT_PLAN_BYTES=$GPU_GTT_CEILING_BYTES
+        # A small machine can have its ceiling under the default
+        ((GPU_GTT_PLAN_BYTES >= floor)) || GPU_GTT_PLAN_BYTES=$floor
+    fi
+    GPU_GTT_PLAN_PAGES=$((GPU_GTT_PLAN_BYTES / GPU_PAGE_BYTES))
+    [[ "$GPU_GTT_FITS" == true ]] && return 0
+    return 2
+}
+
+# Read the limits the running kernel uses
+# Sets: GPU_GTT_TTM_MODULE (ttm, or amdttm with the ROCm DKMS driver),
+#       GPU_GTT_LIVE_PAGES, GPU_GTT_LIVE_POOL (pages), GPU_GTT_LIVE_TOTAL,
+#       GPU_GTT_LIVE_USED (bytes, from the amdgpu device), GPU_GTT_LIVE_GTTSIZE
+#       (amdgpu.gttsize in MiB, -1 when derived from TTM)
+# Returns: 0 if the TTM limit is readable, 1 if not
+gpu_read_gtt_live() {
+    GPU_GTT_TTM_MODULE=ttm GPU_GTT_LIVE_PAGES="" GPU_GTT_LIVE_POOL=""
+    GPU_GTT_LIVE_TOTAL="" GPU_GTT_LIVE_USED="" GPU_GTT_LIVE_GTTSIZE=""
+    [[ -d "$GPU_MODULE_ROOT/amdttm/parameters" ]] && GPU_GTT_TTM_MODULE=amdttm
+    read -r GPU_GTT_LIVE_POOL 2>/dev/null < "$GPU_MODULE_ROOT/$GPU_GTT_TTM_MODULE/parameters/page_pool_size" || true
+    read -r GPU_GTT_LIVE_GTTSIZE 2>/dev/null < "$GPU_MODULE_ROOT/amdgpu/parameters/gttsize" || true
+    if gpu_find_device; then
+        read -r GPU_GTT_LIVE_TOTAL 2>/dev/null < "$GPU_DEVICE_DIR/mem_info_gtt_total" || true
+        read -r GPU_GTT_LIVE_USED 2>/dev/null < "$GPU_DEVICE_DIR/mem_info_gtt_used" || true
+    fi
+    read -r GPU_GTT_LIVE_PAGES 2>/dev/null < "$GPU_MODULE_ROOT/$GPU_GTT_TTM_MODULE/parameters/pages_limit" || return 1
+    return 0
+}
+
+# Print the current plan (after gpu_plan_unified_memory)
+gpu_print_unified_memory_plan() {
+    local row name weights kv need est total
+    echo "GZ302 Unified Memory Plan"
+    echo "========================="
+    _gpu_fmt_gib "$GPU_MEM_TOTAL_BYTES"; total=$_GPU_FIELD
+    _gpu_fmt_gib "$GPU_GTT_RESERVE_BYTES"
+    echo "System memory:  $total GiB (OS reserve $_GPU_FIELD GiB)"
+    echo ""
+    printf '  %-24s %9s %9s %9s\n' MODEL "WEIGHTS" "KV" "NEEDS"
+    for row in "${GPU_GTT_MODELS[@]}"; do
+        IFS=$'\t' read -r name weights kv need est <<< "$row"
+        _gpu_fmt_gib "$weights"; weights=$_GPU_FIELD
+        _gpu_fmt_gib "$kv"; kv="$_GPU_FIELD"
+        [[ "$est" == true ]] && kv+="*"
+        _gpu_fmt_gib "$need"; need=$_GPU_FIELD
+        printf '  %-24s %9s %9s %9s\n' "$name" "$weights" "$kv" "$need"
+    done
+    echo "  (GiB; needs = weights + KV + 1 GiB + 5% compute buffers)"
+    if [[ " ${GPU_GTT_MODELS[*]} " == *$'\t'true* ]]; then
+        echo "  * KV estimated for a 70B-class model; give kv= or layers=/kvheads= for an exact figure"
+    fi
+    echo ""
+    _gpu_fmt_gib "$GPU_GTT_NEED_BYTES"
+    echo "Needed:         $_GPU_FIELD GiB ($([[ "$GPU_GTT_CONCURRENT" == true ]] && echo "all models loaded together" || echo "largest model"))"
+    _gpu_fmt_gib "$GPU_GTT_DEFAULT_BYTES"; total=$_GPU_FIELD
+    _gpu_fmt_gib "$GPU_GTT_CEILING_BYTES"
+    echo "Kernel default: $total GiB, ceiling $_GPU_FIELD GiB"
+    _gpu_fmt_gib "$GPU_GTT_PLAN_BYTES"
+    echo "Planned GTT:    $_GPU_FIELD GiB (ttm.pages_limit=$GPU_GTT_PLAN_PAGES)"
+    if ((GPU_GTT_NEED_BYTES <= GPU_GTT_DEFAULT_BYTES)); then
+        echo "                (the kernel default already fits; applying only pins it)"
+    fi
+    if [[ "$GPU_GTT_FITS" != true ]]; then
+        echo ""
+        echo "WARNING: the models need more than the ceiling. Use a smaller quant or"
+        echo "context, a q8_0 KV cache, or lower the BIOS VRAM carve-out (UMA frame"
+        echo "buffer) so the kernel manages more of the RAM."
+    fi
+    if gpu_read_gtt_live; then
+        _gpu_fmt_gib $((GPU_GTT_LIVE_PAGES * GPU_PAGE_BYTES))
+        echo ""
+        echo "Running kernel: $_GPU_FIELD GiB ($GPU_GTT_TTM_MODULE.pages_limit=$GPU_GTT_LIVE_PAGES)"
+    fi
+}
+
+# Write the plan as module options and rebuild the initramfs (root)
+# Module options rather than kernel parameters: one file for every
+# bootloader, and the initramfs hooks (mkinitcpio modconf, dracut,
+# initramfs-tools) copy modprobe.d, so the early-loaded amdgpu sees them.
+# Must follow gpu_plan_unified_memory.
+# Returns: 0 on success, 1 on failure
+gpu_apply_unified_memory() {
+    local pages="$GPU_GTT_PLAN_PAGES" mib=$((GPU_GTT_PLAN_BYTES / 1048576))
+    local names="" row boot_id=""
+    for row in "${GPU_GTT_MODELS[@]}"; do
+        names+="${names:+ }${row%%$'\t'*}"
+    done
+
+    # Built-in TTM never reads modprobe.d; say what to put on the cmdline
+    if [[ -d "$GPU_MODULE_ROOT/ttm" && ! -e "$GPU_MODULE_ROOT/ttm/initstate" ]]; then
+        gpu_log_warning "TTM is built into this kernel; add 'ttm.pages_limit=$pages ttm.page_pool_size=$pages' to the kernel command line instead"
+        return 1
+    fi
+    if [[ -r "$GPU_CMDLINE" ]]; then
+        local cmdline
+        read -r cmdline 2>/dev/null < "$GPU_CMDLINE" || true
+        if [[ " $cmdline" =~ [[:space:]](amd)?(ttm\.pages_limit|ttm\.page_pool_size|amdgpu\.gttsize)= ]]; then
+            gpu_log_warning "The kernel command line sets ${BASH_REMATCH[2]}, which overrides the module options; remove it from your bootloader"
+        fi
+    fi
+
+    declare -f backup_config_file >/dev/null && backup_config_file "$GPU_GTT_CONF" gpu
+    mkdir -p "${GPU_GTT_CONF%/*}"
+    {
+        echo "# GZ302 unified memory plan, written by 'gz302-gpu memory apply'"
+        echo "# Models: $names"
+        echo "# GPU-mappable system memory (GTT): $((mib / 1024)) GiB of $((GPU_MEM_TOTAL_BYTES / GPU_GIB)) GiB"
+        echo "# pages_limit caps what TTM lets the GPU pin; page_pool_size keeps"
+        echo "# freed pages pooled up to the same size so reloads stay fast"
+        echo "options ttm pages_limit=$pages page_pool_size=$pages"
+        # ROCm's DKMS driver ships its own copy of TTM
+        [[ -d "$GPU_MODULE_ROOT/amdttm" ]] && echo "options amdttm pages_limit=$pages page_pool_size=$pages"
+        if [[ -e "$GPU_MODULE_ROOT/amdgpu/parameters/gttsize" ]]; then
+            echo "# Newer kernels size GTT from ttm.pages_limit and only log a"
+            echo "# deprecation notice for this; older ones need it"
+            echo "options amdgpu gttsize=$mib"
+        fi
+    } > "$GPU_GTT_CONF"
+
+    gpu_regenerate_initramfs || return 1
+
+    read -r boot_id 2>/dev/null < "$GPU_BOOT_ID" || true
+    mkdir -p "${GPU_GTT_STATE%/*}"
+    {
+        echo "PAGES_LIMIT=$pages"
+        echo "PAGE_POOL_SIZE=$pages"
+        echo "GTT_BYTES=$GPU_GTT_PLAN_BYTES"
+        echo "MODELS=$names"
+        echo "APPLIED_BOOT_ID=$boot_id"
+        printf 'APPLIED_AT=%(%Y-%m-%dT%H:%M:%S)T\n' -1
+    } > "$GPU_GTT_STATE"
+    chmod 644 "$GPU_GTT_STATE"
+
+    # Check once per boot that the limits survived (kernel updates,
+    # initramfs rebuilt without modconf, a cmdline override)
+    if [[ -d /etc/systemd/system ]]; then
+        gpu_get_gtt_verify_unit > "/etc/systemd/system/$GPU_GTT_VERIFY_UNIT"
+        systemctl daemon-reload >/dev/null 2>&1 || true
+        systemctl enable "$GPU_GTT_VERIFY_UNIT" >/dev/null 2>&1 || true
+    fi
+    return 0
+}
+
+# Compare the applied plan with the running kernel
+# Sets: GPU_GTT_VERIFY (ok, pending = not rebooted since apply, mismatch,
+#       none = no plan applied), GPU_GTT_VERIFY_DETAIL
+# Returns: 0 if ok, 1 otherwise
+gpu_verify_unified_memory() {
+    local key value boot_id=""
+    local -A plan=()
+    GPU_GTT_VERIFY=none GPU_GTT_VERIFY_DETAIL=""
+
+    if [[ ! -r "$GPU_GTT_STATE" ]]; then
+        GPU_GTT_VERIFY_DETAIL="no plan applied (gz302-gpu memory apply)"
+        return 1
+    fi
+    while IFS='=' read -r key value; do
+        [[ "$key" =~ ^[A-Z_]+$ ]] && plan[$key]="$value"
+    done < "$GPU_GTT_STATE"
+
+    read -r boot_id 2>/dev/null < "$GPU_BOOT_ID" || true
+    if [[ -n "$boot_id" && "$boot_id" == "${plan[APPLIED_BOOT_ID]:-}" ]]; then
+        GPU_GTT_VERIFY=pending
+        GPU_GTT_VERIFY_DETAIL="applied ${plan[APPLIED_AT]:-}; reboot to load it"
+        return 1
+    fi
+
+    GPU_GTT_VERIFY=mismatch
+    if ! gpu_read_gtt_live; then
+        GPU_GTT_VERIFY_DETAIL="TTM limits not readable under $GPU_MODULE_ROOT"
+        return 1
+    fi
+    local problems=""
+    [[ "$GPU_GTT_LIVE_PAGES" == "${plan[PAGES_LIMIT]:-}" ]] \
+        || problems+="${problems:+; }$GPU_GTT_TTM_MODULE.pages_limit is $GPU_GTT_LIVE_PAGES, planned ${plan[PAGES_LIMIT]:-?}"
+    [[ "$GPU_GTT_LIVE_POOL" == "${plan[PAGE_POOL_SIZE]:-}" ]] \
+        || problems+="${problems:+; }$GPU_GTT_TTM_MODULE.page_pool_size is ${GPU_GTT_LIVE_POOL:-?}, planned ${plan[PAGE_POOL_SIZE]:-?}"
+    # amdgpu may round GTT; a MiB either way is the same plan
+    if [[ -n "$GPU_GTT_LIVE_TOTAL" ]]; then
+        local diff=$((GPU_GTT_LIVE_TOTAL - ${plan[GTT_BYTES]:-0}))
+        ((diff < 0)) && diff=$((-diff))
+        if ((diff > 1048576)); then
+            _gpu_fmt_gib "$GPU_GTT_LIVE_TOTAL"
+            problems+="${problems:+; }amdgpu GTT is $_GPU_FIELD GiB"
+            _gpu_fmt_gib "${plan[GTT_BYTES]:-0}"
+            problems+=", planned $_GPU_FIELD GiB"
+        fi
+    fi
+    if [[ -n "$problems" ]]; then
+        GPU_GTT_VERIFY_DETAIL="$problems"
+        return 1
+    fi
+    GPU_GTT_VERIFY=ok
+    _gpu_fmt_gib "${plan[GTT_BYTES]:-0}"
+    GPU_GTT_VERIFY_DETAIL="$_GPU_FIELD GiB GTT for ${plan[MODELS]:-the planned models}"
+    return 0
+}
+
+# Get the boot-time verification unit (runs 'gz302-gpu memory verify')
+# Output: systemd unit content
+gpu_get_gtt_verify_unit() {
+    cat <<'GTT_UNIT'
+[Unit]
+Description=GZ302 check that the planned GPU memory limits are active
+ConditionPathExists=/var/lib/gz302/gtt-plan
+After=multi-user.target
+
+[Service]
+Type=oneshot
+ExecStart=/usr/local/bin/gz302-gpu memory verify
+RemainAfterExit=yes
+
+[Install]
+WantedBy=multi-user.target
+GTT_UNIT
+}
+
+# Get the model list template for GPU_GTT_MODELS_CONF
+# Output: Configuration file content
+gpu_get_llm_models_config() {
+    cat <<'MODELS'
+# GZ302 models to size GPU memory for (gz302-gpu memory plan)
+#
+# One model per line: NAME key=value...
+#   size=42G | file=/path/model.gguf  weights (split GGUFs: the -00001- part)
+#   ctx=32768                         context in tokens (default 8192)
+#   kv=320K                           KV cache bytes per token, or the shape:
+#   layers=80 kvheads=8 headdim=128   (from the model card / GGUF metadata)
+#   kvtype=f16|q8_0|q4_0              KV cache type (llama.cpp -ctk/-ctv)
+#
+# The largest model sets the plan; add "concurrent=yes" to size for all of
+# them loaded at once (e.g. Ollama with OLLAMA_MAX_LOADED_MODELS > 1).
+
+llama-3.3-70b-q4_k_m  size=42.5G ctx=32768 layers=80 kvheads=8
+gpt-oss-120b-mxfp4    size=60.9G ctx=131072 layers=36 kvheads=8 headdim=64
+MODELS
+}
+
 # --- Library Information ---
 
 gpu_lib_version() {
-    echo "3.0.0"
+    echo "3.3.0"
 }
 
 gpu_lib_help() {
     cat <<'HELP'
-GZ302 GPU Manager Library v3.0.0
+GZ302 GPU Manager Library v3.3.0
 
 Detection Functions (read-only):
   gpu_detect_hardware           - Check if Radeon 8060S present
@@ -550,6 +1480,31 @@ Verification Functions:
   gpu_verify_working            - Verify GPU is working correctly
   gpu_print_status              - Print formatted status (for users)
 
+Telemetry Functions (read-only, no forks):
+  gpu_find_device               - Find the amdgpu device with gpu_metrics
+  gpu_read_metrics              - Decode gpu_metrics (format 3.0) into GPU_* globals
+  gpu_read_hwmon                - Read amdgpu hwmon sensors and gpu_busy_percent
+  gpu_read_telemetry            - Both, hwmon filling gaps, plus a limit verdict
+  gpu_get_telemetry             - Telemetry snapshot as key=value lines
+  gpu_print_telemetry           - Print formatted telemetry (for users)
+  gpu_get_telemetry_script      - Get gz302-gpu CLI script content
+
+Runtime Power Policy Functions:
+  gpu_read_power_policy         - Read performance level and workload profile
+  gpu_set_power_policy <l> <m>  - Set both and verify by readback (root)
+
+Unified Memory Functions (GTT/TTM):
+  gpu_read_memtotal             - Read MemTotal into GPU_MEM_TOTAL_BYTES
+  gpu_model_need <spec>         - Size one model (weights + KV + buffers)
+  gpu_plan_unified_memory [spec...]
+                                - Plan the GTT limit for the model list
+  gpu_read_gtt_live             - Read the running TTM/GTT limits and use
+  gpu_print_unified_memory_plan - Print the plan (for users)
+  gpu_apply_unified_memory      - Write module options, rebuild initramfs (root)
+  gpu_verify_unified_memory     - Compare the applied plan with the kernel
+  gpu_get_gtt_verify_unit       - Get the boot-time verification unit
+  gpu_get_llm_models_config     - Get the model list template
+
 Library Information:
   gpu_lib_version               - Get library version
   gpu_lib_help                  - Show this help
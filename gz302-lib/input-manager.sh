@@ -4,7 +4,7 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 Input Manager Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library manages ASUS HID devices (keyboard, touchpad) and tablet mode
 # functionality for the GZ302.
@@ -23,6 +23,14 @@ set -euo pipefail
 #   input_verify_working
 # ==============================================================================
 
+# --- Kernel Capability Table ---
+# Kernel checks come from kernel-compat.sh; load it when this library is
+# sourced on its own.
+if ! declare -f kernel_caps_init >/dev/null 2>&1; then
+    # shellcheck source=gz302-lib/kernel-compat.sh
+    source "$(dirname "${BASH_SOURCE[0]}")/kernel-compat.sh"
+fi
+
 # --- Input Hardware Detection ---
 
 # Detect ASUS HID devices
@@ -84,8 +92,7 @@ input_hid_asus_loaded() {
 # Returns: 0 if available, 1 if not
 input_tablet_mode_switch_available() {
     # Kernel 6.17+ has asus-wmi tablet mode support
-    if [[ -f /proc/acpi/button/lid/LID0/state ]] || \
-       find /sys/devices -name "input*" -type d -print0 2>/dev/null | xargs -0 grep -l "SW_TABLET_MODE" 2>/dev/null | grep -q .; then
+    if [[ -f /proc/acpi/button/lid/LID0/state ]] || kernel_cap sw_tablet_mode; then
         return 0
     else
         return 1
@@ -96,7 +103,7 @@ input_tablet_mode_switch_available() {
 # Returns: "docked", "tablet", or "unknown"
 input_get_tablet_mode() {
     # Try asus-wmi first (kernel 6.17+)
-    if find /sys/devices -name "input*" -type d -print0 2>/dev/null | xargs -0 grep -l "SW_TABLET_MODE" 2>/dev/null | grep -q .; then
+    if kernel_cap sw_tablet_mode; then
         # Parse tablet mode switch state
         # This is a simplified check - real implementation would parse evdev
         echo "available"
@@ -251,6 +258,7 @@ input_apply_hid_config() {
     fi
     
     # Create HID configuration
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/modprobe.d/hid-asus.conf input
     cat > /etc/modprobe.d/hid-asus.conf <<'EOF'
 # ASUS HID configuration for GZ302
 # fnlock_default=0: F1-F12 keys work as media keys by default
@@ -267,6 +275,7 @@ input_apply_touchpad_forcing() {
     # This is a legacy workaround for kernel < 6.17
     # Should only be called if kernel requires it
     
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/modprobe.d/hid-asus.conf input
     cat > /etc/modprobe.d/hid-asus.conf <<'EOF'
 # ASUS HID configuration for GZ302
 # fnlock_default=0: F1-F12 keys work as media keys by default
@@ -285,6 +294,7 @@ input_remove_touchpad_forcing() {
     fi
     
     # Remove forcing option, keep fnlock setting
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/modprobe.d/hid-asus.conf input
     cat > /etc/modprobe.d/hid-asus.conf <<'EOF'
 # ASUS HID configuration for GZ302
 # fnlock_default=0: F1-F12 keys work as media keys by default
@@ -302,6 +312,7 @@ input_apply_i2c_quirk() {
         return 0  # Already applied
     fi
     
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/modprobe.d/i2c-hid-acpi-gz302.conf input
     cat > /etc/modprobe.d/i2c-hid-acpi-gz302.conf <<'EOF'
 # ASUS GZ302 touchpad stability
 # Some units benefit from enabling i2c_hid_acpi quirk 0x01
@@ -314,6 +325,7 @@ EOF
 # Create HID reload service (legacy, only for kernel < 6.17)
 # Returns: 0 if created
 input_create_reload_service() {
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/systemd/system/reload-hid_asus.service input
     cat > /etc/systemd/system/reload-hid_asus.service <<'EOF'
 [Unit]
 Description=Reload hid_asus module for GZ302 touchpad
@@ -356,6 +368,7 @@ input_apply_rgb_udev_rule() {
         return 0  # Already applied
     fi
     
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/udev/rules.d/99-gz302-keyboard.rules input
     cat > /etc/udev/rules.d/99-gz302-keyboard.rules <<'EOF'
 # GZ302 Keyboard RGB Control - Allow unprivileged USB access
 # ASUS ROG Flow Z13 keyboard (USB 0b06.0.00)
@@ -377,18 +390,8 @@ input_apply_configuration() {
     
     # Auto-detect kernel version if not provided
     if [[ -z "$kernel_ver" ]]; then
-        # Try to use kernel-compat library if available
-        if declare -f kernel_get_version_num >/dev/null 2>&1; then
-            kernel_ver=$(kernel_get_version_num)
-        else
-            # Fallback: calculate manually
-            local kernel_version
-            kernel_version=$(uname -r | cut -d. -f1,2)
-            local major minor
-            major=$(echo "$kernel_version" | cut -d. -f1)
-            minor=$(echo "$kernel_version" | cut -d. -f2)
-            kernel_ver=$((major * 100 + minor))
-        fi
+        kernel_caps_init
+        kernel_ver="${KERNEL_CAPS[version_num]}"
     fi
     
     echo "Configuring ASUS input devices..."
@@ -459,6 +462,7 @@ input_create_keyboard_remap() {
     # Fallback to standard GZ302EA product ID if not detected
     [[ -z "$product_id" ]] && product_id="1A30"
 
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/udev/hwdb.d/90-gz302-remap.hwdb input
     cat > /etc/udev/hwdb.d/90-gz302-remap.hwdb <<EOF
 # GZ302 Keyboard Remapping (Copilot -> Insert)
 # Detected Product ID: $product_id
@@ -551,12 +555,8 @@ input_print_status() {
     echo "  Keyboard remapped:   $keyboard_remapped"
     
     # Check for obsolete workarounds on kernel 6.17+
-    local kernel_ver
-    if declare -f kernel_get_version_num >/dev/null 2>&1; then
-        kernel_ver=$(kernel_get_version_num)
-    else
-        kernel_ver=0
-    fi
+    kernel_caps_init
+    local kernel_ver="${KERNEL_CAPS[version_num]}"
     
     if [[ $kernel_ver -ge 617 ]]; then
         if [[ "$touchpad_forcing" == "true" ]]; then
@@ -4,7 +4,7 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 Kernel Compatibility Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library provides central kernel version detection and compatibility
 # logic for all other libraries. It determines what workarounds are needed
@@ -22,6 +22,7 @@ set -euo pipefail
 #
 # Usage:
 #   source gz302-lib/kernel-compat.sh
+#   kernel_caps_probe_all            # once, from the top-level shell
 #   kernel_get_version_num
 #   kernel_requires_wifi_workaround
 #   kernel_requires_input_workaround
@@ -35,69 +36,283 @@ readonly KERNEL_NATIVE=617       # 6.17 - Native support for most hardware
 readonly KERNEL_OPTIMAL=618      # 6.18 - ROCm 7.2, firmware improvements
 readonly KERNEL_AUDIO_NATIVE=619 # 6.19 - CS35L41 audio native support
 
+# --- Capability Table ---
+#
+# Every kernel question is answered from KERNEL_CAPS, which is filled once per
+# process instead of re-running uname/cut pipelines on every call:
+#
+#   release / version_num / version_short  read from /proc at source time
+#   modparams:<module>                     parameter list from modinfo -p
+#   <probe>                                1 = present, 0 = absent
+#
+# Probes run lazily on first use. A probe first evaluated inside a $(...)
+# subshell is lost when the subshell exits, so entry points should call
+# kernel_caps_probe_all once from the parent shell. The table is exported as
+# GZ302_KERNEL_CAPS so child scripts inherit it instead of asking again.
+#
+# GZ302_KERNEL_RELEASE overrides the detected release (tests, benchmarks).
+declare -gA KERNEL_CAPS=()
+
+# Probes evaluated by kernel_caps_probe_all
+KERNEL_CAPS_PROBES=(
+    mt7925e_disable_aspm
+    amdgpu_dcdebugmask
+    amdgpu_runtime_debug_mask
+    sw_tablet_mode
+)
+
+# Populate the version fields of the capability table (idempotent, no fork
+# unless /proc is unavailable)
+# Returns: 0 on success, 1 if the release could not be determined
+kernel_caps_init() {
+    [[ -n "${KERNEL_CAPS[version_num]:-}" ]] && return 0
+
+    local release="${GZ302_KERNEL_RELEASE:-}"
+
+    if [[ -z "$release" && -r /proc/sys/kernel/osrelease ]]; then
+        read -r release < /proc/sys/kernel/osrelease || true
+    fi
+    if [[ -z "$release" ]]; then
+        release=$(uname -r 2>/dev/null || true)
+    fi
+    [[ -n "$release" ]] || return 1
+
+    # Inherit a table exported by a parent process, only for this kernel
+    if [[ -n "${GZ302_KERNEL_CAPS:-}" ]]; then
+        local -a entries
+        local entry
+        IFS=';' read -ra entries <<< "$GZ302_KERNEL_CAPS"
+        if [[ "${entries[0]:-}" == "release=$release" ]]; then
+            for entry in "${entries[@]}"; do
+                [[ "$entry" == *=* ]] && KERNEL_CAPS["${entry%%=*}"]="${entry#*=}"
+            done
+            [[ -n "${KERNEL_CAPS[version_num]:-}" ]] && return 0
+        fi
+    fi
+
+    local major="${release%%.*}"
+    local rest="${release#*.}"
+    local minor="${rest%%[!0-9]*}"
+    major="${major%%[!0-9]*}"
+
+    KERNEL_CAPS[release]="$release"
+    KERNEL_CAPS[version_num]=$(( ${major:-0} * 100 + ${minor:-0} ))
+    KERNEL_CAPS[version_short]="${major:-0}.${minor:-0}"
+    return 0
+}
+
+# Get module parameter names (memoized modinfo -p)
+# Args: $1 = module name
+# Output: Space-separated parameter names (empty if module unknown)
+kernel_module_params() {
+    local module="$1"
+    local key="modparams:${module}"
+
+    if [[ -z "${KERNEL_CAPS[$key]+set}" ]]; then
+        local params="" line
+        if command -v modinfo >/dev/null 2>&1; then
+            while IFS= read -r line; do
+                [[ -n "$line" ]] && params+=" ${line%%:*}"
+            done < <(modinfo -p "$module" 2>/dev/null || true)
+        fi
+        KERNEL_CAPS[$key]="${params# }"
+    fi
+    echo "${KERNEL_CAPS[$key]}"
+}
+
+# Check if a module exposes a parameter
+# Args: $1 = module name, $2 = parameter name
+# Returns: 0 if present, 1 if absent, 2 if module info unavailable
+kernel_module_has_param() {
+    local module="$1"
+    local param="$2"
+    local key="modparams:${module}"
+
+    [[ -n "${KERNEL_CAPS[$key]+set}" ]] || kernel_module_params "$module" >/dev/null
+
+    [[ -z "${KERNEL_CAPS[$key]}" ]] && return 2
+    [[ " ${KERNEL_CAPS[$key]} " == *" ${param} "* ]]
+}
+
+# Evaluate a feature probe and store the result in KERNEL_CAPS
+# Args: $1 = probe name
+# Returns: 0 always (result stored as 1, 0 or empty for "cannot tell")
+kernel_caps_probe() {
+    local probe="$1"
+    local rc=0
+
+    case "$probe" in
+        mt7925e_disable_aspm)
+            kernel_module_has_param mt7925e disable_aspm || rc=$?
+            ;;
+        amdgpu_dcdebugmask)
+            kernel_module_has_param amdgpu dcdebugmask || rc=$?
+            ;;
+        amdgpu_runtime_debug_mask)
+            local node
+            rc=1
+            for node in /sys/kernel/debug/dri/*/amdgpu_dm_debug_mask; do
+                [[ -e "$node" ]] && { rc=0; break; }
+            done
+            ;;
+        sw_tablet_mode)
+            # /proc/bus/input/devices lists a "B: SW=<mask>" line per device;
+            # bit 1 is SW_TABLET_MODE.
+            local line mask
+            rc=1
+            if [[ -r /proc/bus/input/devices ]]; then
+                while IFS= read -r line; do
+                    [[ "$line" == "B: SW="* ]] || continue
+                    mask="${line#B: SW=}"
+                    mask="${mask##* }"
+                    if (( (16#${mask:-0} & 0x2) != 0 )); then
+                        rc=0
+                        break
+                    fi
+                done < /proc/bus/input/devices
+            else
+                rc=2
+            fi
+            ;;
+        *)
+            rc=2
+            ;;
+    esac
+
+    case $rc in
+        0) KERNEL_CAPS[$probe]="1" ;;
+        1) KERNEL_CAPS[$probe]="0" ;;
+        *) KERNEL_CAPS[$probe]="" ;;
+    esac
+    return 0
+}
+
+# Query a feature probe (memoized)
+# Args: $1 = probe name
+# Returns: 0 if present, 1 if absent, 2 if unknown
+kernel_cap() {
+    local probe="$1"
+
+    [[ -n "${KERNEL_CAPS[$probe]+set}" ]] || kernel_caps_probe "$probe"
+
+    case "${KERNEL_CAPS[$probe]}" in
+        1) return 0 ;;
+        0) return 1 ;;
+        *) return 2 ;;
+    esac
+}
+
+# Evaluate every probe now and export the table to child processes
+# Returns: 0 always
+kernel_caps_probe_all() {
+    kernel_caps_init || return 0
+    local probe
+    for probe in "${KERNEL_CAPS_PROBES[@]}"; do
+        kernel_cap "$probe" || true
+    done
+    kernel_caps_export
+    return 0
+}
+
+# Export the capability table as GZ302_KERNEL_CAPS
+kernel_caps_export() {
+    kernel_caps_init || return 0
+    local serialized="release=${KERNEL_CAPS[release]}"
+    local key
+    for key in "${!KERNEL_CAPS[@]}"; do
+        [[ "$key" == "release" ]] && continue
+        serialized+=";${key}=${KERNEL_CAPS[$key]}"
+    done
+    export GZ302_KERNEL_CAPS="$serialized"
+}
+
+# Summarize what setup steps depend on: the kernel series plus every probe
+# Patch releases within a series only change this when a probe result flips.
+# Output: "<major.minor>;<probe>=<0|1|>;..."
+kernel_caps_fingerprint() {
+    kernel_caps_init || return 1
+    local fingerprint="${KERNEL_CAPS[version_short]}"
+    local probe
+    for probe in "${KERNEL_CAPS_PROBES[@]}"; do
+        [[ -n "${KERNEL_CAPS[$probe]+set}" ]] || kernel_caps_probe "$probe"
+        fingerprint+=";${probe}=${KERNEL_CAPS[$probe]}"
+    done
+    echo "$fingerprint"
+}
+
+# Print the capability table
+# Output: key = value lines
+kernel_caps_print() {
+    kernel_caps_init || return 1
+    local key
+    for key in $(printf '%s\n' "${!KERNEL_CAPS[@]}" | sort); do
+        printf "  %-28s %s\n" "$key" "${KERNEL_CAPS[$key]:-unknown}"
+    done
+}
+
+kernel_caps_init || true
+
 # --- Core Version Functions ---
 
 # Get kernel version as comparable number
 # Returns: Version number (e.g., 617 for 6.17.4)
 # Output: None (return value only)
 kernel_get_version_num() {
-    local kernel_version
-    kernel_version=$(uname -r | cut -d. -f1,2)
-    local major minor
-    major=$(echo "$kernel_version" | cut -d. -f1)
-    minor=$(echo "$kernel_version" | cut -d. -f2)
-    echo $((major * 100 + minor))
+    kernel_caps_init || return 1
+    echo "${KERNEL_CAPS[version_num]}"
 }
 
 # Get full kernel version string
 # Returns: Full version (e.g., "6.17.4-arch1-1")
 kernel_get_version_string() {
-    uname -r
+    kernel_caps_init || return 1
+    echo "${KERNEL_CAPS[release]}"
 }
 
 # Get major.minor version string
 # Returns: Short version (e.g., "6.17")
 kernel_get_version_short() {
-    uname -r | cut -d. -f1,2
+    kernel_caps_init || return 1
+    echo "${KERNEL_CAPS[version_short]}"
 }
 
 # Check if kernel meets minimum requirements
 # Returns: 0 if meets minimum, 1 if below minimum
 kernel_meets_minimum() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     [[ $version_num -ge $KERNEL_MIN ]]
 }
 
 # Check if kernel is at recommended level or above
 # Returns: 0 if recommended or better, 1 if below
 kernel_is_recommended() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     [[ $version_num -ge $KERNEL_RECOMMENDED ]]
 }
 
 # Check if kernel is at stable level or above
 # Returns: 0 if stable or better, 1 if below
 kernel_is_stable() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     [[ $version_num -ge $KERNEL_STABLE ]]
 }
 
 # Check if kernel has native hardware support (6.17+)
 # Returns: 0 if native support available, 1 if not
 kernel_has_native_support() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     [[ $version_num -ge $KERNEL_NATIVE ]]
 }
 
 # Check if kernel is at optimal level (6.18+)
 # Returns: 0 if optimal, 1 if not
 kernel_is_optimal() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     [[ $version_num -ge $KERNEL_OPTIMAL ]]
 }
 
@@ -106,17 +321,21 @@ kernel_is_optimal() {
 # Check if WiFi ASPM workaround is required
 # Returns: 0 if workaround needed, 1 if not needed
 kernel_requires_wifi_workaround() {
-    local version_num
-    version_num=$(kernel_get_version_num)
-    # ASPM workaround needed for kernels < 6.17
-    [[ $version_num -lt $KERNEL_NATIVE ]]
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
+    # ASPM workaround needed for kernels < 6.17, and only when the loaded
+    # driver actually exposes the disable_aspm option
+    [[ $version_num -lt $KERNEL_NATIVE ]] || return 1
+    local rc=0
+    kernel_cap mt7925e_disable_aspm || rc=$?
+    [[ $rc -ne 1 ]]
 }
 
 # Check if input device forcing is required
 # Returns: 0 if forcing needed, 1 if not needed
 kernel_requires_input_workaround() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     # Input forcing needed for kernels < 6.17
     [[ $version_num -lt $KERNEL_NATIVE ]]
 }
@@ -124,17 +343,19 @@ kernel_requires_input_workaround() {
 # Check if tablet mode daemon is required
 # Returns: 0 if daemon needed, 1 if not needed (native support)
 kernel_requires_tablet_daemon() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     # Tablet mode daemon needed for kernels < 6.17 (no asus-wmi support)
-    [[ $version_num -lt $KERNEL_NATIVE ]]
+    # unless an input device already reports SW_TABLET_MODE
+    [[ $version_num -lt $KERNEL_NATIVE ]] || return 1
+    ! kernel_cap sw_tablet_mode
 }
 
 # Check if GPU stability workarounds are required
 # Returns: 0 if workarounds needed, 1 if not needed
 kernel_requires_gpu_workarounds() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     # GPU workarounds needed for kernels < 6.16
     [[ $version_num -lt $KERNEL_STABLE ]]
 }
@@ -143,8 +364,8 @@ kernel_requires_gpu_workarounds() {
 # Returns: 0 if quirks needed, 1 if not needed
 # Note: CS35L41 GZ302 quirk (10431fb3) upstreamed in kernel 6.19
 kernel_requires_audio_quirks() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     # Audio quirks needed for kernels < 6.19 (CS35L41 quirk upstreamed in 6.19)
     [[ $version_num -lt ${KERNEL_AUDIO_NATIVE:-619} ]]
 }
@@ -152,8 +373,8 @@ kernel_requires_audio_quirks() {
 # Check if kernel has CS35L41 native audio support
 # Returns: 0 if native support, 1 if quirks needed
 kernel_has_native_audio() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     [[ $version_num -ge ${KERNEL_AUDIO_NATIVE:-619} ]]
 }
 
@@ -162,24 +383,24 @@ kernel_has_native_audio() {
 # Check if kernel has asus-wmi tablet mode support
 # Returns: 0 if supported, 1 if not
 kernel_has_asus_wmi_tablet_mode() {
-    local version_num
-    version_num=$(kernel_get_version_num)
-    [[ $version_num -ge $KERNEL_NATIVE ]]
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
+    [[ $version_num -ge $KERNEL_NATIVE ]] || kernel_cap sw_tablet_mode
 }
 
 # Check if kernel has MT7925 WiFi improvements
 # Returns: 0 if has improvements, 1 if not
 kernel_has_mt7925_improvements() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     [[ $version_num -ge $KERNEL_NATIVE ]]
 }
 
 # Check if kernel has AMD GPU DC stabilization
 # Returns: 0 if has stabilization, 1 if not
 kernel_has_amdgpu_dc_fixes() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     [[ $version_num -ge $KERNEL_STABLE ]]
 }
 
@@ -187,16 +408,16 @@ kernel_has_amdgpu_dc_fixes() {
 # Returns: 0 if has fixes, 1 if not (PSR-SU disabled on eDP)
 # Note: PSR-SU disabled on eDP panels in kernel 6.12+ (commit e8863f8b0316d8ee1e7e5291e8f2f72c91ac967d)
 kernel_has_psr_su_fixes() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     [[ $version_num -ge 612 ]]
 }
 
 # Check if PSR-SU workaround is required (kernel < 6.12 or specific OLED panels)
 # Returns: 0 if workaround needed, 1 if not needed
 kernel_requires_psr_su_workaround() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     # PSR-SU workaround needed for kernels < 6.12
     [[ $version_num -lt 612 ]]
 }
@@ -204,9 +425,9 @@ kernel_requires_psr_su_workaround() {
 # Get PSR-SU kernel parameter for current kernel
 # Returns: Kernel parameter string for PSR-SU
 kernel_get_psr_su_parameter() {
-    local version_num
-    version_num=$(kernel_get_version_num)
-    
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
+
     # For all kernels: disable PSR/PSR-SU/Replay/IPS/stutter via dcdebugmask
     # 0xe12 = DC_DISABLE_STUTTER(0x002) | DC_DISABLE_PSR(0x010) |
     #         DC_DISABLE_PSR_SU(0x200) | DC_DISABLE_REPLAY(0x400) |
@@ -227,8 +448,8 @@ kernel_get_psr_su_parameter() {
 # Get kernel status category
 # Returns: String describing kernel status
 kernel_get_status() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     
     if [[ $version_num -lt $KERNEL_MIN ]]; then
         echo "unsupported"
@@ -252,8 +473,9 @@ kernel_print_status() {
     local version_num
     local status
     
-    version_str=$(kernel_get_version_string)
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    version_str="${KERNEL_CAPS[release]}"
+    version_num="${KERNEL_CAPS[version_num]}"
     status=$(kernel_get_status)
     
     echo "Kernel Version: $version_str"
@@ -316,13 +538,18 @@ kernel_print_status() {
     if kernel_has_native_support; then
         echo "  (Most hardware now native - minimal fixes needed)"
     fi
+    echo
+
+    echo "Detected Capabilities:"
+    kernel_caps_probe_all
+    kernel_caps_print
 }
 
 # Get list of obsolete workarounds for current kernel
 # Output: Newline-separated list of obsolete workarounds
 kernel_list_obsolete_workarounds() {
-    local version_num
-    version_num=$(kernel_get_version_num)
+    kernel_caps_init || return 1
+    local version_num="${KERNEL_CAPS[version_num]}"
     
     if [[ $version_num -ge $KERNEL_AUDIO_NATIVE ]]; then
         # Kernel 6.19+ - CS35L41 audio quirk upstreamed
@@ -345,12 +572,24 @@ kernel_list_obsolete_workarounds() {
 # --- Library Information ---
 
 kernel_lib_version() {
-    echo "3.0.0"
+    echo "3.2.0"
 }
 
 kernel_lib_help() {
     cat <<'HELP'
-GZ302 Kernel Compatibility Library v3.0.0
+GZ302 Kernel Compatibility Library v3.2.0
+
+Capability Table (computed once per process):
+  kernel_caps_init              - Fill version fields from /proc (no fork)
+  kernel_caps_probe_all         - Run all feature probes and export the table
+  kernel_cap <probe>            - Query a memoized probe (0 present, 1 absent, 2 unknown)
+  kernel_module_has_param <m> <p> - Check a module parameter (memoized modinfo)
+  kernel_caps_export            - Export table as GZ302_KERNEL_CAPS for children
+  kernel_caps_print             - Print the table
+  kernel_caps_fingerprint       - Kernel series + probe results (setup steps)
+
+  Probes: mt7925e_disable_aspm, amdgpu_dcdebugmask,
+          amdgpu_runtime_debug_mask, sw_tablet_mode
 
 Version Detection Functions:
   kernel_get_version_num        - Get version as comparable number (e.g., 617)
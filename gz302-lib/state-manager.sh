@@ -4,14 +4,14 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 State Manager Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library provides persistent state tracking for the GZ302 toolkit.
 # It tracks what fixes have been applied, when they were applied, and provides
 # rollback capabilities.
 #
-# State is stored in: /var/lib/gz302/state/
-# Backups stored in: /var/backups/gz302/
+# State is stored in: /var/lib/gz302/state/journal
+# Backups stored in: /var/backups/gz302/store (content-addressed, deduplicated)
 # Logs stored in: /var/log/gz302/
 #
 # Usage:
@@ -19,14 +19,24 @@ set -euo pipefail
 #   state_init
 #   state_mark_applied "wifi" "aspm_workaround" "6.16"
 #   state_is_applied "wifi" "aspm_workaround"
-#   state_rollback "wifi" "aspm_workaround"
+#
+#   state_txn_begin "gpu"                  # several fixes, one atomic commit
+#   state_mark_applied "gpu" "modprobe_config"
+#   state_mark_applied "gpu" "early_kms"
+#   state_txn_commit
+#
+#   state_backup_file "/etc/default/grub" "bootloader"   # before editing
+#   state_restore_originals                               # undo everything
 # ==============================================================================
 
 # --- State Directory Paths ---
-readonly STATE_STORE_DIR="/var/lib/gz302/state"
-readonly BACKUP_DIR="/var/backups/gz302"
+# GZ302_STATE_STORE_DIR / GZ302_BACKUP_STORE_DIR let tooling (e.g. the
+# benchmark harness) point the stores at a fixture tree instead of the live
+# system state.
+readonly STATE_STORE_DIR="${GZ302_STATE_STORE_DIR:-/var/lib/gz302/state}"
+readonly BACKUP_DIR="${GZ302_BACKUP_STORE_DIR:-/var/backups/gz302}"
 readonly LOG_DIR="/var/log/gz302"
-readonly STATE_VERSION="1.0"
+readonly STATE_VERSION="2.0"
 
 # --- Initialization ---
 
@@ -55,14 +65,30 @@ state_init() {
         }
     fi
     
-    # Create version file if it doesn't exist
-    if [[ ! -f "$STATE_STORE_DIR/version" ]]; then
+    # Create or upgrade the version file
+    local current_version=""
+    if [[ -f "$STATE_STORE_DIR/version" ]]; then
+        read -r current_version < "$STATE_STORE_DIR/version" || true
+    fi
+    if [[ "$current_version" != "$STATE_VERSION" ]]; then
         local tmp_ver
         tmp_ver=$(mktemp "${STATE_STORE_DIR}/version.XXXXXX")
         echo "$STATE_VERSION" > "$tmp_ver"
         mv "$tmp_ver" "${STATE_STORE_DIR}/version"
     fi
     
+    state_index_load
+    
+    # Fold pre-journal <component>.state files into the journal
+    local legacy
+    for legacy in "$STATE_STORE_DIR"/*.state; do
+        if [[ -f "$legacy" ]]; then
+            state_compact || echo "WARNING: Failed to migrate legacy state files"
+            break
+        fi
+    done
+    
+    state_maybe_compact
     return 0
 }
 
@@ -72,14 +98,283 @@ state_is_initialized() {
     [[ -d "$STATE_STORE_DIR" ]] && [[ -f "$STATE_STORE_DIR/version" ]]
 }
 
+# --- Journal Store ---
+#
+# All component state lives in a single append-only journal:
+#
+#   S|component|fix|timestamp|metadata   fix applied (latest record wins)
+#   D|component|fix                      fix removed
+#   X|component                          component cleared (X|* = everything)
+#   B|txid ... C|txid                    atomic group of records
+#
+# The journal is replayed once per invocation into STATE_INDEX, so lookups
+# are plain associative-array reads. Records of a transaction are only
+# applied when its C| record is present; a torn tail (crash mid-write) is
+# ignored on replay. Writers serialize on a separate lock file so compaction,
+# which replaces the journal, never races an append.
+
+readonly STATE_JOURNAL="${STATE_STORE_DIR}/journal"
+readonly STATE_LOCK_FILE="${STATE_STORE_DIR}/.lock"
+STATE_COMPACT_THRESHOLD="${STATE_COMPACT_THRESHOLD:-512}"
+
+declare -gA STATE_INDEX=()      # "component|fix" -> "timestamp|metadata"
+declare -ga STATE_INDEX_ORDER=() # keys in first-applied order
+STATE_INDEX_LOADED=false
+STATE_JOURNAL_RECORDS=0
+STATE_JOURNAL_TORN=false        # unterminated transaction or partial last line
+
+declare -ga STATE_FIXES=()      # filled by state_collect_fixes
+declare -ga STATE_COMPONENTS=() # filled by state_collect_components
+
+# Pending transaction (see state_txn_begin)
+STATE_TXN_ID=""
+declare -ga STATE_TXN_RECORDS=()
+
+# Apply one journal record to the in-memory index
+# Args: $1 = record line
+state_index_apply() {
+    local rest="$1"
+    local op component key
+
+    # Split with parameter expansion - replay must not fork per record
+    op="${rest%%|*}"
+    rest="${rest#*|}"
+    component="${rest%%|*}"
+    rest="${rest#*|}"
+
+    case "$op" in
+        S)
+            # rest = fix|timestamp|metadata
+            key="${component}|${rest%%|*}"
+            [[ -n "${STATE_INDEX[$key]+set}" ]] || STATE_INDEX_ORDER+=("$key")
+            STATE_INDEX[$key]="${rest#*|}"
+            ;;
+        D)
+            unset "STATE_INDEX[${component}|${rest}]"
+            ;;
+        X)
+            for key in "${!STATE_INDEX[@]}"; do
+                if [[ "$component" == "*" || "$key" == "${component}|"* ]]; then
+                    unset "STATE_INDEX[$key]"
+                fi
+            done
+            ;;
+    esac
+}
+
+# Replay the journal into STATE_INDEX (once per invocation)
+# Args: $1 = "force" to rebuild even if already loaded
+# Returns: 0 always
+state_index_load() {
+    [[ "$STATE_INDEX_LOADED" == true && "${1:-}" != "force" ]] && return 0
+
+    STATE_INDEX=()
+    STATE_INDEX_ORDER=()
+    STATE_JOURNAL_RECORDS=0
+    STATE_JOURNAL_TORN=false
+    STATE_INDEX_LOADED=true
+
+    if [[ -f "$STATE_JOURNAL" ]]; then
+        local line txid=""
+        local -a pending=()
+        # A final line without newline is a torn write and is skipped by read
+        while IFS= read -r line; do
+            STATE_JOURNAL_RECORDS=$((STATE_JOURNAL_RECORDS + 1))
+            case "$line" in
+                B\|*)
+                    txid="${line#B|}"
+                    pending=()
+                    ;;
+                C\|*)
+                    if [[ -n "$txid" && "${line#C|}" == "$txid" ]]; then
+                        local record
+                        for record in "${pending[@]}"; do
+                            state_index_apply "$record"
+                        done
+                    fi
+                    txid=""
+                    pending=()
+                    ;;
+                *)
+                    if [[ -n "$txid" ]]; then
+                        pending+=("$line")
+                    else
+                        state_index_apply "$line"
+                    fi
+                    ;;
+            esac
+        done < "$STATE_JOURNAL"
+
+        # Appending after a torn tail would glue new records onto it
+        [[ -n "$txid" || -n "$line" ]] && STATE_JOURNAL_TORN=true
+    fi
+
+    # Pre-journal layout: one <component>.state file per component
+    local legacy component fix timestamp metadata
+    for legacy in "$STATE_STORE_DIR"/*.state; do
+        [[ -f "$legacy" ]] || continue
+        component="${legacy##*/}"
+        component="${component%.state}"
+        while IFS='|' read -r fix timestamp metadata; do
+            [[ -n "$fix" ]] || continue
+            [[ -n "${STATE_INDEX[${component}|${fix}]+set}" ]] && continue
+            state_index_apply "S|${component}|${fix}|${timestamp}|${metadata}"
+        done < "$legacy"
+    done
+
+    return 0
+}
+
+# Run a command while holding the state write lock
+# Args: command and arguments
+# Returns: exit status of the command
+state_with_lock() {
+    if command -v flock >/dev/null 2>&1; then
+        {
+            flock -x 9 || return 1
+            "$@"
+        } 9>>"$STATE_LOCK_FILE"
+    else
+        "$@"
+    fi
+}
+
+# Append records to the journal (caller holds the lock)
+# Args: record lines
+state_journal_write() {
+    local payload
+    printf -v payload '%s\n' "$@"
+    printf '%s' "$payload" >> "$STATE_JOURNAL"
+}
+
+# Append records to the journal and apply them to the index
+# Args: record lines
+# Returns: 0 on success, 1 on failure
+state_journal_append() {
+    if ! state_is_initialized; then
+        state_init >/dev/null || return 1
+    fi
+    state_index_load
+    if [[ "$STATE_JOURNAL_TORN" == true ]]; then
+        state_compact || return 1
+    fi
+
+    state_with_lock state_journal_write "$@" || return 1
+
+    local record
+    for record in "$@"; do
+        case "$record" in
+            B\|*|C\|*) ;;
+            *) state_index_apply "$record" ;;
+        esac
+        STATE_JOURNAL_RECORDS=$((STATE_JOURNAL_RECORDS + 1))
+    done
+
+    state_maybe_compact
+    return 0
+}
+
+# Queue a record, or append it right away outside a transaction
+# Args: $1 = record line
+state_record() {
+    if [[ -n "$STATE_TXN_ID" ]]; then
+        STATE_TXN_RECORDS+=("$1")
+        return 0
+    fi
+    state_journal_append "$1"
+}
+
+# --- Transactions ---
+
+# Start an atomic group of state changes
+# Args: $1 = transaction name (optional)
+# Returns: 0 on success, 1 if a transaction is already open
+state_txn_begin() {
+    if [[ -n "$STATE_TXN_ID" ]]; then
+        echo "ERROR: State transaction already open: $STATE_TXN_ID"
+        return 1
+    fi
+    STATE_TXN_ID="${1:-txn}-${BASHPID}-${EPOCHSECONDS}-${RANDOM}"
+    STATE_TXN_RECORDS=()
+    return 0
+}
+
+# Commit the open transaction (all records become visible together)
+# Returns: 0 on success, 1 on failure
+state_txn_commit() {
+    if [[ -z "$STATE_TXN_ID" ]]; then
+        echo "ERROR: No state transaction open"
+        return 1
+    fi
+
+    local txid="$STATE_TXN_ID"
+    local -a records=("${STATE_TXN_RECORDS[@]}")
+    STATE_TXN_ID=""
+    STATE_TXN_RECORDS=()
+
+    [[ ${#records[@]} -eq 0 ]] && return 0
+    state_journal_append "B|${txid}" "${records[@]}" "C|${txid}"
+}
+
+# Discard the open transaction
+state_txn_abort() {
+    STATE_TXN_ID=""
+    STATE_TXN_RECORDS=()
+    return 0
+}
+
+# --- Compaction ---
+
+# Rewrite the journal with one S| record per live fix (caller holds the lock)
+state_compact_locked() {
+    # Pick up records appended by other processes since our replay
+    state_index_load force
+
+    local tmp_file key seen_key
+    local -A seen=()
+    tmp_file=$(mktemp "${STATE_JOURNAL}.XXXXXX") || return 1
+    {
+        for key in "${STATE_INDEX_ORDER[@]}"; do
+            [[ -n "${STATE_INDEX[$key]+set}" && -z "${seen[$key]+set}" ]] || continue
+            seen[$key]=1
+            echo "S|${key}|${STATE_INDEX[$key]}"
+        done
+    } > "$tmp_file"
+    chmod 644 "$tmp_file" 2>/dev/null || true
+    mv "$tmp_file" "$STATE_JOURNAL" || { rm -f "$tmp_file"; return 1; }
+
+    # Legacy files are now represented in the journal
+    local legacy
+    for legacy in "$STATE_STORE_DIR"/*.state; do
+        [[ -f "$legacy" ]] && rm -f "$legacy"
+    done
+
+    state_index_load force
+}
+
+# Compact the journal now
+# Returns: 0 on success, 1 on failure
+state_compact() {
+    state_is_initialized || return 1
+    state_with_lock state_compact_locked
+}
+
+# Compact when dead records dominate the journal
+state_maybe_compact() {
+    local live=${#STATE_INDEX[@]}
+    if [[ $STATE_JOURNAL_RECORDS -gt $STATE_COMPACT_THRESHOLD && $STATE_JOURNAL_RECORDS -gt $((live * 2)) ]]; then
+        state_compact || true
+    fi
+    return 0
+}
+
 # --- Component State Management ---
 
 # Get state file path for component
 # Args: $1 = component name (wifi, gpu, input, audio, etc.)
-# Returns: Path to state file
+# Returns: Path to the journal (shared by all components)
 state_get_component_file() {
-    local component="$1"
-    echo "$STATE_STORE_DIR/${component}.state"
+    echo "$STATE_JOURNAL"
 }
 
 # Mark a fix as applied for a component
@@ -95,31 +390,12 @@ state_mark_applied() {
         return 1
     fi
     
-    # Ensure state is initialized
-    if ! state_is_initialized; then
-        state_init || return 1
-    fi
-    
-    local state_file
-    state_file=$(state_get_component_file "$component")
-    
     local timestamp
-    timestamp=$(date +%Y-%m-%d_%H:%M:%S)
-    
-    # Create or update state file
-    # Format: fix_name|timestamp|metadata
-    local entry="${fix_name}|${timestamp}|${metadata}"
-    
-    # Write atomically via mktemp + mv
-    local tmp_file
-    tmp_file=$(mktemp "${state_file}.XXXXXX")
-    if [[ -f "$state_file" ]]; then
-        grep -v "^${fix_name}|" "$state_file" > "$tmp_file" 2>/dev/null || true
-    fi
-    echo "$entry" >> "$tmp_file"
-    mv "$tmp_file" "$state_file"
+    printf -v timestamp '%(%Y-%m-%d_%H:%M:%S)T' -1
+    # Records are line-based
+    metadata="${metadata//$'\n'/ }"
     
-    return 0
+    state_record "S|${component}|${fix_name}|${timestamp}|${metadata}"
 }
 
 # Check if a fix is applied for a component
@@ -133,18 +409,8 @@ state_is_applied() {
         return 1
     fi
     
-    if ! state_is_initialized; then
-        return 1
-    fi
-    
-    local state_file
-    state_file=$(state_get_component_file "$component")
-    
-    if [[ ! -f "$state_file" ]]; then
-        return 1
-    fi
-    
-    grep -q "^${fix_name}|" "$state_file" 2>/dev/null
+    state_index_load
+    [[ -n "${STATE_INDEX[${component}|${fix_name}]+set}" ]]
 }
 
 # Remove a fix from state (mark as not applied)
@@ -159,24 +425,11 @@ state_mark_removed() {
         return 1
     fi
     
-    if ! state_is_initialized; then
-        return 0  # Nothing to remove
-    fi
-    
-    local state_file
-    state_file=$(state_get_component_file "$component")
-    
-    if [[ ! -f "$state_file" ]]; then
+    if ! state_is_applied "$component" "$fix_name"; then
         return 0  # Nothing to remove
     fi
     
-    # Remove entry atomically via mktemp + mv
-    local tmp_file
-    tmp_file=$(mktemp "${state_file}.XXXXXX")
-    grep -v "^${fix_name}|" "$state_file" > "$tmp_file" 2>/dev/null || true
-    mv "$tmp_file" "$state_file"
-    
-    return 0
+    state_record "D|${component}|${fix_name}"
 }
 
 # Get metadata for a fix
@@ -191,11 +444,8 @@ state_get_metadata() {
         return 1
     fi
     
-    local state_file
-    state_file=$(state_get_component_file "$component")
-    
-    # Extract metadata (third field)
-    grep "^${fix_name}|" "$state_file" 2>/dev/null | cut -d'|' -f3
+    local entry="${STATE_INDEX[${component}|${fix_name}]}"
+    echo "${entry#*|}"
 }
 
 # Get timestamp when fix was applied
@@ -210,11 +460,41 @@ state_get_timestamp() {
         return 1
     fi
     
-    local state_file
-    state_file=$(state_get_component_file "$component")
-    
-    # Extract timestamp (second field)
-    grep "^${fix_name}|" "$state_file" 2>/dev/null | cut -d'|' -f2
+    local entry="${STATE_INDEX[${component}|${fix_name}]}"
+    echo "${entry%%|*}"
+}
+
+# Collect the fixes of a component into STATE_FIXES (no subshell)
+# Args: $1 = component
+state_collect_fixes() {
+    local component="$1"
+    local key
+    local -A seen=()
+
+    STATE_FIXES=()
+    state_index_load
+    for key in "${STATE_INDEX_ORDER[@]}"; do
+        [[ "$key" == "${component}|"* ]] || continue
+        [[ -n "${STATE_INDEX[$key]+set}" && -z "${seen[$key]+set}" ]] || continue
+        seen[$key]=1
+        STATE_FIXES+=("${key#*|}")
+    done
+}
+
+# Collect components with at least one applied fix into STATE_COMPONENTS
+state_collect_components() {
+    local key component
+    local -A seen=()
+
+    STATE_COMPONENTS=()
+    state_index_load
+    for key in "${STATE_INDEX_ORDER[@]}"; do
+        [[ -n "${STATE_INDEX[$key]+set}" ]] || continue
+        component="${key%%|*}"
+        [[ -z "${seen[$component]+set}" ]] || continue
+        seen[$component]=1
+        STATE_COMPONENTS+=("$component")
+    done
 }
 
 # List all fixes for a component
@@ -227,15 +507,15 @@ state_list_fixes() {
         return 1
     fi
     
-    local state_file
-    state_file=$(state_get_component_file "$component")
-    
-    if [[ ! -f "$state_file" ]]; then
-        return 0
-    fi
-    
-    # Extract fix names (first field)
-    cut -d'|' -f1 "$state_file"
+    state_collect_fixes "$component"
+    [[ ${#STATE_FIXES[@]} -eq 0 ]] || printf '%s\n' "${STATE_FIXES[@]}"
+}
+
+# List components that have at least one applied fix
+# Output: Component names (one per line, first-applied order)
+state_list_components() {
+    state_collect_components
+    [[ ${#STATE_COMPONENTS[@]} -eq 0 ]] || printf '%s\n' "${STATE_COMPONENTS[@]}"
 }
 
 # --- Component Status ---
@@ -251,25 +531,26 @@ state_get_component_state() {
         return 1
     fi
     
-    local state_file
-    state_file=$(state_get_component_file "$component")
+    state_collect_fixes "$component"
+    local -a fixes=("${STATE_FIXES[@]}")
     
-    if [[ ! -f "$state_file" ]]; then
+    if [[ ${#fixes[@]} -eq 0 ]]; then
         echo "{\"component\": \"$component\", \"fixes\": []}"
         return 0
     fi
     
     echo "{\"component\": \"$component\", \"fixes\": ["
     
-    local first=true
-    while IFS='|' read -r fix_name timestamp metadata; do
+    local first=true fix_name entry
+    for fix_name in "${fixes[@]}"; do
+        entry="${STATE_INDEX[${component}|${fix_name}]}"
         if [[ "$first" == true ]]; then
             first=false
         else
             echo ","
         fi
-        echo "    {\"name\": \"$fix_name\", \"timestamp\": \"$timestamp\", \"metadata\": \"$metadata\"}"
-    done < "$state_file"
+        echo "    {\"name\": \"$fix_name\", \"timestamp\": \"${entry%%|*}\", \"metadata\": \"${entry#*|}\"}"
+    done
     
     echo "  ]}"
 }
@@ -282,26 +563,23 @@ state_get_system_state() {
         return 1
     fi
     
+    state_index_load
+    
     echo "{"
     echo "  \"version\": \"$STATE_VERSION\","
     echo "  \"components\": {"
     
-    local first=true
-    for state_file in "$STATE_STORE_DIR"/*.state; do
-        if [[ ! -f "$state_file" ]]; then
-            continue
-        fi
-        
-        local component
-        component=$(basename "$state_file" .state)
-        
+    local first=true component
+    state_collect_components
+    for component in "${STATE_COMPONENTS[@]}"; do
         if [[ "$first" == true ]]; then
             first=false
         else
             echo ","
         fi
         
-        echo "    \"$component\": $(state_get_component_state "$component")"
+        printf '    "%s": ' "$component"
+        state_get_component_state "$component"
     done
     
     echo "  }"
@@ -309,82 +587,354 @@ state_get_system_state() {
 }
 
 # --- Config File Backup ---
+#
+# Backups live in a content-addressed store: every distinct file content is
+# kept once as objects/<aa>/<sha256>, and an append-only manifest records
+# which content a path had at which time:
+#
+#   <epoch>|<component>|<sha256 or "absent">|<mode>|<path>
+#
+# "absent" means the file did not exist when the backup was taken, so
+# restoring that entry deletes the file. Because a backup is always taken
+# right before a modification, an entry holds the content the file had up to
+# that moment: the first entry for a path is its pre-GZ302 original, and the
+# first entry at or after time T is its content at T.
+
+readonly BACKUP_STORE_DIR="$BACKUP_DIR/store"
+readonly BACKUP_OBJECTS_DIR="$BACKUP_STORE_DIR/objects"
+readonly BACKUP_MANIFEST="$BACKUP_STORE_DIR/manifest"
+
+# path -> hash of the newest manifest entry (loaded once per run)
+declare -gA BACKUP_LATEST=()
+BACKUP_LATEST_LOADED=false
+
+# Paths changed by the last state_restore_* call
+declare -ga BACKUP_RESTORED=()
+
+# Create the backup store directories
+# Returns: 0 on success, 1 on failure
+state_backup_store_init() {
+    [[ -d "$BACKUP_OBJECTS_DIR" ]] && return 0
+    mkdir -p "$BACKUP_OBJECTS_DIR" 2>/dev/null || {
+        echo "ERROR: Failed to create backup store: $BACKUP_STORE_DIR"
+        return 1
+    }
+    # Blobs may hold sudoers and other sensitive files
+    chmod 700 "$BACKUP_STORE_DIR" 2>/dev/null || true
+}
+
+# Load the newest hash per path from the manifest
+state_backup_index_load() {
+    [[ "$BACKUP_LATEST_LOADED" == true ]] && return 0
+    BACKUP_LATEST=()
+    BACKUP_LATEST_LOADED=true
+    [[ -f "$BACKUP_MANIFEST" ]] || return 0
+
+    local line rest hash
+    while IFS= read -r line || [[ -n "$line" ]]; do
+        rest="${line#*|*|}"
+        hash="${rest%%|*}"
+        rest="${rest#*|*|}"
+        [[ -n "$rest" ]] && BACKUP_LATEST["$rest"]="$hash"
+    done < "$BACKUP_MANIFEST"
+}
 
 # Backup a configuration file before modifying
-# Args: $1 = file path
+# Each distinct content is stored once, so this is cheap to call before every
+# edit. A missing file is recorded as "absent".
+# Args: $1 = file path, $2 = component (default: manual)
 # Returns: 0 on success, 1 on failure
-# Output: Backup file path
+# Output: Blob path (empty if the file does not exist)
 state_backup_file() {
-    local file_path="$1"
-    
-    if [[ ! -f "$file_path" ]]; then
-        echo "WARNING: File not found: $file_path"
+    local file_path="${1:-}"
+    local component="${2:-manual}"
+    component="${component//|/_}"
+
+    if [[ -z "$file_path" ]]; then
+        echo "ERROR: File path required"
         return 1
     fi
-    
-    # Ensure backup directory exists
-    if [[ ! -d "$BACKUP_DIR" ]]; then
-        mkdir -p "$BACKUP_DIR" 2>/dev/null || {
-            echo "ERROR: Failed to create backup directory"
+    [[ "$file_path" == /* ]] || file_path="$PWD/$file_path"
+
+    state_backup_store_init || return 1
+    state_backup_index_load
+
+    local hash="absent" mode="-" blob=""
+    if [[ -e "$file_path" ]]; then
+        if [[ ! -f "$file_path" ]]; then
+            echo "WARNING: Not a regular file: $file_path"
+            return 1
+        fi
+
+        local sum
+        sum=$(sha256sum "$file_path" 2>/dev/null) || {
+            echo "ERROR: Failed to read file: $file_path"
             return 1
         }
+        hash="${sum%% *}"
+        mode=$(stat -c '%a' "$file_path" 2>/dev/null) || mode="644"
+
+        blob="$BACKUP_OBJECTS_DIR/${hash:0:2}/$hash"
+        if [[ ! -f "$blob" ]]; then
+            if ! { mkdir -p "${blob%/*}" && cp "$file_path" "$blob.tmp.$$" && mv -f "$blob.tmp.$$" "$blob"; } 2>/dev/null; then
+                rm -f "$blob.tmp.$$"
+                echo "ERROR: Failed to backup file: $file_path"
+                return 1
+            fi
+        fi
     fi
-    
-    # Create timestamped backup
-    local timestamp
-    timestamp=$(date +%Y%m%d_%H%M%S)
-    
-    local filename
-    filename=$(basename "$file_path")
-    
-    local backup_path="${BACKUP_DIR}/${filename}.${timestamp}.bak"
-    
-    if cp "$file_path" "$backup_path" 2>/dev/null; then
-        echo "$backup_path"
+
+    printf '%s|%s|%s|%s|%s\n' "$EPOCHSECONDS" "$component" "$hash" "$mode" "$file_path" \
+        >> "$BACKUP_MANIFEST" 2>/dev/null || {
+        echo "ERROR: Failed to update backup manifest"
+        return 1
+    }
+    BACKUP_LATEST["$file_path"]="$hash"
+
+    echo "$blob"
+    return 0
+}
+
+# Backup several files under one component
+# Args: $1 = component, remaining = file paths
+# Returns: 0 if every file was backed up, 1 otherwise
+state_backup_set() {
+    local component="$1"
+    shift
+    local file_path status=0
+    for file_path in "$@"; do
+        state_backup_file "$file_path" "$component" >/dev/null || status=1
+    done
+    return $status
+}
+
+# Put one manifest entry back in place
+# The current content is backed up first, so every restore can be undone.
+# Args: $1 = hash (or "absent"), $2 = mode, $3 = path
+# Returns: 0 on success, 1 on failure
+state_backup_apply_entry() {
+    local hash="$1"
+    local mode="$2"
+    local file_path="$3"
+
+    state_backup_file "$file_path" "restore" >/dev/null || return 1
+    if [[ "${BACKUP_LATEST[$file_path]}" == "$hash" ]]; then
         return 0
+    fi
+
+    if [[ "$hash" == "absent" ]]; then
+        rm -f "$file_path" || return 1
+        echo "Removed: $file_path"
+    else
+        local blob="$BACKUP_OBJECTS_DIR/${hash:0:2}/$hash"
+        if [[ ! -f "$blob" ]]; then
+            echo "ERROR: Backup object missing for $file_path: $hash"
+            return 1
+        fi
+        local tmp="${file_path}.gz302-restore.$$"
+        if ! { mkdir -p "${file_path%/*}" && cp "$blob" "$tmp" && chmod "$mode" "$tmp" && mv -f "$tmp" "$file_path"; } 2>/dev/null; then
+            rm -f "$tmp"
+            echo "ERROR: Failed to restore: $file_path"
+            return 1
+        fi
+        echo "Restored: $file_path"
+    fi
+
+    BACKUP_LATEST["$file_path"]="$hash"
+    BACKUP_RESTORED+=("$file_path")
+    return 0
+}
+
+# Convert a restore time to epoch seconds
+# Args: $1 = epoch seconds or any date(1) string
+# Output: Epoch seconds
+state_backup_parse_time() {
+    local when="$1"
+    if [[ "$when" =~ ^[0-9]+$ ]]; then
+        echo "$when"
     else
-        echo "ERROR: Failed to backup file: $file_path"
+        date -d "$when" +%s 2>/dev/null
+    fi
+}
+
+# Restore every backed-up file to its content at a point in time
+# Paths with no backup at or after that time have not been modified since
+# and are left alone.
+# Args: $1 = epoch seconds or date string, $2 = component filter (optional)
+# Returns: 0 on success, 1 if any file failed
+# Output: One line per changed file
+state_restore_point() {
+    local when="${1:-}"
+    local component="${2:-}"
+    BACKUP_RESTORED=()
+
+    local target
+    target=$(state_backup_parse_time "$when") || target=""
+    if [[ -z "$target" ]]; then
+        echo "ERROR: Invalid restore time: $when"
         return 1
     fi
+    if [[ ! -f "$BACKUP_MANIFEST" ]]; then
+        echo "No backups recorded"
+        return 0
+    fi
+
+    # Collect first: restoring appends to the manifest being read
+    local -A chosen=()
+    local -a order=()
+    local line epoch comp rest file_path
+    while IFS= read -r line || [[ -n "$line" ]]; do
+        epoch="${line%%|*}"
+        rest="${line#*|}"
+        comp="${rest%%|*}"
+        rest="${rest#*|}"
+        file_path="${rest#*|*|}"
+        [[ -z "$file_path" || "$epoch" -lt "$target" ]] && continue
+        [[ -n "$component" && "$comp" != "$component" ]] && continue
+
+        if [[ -z "${chosen[$file_path]+set}" ]]; then
+            order+=("$file_path")
+            chosen["$file_path"]="${rest%|"$file_path"}"
+        fi
+    done < "$BACKUP_MANIFEST"
+
+    local status=0 entry
+    for file_path in "${order[@]}"; do
+        entry="${chosen[$file_path]}"
+        state_backup_apply_entry "${entry%%|*}" "${entry#*|}" "$file_path" || status=1
+    done
+
+    if [[ ${#BACKUP_RESTORED[@]} -gt 0 ]]; then
+        local label="$when"
+        [[ "$target" -eq 0 ]] && label="pre-GZ302 originals"
+        state_log "INFO" "Restored ${#BACKUP_RESTORED[@]} file(s) to $label${component:+ ($component)}"
+    fi
+    return $status
+}
+
+# Restore every backed-up file to its pre-GZ302 original
+# Args: $1 = component filter (optional)
+# Returns: 0 on success, 1 if any file failed
+state_restore_originals() {
+    state_restore_point 0 "${1:-}"
 }
 
-# Restore a configuration file from backup
-# Args: $1 = backup file path
+# Restore a single file
+# Without a time the most recent backup is restored (undoes the last edit).
+# Args: $1 = original file path (or a legacy *.bak file), $2 = time (optional)
 # Returns: 0 on success, 1 on failure
 state_restore_file() {
-    local backup_path="$1"
-    
-    if [[ ! -f "$backup_path" ]]; then
-        echo "ERROR: Backup file not found: $backup_path"
+    local file_path="${1:-}"
+    local when="${2:-}"
+    BACKUP_RESTORED=()
+
+    # Backups written before the content-addressed store existed
+    if [[ "$file_path" == *.bak && "$file_path" == "$BACKUP_DIR"/* ]]; then
+        if [[ ! -f "$file_path" ]]; then
+            echo "ERROR: Backup file not found: $file_path"
+            return 1
+        fi
+        local filename="${file_path##*/}"
+        filename="${filename%.*.bak}"
+        local original_path="/etc/${filename}"
+        if cp "$file_path" "$original_path" 2>/dev/null; then
+            echo "Restored: $original_path from $file_path"
+            return 0
+        fi
+        echo "ERROR: Failed to restore file from: $file_path"
         return 1
     fi
-    
-    # Extract original filename (remove timestamp and .bak)
-    local filename
-    filename=$(basename "$backup_path" | sed 's/\.[0-9_]*\.bak$//')
-    
-    # Determine original path (assume /etc/ for modprobe.d, systemd, etc.)
-    # This is simplified - real implementation would store original path
-    local original_path="/etc/${filename}"
-    
-    if cp "$backup_path" "$original_path" 2>/dev/null; then
-        echo "Restored: $original_path from $backup_path"
-        return 0
-    else
-        echo "ERROR: Failed to restore file from: $backup_path"
+
+    [[ "$file_path" == /* ]] || file_path="$PWD/$file_path"
+    local target=""
+    if [[ -n "$when" ]]; then
+        target=$(state_backup_parse_time "$when") || target=""
+        if [[ -z "$target" ]]; then
+            echo "ERROR: Invalid restore time: $when"
+            return 1
+        fi
+    fi
+
+    local line epoch rest entry=""
+    if [[ -f "$BACKUP_MANIFEST" ]]; then
+        while IFS= read -r line || [[ -n "$line" ]]; do
+            [[ "$line" == *"|$file_path" ]] || continue
+            epoch="${line%%|*}"
+            rest="${line#*|*|}"
+            [[ "${rest#*|*|}" == "$file_path" ]] || continue
+            if [[ -z "$target" ]]; then
+                entry="${rest%|"$file_path"}"
+            elif [[ "$epoch" -ge "$target" ]]; then
+                entry="${rest%|"$file_path"}"
+                break
+            fi
+        done < "$BACKUP_MANIFEST"
+    fi
+
+    if [[ -z "$entry" ]]; then
+        if [[ -n "$target" ]]; then
+            echo "Unchanged since $when: $file_path"
+            return 0
+        fi
+        echo "ERROR: No backup recorded for: $file_path"
         return 1
     fi
+    state_backup_apply_entry "${entry%%|*}" "${entry#*|}" "$file_path"
 }
 
 # List all backups
-# Output: List of backup files with timestamps
+# Args: $1 = component filter (optional)
+# Output: One line per manifest entry (time, component, hash, path), then
+#         any legacy *.bak files
 state_list_backups() {
+    local component="${1:-}"
+
     if [[ ! -d "$BACKUP_DIR" ]]; then
         echo "No backups directory found"
         return 0
     fi
-    
-    find "$BACKUP_DIR" -name "*.bak" -type f 2>/dev/null | sort
+
+    local line epoch comp hash rest
+    if [[ -f "$BACKUP_MANIFEST" ]]; then
+        while IFS= read -r line || [[ -n "$line" ]]; do
+            epoch="${line%%|*}"
+            rest="${line#*|}"
+            comp="${rest%%|*}"
+            rest="${rest#*|}"
+            hash="${rest%%|*}"
+            rest="${rest#*|*|}"
+            [[ -n "$component" && "$comp" != "$component" ]] && continue
+            printf '%(%Y-%m-%d %H:%M:%S)T  %-10s %-12s %s\n' "$epoch" "$comp" "${hash:0:12}" "$rest"
+        done < "$BACKUP_MANIFEST"
+    fi
+
+    [[ -z "$component" ]] || return 0
+    find "$BACKUP_DIR" -path "$BACKUP_STORE_DIR" -prune -o -name "*.bak" -type f -print 2>/dev/null | sort
+}
+
+# Remove objects no manifest entry refers to
+# Returns: 0 on success
+# Output: Number of objects removed
+state_backup_gc() {
+    [[ -d "$BACKUP_OBJECTS_DIR" ]] || { echo "0"; return 0; }
+
+    local -A referenced=()
+    local line rest
+    if [[ -f "$BACKUP_MANIFEST" ]]; then
+        while IFS= read -r line || [[ -n "$line" ]]; do
+            rest="${line#*|*|}"
+            referenced["${rest%%|*}"]=1
+        done < "$BACKUP_MANIFEST"
+    fi
+
+    local blob removed=0
+    for blob in "$BACKUP_OBJECTS_DIR"/*/*; do
+        [[ -f "$blob" ]] || continue
+        if [[ -z "${referenced[${blob##*/}]:-}" ]]; then
+            rm -f "$blob" && removed=$((removed + 1))
+        fi
+    done
+    echo "$removed"
 }
 
 # --- Logging ---
@@ -436,6 +986,7 @@ state_print_status() {
         return 1
     fi
     
+    state_index_load
     echo "Status: Initialized"
     echo "State Directory: $STATE_STORE_DIR"
     echo "Backup Directory: $BACKUP_DIR"
@@ -443,37 +994,45 @@ state_print_status() {
     echo "Version: $STATE_VERSION"
     echo
     
+    echo "Journal: $STATE_JOURNAL_RECORDS record(s), ${#STATE_INDEX[@]} live fix(es)"
+    echo
+    
     echo "Component States:"
-    for state_file in "$STATE_STORE_DIR"/*.state; do
-        if [[ ! -f "$state_file" ]]; then
-            echo "  No components configured yet"
-            break
-        fi
-        
-        local component
-        component=$(basename "$state_file" .state)
-        
+    local component fix_name entry metadata
+    state_collect_components
+    if [[ ${#STATE_COMPONENTS[@]} -eq 0 ]]; then
+        echo "  No components configured yet"
+    fi
+    for component in "${STATE_COMPONENTS[@]}"; do
         echo "  Component: $component"
         
-        while IFS='|' read -r fix_name timestamp metadata; do
-            echo "    ✓ $fix_name (applied: $timestamp)"
+        state_collect_fixes "$component"
+        for fix_name in "${STATE_FIXES[@]}"; do
+            entry="${STATE_INDEX[${component}|${fix_name}]}"
+            metadata="${entry#*|}"
+            echo "    ✓ $fix_name (applied: ${entry%%|*})"
             if [[ -n "$metadata" ]]; then
                 echo "      Metadata: $metadata"
             fi
-        done < "$state_file"
+        done
         
         echo
     done
     
     echo "Recent Backups:"
-    local backup_count
-    backup_count=$(state_list_backups | wc -l)
-    echo "  Total: $backup_count"
+    state_backup_index_load
+    local -a objects=()
+    if [[ -d "$BACKUP_OBJECTS_DIR" ]]; then
+        shopt -s nullglob
+        objects=("$BACKUP_OBJECTS_DIR"/*/*)
+        shopt -u nullglob
+    fi
+    echo "  Files tracked: ${#BACKUP_LATEST[@]}, stored objects: ${#objects[@]}"
     
-    if [[ $backup_count -gt 0 ]]; then
+    if [[ ${#BACKUP_LATEST[@]} -gt 0 ]]; then
         echo "  Latest 5:"
-        state_list_backups | tail -5 | while read -r backup; do
-            echo "    $(basename "$backup")"
+        state_list_backups | tail -5 | while IFS= read -r backup; do
+            echo "    $backup"
         done
     fi
     
@@ -490,11 +1049,12 @@ state_clear_all() {
     echo "WARNING: This will clear all state tracking"
     echo "Backups and logs will be preserved"
     
-    if [[ -d "$STATE_STORE_DIR" ]]; then
-        rm -f "$STATE_STORE_DIR"/*.state 2>/dev/null || {
+    if state_is_initialized; then
+        state_journal_append "X|*" || {
             echo "ERROR: Failed to clear state"
             return 1
         }
+        state_compact || true
         echo "All state cleared"
     fi
     
@@ -512,11 +1072,9 @@ state_clear_component() {
         return 1
     fi
     
-    local state_file
-    state_file=$(state_get_component_file "$component")
-    
-    if [[ -f "$state_file" ]]; then
-        rm -f "$state_file"
+    state_collect_fixes "$component"
+    if [[ ${#STATE_FIXES[@]} -gt 0 ]]; then
+        state_record "X|${component}" || return 1
         echo "State cleared for component: $component"
     fi
     
@@ -526,12 +1084,12 @@ state_clear_component() {
 # --- Library Information ---
 
 state_lib_version() {
-    echo "3.0.0"
+    echo "3.2.0"
 }
 
 state_lib_help() {
     cat <<'HELP'
-GZ302 State Manager Library v3.0.0
+GZ302 State Manager Library v3.2.0
 
 Initialization:
   state_init                    - Initialize state management
@@ -544,15 +1102,29 @@ Component State:
   state_get_metadata <component> <fix> - Get fix metadata
   state_get_timestamp <component> <fix> - Get application timestamp
   state_list_fixes <component>  - List all fixes for component
+  state_list_components         - List components with applied fixes
+
+Transactions (atomic multi-fix commits):
+  state_txn_begin [name]        - Start buffering state changes
+  state_txn_commit              - Write buffered changes as one journal block
+  state_txn_abort               - Discard buffered changes
+
+Journal:
+  state_index_load [force]      - Replay journal into memory (once per run)
+  state_compact                 - Rewrite journal with live records only
 
 Component Status:
   state_get_component_state <component> - Get component state (JSON)
   state_get_system_state        - Get complete system state (JSON)
 
-File Backup:
-  state_backup_file <path>      - Backup file before modification
-  state_restore_file <backup>   - Restore file from backup
-  state_list_backups            - List all backup files
+File Backup (content-addressed store):
+  state_backup_file <path> [component] - Backup file before modification
+  state_backup_set <component> <paths...> - Backup several files
+  state_restore_file <path> [time] - Restore one file (latest or at time)
+  state_restore_point <time> [component] - Restore all files as of time
+  state_restore_originals [component] - Restore pre-GZ302 originals
+  state_list_backups [component] - List manifest entries
+  state_backup_gc               - Remove unreferenced objects
 
 Logging:
   state_log <level> <message>   - Log a message
@@ -582,8 +1154,12 @@ Example Usage:
       echo "ASPM workaround already applied"
   fi
   
-  # Backup file before modification
-  backup=$(state_backup_file "/etc/modprobe.d/mt7925.conf")
+  # Backup file before modification (unchanged content only adds a manifest line)
+  state_backup_file "/etc/modprobe.d/mt7925.conf" "wifi" >/dev/null
+
+  # Undo every GZ302 edit, or go back to yesterday's configuration
+  state_restore_originals
+  state_restore_point "yesterday"
   
   # Log activity
   state_log "INFO" "Applied WiFi ASPM workaround"
@@ -595,8 +1171,8 @@ Example Usage:
   state_get_system_state | jq .
 
 State Storage:
-  State files: /var/lib/gz302/state/
-  Backups: /var/backups/gz302/
+  Journal: /var/lib/gz302/state/journal (append-only, auto-compacted)
+  Backups: /var/backups/gz302/store (objects/<aa>/<sha256> + manifest)
   Logs: /var/log/gz302/
 
 Design Principles:
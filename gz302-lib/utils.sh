@@ -9,7 +9,7 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 Shared Utilities Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library contains shared functions for the GZ302 Linux Setup scripts.
 # It is sourced by gz302-setup.sh and all optional modules.
@@ -21,6 +21,7 @@ export BIN_DIR="/usr/local/bin"
 export STATE_DIR="/var/lib/gz302"
 export LOG_DIR="/var/log/gz302"
 export BACKUP_DIR="/var/backups/gz302"
+export CACHE_DIR="${GZ302_CACHE_DIR:-/var/cache/gz302}"
 export UDEV_RULES_DIR="/etc/udev/rules.d"
 export SUDOERS_DIR="/etc/sudoers.d"
 export SYSTEMD_DIR="/etc/systemd/system"
@@ -392,6 +393,7 @@ ensure_grub_kernel_param() {
     # Escape characters for sed (including quotes inside param)
     local escaped
     escaped=$(printf '%s' "$param" | sed -e 's/[&/]/\\&/g' -e 's/\"/\\\\\"/g')
+    backup_config_file "$grub_file" bootloader
     sed -i "s/^GRUB_CMDLINE_LINUX_DEFAULT=\"\(.*\)\"/GRUB_CMDLINE_LINUX_DEFAULT=\"\1 ${escaped}\"/" "$grub_file"
     return 0
 }
@@ -410,6 +412,7 @@ ensure_kcmdline_param() {
         return 1
     fi
     # Append parameter preserving existing content; ensure trailing newline
+    backup_config_file "$cmdline_file" bootloader
     printf '%s %s\n' "${current}" "$param" | sed 's/^ *//' > "${cmdline_file}.tmp" && mv "${cmdline_file}.tmp" "$cmdline_file"
     return 0
 }
@@ -434,184 +437,202 @@ ensure_loader_entry_param() {
     # Safely append to options line
     local escaped
     escaped=$(printf '%s' "$param" | sed -e 's/[&/]/\\&/g')
+    backup_config_file "$file" bootloader
     sed -i "0,/^options /s//& ${escaped} /" "$file"
     return 0
 }
 
 # ==============================================================================
 # CONFIG BACKUP SYSTEM
-# Creates timestamped backups of configurations before making changes
+# Records configurations in the content-addressed backup store kept by
+# state-manager.sh (/var/backups/gz302/store) before making changes
 # ==============================================================================
 
 # GZ302_BACKUP_DIR and GZ302_CHECKPOINT_FILE are now set from STATE_DIR and BACKUP_DIR
 GZ302_CHECKPOINT_FILE="${STATE_DIR}/checkpoint"
 
-# Create a backup of existing configurations before making changes
+# Load the backup store from state-manager.sh if the caller has not already
+# Returns: 0 if state_backup_file is available
+backup_store_available() {
+    declare -f state_backup_file >/dev/null 2>&1 && return 0
+    local lib="${BASH_SOURCE[0]%/*}/state-manager.sh"
+    # shellcheck source=/dev/null
+    [[ -f "$lib" ]] && source "$lib" 2>/dev/null
+    declare -f state_backup_file >/dev/null 2>&1
+}
+
+# Record a config file in the backup store right before it is modified
+# Files that do not exist yet are recorded too, so a restore removes them.
+# Falls back to a timestamped copy next to the file without the store.
+# Usage: backup_config_file "/etc/default/grub" "bootloader"
+backup_config_file() {
+    local file_path="$1"
+    local component="${2:-manual}"
+    if backup_store_available && state_backup_file "$file_path" "$component" >/dev/null; then
+        return 0
+    fi
+    if [[ -f "$file_path" ]]; then
+        cp "$file_path" "${file_path}.gz302.bak.$(date +%Y%m%d%H%M%S)" 2>/dev/null || true
+    fi
+    return 0
+}
+
+# Record all existing GZ302 configurations as one backup set
+# Only content not already in the store is copied.
 # Usage: create_config_backup "description"
+# Output: Restore point (epoch seconds) for state_restore_point
 create_config_backup() {
     local description="${1:-system-configs}"
-    local timestamp
-    timestamp=$(date +%Y%m%d_%H%M%S)
-    local backup_subdir="${BACKUP_DIR}/${timestamp}_${description}"
-    
-    # Create backup directory
-    mkdir -p "$backup_subdir"
-    
+    local restore_point="$EPOCHSECONDS"
+
     print_subsection "Creating Configuration Backup"
-    info "Backup location: $backup_subdir"
-    
-    local backed_up=0
-    
-    # Backup modprobe.d configurations
+
+    if ! backup_store_available; then
+        warning "Backup store unavailable (state-manager.sh not found)"
+        return 1
+    fi
+    info "Backup store: $BACKUP_STORE_DIR"
+
+    local -a files=()
+    local f
+
+    # Modprobe configurations
     if [[ -d /etc/modprobe.d ]]; then
-        local modprobe_files
-        modprobe_files=$(find /etc/modprobe.d -name "*gz302*" -o -name "*mt7925*" -o -name "*amdgpu*" 2>/dev/null || true)
-        if [[ -n "$modprobe_files" ]]; then
-            mkdir -p "$backup_subdir/modprobe.d"
-            echo "$modprobe_files" | while read -r f; do
-                [[ -f "$f" ]] && cp "$f" "$backup_subdir/modprobe.d/" && ((backed_up++)) || true
-            done
-            completed_item "Modprobe configurations"
-        fi
+        while IFS= read -r f; do
+            files+=("$f")
+        done < <(find /etc/modprobe.d -type f \( -name "*gz302*" -o -name "*mt7925*" -o -name "*amdgpu*" \) 2>/dev/null || true)
     fi
-    
-    # Backup systemd services
+
+    # Systemd services
     if [[ -d "$SYSTEMD_DIR" ]]; then
-        local systemd_files
-        systemd_files=$(find "$SYSTEMD_DIR" -name "*gz302*" 2>/dev/null || true)
-        if [[ -n "$systemd_files" ]]; then
-            mkdir -p "$backup_subdir/systemd"
-            echo "$systemd_files" | while read -r f; do
-                [[ -f "$f" ]] && cp "$f" "$backup_subdir/systemd/" && ((backed_up++)) || true
-            done
-            completed_item "Systemd services"
-        fi
+        while IFS= read -r f; do
+            files+=("$f")
+        done < <(find "$SYSTEMD_DIR" -type f -name "*gz302*" 2>/dev/null || true)
     fi
-    
-    # Backup sudoers entries
+
+    # Sudoers entries
     if [[ -d "$SUDOERS_DIR" ]]; then
-        local sudoers_files
-        sudoers_files=$(find "$SUDOERS_DIR" -name "*gz302*" -o -name "*pwrcfg*" -o -name "*rrcfg*" 2>/dev/null || true)
-        if [[ -n "$sudoers_files" ]]; then
-            mkdir -p "$backup_subdir/sudoers.d"
-            echo "$sudoers_files" | while read -r f; do
-                [[ -f "$f" ]] && cp "$f" "$backup_subdir/sudoers.d/" && ((backed_up++)) || true
-            done
-            completed_item "Sudoers configurations"
-        fi
+        while IFS= read -r f; do
+            files+=("$f")
+        done < <(find "$SUDOERS_DIR" -type f \( -name "*gz302*" -o -name "*pwrcfg*" -o -name "*rrcfg*" \) 2>/dev/null || true)
     fi
-    
-    # Backup custom scripts
+
+    # Custom scripts
     if [[ -d "$BIN_DIR" ]]; then
-        local script_files
-        script_files=$(find "$BIN_DIR" -name "*gz302*" -o -name "pwrcfg" -o -name "rrcfg" 2>/dev/null || true)
-        if [[ -n "$script_files" ]]; then
-            mkdir -p "$backup_subdir/bin"
-            echo "$script_files" | while read -r f; do
-                [[ -f "$f" ]] && cp "$f" "$backup_subdir/bin/" && ((backed_up++)) || true
-            done
-            completed_item "Custom scripts"
-        fi
+        while IFS= read -r f; do
+            files+=("$f")
+        done < <(find "$BIN_DIR" -type f \( -name "*gz302*" -o -name "pwrcfg" -o -name "rrcfg" \) 2>/dev/null || true)
     fi
-    
-    # Backup config directories
+
+    # Config directories
+    local config_dir
     for config_dir in "$CONFIG_DIR" "/etc/gz302-tdp" "/etc/gz302-refresh" "/etc/gz302-rgb"; do
-        if [[ -d "$config_dir" ]]; then
-            local dir_name
-            dir_name=$(basename "$config_dir")
-            cp -r "$config_dir" "$backup_subdir/${dir_name}/"
-            completed_item "Config directory: $dir_name"
-            ((backed_up++)) || true
-        fi
+        [[ -d "$config_dir" ]] || continue
+        while IFS= read -r f; do
+            files+=("$f")
+        done < <(find "$config_dir" -type f 2>/dev/null || true)
     done
-    
-    # Create backup manifest
-    cat > "$backup_subdir/MANIFEST.txt" << EOF
-GZ302 Configuration Backup
-==========================
-Date: $(date)
-Description: $description
-Contents:
-$(find "$backup_subdir" -type f ! -name "MANIFEST.txt" | sed "s|$backup_subdir/||")
-
-To restore:
-  sudo cp -r $backup_subdir/* /
-EOF
-    
-    if [[ $backed_up -gt 0 ]]; then
-        success "Backup created: $backup_subdir"
-        print_tip "To restore: sudo cp -r $backup_subdir/* /"
-    else
+
+    if [[ ${#files[@]} -eq 0 ]]; then
         info "No existing configurations to backup"
-        rmdir "$backup_subdir" 2>/dev/null || true
+        echo "$restore_point"
+        return 0
     fi
-    
-    echo "$backup_subdir"
+
+    if state_backup_set "$description" "${files[@]}"; then
+        completed_item "${#files[@]} configuration file(s) recorded"
+    else
+        warning "Some configuration files could not be backed up"
+    fi
+
+    success "Backup set created: $description"
+    print_tip "To restore: state_restore_point $restore_point (gz302-lib/state-manager.sh)"
+    echo "$restore_point"
 }
 
 # List available backups
 list_backups() {
-    if [[ ! -d "$BACKUP_DIR" ]]; then
+    if ! backup_store_available || [[ ! -f "$BACKUP_MANIFEST" ]]; then
         info "No backups found"
         return 1
     fi
-    
+
     print_subsection "Available Backups"
-    local count=0
-    for backup in "$BACKUP_DIR"/*; do
-        if [[ -d "$backup" ]]; then
-            local name
-            name=$(basename "$backup")
-            local manifest="$backup/MANIFEST.txt"
-            if [[ -f "$manifest" ]]; then
-                local date_line
-                date_line=$(grep "^Date:" "$manifest" | head -1)
-                info "$name - ${date_line#Date: }"
-            else
-                info "$name"
-            fi
-            ((count++))
-        fi
-    done
-    
-    if [[ $count -eq 0 ]]; then
-        info "No backups found"
-        return 1
-    fi
-    
+    state_list_backups
     return 0
 }
 
 # ==============================================================================
 # ERROR RECOVERY / CHECKPOINT SYSTEM
 # Tracks completed steps for resumable installations
+#
+# The checkpoint file is append-only: a PHASE=/STARTED= header followed by one
+# "STEP=<name>|<epoch>" line per completed step, so completing a step is a
+# single append rather than an in-place rewrite.
 # ==============================================================================
 
+CHECKPOINT_LOADED=false
+CHECKPOINT_PHASE=""
+CHECKPOINT_LAST_UPDATE=""
+declare -gA CHECKPOINT_STEPS=()
+declare -ga CHECKPOINT_ORDER=()
+
+# Read the checkpoint file into memory (once per run)
+checkpoint_load() {
+    [[ "$CHECKPOINT_LOADED" == true ]] && return 0
+    CHECKPOINT_LOADED=true
+    CHECKPOINT_PHASE=""
+    CHECKPOINT_LAST_UPDATE=""
+    CHECKPOINT_STEPS=()
+    CHECKPOINT_ORDER=()
+    [[ -f "$GZ302_CHECKPOINT_FILE" ]] || return 0
+
+    local line step legacy
+    while IFS= read -r line || [[ -n "$line" ]]; do
+        case "$line" in
+            PHASE=*) CHECKPOINT_PHASE="${line#PHASE=}" ;;
+            STARTED=*|LAST_UPDATE=*) CHECKPOINT_LAST_UPDATE="${line#*=}" ;;
+            STEP=*)
+                line="${line#STEP=}"
+                step="${line%%|*}"
+                CHECKPOINT_LAST_UPDATE="${line#*|}"
+                if [[ -n "$step" && -z "${CHECKPOINT_STEPS[$step]+set}" ]]; then
+                    CHECKPOINT_STEPS["$step"]=1
+                    CHECKPOINT_ORDER+=("$step")
+                fi
+                ;;
+            COMPLETED_STEPS=*)
+                # Comma-joined list written by older releases
+                IFS=',' read -ra legacy <<< "${line#COMPLETED_STEPS=}"
+                for step in "${legacy[@]}"; do
+                    [[ -n "$step" && -z "${CHECKPOINT_STEPS[$step]+set}" ]] || continue
+                    CHECKPOINT_STEPS["$step"]=1
+                    CHECKPOINT_ORDER+=("$step")
+                done
+                ;;
+        esac
+    done < "$GZ302_CHECKPOINT_FILE"
+}
+
 # Initialize or load checkpoint state
 # Usage: init_checkpoint "install-phase"
 init_checkpoint() {
     local phase="${1:-main}"
-    local checkpoint_dir
-    checkpoint_dir=$(dirname "$GZ302_CHECKPOINT_FILE")
-    
-    mkdir -p "$checkpoint_dir"
-    
+
+    mkdir -p "${GZ302_CHECKPOINT_FILE%/*}"
+
     # Check for existing checkpoint
-    if [[ -f "$GZ302_CHECKPOINT_FILE" ]]; then
-        local saved_phase
-        saved_phase=$(grep "^PHASE=" "$GZ302_CHECKPOINT_FILE" | cut -d'=' -f2)
-        if [[ "$saved_phase" == "$phase" ]]; then
-            return 0  # Checkpoint exists for this phase
-        fi
+    checkpoint_load
+    if [[ -f "$GZ302_CHECKPOINT_FILE" && "$CHECKPOINT_PHASE" == "$phase" ]]; then
+        return 0  # Checkpoint exists for this phase
     fi
-    
+
     # Create new checkpoint file
-    cat > "$GZ302_CHECKPOINT_FILE" << EOF
-PHASE=$phase
-STARTED=$(date +%s)
-LAST_UPDATE=$(date +%s)
-COMPLETED_STEPS=
-EOF
+    printf 'PHASE=%s\nSTARTED=%s\n' "$phase" "$EPOCHSECONDS" > "$GZ302_CHECKPOINT_FILE"
+    CHECKPOINT_PHASE="$phase"
+    CHECKPOINT_LAST_UPDATE="$EPOCHSECONDS"
+    CHECKPOINT_STEPS=()
+    CHECKPOINT_ORDER=()
     return 0  # New checkpoint created
 }
 
@@ -642,18 +663,13 @@ complete_step() {
         return 1
     fi
     
-    # Add step to completed list
-    local current_steps
-    current_steps=$(grep "^COMPLETED_STEPS=" "$GZ302_CHECKPOINT_FILE" | cut -d'=' -f2)
-    
-    if [[ -z "$current_steps" ]]; then
-        current_steps="$step"
-    else
-        current_steps="${current_steps},$step"
+    checkpoint_load
+    printf 'STEP=%s|%s\n' "$step" "$EPOCHSECONDS" >> "$GZ302_CHECKPOINT_FILE" || return 1
+    CHECKPOINT_LAST_UPDATE="$EPOCHSECONDS"
+    if [[ -z "${CHECKPOINT_STEPS[$step]+set}" ]]; then
+        CHECKPOINT_STEPS["$step"]=1
+        CHECKPOINT_ORDER+=("$step")
     fi
-    
-    sed -i "s/^COMPLETED_STEPS=.*/COMPLETED_STEPS=${current_steps}/" "$GZ302_CHECKPOINT_FILE"
-    sed -i "s/^LAST_UPDATE=.*/LAST_UPDATE=$(date +%s)/" "$GZ302_CHECKPOINT_FILE"
 }
 
 # Check if a step was already completed
@@ -665,28 +681,27 @@ is_step_completed() {
         return 1
     fi
     
-    local completed_steps
-    completed_steps=$(grep "^COMPLETED_STEPS=" "$GZ302_CHECKPOINT_FILE" | cut -d'=' -f2)
-    
-    if echo ",$completed_steps," | grep -q ",$step,"; then
-        return 0
-    fi
-    return 1
+    checkpoint_load
+    [[ -n "${CHECKPOINT_STEPS[$step]+set}" ]]
 }
 
 # Get list of completed steps
+# Output: Comma-joined step names
 get_completed_steps() {
     if [[ ! -f "$GZ302_CHECKPOINT_FILE" ]]; then
         echo ""
         return
     fi
     
-    grep "^COMPLETED_STEPS=" "$GZ302_CHECKPOINT_FILE" | cut -d'=' -f2
+    checkpoint_load
+    local IFS=','
+    echo "${CHECKPOINT_ORDER[*]}"
 }
 
 # Clear checkpoint (installation complete)
 clear_checkpoint() {
     rm -f "$GZ302_CHECKPOINT_FILE"
+    CHECKPOINT_LOADED=false
 }
 
 # Check if we're resuming from a checkpoint
@@ -697,17 +712,12 @@ check_resume() {
         return 1  # No checkpoint to resume
     fi
     
-    local saved_phase
-    saved_phase=$(grep "^PHASE=" "$GZ302_CHECKPOINT_FILE" | cut -d'=' -f2)
-    
-    if [[ "$saved_phase" != "$phase" ]]; then
+    checkpoint_load
+    if [[ "$CHECKPOINT_PHASE" != "$phase" ]]; then
         return 1  # Different phase
     fi
     
-    local completed_steps
-    completed_steps=$(get_completed_steps)
-    
-    if [[ -z "$completed_steps" ]]; then
+    if [[ ${#CHECKPOINT_ORDER[@]} -eq 0 ]]; then
         return 1  # No steps completed
     fi
     
@@ -723,20 +733,15 @@ prompt_resume() {
         return 1
     fi
     
-    local completed_steps
-    completed_steps=$(get_completed_steps)
-    local step_count
-    step_count=$(echo "$completed_steps" | tr ',' '\n' | wc -l)
-    
-    local last_update
-    last_update=$(grep "^LAST_UPDATE=" "$GZ302_CHECKPOINT_FILE" | cut -d'=' -f2)
-    local last_date
-    last_date=$(date -d "@$last_update" 2>/dev/null || date -r "$last_update" 2>/dev/null || echo "unknown")
+    local last_date="unknown"
+    if [[ "$CHECKPOINT_LAST_UPDATE" =~ ^[0-9]+$ ]]; then
+        printf -v last_date '%(%c)T' "$CHECKPOINT_LAST_UPDATE"
+    fi
     
     echo
     print_box "Resume Previous Installation?"
     info "Found incomplete installation from: $last_date"
-    info "Completed steps: $step_count"
+    info "Completed steps: ${#CHECKPOINT_ORDER[@]}"
     echo
     
     # Use helper to ask prompt but honor ASSUME_YES
@@ -748,6 +753,136 @@ prompt_resume() {
     fi
 }
 
+# ==============================================================================
+# STEP FINGERPRINTS
+# Skips setup steps whose inputs have not changed since they last succeeded
+#
+# Each step declares its inputs as a list of tokens:
+#   kernel        - kernel series and detected capabilities (kernel-compat.sh)
+#   lib:<name>    - content of gz302-lib/<name>
+#   file:<path>   - content of any file ("absent" if missing)
+#   tool:<name>   - installed path and --version output of a command
+#   <key>=<value> - any literal (distro, tool version, ...)
+# The inputs are hashed into one fingerprint and stored in the state journal
+# (component "setup") once the step succeeds.
+# ==============================================================================
+
+GZ302_FORCE_STEPS="${GZ302_FORCE_STEPS:-false}"
+
+# Hash a list of input tokens into one fingerprint
+# Args: input tokens (see above)
+# Output: sha256 fingerprint
+step_fingerprint() {
+    local lib_dir="${BASH_SOURCE[0]%/*}"
+    local -a files=()
+    local material="" token
+
+    for token in "$@"; do
+        case "$token" in
+            kernel)
+                if declare -f kernel_caps_fingerprint >/dev/null 2>&1; then
+                    material+="kernel=$(kernel_caps_fingerprint)"$'\n'
+                else
+                    material+="kernel=$(uname -r)"$'\n'
+                fi
+                ;;
+            tool:*)
+                local tool="${token#tool:}" tool_path
+                # type -P: trace_attach shadows some tools with functions,
+                # for which command -v prints the name, not the path
+                if tool_path=$(type -P "$tool" 2>/dev/null); then
+                    material+="${tool}=${tool_path} $("$tool_path" --version 2>/dev/null || true)"$'\n'
+                else
+                    material+="${tool}=none"$'\n'
+                fi
+                ;;
+            lib:*) files+=("${lib_dir}/${token#lib:}") ;;
+            file:*) files+=("${token#file:}") ;;
+            *) material+="${token}"$'\n' ;;
+        esac
+    done
+
+    # Hash all files in one call; missing ones are part of the fingerprint too
+    local -a present=()
+    local f
+    for f in "${files[@]}"; do
+        if [[ -f "$f" ]]; then
+            present+=("$f")
+        else
+            material+="absent ${f}"$'\n'
+        fi
+    done
+    if [[ ${#present[@]} -gt 0 ]]; then
+        material+="$(sha256sum "${present[@]}" 2>/dev/null)"$'\n'
+    fi
+
+    local sum
+    sum=$(printf '%s' "$material" | sha256sum)
+    echo "${sum%% *}"
+}
+
+# Check whether a step's recorded fingerprint matches
+# Args: $1 = step name, $2 = fingerprint
+# Returns: 0 if the step is up to date
+step_is_current() {
+    local step="$1"
+    local fingerprint="$2"
+    [[ "$GZ302_FORCE_STEPS" == "true" ]] && return 1
+    declare -f state_get_metadata >/dev/null 2>&1 || return 1
+    state_is_applied "setup" "$step" 2>/dev/null || return 1
+    [[ "$(state_get_metadata "setup" "$step" 2>/dev/null)" == "$fingerprint" ]]
+}
+
+# Run a command with errexit in force, even where the caller tests its status
+# A function called from if, || or && runs with errexit off, and so would a
+# subshell it starts. A process substitution is a new process that does not
+# inherit that, so the first failing command ends the step. Stdin is shared
+# and stdout is ours, so prompts still work; variables it sets are not seen.
+# Args: command and its arguments
+# Returns: the command's exit status
+run_with_errexit() {
+    local out pid
+    exec {out}>&1
+    : < <(set -e; "$@" >&"$out")
+    pid=$!
+    exec {out}>&-
+    wait "$pid"
+}
+
+# Run a setup step unless its inputs are unchanged since it last succeeded
+# The fingerprint is recorded after the step, so files the step itself
+# writes can be listed as inputs: a later manual edit triggers a re-run.
+# Args: $1 = step name, $2 = name of an array holding the input tokens,
+#       remaining = command to run
+# Returns: the command's status (0 when skipped)
+run_setup_step() {
+    local step="$1"
+    local -n step_inputs="$2"
+    shift 2
+
+    local fingerprint
+    fingerprint=$(step_fingerprint "${step_inputs[@]}")
+    if step_is_current "$step" "$fingerprint"; then
+        completed_item "${step}: unchanged since last run (skipped; use --force to redo)"
+        return 0
+    fi
+
+    local status=0
+    trace_span "$step" step run_with_errexit "$@" || status=$?
+    # Pick up the state the step recorded in its own process
+    declare -f state_index_load >/dev/null 2>&1 && state_index_load force
+    if [[ $status -ne 0 ]]; then
+        declare -f state_mark_removed >/dev/null 2>&1 && state_mark_removed "setup" "$step" >/dev/null 2>&1
+        return $status
+    fi
+
+    if declare -f state_mark_applied >/dev/null 2>&1; then
+        fingerprint=$(step_fingerprint "${step_inputs[@]}")
+        state_mark_applied "setup" "$step" "$fingerprint" >/dev/null 2>&1 || true
+    fi
+    return 0
+}
+
 # Configure kernel parameters for rEFInd
 ensure_refind_kernel_param() {
     local param="$1"
@@ -760,6 +895,7 @@ ensure_refind_kernel_param() {
             # Escaping for sed
             local escaped
             escaped=$(printf '%s' "$param" | sed -e 's/[&/]/\\&/g')
+            backup_config_file "$refind_conf" bootloader
             sed -i "/^\"Boot with standard options\"/ s/\"$/ ${escaped}\"/" "$refind_conf"
             return 0
         else
@@ -787,6 +923,7 @@ ensure_syslinux_kernel_param() {
             # Add parameters to APPEND line
             local escaped
             escaped=$(printf '%s' "$param" | sed -e 's/[&/]/\\&/g')
+            backup_config_file "$syslinux_cfg" bootloader
             sed -i "/^APPEND/ s/$/ ${escaped}/" "$syslinux_cfg"
             return 0
         else
@@ -818,6 +955,8 @@ ensure_limine_kernel_param() {
     local escaped
     escaped=$(printf '%s' "$param" | sed -e 's/[&/\]/\\&/g')
 
+    backup_config_file "$limine_conf" bootloader
+
     # Check if KERNEL_CMDLINE[default] line exists with quotes
     if grep -qE '^KERNEL_CMDLINE\[default\]\+?="[^"]*"' "$limine_conf"; then
         # Append to existing KERNEL_CMDLINE[default] line (handles both = and +=)
@@ -833,3 +972,684 @@ ensure_limine_kernel_param() {
         return 0
     fi
 }
+
+# ==============================================================================
+# PACKAGE PLAN
+# gz302-setup.sh collects the packages of every selected section and module
+# first and installs them in one transaction per package manager, so
+# repository metadata is refreshed once and post-install hooks (ldconfig,
+# icon caches, initramfs triggers) run once instead of once per section.
+#
+# The plan is a file exported as GZ302_PKG_PLAN so modules started as child
+# processes can see it. Lines:
+#   U|<source>         - <source> requested a full system upgrade; <source>
+#                        is not marked C unless the upgrade succeeded
+#   P|<source>|<pkg>   - package requested by <source> (section or module)
+#   C|<source>         - <source>'s packages were installed by the plan
+#   F|<source>         - <source>'s packages failed; it installs its own
+# Package names are the distribution's own. "a|b" installs the first of a/b
+# the repositories offer; dnf groups are written @group, zypper patterns
+# pattern:name and local packages as absolute paths.
+# ==============================================================================
+
+# Start an empty plan
+# Exports: GZ302_PKG_PLAN
+pkg_plan_init() {
+    local plan
+    plan=$(mktemp /tmp/gz302-pkg-plan-XXXXXX) || return 1
+    mkdir -p "${plan}.d"
+    export GZ302_PKG_PLAN="$plan"
+}
+
+# Remove the plan and anything downloaded for it
+pkg_plan_cleanup() {
+    [[ -n "${GZ302_PKG_PLAN:-}" ]] || return 0
+    rm -rf "${GZ302_PKG_PLAN}" "${GZ302_PKG_PLAN}.d"
+    unset GZ302_PKG_PLAN
+}
+
+# Request packages
+# Args: $1 = source name, remaining = package names (whitespace-separated
+#       lists are split, so "$(module --list-packages)" can be passed as one)
+pkg_plan_add() {
+    [[ -n "${GZ302_PKG_PLAN:-}" ]] || return 0
+    local source="$1"
+    shift
+    local -a packages
+    read -ra packages <<< "$*"
+    local pkg
+    for pkg in "${packages[@]}"; do
+        echo "P|${source}|${pkg}" >> "$GZ302_PKG_PLAN"
+    done
+}
+
+# Request a full system upgrade as part of the transaction
+# Args: $1 = source that asked for it (it is only marked installed once the
+#       upgrade succeeded, so its own pkg_install --upgrade can retry)
+pkg_plan_upgrade() {
+    [[ -n "${GZ302_PKG_PLAN:-}" ]] || return 0
+    echo "U|${1:-}" >> "$GZ302_PKG_PLAN"
+}
+
+# Check whether the plan installed a source's packages
+# Args: $1 = source name
+# Returns: 0 if installed by the plan
+pkg_plan_has() {
+    [[ -n "${GZ302_PKG_PLAN:-}" && -f "$GZ302_PKG_PLAN" ]] || return 1
+    local line
+    while IFS= read -r line; do
+        [[ "$line" == "C|$1" ]] && return 0
+    done < "$GZ302_PKG_PLAN"
+    return 1
+}
+
+# Check whether a package is offered by the configured repositories
+# Args: $1 = distribution, $2 = package
+# Returns: 0 if available (unknown managers assume yes)
+pkg_available() {
+    case "$1" in
+        arch) pacman -Si "$2" >/dev/null 2>&1 ;;
+        debian|ubuntu) apt-cache show "$2" >/dev/null 2>&1 ;;
+        fedora) dnf -q info "$2" >/dev/null 2>&1 ;;
+        opensuse) zypper -q info "$2" 2>/dev/null | grep -q '^Name' ;;
+        *) return 0 ;;
+    esac
+}
+
+# Resolve "a|b" alternatives to the first available package
+# Args: $1 = distribution, $2 = package or alternatives
+# Output: package name (the last alternative if none is available)
+pkg_resolve() {
+    local distro="$1"
+    local spec="$2"
+    if [[ "$spec" != *"|"* ]]; then
+        echo "$spec"
+        return 0
+    fi
+    local -a alternatives
+    IFS='|' read -ra alternatives <<< "$spec"
+    local alt
+    for alt in "${alternatives[@]}"; do
+        if pkg_available "$distro" "$alt"; then
+            echo "$alt"
+            return 0
+        fi
+    done
+    echo "${alternatives[-1]}"
+}
+
+# Refresh repository metadata once per setup run
+# Args: $1 = distribution
+pkg_refresh() {
+    [[ "${GZ302_PKG_REFRESHED:-}" == "true" ]] && return 0
+    case "$1" in
+        debian|ubuntu) apt-get update ;;
+        opensuse) zypper refresh ;;
+        *) return 0 ;;
+    esac
+    local status=$?
+    [[ $status -eq 0 ]] && export GZ302_PKG_REFRESHED=true
+    return $status
+}
+
+# Run one package manager transaction
+# Args: $1 = distribution, $2 = "upgrade" for a full upgrade or "" for none,
+#       remaining = packages (alternatives allowed)
+# Returns: the package manager's exit status
+pkg_transaction() {
+    local distro="$1"
+    local upgrade="$2"
+    shift 2
+
+    pkg_refresh "$distro" || return 1
+    local -a packages=()
+    local spec
+    for spec in "$@"; do
+        packages+=("$(pkg_resolve "$distro" "$spec")")
+    done
+
+    case "$distro" in
+        arch)
+            # pacman upgrades and installs in the same transaction
+            if [[ "$upgrade" == "upgrade" ]]; then
+                pacman -Syu --noconfirm --needed "${packages[@]}"
+            elif [[ ${#packages[@]} -gt 0 ]]; then
+                pacman -S --noconfirm --needed "${packages[@]}"
+            fi
+            ;;
+        debian|ubuntu)
+            if [[ "$upgrade" == "upgrade" ]]; then
+                apt-get upgrade -y || return 1
+            fi
+            [[ ${#packages[@]} -eq 0 ]] || apt-get install -y "${packages[@]}"
+            ;;
+        fedora)
+            if [[ "$upgrade" == "upgrade" ]]; then
+                dnf upgrade -y || return 1
+            fi
+            [[ ${#packages[@]} -eq 0 ]] || dnf install -y "${packages[@]}"
+            ;;
+        opensuse)
+            if [[ "$upgrade" == "upgrade" ]]; then
+                zypper update -y || return 1
+            fi
+            [[ ${#packages[@]} -eq 0 ]] || zypper install -y "${packages[@]}"
+            ;;
+        *)
+            warning "No package manager support for ${distro}"
+            return 1
+            ;;
+    esac
+}
+
+# Install everything in the plan: one transaction for all sources, falling
+# back to one transaction per source if the combined one fails, so a single
+# unavailable package does not block every other section
+# Args: $1 = distribution
+# Returns: 0 if every source was installed
+pkg_plan_commit() {
+    local distro="$1"
+    [[ -n "${GZ302_PKG_PLAN:-}" && -f "$GZ302_PKG_PLAN" ]] || return 0
+
+    local upgrade="" upgrade_source="" line source pkg
+    local -a sources=() packages=()
+    local -A source_packages=() seen=()
+    while IFS= read -r line; do
+        case "$line" in
+            U\|*)
+                upgrade="upgrade"
+                upgrade_source="${line#U|}"
+                ;;
+            P\|*)
+                line="${line#P|}"
+                source="${line%%|*}"
+                pkg="${line#*|}"
+                [[ -n "${source_packages[$source]+set}" ]] || sources+=("$source")
+                source_packages[$source]+="${pkg} "
+                if [[ -z "${seen[$pkg]:-}" ]]; then
+                    seen[$pkg]=1
+                    packages+=("$pkg")
+                fi
+                ;;
+        esac
+    done < "$GZ302_PKG_PLAN"
+
+    if [[ ${#packages[@]} -eq 0 && -z "$upgrade" ]]; then
+        info "Package plan is empty"
+        return 0
+    fi
+
+    info "Installing ${#packages[@]} package(s) for: ${sources[*]:-system upgrade}"
+    if pkg_transaction "$distro" "$upgrade" "${packages[@]}"; then
+        for source in "${sources[@]}"; do
+            echo "C|${source}" >> "$GZ302_PKG_PLAN"
+        done
+        success "Packages installed in one transaction"
+        return 0
+    fi
+
+    warning "Combined package transaction failed — installing per section"
+    local failed=0 upgraded=true
+    if [[ -n "$upgrade" ]] && ! pkg_transaction "$distro" upgrade; then
+        warning "System upgrade failed"
+        upgraded=false
+        failed=1
+    fi
+    for source in "${sources[@]}"; do
+        local -a group
+        read -ra group <<< "${source_packages[$source]}"
+        if pkg_transaction "$distro" "" "${group[@]}"; then
+            # Left unmarked, the source's own pkg_install retries the upgrade
+            [[ "$upgraded" == false && "$source" == "$upgrade_source" ]] && continue
+            echo "C|${source}" >> "$GZ302_PKG_PLAN"
+        else
+            echo "F|${source}" >> "$GZ302_PKG_PLAN"
+            warning "Packages for ${source} failed to install"
+            failed=1
+        fi
+    done
+    return $failed
+}
+
+# Install a section's packages unless the plan already did
+# Sections and modules call this instead of the package manager, so they
+# still work when run on their own (no plan active).
+# Args: [--upgrade] $1 = source name, $2 = distribution, remaining = packages
+# Returns: 0 on success
+pkg_install() {
+    local upgrade=""
+    if [[ "${1:-}" == "--upgrade" ]]; then
+        upgrade="upgrade"
+        shift
+    fi
+    local source="$1"
+    local distro="$2"
+    shift 2
+
+    if pkg_plan_has "$source"; then
+        completed_item "${source}: packages installed by the package plan"
+        return 0
+    fi
+    pkg_transaction "$distro" "$upgrade" "$@"
+}
+
+# ==============================================================================
+# FETCHER
+# Downloads go through a content-addressed cache under /var/cache/gz302, so
+# re-runs and air-gapped reinstalls are served locally:
+#   objects/<aa>/<sha256>  - each distinct download, stored once
+#   urls                   - append-only "<url>|<sha256>" index (last wins)
+#   partial/<url-hash>     - interrupted downloads, resumed on the next try
+# A download is verified when its SHA-256 is known: SHA256SUMS in the
+# repository for project files, the GitHub "digest" for release assets.
+# Only verified downloads are resumed; the content behind an unpinned URL
+# may have changed in between.
+#
+# GZ302_OFFLINE=true serves everything from the cache. GITHUB_RAW_URL may
+# point at any HTTP server that mirrors the repository layout, and
+# GZ302_GITHUB_API at a mirror or stand-in of the GitHub REST API.
+# ==============================================================================
+
+GZ302_OFFLINE="${GZ302_OFFLINE:-false}"
+GZ302_FETCH_JOBS="${GZ302_FETCH_JOBS:-4}"
+GITHUB_RAW_URL="${GITHUB_RAW_URL:-https://raw.githubusercontent.com/th3cavalry/GZ302-Linux-Setup/main}"
+GZ302_GITHUB_API="${GZ302_GITHUB_API:-https://api.github.com}"
+FETCH_REPO_SUMS_LOADED=false
+declare -gA FETCH_REPO_SUMS=()
+
+# Create the cache (falls back to a per-run directory if it is not writable)
+fetch_cache_init() {
+    if mkdir -p "${CACHE_DIR}/objects" "${CACHE_DIR}/partial" 2>/dev/null && [[ -w "$CACHE_DIR" ]]; then
+        return 0
+    fi
+    CACHE_DIR=$(mktemp -d /tmp/gz302-cache.XXXXXX) || return 1
+    mkdir -p "${CACHE_DIR}/objects" "${CACHE_DIR}/partial"
+}
+
+# Path of a cached object
+# Args: $1 = sha256
+# Output: Object path
+fetch_cache_object() {
+    echo "${CACHE_DIR}/objects/${1:0:2}/${1}"
+}
+
+# Last hash recorded for a URL
+# Args: $1 = url
+# Output: sha256 (nothing if the URL was never fetched)
+fetch_cache_lookup() {
+    local url="$1"
+    local line sum=""
+    [[ -f "${CACHE_DIR}/urls" ]] || return 0
+    while IFS= read -r line; do
+        [[ "${line%|*}" == "$url" ]] && sum="${line##*|}"
+    done < "${CACHE_DIR}/urls"
+    [[ -z "$sum" ]] || echo "$sum"
+}
+
+# Copy a cached object to its destination (atomically)
+# Args: $1 = sha256, $2 = destination
+fetch_cache_copy() {
+    local dest="$2"
+    [[ "$dest" != */* ]] || mkdir -p "${dest%/*}"
+    cp -f "$(fetch_cache_object "$1")" "${dest}.part.${BASHPID}" \
+        && mv -f "${dest}.part.${BASHPID}" "$dest"
+}
+
+# Move a completed download into the cache and index its URL
+# Args: $1 = downloaded file, $2 = sha256, $3 = url
+fetch_cache_store() {
+    local obj
+    obj=$(fetch_cache_object "$2")
+    mkdir -p "${obj%/*}" || return 1
+    if [[ -f "$obj" ]]; then
+        rm -f "$1"
+    else
+        mv -f "$1" "$obj" || return 1
+    fi
+    echo "${3}|${2}" >> "${CACHE_DIR}/urls"
+}
+
+# Download a URL into a file
+# Args: $1 = url, $2 = output file, $3 = "resume" to continue a partial file
+# Returns: the downloader's exit status
+fetch_download() {
+    local url="$1"
+    local out="$2"
+    local resume="${3:-}"
+    local -a opts
+    if command -v curl >/dev/null 2>&1; then
+        opts=(-fsSL --retry 3 --retry-delay 2 --connect-timeout 15)
+        [[ "$resume" == "resume" && -s "$out" ]] && opts+=(-C -)
+        curl "${opts[@]}" -o "$out" "$url"
+    elif command -v wget >/dev/null 2>&1; then
+        opts=(-q --tries=3 --timeout=15)
+        [[ "$resume" == "resume" ]] && opts+=(-c)
+        wget "${opts[@]}" -O "$out" "$url"
+    else
+        warning "curl or wget not found"
+        return 127
+    fi
+}
+
+# Fetch a URL through the cache
+# Args: $1 = url, $2 = destination file, $3 = expected sha256 (optional)
+# Returns: 0 on success, 1 if unavailable or the checksum does not match
+fetch_file() {
+    local url="$1"
+    local dest="$2"
+    local expected="${3:-}"
+
+    fetch_cache_init || return 1
+
+    # Pinned content is served from the cache without touching the network
+    if [[ -n "$expected" && -f "$(fetch_cache_object "$expected")" ]]; then
+        fetch_cache_copy "$expected" "$dest"
+        return
+    fi
+
+    if [[ "$GZ302_OFFLINE" != "true" ]]; then
+        local key
+        key=$(printf '%s' "$url" | sha256sum)
+        local partial="${CACHE_DIR}/partial/${key%% *}"
+        local downloaded=false
+        if [[ -n "$expected" ]] && fetch_download "$url" "$partial" resume 2>/dev/null; then
+            downloaded=true
+        else
+            # Unpinned URLs, or a resume the server refused: start over
+            rm -f "$partial"
+            fetch_download "$url" "$partial" && downloaded=true
+        fi
+
+        if [[ "$downloaded" == true ]]; then
+            local sum
+            sum=$(sha256sum "$partial")
+            sum="${sum%% *}"
+            if [[ -n "$expected" && "$sum" != "$expected" ]]; then
+                rm -f "$partial"
+                warning "Checksum mismatch for ${url##*/} (expected ${expected:0:12}, got ${sum:0:12})"
+                return 1
+            fi
+            fetch_cache_store "$partial" "$sum" "$url" || return 1
+            fetch_cache_copy "$sum" "$dest"
+            return
+        fi
+    fi
+
+    # Offline, or the download failed: use the last copy of this URL
+    local known="$expected"
+    [[ -n "$known" ]] || known=$(fetch_cache_lookup "$url")
+    if [[ -n "$known" && -f "$(fetch_cache_object "$known")" ]]; then
+        [[ "$GZ302_OFFLINE" == "true" ]] || warning "Download failed — using cached ${url##*/}"
+        fetch_cache_copy "$known" "$dest"
+        return
+    fi
+    [[ "$GZ302_OFFLINE" != "true" ]] || warning "Offline: ${url##*/} is not in ${CACHE_DIR}"
+    return 1
+}
+
+# Fetch several files, at most GZ302_FETCH_JOBS at a time
+# Args: specs of the form "<url>|<destination>|<sha256 or empty>"
+# Returns: 0 if every fetch succeeded
+fetch_parallel() {
+    fetch_cache_init || return 1
+    local spec url dest sum
+    local running=0 failed=0
+    for spec in "$@"; do
+        IFS='|' read -r url dest sum <<< "$spec"
+        fetch_file "$url" "$dest" "$sum" &
+        running=$((running + 1))
+        if [[ $running -ge $GZ302_FETCH_JOBS ]]; then
+            wait -n || failed=1
+            running=$((running - 1))
+        fi
+    done
+    while [[ $running -gt 0 ]]; do
+        wait -n || failed=1
+        running=$((running - 1))
+    done
+    return $failed
+}
+
+# Load the checksums of repository files (SHA256SUMS next to GITHUB_RAW_URL)
+fetch_repo_sums_load() {
+    [[ "$FETCH_REPO_SUMS_LOADED" == "true" ]] && return 0
+    FETCH_REPO_SUMS_LOADED=true
+    local tmp
+    tmp=$(mktemp /tmp/gz302-sums.XXXXXX) || return 1
+    if fetch_file "${GITHUB_RAW_URL}/SHA256SUMS" "$tmp"; then
+        local sum path
+        while read -r sum path; do
+            [[ -n "$path" ]] && FETCH_REPO_SUMS["${path#\*}"]="$sum"
+        done < "$tmp"
+    else
+        warning "SHA256SUMS unavailable — repository files will not be verified"
+    fi
+    rm -f "$tmp"
+}
+
+# Fetch one repository file
+# Args: $1 = path relative to the repository root, $2 = destination
+fetch_repo_file() {
+    fetch_repo_sums_load
+    fetch_file "${GITHUB_RAW_URL}/$1" "$2" "${FETCH_REPO_SUMS[$1]:-}"
+}
+
+# Fetch repository files in parallel, keeping their relative paths
+# Args: $1 = destination root, remaining = paths relative to the repository root
+fetch_repo_files() {
+    local root="$1"
+    shift
+    fetch_repo_sums_load
+    local -a specs=()
+    local path
+    for path in "$@"; do
+        specs+=("${GITHUB_RAW_URL}/${path}|${root}/${path}|${FETCH_REPO_SUMS[$path]:-}")
+    done
+    fetch_parallel "${specs[@]}"
+}
+
+# Look up a GitHub release asset and its SHA-256 digest
+# Args: $1 = owner/repo, $2 = asset name suffix, $3 = tag (default: latest)
+# Output: "<url> <sha256>" (sha256 is empty for releases without digests)
+github_release_asset() {
+    local repo="$1"
+    local suffix="$2"
+    local tag="${3:-latest}"
+    local api="${GZ302_GITHUB_API}/repos/${repo}/releases/latest"
+    [[ "$tag" == "latest" ]] || api="${GZ302_GITHUB_API}/repos/${repo}/releases/tags/${tag}"
+
+    local tmp
+    tmp=$(mktemp /tmp/gz302-release.XXXXXX) || return 1
+    if ! fetch_file "$api" "$tmp"; then
+        rm -f "$tmp"
+        return 1
+    fi
+    # "digest" precedes "browser_download_url" within each asset object
+    grep -oE '"(digest|browser_download_url)": *"[^"]*"' "$tmp" \
+        | awk -v suffix="$suffix" '
+            { value = $0; sub(/^"[a-z_]*": *"/, "", value); sub(/"$/, "", value) }
+            /^"digest"/ { digest = value; next }
+            !found && substr(value, length(value) - length(suffix) + 1) == suffix {
+                sub(/^sha256:/, "", digest); print value, digest; found = 1
+            }
+            { digest = "" }'
+    rm -f "$tmp"
+}
+
+# ==============================================================================
+# TRACING
+# Records timed spans in Chrome Trace Event format (open the JSON in
+# https://ui.perfetto.dev or chrome://tracing). gz302-setup.sh starts the
+# trace; modules that source this file join it through GZ302_TRACE_EVENTS.
+#
+# Spans are appended as one JSON object per line to "<trace>.events" while
+# setup runs and wrapped into the final JSON file by trace_finalize.
+# Package managers, downloads and boot-artifact tools are timed
+# automatically: trace_attach shadows them with functions that call
+# trace_span.
+# ==============================================================================
+
+GZ302_TRACE="${GZ302_TRACE:-true}"
+TRACE_OWNER=false
+TRACE_NOW_US=0
+declare -ga TRACE_STACK=()
+
+# External commands timed automatically, as <category>:<command>
+TRACE_WRAPPED_COMMANDS=(
+    pkg:pacman pkg:apt pkg:apt-get pkg:dnf pkg:zypper pkg:flatpak pkg:pip pkg:pip3
+    download:curl download:wget download:git
+    boot:grub-mkconfig boot:grub2-mkconfig boot:mkinitcpio boot:dracut
+    boot:update-initramfs boot:kernel-install boot:bootctl boot:limine-update
+    boot:limine-mkinitcpio
+)
+
+# Current time in microseconds into TRACE_NOW_US (no fork)
+trace_now_us() {
+    local now="$EPOCHREALTIME"
+    now="${now/[.,]/}"
+    TRACE_NOW_US=$(( 10#$now - ${GZ302_TRACE_START_US:-0} ))
+}
+
+# Append one complete ("X") event
+# Args: $1 = name, $2 = category, $3 = start (us), $4 = duration (us), $5 = exit status
+trace_event() {
+    [[ -n "${GZ302_TRACE_EVENTS:-}" ]] || return 0
+    local name="${1//\\/\\\\}"
+    name="${name//\"/\\\"}"
+    name="${name//[$'\t\r\n']/ }"
+    printf '{"name":"%s","cat":"%s","ph":"X","ts":%s,"dur":%s,"pid":%s,"tid":%s,"args":{"status":%s}}\n' \
+        "$name" "$2" "$3" "$4" "$$" "$BASHPID" "${5:-0}" >> "$GZ302_TRACE_EVENTS" 2>/dev/null || true
+}
+
+# Start a trace (no-op if one is already active or GZ302_TRACE=false)
+# Args: $1 = process name shown in the trace viewer
+# Exports: GZ302_TRACE_FILE, GZ302_TRACE_EVENTS, GZ302_TRACE_START_US
+trace_init() {
+    [[ "$GZ302_TRACE" == "true" ]] || return 0
+    if [[ -z "${GZ302_TRACE_EVENTS:-}" ]]; then
+        mkdir -p "$LOG_DIR" 2>/dev/null || return 0
+        local stamp
+        printf -v stamp '%(%Y%m%d-%H%M%S)T' -1
+        local trace_file="${GZ302_TRACE_FILE:-${LOG_DIR}/setup-trace-${stamp}.json}"
+        : > "${trace_file}.events" 2>/dev/null || return 0
+
+        local now="$EPOCHREALTIME"
+        export GZ302_TRACE_START_US="${now/[.,]/}"
+        export GZ302_TRACE_FILE="$trace_file"
+        export GZ302_TRACE_EVENTS="${trace_file}.events"
+        TRACE_OWNER=true
+    fi
+    trace_attach "${1:-${0##*/}}"
+}
+
+# Join the active trace: name this process and time wrapped commands
+# Args: $1 = process name
+trace_attach() {
+    [[ -n "${GZ302_TRACE_EVENTS:-}" ]] || return 0
+    printf '{"name":"process_name","ph":"M","pid":%s,"tid":%s,"args":{"name":"%s"}}\n' \
+        "$$" "$$" "${1:-${0##*/}}" >> "$GZ302_TRACE_EVENTS" 2>/dev/null || return 0
+
+    local entry cmd
+    for entry in "${TRACE_WRAPPED_COMMANDS[@]}"; do
+        cmd="${entry#*:}"
+        # Only shadow installed commands, so "command -v" existence checks
+        # keep working (use type -P where a path is needed), and never
+        # replace a function the caller defined
+        type -P "$cmd" >/dev/null 2>&1 || continue
+        declare -F "$cmd" >/dev/null 2>&1 && continue
+        eval "${cmd}() { trace_command ${entry%%:*} ${cmd} \"\$@\"; }"
+    done
+}
+
+# Run an external command as a span named after its command line
+# Args: $1 = category, remaining = command
+trace_command() {
+    local category="$1"
+    shift
+    local name="$*"
+    [[ ${#name} -gt 96 ]] && name="${name:0:93}..."
+    trace_span "$name" "$category" command "$@"
+}
+
+# Open a span; close it with trace_end in the same shell
+# Args: $1 = name, $2 = category (default: step)
+trace_begin() {
+    [[ -n "${GZ302_TRACE_EVENTS:-}" ]] || return 0
+    trace_now_us
+    TRACE_STACK+=("${TRACE_NOW_US}"$'\t'"${2:-step}"$'\t'"$1")
+}
+
+# Close the innermost open span
+# Args: $1 = exit status to record (default: 0)
+trace_end() {
+    [[ ${#TRACE_STACK[@]} -gt 0 ]] || return 0
+    local top="${TRACE_STACK[-1]}"
+    unset 'TRACE_STACK[-1]'
+    local start="${top%%$'\t'*}"
+    local rest="${top#*$'\t'}"
+    trace_now_us
+    trace_event "${rest#*$'\t'}" "${rest%%$'\t'*}" "$start" "$((TRACE_NOW_US - start))" "${1:-0}"
+}
+
+# Run a command inside a span
+# errexit still applies to the command: if it aborts the script, the span is
+# closed by trace_finalize with status -1.
+# Args: $1 = name, $2 = category, remaining = command
+# Returns: the command's exit status
+trace_span() {
+    local name="$1"
+    local category="$2"
+    shift 2
+    trace_begin "$name" "$category"
+    "$@"
+    local status=$?
+    trace_end "$status"
+    return $status
+}
+
+# Write the trace JSON and print the slowest spans
+# Only the process that started the trace finalizes it; safe to call twice.
+# Args: $1 = number of rows in the summary (default: 10)
+trace_finalize() {
+    [[ "$TRACE_OWNER" == "true" && -f "${GZ302_TRACE_EVENTS:-}" ]] || return 0
+    TRACE_OWNER=false
+    while [[ ${#TRACE_STACK[@]} -gt 0 ]]; do
+        trace_end -1
+    done
+
+    {
+        printf '{"displayTimeUnit":"ms","traceEvents":[\n'
+        sed '$!s/$/,/' "$GZ302_TRACE_EVENTS"
+        printf ']}\n'
+    } > "$GZ302_TRACE_FILE" 2>/dev/null || return 0
+
+    trace_print_summary "${1:-10}"
+    rm -f "$GZ302_TRACE_EVENTS"
+    info "Trace written to ${GZ302_TRACE_FILE} (open in https://ui.perfetto.dev)"
+}
+
+# Print the slowest spans recorded so far
+# Args: $1 = number of rows
+trace_print_summary() {
+    local rows="${1:-10}"
+    local total_us
+    trace_now_us
+    total_us="$TRACE_NOW_US"
+
+    print_subsection "Slowest Steps (total $(awk -v t="$total_us" 'BEGIN { printf "%.1f", t / 1000000 }')s)"
+    printf "   %9s  %-9s %s\n" "SECONDS" "CATEGORY" "SPAN"
+    awk '/"ph":"X"/ {
+            name = $0; sub(/^\{"name":"/, "", name); sub(/","cat":".*/, "", name)
+            gsub(/\\"/, "\"", name); gsub(/\\\\/, "\\", name)
+            cat = $0;  sub(/.*"cat":"/, "", cat);    sub(/".*/, "", cat)
+            dur = $0;  sub(/.*"dur":/, "", dur);     sub(/,.*/, "", dur)
+            printf "%d\t%s\t%s\n", dur, cat, name
+        }' "$GZ302_TRACE_EVENTS" \
+        | sort -t$'\t' -k1,1nr \
+        | awk -F'\t' -v rows="$rows" 'NR <= rows { printf "   %9.2f  %-9s %s\n", $1 / 1000000, $2, $3 }'
+}
+
+# Join a trace started by a parent process (gz302-setup.sh running a module)
+if [[ -n "${GZ302_TRACE_EVENTS:-}" && -w "${GZ302_TRACE_EVENTS}" ]]; then
+    trace_attach "${0##*/}"
+fi
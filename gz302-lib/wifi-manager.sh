@@ -4,7 +4,7 @@ set -euo pipefail
 
 # ==============================================================================
 # GZ302 WiFi Manager Library
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This library provides hardware detection, configuration, and management
 # functions for the MediaTek MT7925e WiFi controller in the GZ302.
@@ -23,6 +23,14 @@ set -euo pipefail
 #   wifi_verify_fix
 # ==============================================================================
 
+# --- Kernel Capability Table ---
+# Kernel checks come from kernel-compat.sh; load it when this library is
+# sourced on its own.
+if ! declare -f kernel_caps_init >/dev/null 2>&1; then
+    # shellcheck source=gz302-lib/kernel-compat.sh
+    source "$(dirname "${BASH_SOURCE[0]}")/kernel-compat.sh"
+fi
+
 # --- WiFi Hardware Detection (Read-Only) ---
 
 # Detect if MT7925e WiFi controller is present
@@ -70,21 +78,7 @@ wifi_get_firmware_version() {
 # Check if current kernel requires ASPM workaround
 # Returns: 0 if workaround needed, 1 if not needed
 wifi_requires_aspm_workaround() {
-    # Use kernel-compat library if available, otherwise fallback to local logic
-    if declare -f kernel_get_version_num >/dev/null 2>&1; then
-        local version_num
-        version_num=$(kernel_get_version_num)
-        [[ $version_num -lt 617 ]]
-    else
-        # Fallback: local implementation
-        local kernel_version
-        kernel_version=$(uname -r | cut -d. -f1,2)
-        local major minor
-        major=$(echo "$kernel_version" | cut -d. -f1)
-        minor=$(echo "$kernel_version" | cut -d. -f2)
-        local version_num=$((major * 100 + minor))
-        [[ $version_num -lt 617 ]]
-    fi
+    kernel_requires_wifi_workaround
 }
 
 # --- State Detection (What's Currently Applied) ---
@@ -173,6 +167,7 @@ wifi_apply_aspm_workaround() {
     fi
     
     # Create modprobe configuration
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/modprobe.d/mt7925.conf wifi
     cat > /etc/modprobe.d/mt7925.conf <<'EOF'
 # MediaTek MT7925 Wi-Fi fix for GZ302
 # Disable ASPM for stability (required for kernels < 6.17)
@@ -204,6 +199,7 @@ wifi_remove_aspm_workaround() {
     fi
     
     # Create clean configuration noting native support
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/modprobe.d/mt7925.conf wifi
     cat > /etc/modprobe.d/mt7925.conf <<'EOF'
 # MediaTek MT7925 Wi-Fi configuration for GZ302
 # Kernel 6.17+ has native ASPM support - no workarounds needed
@@ -230,6 +226,7 @@ wifi_disable_powersave() {
     
     # Create NetworkManager configuration
     mkdir -p /etc/NetworkManager/conf.d/
+    declare -f backup_config_file >/dev/null && backup_config_file /etc/NetworkManager/conf.d/wifi-powersave.conf wifi
     cat > /etc/NetworkManager/conf.d/wifi-powersave.conf <<'EOF'
 [connection]
 # Disable WiFi power saving for stability (2 = disabled)
@@ -3,7 +3,7 @@
 # ==============================================================================
 # ASUS ROG Flow Z13 (GZ302) Linux Setup — Unified Installer
 # Author: th3cavalry using Copilot
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # Supported Models:
 # - GZ302EA-XS99 (128GB RAM)
@@ -30,6 +30,14 @@ SKIP_Z13CTL=false
 SKIP_TOOLS=false
 SKIP_MODULES=false
 
+# Sections selected at the prompts (asked before anything is installed)
+DO_BASE=false
+DO_FIXES=false
+DO_Z13CTL=false
+DO_TOOLS=false
+SELECTED_MODULES=()
+declare -A MODULE_PATHS=()
+
 while [[ $# -gt 0 ]]; do
     case "$1" in
         -y|--assume-yes) ASSUME_YES=true; shift ;;
@@ -39,9 +47,12 @@ while [[ $# -gt 0 ]]; do
         --no-z13ctl)     SKIP_Z13CTL=true; shift ;;
         --no-tools)      SKIP_TOOLS=true; shift ;;
         --no-modules)    SKIP_MODULES=true; shift ;;
+        --force)         export GZ302_FORCE_STEPS=true; shift ;;
+        --no-trace)      export GZ302_TRACE=false; shift ;;
+        --offline)       export GZ302_OFFLINE=true; shift ;;
         -h|--help)
             cat << 'EOF'
-ASUS ROG Flow Z13 (GZ302) Linux Setup — Unified Installer v6.3.6
+ASUS ROG Flow Z13 (GZ302) Linux Setup — Unified Installer v6.28.1
 
 Usage: sudo ./gz302-setup.sh [OPTIONS]
 
@@ -53,8 +64,21 @@ Options:
   --no-z13ctl        Skip z13ctl installation
   --no-tools         Skip display tools and tray app
   --no-modules       Skip optional modules
+  --force            Redo every step, even if its inputs are unchanged
+  --no-trace         Do not record /var/log/gz302/setup-trace-*.json
+  --offline          Serve downloads from /var/cache/gz302 only
   -h, --help         Show this help message
 
+Re-runs only redo steps whose inputs changed since they last succeeded
+(kernel series and capabilities, distribution, library and config file
+content). Use --force after manual changes the fingerprints cannot see.
+
+All prompts are asked up front; the packages of every selected section and
+module are then installed in one transaction per package manager.
+
+Downloads are verified and cached in /var/cache/gz302, so re-runs and
+--offline reinstalls reuse them. Set GITHUB_RAW_URL to install from a mirror.
+
 Sections (each prompted with Y/n):
   1. Hardware Fixes    WiFi, GPU, Input, Audio, Display, Suspend
   2. z13ctl           RGB, power profiles, TDP, fan curves, battery
@@ -72,7 +96,7 @@ EOF
 done
 
 # --- GitHub base URL ---
-GITHUB_RAW_URL="https://raw.githubusercontent.com/th3cavalry/GZ302-Linux-Setup/main"
+GITHUB_RAW_URL="${GITHUB_RAW_URL:-https://raw.githubusercontent.com/th3cavalry/GZ302-Linux-Setup/main}"
 
 # --- Script directory detection ---
 resolve_script_dir() {
@@ -106,6 +130,13 @@ else
     source "${SCRIPT_DIR}/gz302-lib/utils.sh"
 fi
 
+# Time sections, steps, package transactions, downloads and boot-artifact
+# regeneration; the trace is written when setup exits
+if [[ ${EUID:-$(id -u)} -eq 0 ]]; then
+    trace_init "gz302-setup"
+    trap 'trace_finalize; pkg_plan_cleanup' EXIT
+fi
+
 # --- Load Libraries ---
 # Expected version for all library files (must match # Version: line)
 
@@ -122,14 +153,7 @@ load_library() {
 
     warning "Library ${lib_name} missing locally. Cloning the repository is recommended."
     info "Downloading ${lib_name} from GitHub..."
-    mkdir -p "${SCRIPT_DIR}/gz302-lib"
-    if command -v curl >/dev/null 2>&1; then
-        curl -fsSL "${GITHUB_RAW_URL}/gz302-lib/${lib_name}" -o "$lib_path" || return 1
-    elif command -v wget >/dev/null 2>&1; then
-        wget -q "${GITHUB_RAW_URL}/gz302-lib/${lib_name}" -O "$lib_path" || return 1
-    else
-        error "curl or wget not found."
-    fi
+    fetch_repo_file "gz302-lib/${lib_name}" "$lib_path" || return 1
 
     # shellcheck source=/dev/null
     source "$lib_path"
@@ -146,9 +170,15 @@ load_library "input-manager.sh"  || warning "Failed to load input-manager.sh"
 load_library "audio-manager.sh"  || warning "Failed to load audio-manager.sh"
 load_library "display-fix.sh"    || warning "Failed to load display-fix.sh"
 load_library "display-manager.sh" || warning "Failed to load display-manager.sh"
+load_library "envelope-manager.sh" || warning "Failed to load envelope-manager.sh"
 
 state_init >/dev/null 2>&1 || true
 
+# Probe kernel capabilities once; libraries and child modules read the table
+if declare -f kernel_caps_probe_all >/dev/null 2>&1; then
+    kernel_caps_probe_all
+fi
+
 # ==============================================================================
 # Helper Functions
 # ==============================================================================
@@ -170,10 +200,9 @@ check_network() {
 }
 
 check_kernel_version() {
-    if declare -f kernel_get_version_num >/dev/null 2>&1; then
-        local kver
-        kver=$(kernel_get_version_num)
-        info "Detected kernel version: $(uname -r)"
+    if declare -f kernel_caps_init >/dev/null 2>&1 && kernel_caps_init; then
+        local kver="${KERNEL_CAPS[version_num]}"
+        info "Detected kernel version: ${KERNEL_CAPS[release]}"
         if ! kernel_meets_minimum 2>/dev/null; then
             error "Kernel 6.14+ is required. Please upgrade."
         fi
@@ -284,12 +313,12 @@ apply_hardware_fixes() {
     # Delegate modular hardware configuration to the library orchestrator.
     # Covers: WiFi, GPU (incl. Early KMS via gpu_configure_early_kms),
     #         Input, RGB, backlight restore, battery limit, amd_pstate.
-    distro_apply_hardware_fixes
+    run_setup_step "hardware-core" CORE_INPUTS distro_apply_hardware_fixes
 
     # Audio: SOF firmware + CS35L41 ASoC configuration.
     info "Configuring audio..."
     if declare -f audio_apply_configuration >/dev/null 2>&1; then
-        if audio_apply_configuration "$distro"; then
+        if run_setup_step "audio" AUDIO_INPUTS audio_apply_configuration "$distro"; then
             success "Audio configured"
         else
             warning "Audio configuration had issues"
@@ -297,6 +326,20 @@ apply_hardware_fixes() {
     fi
 
     # Display: PSR-SU OLED scrolling artifact fix.
+    run_setup_step "display-psr-su" DISPLAY_INPUTS apply_psr_su_fix || true
+
+    # Suspend Fix
+    run_setup_step "suspend-fix" SUSPEND_INPUTS install_suspend_fix || true
+
+    # Show distribution-specific tuning tips.
+    if declare -f distro_provide_optimization_info >/dev/null 2>&1; then
+        distro_provide_optimization_info "$distro"
+    fi
+
+    success "Hardware fixes complete"
+}
+
+apply_psr_su_fix() {
     info "Checking OLED display PSR-SU configuration..."
     if declare -f display_psr_su_enabled >/dev/null 2>&1 && display_psr_su_enabled 2>/dev/null; then
         info "PSR-SU is enabled — applying fix for scrolling artifacts..."
@@ -304,20 +347,11 @@ apply_hardware_fixes() {
             success "PSR-SU fix applied"
         else
             warning "PSR-SU fix issues"
+            return 1
         fi
     else
         success "PSR-SU already disabled"
     fi
-
-    # Suspend Fix
-    install_suspend_fix
-
-    # Show distribution-specific tuning tips.
-    if declare -f distro_provide_optimization_info >/dev/null 2>&1; then
-        distro_provide_optimization_info "$distro"
-    fi
-
-    success "Hardware fixes complete"
 }
 
 install_suspend_fix() {
@@ -328,20 +362,25 @@ install_suspend_fix() {
             success "Suspend fix installed"
         else
             warning "Suspend fix issues"
+            return 1
         fi
     else
         info "Suspend fix script not found, downloading..."
         local tmp
         tmp=$(mktemp /tmp/gz302-fix-suspend.XXXXXX)
-        if curl -fsSL "${GITHUB_RAW_URL}/scripts/fix-suspend.sh" -o "$tmp" 2>/dev/null; then
+        if fetch_repo_file scripts/fix-suspend.sh "$tmp"; then
+            local status=0
             if bash "$tmp"; then
                 success "Suspend fix installed"
             else
                 warning "Suspend fix issues"
+                status=1
             fi
             rm -f "$tmp"
+            return $status
         else
             warning "Could not download suspend fix"
+            return 1
         fi
     fi
 }
@@ -389,25 +428,25 @@ install_z13ctl() {
             ;;
         debian|ubuntu)
             info "Installing z13ctl from .deb package..."
-            local deb_url
-            deb_url=$(z13ctl_get_release_url ".deb")
-            if [[ -n "$deb_url" ]]; then
-                local tmp_deb
-                tmp_deb=$(mktemp /tmp/z13ctl-XXXXXX.deb)
-                curl -fsSL "$deb_url" -o "$tmp_deb"
+            local tmp_deb
+            tmp_deb=$(mktemp /tmp/z13ctl-XXXXXX.deb)
+            if z13ctl_fetch_release ".deb" "$tmp_deb"; then
                 apt install -y "$tmp_deb"
                 rm -f "$tmp_deb"
             else
+                rm -f "$tmp_deb"
                 z13ctl_install_from_release
             fi
             ;;
         fedora)
             info "Installing z13ctl from .rpm package..."
-            local rpm_url
-            rpm_url=$(z13ctl_get_release_url ".rpm")
-            if [[ -n "$rpm_url" ]]; then
-                dnf install -y "$rpm_url"
+            local tmp_rpm
+            tmp_rpm=$(mktemp /tmp/z13ctl-XXXXXX.rpm)
+            if z13ctl_fetch_release ".rpm" "$tmp_rpm"; then
+                dnf install -y "$tmp_rpm"
+                rm -f "$tmp_rpm"
             else
+                rm -f "$tmp_rpm"
                 z13ctl_install_from_release
             fi
             ;;
@@ -430,27 +469,25 @@ install_z13ctl() {
     success "z13ctl setup complete — RGB, power, TDP, fan curves ready"
 }
 
-z13ctl_get_release_url() {
-    local suffix="$1"
-    local api_url="https://api.github.com/repos/dahui/z13ctl/releases/latest"
-    curl -fsSL "$api_url" 2>/dev/null \
-        | grep -o "\"browser_download_url\": *\"[^\"]*${suffix}\"" \
-        | head -1 \
-        | sed 's/"browser_download_url": *"//' \
-        | tr -d '"'
+# Download the latest z13ctl release asset, verified against its digest
+# Args: $1 = asset name suffix, $2 = destination
+# Returns: 1 if there is no such asset or the download failed
+z13ctl_fetch_release() {
+    local url sum
+    read -r url sum <<< "$(github_release_asset dahui/z13ctl "$1")"
+    [[ -n "$url" ]] || return 1
+    fetch_file "$url" "$2" "$sum"
 }
 
 z13ctl_install_from_release() {
     info "Installing z13ctl from release tarball..."
-    local tar_url
-    tar_url=$(z13ctl_get_release_url "_linux_amd64.tar.gz")
-    if [[ -z "$tar_url" ]]; then
-        warning "Could not find z13ctl release URL"
-        return 1
-    fi
     local tmp_dir
     tmp_dir=$(mktemp -d /tmp/z13ctl-install.XXXXXX)
-    curl -fsSL "$tar_url" -o "$tmp_dir/z13ctl.tar.gz"
+    if ! z13ctl_fetch_release "_linux_amd64.tar.gz" "$tmp_dir/z13ctl.tar.gz"; then
+        warning "Could not download the z13ctl release"
+        rm -rf "$tmp_dir"
+        return 1
+    fi
     tar xzf "$tmp_dir/z13ctl.tar.gz" -C "$tmp_dir"
     install -Dm755 "$tmp_dir/z13ctl" /usr/local/bin/z13ctl
     rm -rf "$tmp_dir"
@@ -697,6 +734,7 @@ RGBWRAP
 ${real_user} ALL=(ALL) NOPASSWD: /usr/local/bin/pwrcfg
 ${real_user} ALL=(ALL) NOPASSWD: /usr/local/bin/gz302-rgb
 ${real_user} ALL=(ALL) NOPASSWD: ${z13ctl_bin}
+${real_user} ALL=(ALL) NOPASSWD: /usr/local/bin/gz302-gpu policy *
 EOF
     if visudo -c -f "$sudoers_tmp" >/dev/null 2>&1; then
         mv "$sudoers_tmp" "$sudoers_file"
@@ -725,9 +763,48 @@ install_display_tools() {
         local lib_dest="/usr/local/share/gz302/gz302-lib"
         mkdir -p "$lib_dest"
         install -Dm644 "${SCRIPT_DIR}/gz302-lib/display-manager.sh" "${lib_dest}/display-manager.sh"
+        # The uninstaller uses the state manager to restore backed-up originals
+        install -Dm644 "${SCRIPT_DIR}/gz302-lib/state-manager.sh" "${lib_dest}/state-manager.sh"
         display_get_rrcfg_script > /usr/local/bin/rrcfg
         chmod 755 /usr/local/bin/rrcfg
         success "rrcfg installed"
+
+        # Performance envelopes: power, refresh and frame cap per profile in one step
+        if declare -f envelope_get_script >/dev/null 2>&1; then
+            install -Dm644 "${SCRIPT_DIR}/gz302-lib/envelope-manager.sh" "${lib_dest}/envelope-manager.sh"
+            envelope_get_script > /usr/local/bin/gz302-envelope
+            chmod 755 /usr/local/bin/gz302-envelope
+            if [[ ! -f "$ENVELOPE_CONFIG" ]]; then
+                mkdir -p "${ENVELOPE_CONFIG%/*}"
+                envelope_get_config > "$ENVELOPE_CONFIG"
+            fi
+            # Shared lock for tray (user) and root callers; /run/lock is 0755 on some distros
+            echo "f ${ENVELOPE_LOCK_FILE} 0666 root root -" > "$ENVELOPE_TMPFILES_CONF"
+            systemd-tmpfiles --create "$ENVELOPE_TMPFILES_CONF" >/dev/null 2>&1 || true
+            success "gz302-envelope installed"
+        fi
+
+        # Per-game frame caps / VRR for the active profile (Steam: gz302-game %command%)
+        display_get_game_launcher_script > /usr/local/bin/gz302-game
+        chmod 755 /usr/local/bin/gz302-game
+
+        # GPU telemetry from gpu_metrics/hwmon (gz302 gpu)
+        if declare -f gpu_get_telemetry_script >/dev/null 2>&1; then
+            install -Dm644 "${SCRIPT_DIR}/gz302-lib/gpu-manager.sh" "${lib_dest}/gpu-manager.sh"
+            gpu_get_telemetry_script > /usr/local/bin/gz302-gpu
+            chmod 755 /usr/local/bin/gz302-gpu
+        fi
+
+        # Adaptive refresh: per-user daemon, started with the graphical session
+        display_get_adaptive_refresh_script > /usr/local/bin/gz302-adaptive-refresh
+        chmod 755 /usr/local/bin/gz302-adaptive-refresh
+        mkdir -p /etc/systemd/user
+        display_get_adaptive_refresh_unit > /etc/systemd/user/gz302-adaptive-refresh.service
+        if systemctl --global enable gz302-adaptive-refresh.service >/dev/null 2>&1; then
+            success "Adaptive refresh enabled (idle-aware ${GZ302_INTERNAL_DISPLAY} rate on battery, from next login)"
+        else
+            warning "Could not enable gz302-adaptive-refresh.service for all users"
+        fi
     else
         warning "display-manager library not loaded — skipping rrcfg"
     fi
@@ -738,6 +815,18 @@ install_display_tools() {
     success "Display tools installed"
 }
 
+# Python dependencies of the tray app
+# Args: $1 = distribution
+# Output: Package names
+tray_packages() {
+    case "$1" in
+        arch) echo "python-pyqt6 python-psutil python-dbus" ;;
+        debian|ubuntu) echo "python3-pyqt6 python3-pyqt6.qtsvg python3-psutil python3-dbus" ;;
+        fedora) echo "python3-pyqt6 python3-qt6-qtsvg python3-psutil python3-dbus" ;;
+        opensuse) echo "python3-pyqt6 python3-qt6-svg python3-psutil python3-dbus-python" ;;
+    esac
+}
+
 install_tray_app() {
     local distro="$1"
     info "Installing ASUS ROG Flow Z13 (GZ302) Command Center..."
@@ -745,32 +834,21 @@ install_tray_app() {
     local tray_dir="${SCRIPT_DIR}/command-center"
     if [[ ! -d "$tray_dir" ]]; then
         info "Downloading tray app..."
-        mkdir -p "$tray_dir"
-        for f in install-tray.sh requirements.txt VERSION; do
-            curl -fsSL "${GITHUB_RAW_URL}/command-center/${f}" -o "${tray_dir}/${f}" 2>/dev/null || true
-        done
-        mkdir -p "${tray_dir}/src/modules"
-        for f in command_center.py modules/__init__.py modules/config.py modules/notifications.py \
-                 modules/power_controller.py modules/rgb_controller.py; do
-            curl -fsSL "${GITHUB_RAW_URL}/command-center/src/${f}" -o "${tray_dir}/src/${f}" 2>/dev/null || true
-        done
+        fetch_repo_files "$SCRIPT_DIR" \
+            command-center/install-tray.sh command-center/requirements.txt command-center/VERSION \
+            command-center/src/command_center.py command-center/src/modules/__init__.py \
+            command-center/src/modules/config.py command-center/src/modules/notifications.py \
+            command-center/src/modules/power_controller.py command-center/src/modules/rgb_controller.py \
+            command-center/src/modules/gpu_telemetry.py \
+            || warning "Some tray app files could not be downloaded"
     fi
 
     # Install Python dependencies (including SVG support for tray icons)
-    case "$distro" in
-        arch)
-            pacman -S --noconfirm --needed python-pyqt6 python-psutil python-dbus 2>/dev/null || true
-            ;;
-        debian|ubuntu)
-            apt install -y python3-pyqt6 python3-pyqt6.qtsvg python3-psutil python3-dbus 2>/dev/null || true
-            ;;
-        fedora)
-            dnf install -y python3-pyqt6 python3-qt6-qtsvg python3-psutil python3-dbus 2>/dev/null || true
-            ;;
-        opensuse)
-            zypper install -y python3-pyqt6 python3-qt6-svg python3-psutil python3-dbus-python 2>/dev/null || true
-            ;;
-    esac
+    local -a tray_deps
+    read -ra tray_deps <<< "$(tray_packages "$distro")"
+    if [[ ${#tray_deps[@]} -gt 0 ]]; then
+        pkg_install tray "$distro" "${tray_deps[@]}" 2>/dev/null || true
+    fi
 
     # Run the tray installer
     if [[ -f "${tray_dir}/install-tray.sh" ]]; then
@@ -794,62 +872,166 @@ install_tray_app() {
 # Section 4: Optional Modules
 # ==============================================================================
 
-install_optional_modules() {
-    print_section "Section 4: Optional Modules"
-
-    local distro
-    distro=$(detect_distribution)
-
+# Ask which optional modules to install
+# Sets: SELECTED_MODULES
+select_optional_modules() {
     info "Optional modules provide additional features like Gaming, AI, or Hypervisor support."
     echo
 
     if prompt_section "Install Gaming module? (Steam, Lutris, MangoHUD, GameMode)" N; then
-        download_and_execute_module "gz302-gaming" "$distro"
+        SELECTED_MODULES+=("gz302-gaming")
     fi
 
     if prompt_section "Install AI / LLM module? (Ollama, LM Studio, ROCm, PyTorch)" N; then
-        download_and_execute_module "gz302-llm" "$distro"
+        SELECTED_MODULES+=("gz302-llm")
     fi
 
     if prompt_section "Install Hypervisor module? (KVM/QEMU, libvirt)" N; then
-        download_and_execute_module "gz302-hypervisor" "$distro"
+        SELECTED_MODULES+=("gz302-hypervisor")
     fi
+}
+
+install_optional_modules() {
+    print_section "Section 4: Optional Modules"
+
+    local distro
+    distro=$(detect_distribution)
+
+    local module
+    for module in "${SELECTED_MODULES[@]}"; do
+        download_and_execute_module "$module" "$distro" || warning "Module ${module} reported errors"
+    done
 
     success "Optional modules processing complete"
 }
 
-download_and_execute_module() {
+# Locate a module script, downloading it once per run if not local
+# Args: $1 = module name
+# Output: Path to the module script
+# Returns: 1 if it could not be found or downloaded
+fetch_module() {
     local module_name="$1"
-    local distro="$2"
     local local_module="${SCRIPT_DIR}/modules/${module_name}.sh"
 
     # Check for local module first
     if [[ -f "$local_module" ]]; then
-        info "Running local module ${module_name}..."
-        bash "$local_module" "$distro"
-        return $?
+        echo "$local_module"
+        return 0
+    fi
+    if [[ -s "${MODULE_PATHS[$module_name]:-}" ]]; then
+        echo "${MODULE_PATHS[$module_name]}"
+        return 0
     fi
 
     local tmp
     tmp=$(mktemp /tmp/gz302-module-XXXXXX.sh)
-    info "Downloading ${module_name}..."
-    if command -v curl >/dev/null 2>&1; then
-        curl -fsSL "${GITHUB_RAW_URL}/modules/${module_name}.sh" -o "$tmp" 2>/dev/null
-    elif command -v wget >/dev/null 2>&1; then
-        wget -q "${GITHUB_RAW_URL}/modules/${module_name}.sh" -O "$tmp" 2>/dev/null
-    fi
+    info "Downloading ${module_name}..." >&2
+    fetch_repo_file "modules/${module_name}.sh" "$tmp" >&2 || true
 
-    if [[ -s "$tmp" ]]; then
-        chmod +x "$tmp"
-        bash "$tmp" "$distro"
-        local rc=$?
+    if [[ ! -s "$tmp" ]]; then
         rm -f "$tmp"
-        return $rc
+        return 1
     fi
+    chmod +x "$tmp"
+    MODULE_PATHS[$module_name]="$tmp"
+    echo "$tmp"
+}
 
-    warning "Failed to download or execute ${module_name}"
-    rm -f "$tmp"
-    return 1
+download_and_execute_module() {
+    local module_name="$1"
+    local distro="$2"
+
+    local module
+    if ! module=$(fetch_module "$module_name"); then
+        warning "Failed to download or execute ${module_name}"
+        return 1
+    fi
+
+    info "Running module ${module_name}..."
+    trace_span "module ${module_name}" module bash "$module" "$distro"
+    local rc=$?
+    [[ "$module" == /tmp/gz302-module-* ]] && rm -f "$module"
+    unset "MODULE_PATHS[$module_name]"
+    return $rc
+}
+
+# ==============================================================================
+# Package Plan
+# ==============================================================================
+
+# Base packages installed with the system update
+# Args: $1 = distribution
+# Output: Package names
+base_packages() {
+    case "$1" in
+        arch) echo "git base-devel wget curl" ;;
+        debian|ubuntu) echo "curl wget git build-essential ca-certificates gnupg" ;;
+        fedora|opensuse) echo "curl wget git gcc make kernel-devel" ;;
+    esac
+}
+
+# z13ctl release packages (.deb / .rpm, downloaded) when not installed yet;
+# Arch uses the AUR and other distributions the release tarball, both
+# installed by install_z13ctl itself
+# Args: $1 = distribution
+# Output: Package URL or downloaded path
+z13ctl_packages() {
+    command -v z13ctl >/dev/null 2>&1 && return 0
+    case "$1" in
+        debian|ubuntu|fedora)
+            [[ -n "${GZ302_PKG_PLAN:-}" ]] || return 0
+            local suffix=".deb"
+            [[ "$1" == "fedora" ]] && suffix=".rpm"
+            local package="${GZ302_PKG_PLAN}.d/z13ctl${suffix}"
+            z13ctl_fetch_release "$suffix" "$package" >&2 && echo "$package"
+            ;;
+    esac
+    return 0
+}
+
+# Check whether a step will run (its inputs changed or --force)
+# Args: $1 = step name, $2 = name of the step's input array
+step_pending() {
+    local -n pending_inputs="$2"
+    ! step_is_current "$1" "$(step_fingerprint "${pending_inputs[@]}")"
+}
+
+# Collect the packages of every selected section and module and install
+# them in one transaction per package manager. Sections and modules still
+# call pkg_install; it skips what the plan already installed.
+# Args: $1 = distribution
+plan_packages() {
+    local distro="$1"
+    print_section "Package Plan"
+    pkg_plan_init || { warning "Could not create a package plan — sections install their own packages"; return 0; }
+
+    if [[ "$DO_BASE" == true ]] && step_pending base-packages BASE_INPUTS; then
+        pkg_plan_upgrade base
+        pkg_plan_add base "$(base_packages "$distro")"
+    fi
+    if [[ "$DO_FIXES" == true ]] && declare -f audio_packages >/dev/null 2>&1 \
+            && step_pending audio AUDIO_INPUTS \
+            && ! { audio_sof_firmware_installed && audio_ucm_installed; }; then
+        pkg_plan_add audio "$(audio_packages "$distro")"
+    fi
+    if [[ "$DO_Z13CTL" == true ]] && step_pending z13ctl Z13CTL_INPUTS; then
+        pkg_plan_add z13ctl "$(z13ctl_packages "$distro")"
+    fi
+    if [[ "$DO_TOOLS" == true ]] && step_pending display-tools TOOLS_INPUTS; then
+        pkg_plan_add tray "$(tray_packages "$distro")"
+    fi
+
+    # Modules that support the plan list their packages and enable the
+    # repositories they need (multilib, i386) before the transaction
+    local module_name module
+    for module_name in "${SELECTED_MODULES[@]}"; do
+        module=$(fetch_module "$module_name") || continue
+        grep -q -- '--list-packages' "$module" || continue
+        bash "$module" --prepare "$distro" || continue
+        pkg_plan_add "${module_name#gz302-}" "$(bash "$module" --list-packages "$distro")"
+    done
+
+    pkg_plan_commit "$distro" || warning "Some packages failed; their sections retry on their own"
 }
 
 # ==============================================================================
@@ -860,36 +1042,79 @@ setup_distro_base() {
     local distro="$1"
     info "Updating system and installing base packages..."
 
-    case "$distro" in
-        arch)
-            pacman -Syu --noconfirm --needed
-            pacman -S --noconfirm --needed git base-devel wget curl
-            # Install AUR helper if missing
-            if ! command -v yay >/dev/null 2>&1 && ! command -v paru >/dev/null 2>&1; then
-                info "Installing yay AUR helper..."
-                local real_user
-                real_user=$(get_real_user)
-                sudo -u "$real_user" -H bash -c '
-                    cd /tmp && git clone https://aur.archlinux.org/yay.git && cd yay && makepkg -si --noconfirm
-                '
-            fi
-            ;;
-        debian|ubuntu)
-            apt update && apt upgrade -y
-            apt install -y curl wget git build-essential ca-certificates gnupg
-            ;;
-        fedora)
-            dnf upgrade -y
-            dnf install -y curl wget git gcc make kernel-devel
-            ;;
-        opensuse)
-            zypper refresh && zypper update -y
-            zypper install -y curl wget git gcc make kernel-devel
-            ;;
-    esac
+    local -a packages
+    read -ra packages <<< "$(base_packages "$distro")"
+    pkg_install --upgrade base "$distro" "${packages[@]}"
+
+    # Install AUR helper if missing
+    if [[ "$distro" == "arch" ]] && ! command -v yay >/dev/null 2>&1 && ! command -v paru >/dev/null 2>&1; then
+        info "Installing yay AUR helper..."
+        local real_user
+        real_user=$(get_real_user)
+        sudo -u "$real_user" -H bash -c '
+            cd /tmp && git clone https://aur.archlinux.org/yay.git && cd yay && makepkg -si --noconfirm
+        '
+    fi
     success "System updated"
 }
 
+# Step inputs: a re-run only redoes steps whose inputs changed. Files a
+# step writes are listed too, so manual edits or removals are repaired.
+# Args: $1 = distribution
+# Sets: BASE_INPUTS, CORE_INPUTS, AUDIO_INPUTS, DISPLAY_INPUTS,
+#       SUSPEND_INPUTS, Z13CTL_INPUTS, TOOLS_INPUTS
+define_step_inputs() {
+    local distro="$1"
+    local setup_version="file:${SCRIPT_DIR}/VERSION"
+    local today
+    printf -v today '%(%F)T' -1
+
+    # The system upgrade is redone once a day: a same-day re-run (e.g. after
+    # a failed section) skips it, a later one brings the system up to date
+    BASE_INPUTS=(
+        "distro=${distro}" "$setup_version" "upgraded=${today}"
+        "packages=$(base_packages "$distro")"
+    )
+    CORE_INPUTS=(
+        "distro=${distro}" kernel
+        lib:distro-manager.sh lib:wifi-manager.sh lib:gpu-manager.sh lib:input-manager.sh
+        file:/etc/modprobe.d/mt7925.conf file:/etc/modprobe.d/amdgpu.conf
+        file:/etc/modprobe.d/hid-asus.conf file:/etc/mkinitcpio.conf
+    )
+    AUDIO_INPUTS=(
+        "distro=${distro}" kernel lib:audio-manager.sh
+        file:/etc/modprobe.d/cs35l41.conf
+    )
+    DISPLAY_INPUTS=(
+        kernel lib:display-fix.sh
+        file:/etc/default/grub file:/etc/kernel/cmdline
+    )
+    local entry
+    for entry in /boot/loader/entries/*.conf /boot/refind_linux.conf /etc/limine/limine.conf; do
+        [[ -f "$entry" ]] && DISPLAY_INPUTS+=("file:${entry}")
+    done
+    SUSPEND_INPUTS=(
+        kernel "file:${SCRIPT_DIR}/scripts/fix-suspend.sh"
+        file:/usr/lib/systemd/system-sleep/gz302-reset.sh
+    )
+    Z13CTL_INPUTS=(
+        "distro=${distro}" "$setup_version"
+        tool:z13ctl file:/etc/sudoers.d/gz302
+        file:/usr/local/bin/pwrcfg file:/usr/local/bin/gz302-rgb
+    )
+    TOOLS_INPUTS=(
+        "distro=${distro}" lib:display-manager.sh lib:envelope-manager.sh lib:gpu-manager.sh
+        file:/usr/local/bin/rrcfg file:/usr/local/bin/gz302-adaptive-refresh
+        file:/usr/local/bin/gz302-envelope file:/usr/local/bin/gz302-game
+        file:/usr/local/bin/gz302-gpu file:/etc/tmpfiles.d/gz302-envelope.conf
+        "file:${SCRIPT_DIR}/command-center/VERSION"
+    )
+    local src
+    for src in "${SCRIPT_DIR}"/command-center/src/*.py "${SCRIPT_DIR}"/command-center/src/modules/*.py; do
+        [[ -f "$src" ]] && TOOLS_INPUTS+=("file:${src}")
+    done
+}
+
 # ==============================================================================
 # Main
 # ==============================================================================
@@ -901,82 +1126,121 @@ main() {
     echo
 
     # System checks
+    trace_begin "System checks" section
     print_step 1 3 "Validating system..."
     check_kernel_version >/dev/null
 
     print_step 2 3 "Checking network..."
-    check_network || warning "Network connectivity limited — some downloads may fail"
+    if [[ "$GZ302_OFFLINE" == "true" ]]; then
+        info "Offline mode — downloads are served from ${CACHE_DIR}"
+    else
+        check_network || warning "Network connectivity limited — cached downloads will be used where available"
+    fi
 
     print_step 3 3 "Detecting distribution..."
     local distro
     distro=$(detect_distribution)
     success "Detected: ${distro}"
+    trace_end
     echo
 
     print_keyval "Distribution" "$distro"
-    print_keyval "Kernel" "$(uname -r)"
+    print_keyval "Kernel" "$(kernel_get_version_string 2>/dev/null || uname -r)"
     print_keyval "z13ctl" "$(command -v z13ctl >/dev/null 2>&1 && z13ctl --version 2>/dev/null || echo 'not installed')"
     echo
 
     # Pre-flight: clean legacy v3/v4 artifacts
-    cleanup_legacy_install
+    trace_span "Legacy cleanup" section cleanup_legacy_install
 
-    # Update system
+    define_step_inputs "$distro"
+
+    # Ask everything first, so the package plan covers all selected sections
     if prompt_section "Update system and install base packages? (Y/n): " Y; then
-        setup_distro_base "$distro"
+        DO_BASE=true
     fi
-
-    # Section 1: Hardware Fixes
     if [[ "$SKIP_FIXES" != "true" ]]; then
         echo
         if prompt_section "Apply hardware fixes? (WiFi, GPU, Input, Audio, Display) (Y/n): " Y; then
-            apply_hardware_fixes
+            DO_FIXES=true
         else
             info "Skipping hardware fixes"
         fi
     fi
-
-    # Section 2: z13ctl
     if [[ "$SKIP_Z13CTL" != "true" ]]; then
         echo
         if prompt_section "Install z13ctl? (RGB, power profiles, TDP, fan curves) (Y/n): " Y; then
-            install_z13ctl
+            DO_Z13CTL=true
         else
             info "Skipping z13ctl"
         fi
     fi
-
-    # Section 3: Display Tools & Tray
     if [[ "$SKIP_TOOLS" != "true" ]]; then
         echo
         if prompt_section "Install display tools and system tray app? (Y/n): " Y; then
-            install_display_tools
+            DO_TOOLS=true
         else
             info "Skipping display tools"
         fi
     fi
-
-    # Section 4: Optional Modules
     if [[ "$SKIP_MODULES" != "true" ]]; then
         echo
         if prompt_section "Browse optional modules? (Gaming, AI, Hypervisor) (y/N): " N; then
-            install_optional_modules
+            select_optional_modules
         else
             info "Skipping optional modules"
         fi
     fi
 
+    # One package transaction for everything selected above
+    trace_span "Package plan" section plan_packages "$distro"
+
+    # Update system
+    if [[ "$DO_BASE" == true ]]; then
+        trace_span "System update" section \
+            run_setup_step "base-packages" BASE_INPUTS setup_distro_base "$distro"
+    fi
+
+    # Section 1: Hardware Fixes
+    if [[ "$DO_FIXES" == true ]]; then
+        trace_span "Section 1: Hardware Fixes" section apply_hardware_fixes
+    fi
+
+    # Section 2: z13ctl
+    if [[ "$DO_Z13CTL" == true ]]; then
+        trace_span "Section 2: z13ctl" section \
+            run_setup_step "z13ctl" Z13CTL_INPUTS install_z13ctl
+    fi
+
+    # Section 3: Display Tools & Tray
+    if [[ "$DO_TOOLS" == true ]]; then
+        trace_span "Section 3: Display & Tools" section \
+            run_setup_step "display-tools" TOOLS_INPUTS install_display_tools
+    fi
+
+    # Section 4: Optional Modules
+    if [[ ${#SELECTED_MODULES[@]} -gt 0 ]]; then
+        trace_span "Section 4: Optional Modules" section install_optional_modules
+    fi
+    pkg_plan_cleanup
+
     # Done
     echo
     print_section "Setup Complete"
     echo
-    completed_item "Kernel $(uname -r)"
+    completed_item "Kernel $(kernel_get_version_string 2>/dev/null || uname -r)"
     completed_item "Distribution: ${distro}"
-    [[ "$SKIP_FIXES" != "true" ]] && completed_item "Hardware fixes applied"
+    [[ "$DO_FIXES" == true ]] && completed_item "Hardware fixes applied"
     command -v z13ctl >/dev/null 2>&1 && completed_item "z13ctl — RGB, power, TDP, fan curves"
     command -v pwrcfg >/dev/null 2>&1 && completed_item "pwrcfg — power profile switching"
     command -v gz302-rgb >/dev/null 2>&1 && completed_item "gz302-rgb — RGB lighting control"
     [[ -f /usr/local/bin/rrcfg ]] && completed_item "rrcfg — refresh rate control"
+    [[ -f /usr/local/bin/gz302-envelope ]] && completed_item "gz302-envelope — power, refresh and frame cap per profile in one step"
+    [[ -f /usr/local/bin/gz302-game ]] && completed_item "gz302-game — per-game frame caps (Steam: gz302-game %command%)"
+    [[ -f /usr/local/bin/gz302-gpu ]] && completed_item "gz302-gpu — live GPU clocks, activity, power and temperatures"
+    [[ -f /usr/local/bin/gz302-adaptive-refresh ]] && completed_item "gz302-adaptive-refresh — idle-aware refresh rate (user service)"
+    echo
+
+    trace_finalize
     echo
 
     print_box "🚀 SETUP COMPLETE! 🚀" "$C_BOLD_GREEN"
@@ -2,7 +2,7 @@
 
 # ==============================================================================
 # GZ302 Gaming Software Module
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This module installs gaming software for the ASUS ROG Flow Z13 (GZ302)
 # Includes: Steam, Lutris, MangoHUD, GameMode, Wine, and performance tools
@@ -56,71 +56,68 @@ else
     fi
 fi
 
-# --- Main Installation Logic ---
+# --- Package Selection ---
 
-install_gaming_stack() {
-    print_section "Installing Gaming Software Stack"
-    
-    local distro
-    distro=$(detect_distribution)
-    
-    case "$distro" in
+# Gaming packages for a distribution (see pkg_plan_add for the syntax)
+# Args: $1 = distribution
+# Output: Package names
+gaming_packages() {
+    case "$1" in
         arch)
-            info "Installing Gaming packages for Arch Linux..."
-            
-            # Check for CachyOS
-            if grep -q "CachyOS" /etc/os-release; then
-                info "CachyOS detected - using optimized gaming meta-packages..."
-                pacman -S --noconfirm --needed cachyos-gaming-meta cachyos-gaming-applications
+            if grep -q "CachyOS" /etc/os-release 2>/dev/null; then
+                echo "cachyos-gaming-meta cachyos-gaming-applications"
             else
-                # Enable multilib if not enabled
-                if ! grep -q "^\[multilib\]" /etc/pacman.conf; then
-                    info "Enabling multilib repository..."
-                    printf '\n[multilib]\nInclude = /etc/pacman.d/mirrorlist\n' >> /etc/pacman.conf
-                    pacman -Sy
-                fi
-                
-                # Install packages (Using standard wine as requested)
-                pacman -S --noconfirm --needed \
-                    steam \
-                    lutris \
-                    mangohud lib32-mangohud \
-                    gamemode lib32-gamemode \
-                    wine \
-                    winetricks
+                # Using standard wine as requested
+                echo "steam lutris mangohud lib32-mangohud gamemode lib32-gamemode wine winetricks"
+            fi
+            ;;
+        debian|ubuntu) echo "steam-installer|steam lutris mangohud gamemode wine winetricks" ;;
+        # Fedora usually needs RPM Fusion for Steam/Lutris; best effort
+        fedora) echo "steam lutris mangohud gamemode wine winetricks" ;;
+        opensuse) echo "steam lutris mangohud gamemode wine winetricks" ;;
+    esac
+}
+
+# Enable the 32-bit repositories the packages come from (idempotent)
+# Args: $1 = distribution
+gaming_prepare() {
+    case "$1" in
+        arch)
+            # Enable multilib if not enabled
+            if ! grep -q "CachyOS" /etc/os-release 2>/dev/null && ! grep -q "^\[multilib\]" /etc/pacman.conf; then
+                info "Enabling multilib repository..."
+                printf '\n[multilib]\nInclude = /etc/pacman.d/mirrorlist\n' >> /etc/pacman.conf
+                pacman -Sy
             fi
             ;;
-            
         debian|ubuntu)
-            info "Installing Gaming packages for Debian/Ubuntu..."
-            # Enable 32-bit architecture
+            # Enable 32-bit architecture (package lists are refreshed by the install)
             dpkg --add-architecture i386
-            apt-get update
-            
-            # Install Steam
-            apt-get install -y steam-installer || apt-get install -y steam
-            
-            # Install Lutris, MangoHUD, GameMode
-            apt-get install -y lutris mangohud gamemode wine winetricks
-            ;;
-            
-        fedora)
-            info "Installing Gaming packages for Fedora..."
-            # Enable RPM Fusion if possible (usually needed for Steam/Lutris)
-            # We assume user might have it, or we try best effort
-            dnf install -y steam lutris mangohud gamemode wine winetricks
-            ;;
-            
-        opensuse)
-            info "Installing Gaming packages for OpenSUSE..."
-            zypper install -y steam lutris mangohud gamemode wine winetricks
-            ;;
-            
-        *)
-            warning "Unsupported distribution: $distro"
-            return 1
             ;;
     esac
+}
+
+# --- Main Installation Logic ---
+
+install_gaming_stack() {
+    print_section "Installing Gaming Software Stack"
+    
+    local distro
+    distro=$(detect_distribution)
+
+    local -a packages
+    read -ra packages <<< "$(gaming_packages "$distro")"
+    if [[ ${#packages[@]} -eq 0 ]]; then
+        warning "Unsupported distribution: $distro"
+        return 1
+    fi
+
+    info "Installing Gaming packages for ${distro}..."
+    if grep -q "CachyOS" /etc/os-release 2>/dev/null; then
+        info "CachyOS detected - using optimized gaming meta-packages..."
+    fi
+    gaming_prepare "$distro"
+    pkg_install gaming "$distro" "${packages[@]}"
     
     # --- Optimizations ---
     print_subsection "Applying Gaming Optimizations"
@@ -134,9 +131,19 @@ install_gaming_stack() {
     fi
     
     success "Gaming stack installed!"
+    if [[ -x /usr/local/bin/gz302-game ]]; then
+        info "Per-game frame caps: set Steam launch options to 'gz302-game %command%'"
+        info "  and list games in ~/.config/gz302/game-profiles.conf (see: gz302 game help)"
+    fi
 }
 
 main() {
+    # Package plan hooks used by gz302-setup.sh (see pkg_plan_add)
+    case "${1:-}" in
+        --list-packages) gaming_packages "${2:-$(detect_distribution)}"; return 0 ;;
+        --prepare) gaming_prepare "${2:-$(detect_distribution)}"; return 0 ;;
+    esac
+
     # Check root
     if [[ $EUID -ne 0 ]]; then
         error "This script must be run as root"
@@ -2,7 +2,7 @@
 
 # ==============================================================================
 # GZ302 Hypervisor Software Module
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This module installs hypervisor software for the ASUS ROG Flow Z13 (GZ302)
 # Includes: Full KVM/QEMU stack, VirtualBox
@@ -56,51 +56,36 @@ else
     fi
 fi
 
+# --- Package Selection ---
+
+# KVM/QEMU packages for a distribution (see pkg_plan_add for the syntax)
+# Args: $1 = distribution
+# Output: Package names
+kvm_packages() {
+    case "$1" in
+        arch) echo "qemu-full virt-manager virt-viewer dnsmasq vde2 openbsd-netcat libguestfs" ;;
+        debian|ubuntu) echo "qemu-system libvirt-daemon-system libvirt-clients bridge-utils virt-manager" ;;
+        fedora) echo "@virtualization" ;;
+        opensuse) echo "pattern:kvm_server pattern:kvm_tools" ;;
+    esac
+}
+
 # --- Main Installation Logic ---
 install_kvm_stack() {
     print_section "Installing Hypervisor Software (KVM/QEMU)"
     
     local distro
     distro=$(detect_distribution)
-    
-    case "$distro" in
-        arch)
-            info "Installing KVM packages for Arch Linux..."
-            pacman -S --noconfirm --needed \
-                qemu-full \
-                virt-manager \
-                virt-viewer \
-                dnsmasq \
-                vde2 \
-                openbsd-netcat \
-                libguestfs
-            ;;
-            
-        debian|ubuntu)
-            info "Installing KVM packages for Debian/Ubuntu..."
-            apt-get install -y \
-                qemu-system \
-                libvirt-daemon-system \
-                libvirt-clients \
-                bridge-utils \
-                virt-manager
-            ;;
-            
-        fedora)
-            info "Installing KVM packages for Fedora..."
-            dnf groupinstall -y "Virtualization"
-            ;;
-            
-        opensuse)
-            info "Installing KVM packages for OpenSUSE..."
-            zypper install -y -t pattern kvm_server kvm_tools
-            ;;
-            
-        *)
-            warning "Unsupported distribution: $distro"
-            return 1
-            ;;
-    esac
+
+    local -a packages
+    read -ra packages <<< "$(kvm_packages "$distro")"
+    if [[ ${#packages[@]} -eq 0 ]]; then
+        warning "Unsupported distribution: $distro"
+        return 1
+    fi
+
+    info "Installing KVM packages for ${distro}..."
+    pkg_install hypervisor "$distro" "${packages[@]}"
     
     # --- Configuration ---
     print_subsection "Configuring Libvirt"
@@ -133,6 +118,12 @@ install_kvm_stack() {
 }
 
 main() {
+    # Package plan hooks used by gz302-setup.sh (see pkg_plan_add)
+    case "${1:-}" in
+        --list-packages) kvm_packages "${2:-$(detect_distribution)}"; return 0 ;;
+        --prepare) return 0 ;;
+    esac
+
     # Check root
     if [[ $EUID -ne 0 ]]; then
         error "This script must be run as root"
@@ -2,12 +2,15 @@
 
 # ==============================================================================
 # GZ302 LLM/AI Software Module
-# Version: 6.3.6
+# Version: 6.28.1
 #
 # This module installs LLM backends for the ASUS ROG Flow Z13 (GZ302)
-# Uses official installation methods - no custom builds
+# Uses official installation methods; llama.cpp can also be built from source
 #
 # Backends: Ollama, LM Studio, llama.cpp, vLLM
+# Benchmark: sudo ./gz302-llm.sh bench [--model PATH] [--endpoint NAME=URL]
+# llama.cpp source builds: sudo ./gz302-llm.sh build [--variant hip|vulkan] [--tag TAG|latest]
+# Model store: sudo ./gz302-llm.sh models [import PATH|URL | list | remove NAME | gc]
 # Frontends: Open WebUI, SillyTavern, Text Generation WebUI, LibreChat
 # Libraries: PyTorch, Transformers, bitsandbytes, etc.
 #
@@ -66,6 +69,30 @@ LLM_VERSION="6.0.0"
 OLLAMA_ENV_FILE="/etc/systemd/system/ollama.service.d/gz302.conf"
 LMSTUDIO_APPIMAGE="${HOME}/Applications/LMStudio.AppImage"
 VLLM_VENV="/opt/gz302-vllm"
+LLAMACPP_ROOT="/opt/llama.cpp"
+# Source builds: the tested release and its tarball SHA-256, refreshed with
+# scripts/update-llamacpp-pin.sh. LLAMACPP_TAG (or --tag; "latest" looks it
+# up) builds another release, verified when LLAMACPP_SHA256 is set. The
+# pinned tag is never built unverified.
+LLAMACPP_PIN_TAG="b6700"
+LLAMACPP_PIN_SHA256=""
+LLAMACPP_TAG="${LLAMACPP_TAG:-$LLAMACPP_PIN_TAG}"
+LLAMACPP_SHA256="${LLAMACPP_SHA256:-}"
+LLM_OLLAMA_URL="http://localhost:11434"
+LLAMA_SERVER_PORT=8080
+LLM_BACKEND_CONF="/etc/gz302/llm-backend.conf"
+
+# Backend benchmark: a small model keeps a full run to a few minutes
+LLM_BENCH_DIR="/var/cache/gz302/llm-bench"
+LLM_BENCH_RESULTS="/var/log/gz302/llm-bench.tsv"
+LLM_BENCH_MODEL_URL="https://huggingface.co/Qwen/Qwen2.5-0.5B-Instruct-GGUF/resolve/main/qwen2.5-0.5b-instruct-q4_k_m.gguf"
+LLM_BENCH_PROMPT_TOKENS=512
+LLM_BENCH_GEN_TOKENS=128
+LLM_BENCH_REPS=3
+
+# Shared model store, and where the Ollama service keeps its models
+LLM_MODEL_STORE="/var/lib/gz302/models"
+LLM_OLLAMA_MODELS="${OLLAMA_MODELS:-/usr/share/ollama/.ollama/models}"
 
 # --- AMD Strix Halo GPU Configuration ---
 
@@ -234,35 +261,53 @@ install_llamacpp() {
     
     info "Fetching latest llama.cpp release..."
     
-    local version
-    version=$(curl -fsSL https://api.github.com/repos/ggerganov/llama.cpp/releases/latest | grep -oP '"tag_name": "\K[^"]+' || echo "b8043")
-    
     # Linux releases are .tar.gz; Vulkan build supports AMD GPUs via Vulkan compute
-    local vulkan_url="https://github.com/ggerganov/llama.cpp/releases/download/${version}/llama-${version}-bin-ubuntu-vulkan-x64.tar.gz"
-    local fallback_url="https://github.com/ggerganov/llama.cpp/releases/download/${version}/llama-${version}-bin-ubuntu-x64.tar.gz"
+    local url sum
+    read -r url sum <<< "$(github_release_asset ggerganov/llama.cpp -bin-ubuntu-vulkan-x64.tar.gz)"
+    local variant="Vulkan"
+    if [[ -z "$url" ]]; then
+        read -r url sum <<< "$(github_release_asset ggerganov/llama.cpp -bin-ubuntu-x64.tar.gz)"
+        variant="CPU"
+    fi
+    if [[ -z "$url" ]]; then
+        error "Failed to find a llama.cpp release"
+        return 1
+    fi
+    local version="${url%/*}"
+    version="${version##*/}"
     
     local tmpdir
     tmpdir=$(mktemp -d)
     
     info "Downloading llama.cpp ${version}..."
-    if curl -fsSL "$vulkan_url" -o "${tmpdir}/llama.tar.gz" 2>/dev/null; then
-        info "Using Vulkan-enabled build (AMD GPU acceleration)"
-    elif curl -fsSL "$fallback_url" -o "${tmpdir}/llama.tar.gz" 2>/dev/null; then
-        warning "Vulkan build not available, using CPU build"
-    else
+    if ! fetch_file "$url" "${tmpdir}/llama.tar.gz" "$sum"; then
         error "Failed to download llama.cpp binaries"
         rm -rf "$tmpdir"
         return 1
     fi
+    if [[ "$variant" == "Vulkan" ]]; then
+        info "Using Vulkan-enabled build (AMD GPU acceleration)"
+    else
+        warning "Vulkan build not available, using CPU build"
+    fi
     
     tar -xzf "${tmpdir}/llama.tar.gz" -C "${tmpdir}"
-    find "${tmpdir}" -type f -name "llama-*" -exec install -m 755 {} /usr/local/bin/ \;
-    # Also install shared libraries if present (needed for Vulkan build)
-    find "${tmpdir}" -type f -name "*.so*" -exec install -m 644 {} /usr/local/lib/ \; 2>/dev/null || true
-    ldconfig 2>/dev/null || true
+    # The release binaries find their shared libraries next to themselves
+    # ($ORIGIN), so the whole bin directory goes into the prefix
+    local bindir name="${version}-release-${variant,,}"
+    bindir=$(find "${tmpdir}" -type f -name "llama-server" -printf '%h\n' | head -1)
+    if [[ -z "$bindir" ]]; then
+        error "llama-server not found in the llama.cpp release"
+        rm -rf "$tmpdir"
+        return 1
+    fi
+    mkdir -p "${LLAMACPP_ROOT}/${name}/bin"
+    cp -a "${bindir}/." "${LLAMACPP_ROOT}/${name}/bin/"
     rm -rf "$tmpdir"
+    llamacpp_use "$name"
     
     success "llama.cpp installed"
+    info "Optimized build for this APU: sudo $0 build (HIP gfx1151 / Vulkan, Zen 5 AVX-512)"
 }
 
 install_vllm() {
@@ -343,6 +388,290 @@ install_lemonade() {
     success "Lemonade SDK installed and configured for NPU"
 }
 
+# =============================================================================
+# LLAMA.CPP BUILDS
+# =============================================================================
+# Every llama.cpp install lives in its own prefix, LLAMACPP_ROOT/<tag>-<variant>,
+# and LLAMACPP_ROOT/current picks the one /usr/local/bin/llama-* run, so a
+# source build and the release binaries can be benchmarked side by side and
+# switched back. Source builds are static, so each prefix is self-contained.
+
+# Build dependencies for a distribution (see pkg_plan_add for the syntax)
+# Args: $1 = distribution
+# Output: Package names
+llamacpp_build_packages() {
+    case "$1" in
+        arch) echo "base-devel cmake ninja vulkan-headers vulkan-icd-loader shaderc spirv-headers" ;;
+        debian|ubuntu) echo "build-essential cmake ninja-build libvulkan-dev glslc|shaderc spirv-headers" ;;
+        fedora) echo "gcc-c++ cmake ninja-build vulkan-headers vulkan-loader-devel glslc spirv-headers-devel" ;;
+        opensuse) echo "gcc-c++ cmake ninja vulkan-devel shaderc spirv-headers" ;;
+    esac
+}
+
+# ggml CPU kernels and the /proc/cpuinfo flag each one needs
+LLAMACPP_GGML_CPU_FLAGS=(
+    AVX:avx AVX2:avx2 FMA:fma F16C:f16c BMI2:bmi2 AVX_VNNI:avx_vnni
+    AVX512:avx512f AVX512_VBMI:avx512vbmi AVX512_VNNI:avx512_vnni AVX512_BF16:avx512_bf16
+)
+# CPU flags an -march target assumes (Zen 5 adds AVX-VNNI and VP2INTERSECT;
+# sse4a/clzero keep Intel CPUs with AVX-512 off the znver targets)
+declare -A LLAMACPP_MARCH_FLAGS=(
+    [znver4]="sse4a clzero avx512f avx512bw avx512vl avx512vbmi avx512_vnni avx512_bf16"
+    [znver5]="sse4a clzero avx512f avx512bw avx512vl avx512vbmi avx512_vnni avx512_bf16 avx_vnni avx512_vp2intersect movdiri movdir64b"
+)
+
+# Pick CPU flags: the newest Zen -march that both the compiler and this CPU
+# support, and each ggml kernel (AVX-512 ones included; Zen 5 runs them at full
+# width) only when /proc/cpuinfo lists its flag
+# Sets: LLAMACPP_MARCH, LLAMACPP_CPU_OPTS (cmake -D options)
+llamacpp_cpu_flags() {
+    local cc="${CC:-cc}" march line flag entry missing
+    local -A has=()
+    while IFS= read -r line; do
+        [[ "$line" == flags* ]] && break
+    done < /proc/cpuinfo
+    for flag in ${line#*:}; do
+        has[$flag]=1
+    done
+
+    LLAMACPP_MARCH=""
+    for march in znver5 znver4; do
+        missing=""
+        for flag in ${LLAMACPP_MARCH_FLAGS[$march]}; do
+            [[ -n "${has[$flag]:-}" ]] || missing+=" $flag"
+        done
+        [[ -z "$missing" ]] || continue
+        if "$cc" -march="$march" -x c -c -o /dev/null - </dev/null 2>/dev/null; then
+            LLAMACPP_MARCH="$march"
+            break
+        fi
+    done
+    if [[ -z "$LLAMACPP_MARCH" ]]; then
+        # Building for another machine would produce binaries this CPU cannot run
+        warning "This CPU or compiler does not match znver4/znver5; building for the local CPU instead"
+        LLAMACPP_MARCH="native"
+        LLAMACPP_CPU_OPTS=(-DGGML_NATIVE=ON)
+        return 0
+    fi
+
+    LLAMACPP_CPU_OPTS=(-DGGML_NATIVE=OFF)
+    missing=""
+    for entry in "${LLAMACPP_GGML_CPU_FLAGS[@]}"; do
+        if [[ -n "${has[${entry#*:}]:-}" ]]; then
+            LLAMACPP_CPU_OPTS+=("-DGGML_${entry%%:*}=ON")
+        else
+            LLAMACPP_CPU_OPTS+=("-DGGML_${entry%%:*}=OFF")
+            missing+=" ${entry#*:}"
+        fi
+    done
+    [[ -z "$missing" ]] || info "CPU kernels left out (no${missing})"
+}
+
+# Latest llama.cpp release tag
+# Output: tag (e.g. b6700), nothing on failure
+llamacpp_latest_tag() {
+    local tmp
+    tmp=$(mktemp) || return 1
+    if fetch_file "${GZ302_GITHUB_API:-https://api.github.com}/repos/ggerganov/llama.cpp/releases/latest" "$tmp"; then
+        grep -oE '"tag_name": *"[^"]*"' "$tmp" | head -1 | sed -E 's/.*"([^"]*)"$/\1/'
+    fi
+    rm -f "$tmp"
+}
+
+# Build llama.cpp from a source tarball into LLAMACPP_ROOT/<tag>-<variant>
+# Args: $1 = variant (hip, vulkan), $2 = tag, $3 = tarball SHA-256 (optional)
+# Returns: 0 if built (or already present), 1 on failure
+llamacpp_build() {
+    local variant="$1" tag="$2" sha256="${3:-}"
+    local name="${tag}-${variant}"
+    local prefix="${LLAMACPP_ROOT}/${name}"
+    local -a opts=()
+    local gpu_targets="-"
+
+    if [[ -x "${prefix}/bin/llama-server" ]]; then
+        info "llama.cpp ${name} already built"
+        return 0
+    fi
+    case "$variant" in
+        hip)
+            if ! command -v hipconfig &>/dev/null; then
+                warning "hipconfig not found - install ROCm (HIP SDK) for the HIP build"
+                return 1
+            fi
+            local hip_root
+            hip_root=$(hipconfig -R)
+            # ROCm < 7.2 runs gfx1151 as gfx1100 (HSA_OVERRIDE_GFX_VERSION)
+            gpu_targets="gfx1151"
+            rocm_has_native_gfx1151 || gpu_targets="gfx1100"
+            opts+=(-DGGML_HIP=ON "-DAMDGPU_TARGETS=${gpu_targets}" "-DGPU_TARGETS=${gpu_targets}")
+            # rocWMMA flash attention is the faster FA path on RDNA 3.x
+            [[ -f "${hip_root}/include/rocwmma/rocwmma.hpp" ]] && opts+=(-DGGML_HIP_ROCWMMA_FATTN=ON)
+            HIPCXX="$(hipconfig -l)/clang"
+            export HIPCXX HIP_PATH="$hip_root"
+            ;;
+        vulkan)
+            if ! command -v glslc &>/dev/null; then
+                warning "glslc not found - the Vulkan build needs shaderc"
+                return 1
+            fi
+            opts+=(-DGGML_VULKAN=ON)
+            ;;
+        *)
+            error "Unknown llama.cpp build variant: $variant (hip, vulkan)"
+            return 1
+            ;;
+    esac
+    llamacpp_cpu_flags
+    opts+=("${LLAMACPP_CPU_OPTS[@]}")
+    command -v ninja &>/dev/null && opts+=(-G Ninja)
+
+    local tmpdir url sum=""
+    tmpdir=$(mktemp -d)
+    url="https://github.com/ggerganov/llama.cpp/archive/refs/tags/${tag}.tar.gz"
+    info "Downloading llama.cpp ${tag} source..."
+    if ! fetch_file "$url" "${tmpdir}/src.tar.gz" "$sha256"; then
+        error "Failed to download llama.cpp ${tag} source"
+        rm -rf "$tmpdir"
+        return 1
+    fi
+    sum=$(sha256sum "${tmpdir}/src.tar.gz")
+    sum="${sum%% *}"
+    mkdir -p "${tmpdir}/src"
+    tar -xzf "${tmpdir}/src.tar.gz" -C "${tmpdir}/src" --strip-components=1
+
+    info "Building llama.cpp ${name} (-march=${LLAMACPP_MARCH}, GPU ${gpu_targets})..."
+    if ! cmake -S "${tmpdir}/src" -B "${tmpdir}/build" "${opts[@]}" \
+            -DCMAKE_BUILD_TYPE=Release \
+            -DCMAKE_INSTALL_PREFIX="$prefix" \
+            -DCMAKE_C_FLAGS="-march=${LLAMACPP_MARCH} -mtune=${LLAMACPP_MARCH}" \
+            -DCMAKE_CXX_FLAGS="-march=${LLAMACPP_MARCH} -mtune=${LLAMACPP_MARCH}" \
+            -DBUILD_SHARED_LIBS=OFF -DLLAMA_CURL=OFF -DLLAMA_BUILD_TESTS=OFF \
+        || ! cmake --build "${tmpdir}/build" --config Release -j "$(nproc)" \
+        || ! cmake --install "${tmpdir}/build" --prefix "${prefix}.part"; then
+        error "llama.cpp ${name} build failed"
+        rm -rf "$tmpdir" "${prefix}.part"
+        return 1
+    fi
+    {
+        echo "TAG=${tag}"
+        echo "VARIANT=${variant}"
+        echo "SOURCE=${url}"
+        echo "SOURCE_SHA256=${sum}"
+        echo "MARCH=${LLAMACPP_MARCH}"
+        echo "GPU_TARGETS=${gpu_targets}"
+        echo "ROCM=$(get_rocm_version)"
+        echo "CMAKE_OPTIONS=${opts[*]}"
+        printf 'BUILT_AT=%(%Y-%m-%dT%H:%M:%S)T\n' -1
+    } > "${prefix}.part/BUILD_INFO"
+    rm -rf "$prefix"
+    mv "${prefix}.part" "$prefix"
+    rm -rf "$tmpdir"
+    success "llama.cpp ${name} installed in ${prefix} (source sha256 ${sum:0:12}...)"
+}
+
+# Point LLAMACPP_ROOT/current and /usr/local/bin/llama-* at a build
+# Args: $1 = build name (directory under LLAMACPP_ROOT)
+# Returns: 0 on success, 1 if the build does not exist
+llamacpp_use() {
+    local name="$1" bin link
+    if [[ -z "$name" || "$name" == "current" || ! -d "${LLAMACPP_ROOT}/${name}/bin" ]]; then
+        error "No llama.cpp build '${name}' in ${LLAMACPP_ROOT}"
+        return 1
+    fi
+    ln -sfn "$name" "${LLAMACPP_ROOT}/current"
+    # Links left by a build that had a binary this one lacks
+    for link in /usr/local/bin/llama-*; do
+        if [[ -L "$link" && "$(readlink "$link")" == "${LLAMACPP_ROOT}/current/bin/"* && ! -e "$link" ]]; then
+            rm -f "$link"
+        fi
+    done
+    for bin in "${LLAMACPP_ROOT}/current/bin/"llama-*; do
+        [[ -f "$bin" && -x "$bin" ]] || continue
+        ln -sfn "${LLAMACPP_ROOT}/current/bin/${bin##*/}" "/usr/local/bin/${bin##*/}"
+    done
+    success "llama.cpp now runs ${name}"
+    systemctl try-restart gz302-llama-server.service >/dev/null 2>&1 || true
+}
+
+# List the installed builds
+llamacpp_list() {
+    local dir name current="" key value
+    local -A build=()
+    current=$(readlink "${LLAMACPP_ROOT}/current" 2>/dev/null) || true
+    printf '  %-28s %-8s %-9s %-9s %s\n' BUILD VARIANT MARCH GPU BUILT
+    for dir in "${LLAMACPP_ROOT}"/*/; do
+        dir="${dir%/}"
+        name="${dir##*/}"
+        [[ "$name" == "current" || ! -d "${dir}/bin" ]] && continue
+        build=()
+        if [[ -f "${dir}/BUILD_INFO" ]]; then
+            while IFS='=' read -r key value; do
+                build[$key]="$value"
+            done < "${dir}/BUILD_INFO"
+        fi
+        printf '%s %-28s %-8s %-9s %-9s %s\n' "$([[ "$name" == "$current" ]] && echo '*' || echo ' ')" \
+            "$name" "${build[VARIANT]:-release}" "${build[MARCH]:--}" "${build[GPU_TARGETS]:--}" \
+            "${build[BUILT_AT]:--}"
+    done
+}
+
+# gz302-llm.sh build [--variant hip|vulkan|all] [--tag TAG] [--use]
+llamacpp_build_command() {
+    local variant="all" tag="$LLAMACPP_TAG" use=false built=""
+    while [[ $# -gt 0 ]]; do
+        case "$1" in
+            --variant) variant="${2:?--variant needs hip, vulkan or all}"; shift ;;
+            --tag) tag="${2:?--tag needs a release tag}"; shift ;;
+            --use) use=true ;;
+            *) error "Unknown build option: $1"; return 1 ;;
+        esac
+        shift
+    done
+
+    print_section "llama.cpp Source Build"
+    if [[ -z "$tag" || "$tag" == "latest" ]]; then
+        tag=$(llamacpp_latest_tag)
+        if [[ -z "$tag" ]]; then
+            error "Could not look up the latest llama.cpp release; use --tag"
+            return 1
+        fi
+        info "Building the latest release, ${tag}"
+    fi
+    local sha256="$LLAMACPP_SHA256"
+    [[ -n "$sha256" || "$tag" != "$LLAMACPP_PIN_TAG" ]] || sha256="$LLAMACPP_PIN_SHA256"
+    # The pinned release is only built verified: a pin without its hash is a
+    # checkout that skipped scripts/update-llamacpp-pin.sh
+    if [[ -z "$sha256" && "$tag" == "$LLAMACPP_PIN_TAG" ]]; then
+        error "llama.cpp ${tag} is pinned without a SHA-256: run scripts/update-llamacpp-pin.sh ${tag} or set LLAMACPP_SHA256"
+        return 1
+    elif [[ -z "$sha256" ]]; then
+        warning "llama.cpp ${tag} is not pinned: set LLAMACPP_SHA256 to verify the tarball"
+    fi
+
+    local distro
+    distro=$(detect_distribution)
+    info "Installing build dependencies..."
+    # shellcheck disable=SC2046
+    pkg_transaction "$distro" "" $(llamacpp_build_packages "$distro") || warning "Some build dependencies could not be installed"
+
+    local -a variants=("$variant")
+    [[ "$variant" == "all" ]] && variants=(hip vulkan)
+    local v
+    for v in "${variants[@]}"; do
+        llamacpp_build "$v" "$tag" "$sha256" && built="${tag}-${v}"
+    done
+    if [[ -z "$built" ]]; then
+        error "No llama.cpp build succeeded"
+        return 1
+    fi
+    if [[ "$use" == true || ! -e "${LLAMACPP_ROOT}/current" ]]; then
+        llamacpp_use "$built"
+    fi
+    echo
+    llamacpp_list
+    info "Compare them: sudo $0 bench; switch: sudo $0 use BUILD"
+}
+
 # =============================================================================
 # FRONTEND INSTALLATIONS
 # =============================================================================
@@ -378,19 +707,39 @@ install_openwebui() {
         return 0
     fi
     
-    docker rm -f open-webui 2>/dev/null || true
-    
     info "Deploying Open WebUI..."
+    run_openwebui_container
+    
+    success "Open WebUI installed"
+    info "Access: http://localhost:3000"
+}
+
+# (Re)create the Open WebUI container, connected to the backend chosen by
+# 'bench' in LLM_BACKEND_CONF (Ollama until one has been chosen)
+run_openwebui_container() {
+    local backend="" url=""
+    local -a env=()
+    if [[ -f "$LLM_BACKEND_CONF" ]]; then
+        backend=$(sed -n 's/^BACKEND=//p' "$LLM_BACKEND_CONF")
+        url=$(sed -n 's/^OPENAI_BASE_URL=//p' "$LLM_BACKEND_CONF")
+    fi
+    if [[ -z "$backend" || "$backend" == "ollama" ]]; then
+        env=(-e "OLLAMA_BASE_URL=http://host.docker.internal:11434")
+    else
+        # localhost inside the container is the container itself
+        env=(-e "OPENAI_API_BASE_URL=${url/localhost/host.docker.internal}" -e "OPENAI_API_KEY=none"
+             -e "ENABLE_OLLAMA_API=false")
+    fi
+    
+    docker rm -f open-webui 2>/dev/null || true
     docker run -d \
         --name open-webui \
         --restart always \
         -p 3000:8080 \
         --add-host=host.docker.internal:host-gateway \
+        "${env[@]}" \
         -v open-webui:/app/backend/data \
         ghcr.io/open-webui/open-webui:main
-    
-    success "Open WebUI installed"
-    info "Access: http://localhost:3000"
 }
 
 install_sillytavern() {
@@ -548,6 +897,929 @@ EOF
     info "Activate: source ${venv_path}/activate-ai"
 }
 
+# =============================================================================
+# GPU MEMORY (GTT/TTM)
+# =============================================================================
+
+# Load gpu-manager.sh for the unified memory planner
+# Returns: 0 if loaded, 1 if not found
+load_gpu_manager() {
+    declare -f gpu_plan_unified_memory >/dev/null 2>&1 && return 0
+    local lib
+    for lib in "${SCRIPT_DIR}/../gz302-lib/gpu-manager.sh" \
+               /usr/local/share/gz302/gz302-lib/gpu-manager.sh; do
+        if [[ -f "$lib" ]]; then
+            # shellcheck source=/dev/null
+            source "$lib"
+            return 0
+        fi
+    done
+    return 1
+}
+
+# Size the memory the GPU may map (ttm.pages_limit) for the models in
+# /etc/gz302/llm-models.conf; by default the kernel caps it at half of RAM
+configure_unified_memory() {
+    if ! load_gpu_manager; then
+        warning "gpu-manager.sh not found - skipping the GPU memory plan"
+        return 0
+    fi
+    if [[ ! -f "$GPU_GTT_MODELS_CONF" ]]; then
+        mkdir -p "${GPU_GTT_MODELS_CONF%/*}"
+        gpu_get_llm_models_config > "$GPU_GTT_MODELS_CONF"
+        info "Created $GPU_GTT_MODELS_CONF - list the models you run there"
+    fi
+
+    local rc=0
+    gpu_plan_unified_memory || rc=$?
+    if [[ $rc -eq 1 ]]; then
+        warning "Could not plan GPU memory - check $GPU_GTT_MODELS_CONF"
+        return 0
+    fi
+    echo
+    gpu_print_unified_memory_plan
+    echo
+    read -r -p "Apply this GPU memory limit (takes effect after reboot)? (y/N): " choice || choice="n"
+    if [[ "$choice" =~ ^[Yy] ]]; then
+        if gpu_apply_unified_memory; then
+            success "GPU memory limit written to $GPU_GTT_CONF - reboot, then run 'gz302-gpu memory verify'"
+        else
+            warning "GPU memory limit not applied"
+        fi
+    else
+        info "Later: edit $GPU_GTT_MODELS_CONF and run 'sudo gz302-gpu memory apply'"
+    fi
+}
+
+# =============================================================================
+# BACKEND BENCHMARK
+# =============================================================================
+# Runs one model and one workload on every installed backend, so the choice
+# between them (Vulkan vs ROCm on gfx1151 changes between releases) is
+# measured rather than guessed. llama.cpp is measured with llama-bench; Ollama
+# through its streaming API, with the same GGUF imported; other
+# OpenAI-compatible servers (vLLM, Lemonade, LM Studio) with --endpoint.
+
+# Python helper for the HTTP backends
+# Output: script for python3 -c; args: MODE(ollama|openai) URL MODEL
+#         PROMPT_TOKENS GEN_TOKENS REPS; prints "pp_tps tg_tps ttft_ms model"
+llm_bench_client_py() {
+    cat <<'PY'
+import json, sys, time, urllib.request
+
+mode, url, model = sys.argv[1], sys.argv[2].rstrip("/"), sys.argv[3]
+n_prompt, n_gen, reps = (int(v) for v in sys.argv[4:7])
+# Plain English words come out close to one token each in the usual tokenizers
+words = ("the quick brown fox jumps over the lazy dog while a benchmark "
+         "feeds the model a prompt of fixed and predictable length").split()
+
+
+def post(path, body):
+    req = urllib.request.Request(url + path, json.dumps(body).encode(),
+                                 {"Content-Type": "application/json"})
+    return urllib.request.urlopen(req, timeout=900)
+
+
+def run_ollama(prompt):
+    opts = {"num_predict": n_gen, "temperature": 0,
+            "num_ctx": max(2048, n_prompt + n_gen + 64)}
+    start, first, final = time.monotonic(), None, {}
+    with post("/api/generate", {"model": model, "prompt": prompt, "raw": True,
+                                "stream": True, "options": opts}) as resp:
+        for line in resp:
+            msg = json.loads(line)
+            if first is None and msg.get("response"):
+                first = time.monotonic()
+            if msg.get("done"):
+                final = msg
+    pp = final["prompt_eval_count"] / final["prompt_eval_duration"] * 1e9
+    tg = final["eval_count"] / final["eval_duration"] * 1e9
+    return pp, tg, (first - start) * 1000
+
+
+def run_openai(prompt):
+    body = {"model": model, "prompt": prompt, "max_tokens": n_gen,
+            "temperature": 0, "stream": True,
+            "stream_options": {"include_usage": True}}
+    start, first, last, chunks, usage = time.monotonic(), None, None, 0, {}
+    with post("/completions", body) as resp:
+        for raw in resp:
+            line = raw.decode().strip()
+            if not line.startswith("data:") or line == "data: [DONE]":
+                continue
+            msg = json.loads(line[5:])
+            usage = msg.get("usage") or usage
+            if msg.get("choices") and msg["choices"][0].get("text"):
+                last = time.monotonic()
+                first = first or last
+                chunks += 1
+    ttft = first - start
+    tokens = usage.get("completion_tokens", chunks)
+    prompt_tokens = usage.get("prompt_tokens", n_prompt)
+    # No server-side timings here: prompt speed is bounded by TTFT
+    pp = prompt_tokens / ttft
+    tg = (tokens - 1) / (last - first) if last > first else 0.0
+    return pp, tg, ttft * 1000
+
+
+if mode == "openai" and model == "-":
+    with urllib.request.urlopen(url + "/models", timeout=30) as resp:
+        model = json.load(resp)["data"][0]["id"]
+run = run_ollama if mode == "ollama" else run_openai
+run("hello")  # load the model outside the measurement
+results = []
+for rep in range(reps):
+    # A different first word per run keeps prompt caches out of it
+    prompt = f"run{rep} " + " ".join(words[i % len(words)] for i in range(n_prompt - 1))
+    results.append(run(prompt))
+if mode == "ollama":
+    post("/api/generate", {"model": model, "keep_alive": 0}).read()
+med = [sorted(col)[len(col) // 2] for col in zip(*results)]
+print(f"{med[0]:.1f} {med[1]:.1f} {med[2]:.0f} {model}")
+PY
+}
+
+# Memory in use: MemTotal - MemAvailable (GTT pages come out of it) plus the
+# BIOS carve-out VRAM in use
+# Sets: _LLM_MEM_USED_KB
+llm_mem_used() {
+    local key value _rest total=0 avail=0 vram=0 f
+    while read -r key value _rest; do
+        case "$key" in
+            MemTotal:) total=$value ;;
+            MemAvailable:) avail=$value ;;
+        esac
+    done < /proc/meminfo
+    for f in /sys/class/drm/card*/device/mem_info_vram_used; do
+        [[ -r "$f" ]] || continue
+        read -r value < "$f"
+        vram=$((vram + value / 1024))
+    done
+    _LLM_MEM_USED_KB=$((total - avail + vram))
+}
+
+# Track the peak memory growth over the current level in the background
+# Args: $1 = file that receives the peak (KiB) when the watcher stops
+# Sets: LLM_MEM_WATCH_PID
+llm_mem_watch_start() {
+    local out="$1" base
+    llm_mem_used
+    base=$_LLM_MEM_USED_KB
+    (
+        peak=0
+        trap 'echo "$peak" > "$out"; exit 0' TERM
+        while true; do
+            llm_mem_used
+            if ((_LLM_MEM_USED_KB - base > peak)); then
+                peak=$((_LLM_MEM_USED_KB - base))
+            fi
+            sleep 0.2 & wait $!
+        done
+    ) &
+    LLM_MEM_WATCH_PID=$!
+}
+
+# Args: $1 = file given to llm_mem_watch_start
+# Sets: LLM_BENCH_PEAK_MIB
+llm_mem_watch_stop() {
+    local peak=0
+    kill -TERM "$LLM_MEM_WATCH_PID" 2>/dev/null || true
+    wait "$LLM_MEM_WATCH_PID" 2>/dev/null || true
+    read -r peak 2>/dev/null < "$1" || true
+    rm -f "$1"
+    LLM_BENCH_PEAK_MIB=$((${peak:-0} / 1024))
+}
+
+# Append one result to LLM_BENCH_RESULTS and the current run
+# Args: backend variant model pp_tps tg_tps ttft_ms peak_mib endpoint
+llm_bench_record() {
+    local kernel
+    kernel=$(uname -r)
+    mkdir -p "${LLM_BENCH_RESULTS%/*}"
+    if [[ ! -s "$LLM_BENCH_RESULTS" ]]; then
+        printf '# date\tkernel\tbackend\tvariant\tmodel\tpp_tps\ttg_tps\tttft_ms\tpeak_mib\tendpoint\n' \
+            > "$LLM_BENCH_RESULTS"
+    fi
+    printf '%(%Y-%m-%dT%H:%M:%S)T\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n' -1 \
+        "$kernel" "$@" >> "$LLM_BENCH_RESULTS"
+    local IFS=$'\t'
+    LLM_BENCH_RUN+=("$*")
+    success "$1 ($2): pp $4 t/s, tg $5 t/s, TTFT $6 ms, peak $7 MiB"
+}
+
+# Get the bench model, downloading the default one on first use
+# Sets: LLM_BENCH_MODEL_PATH
+# Returns: 0 if available, 1 if not
+llm_bench_model() {
+    if [[ -n "${LLM_BENCH_MODEL_PATH:-}" ]]; then
+        [[ -f "$LLM_BENCH_MODEL_PATH" ]] && return 0
+        error "Model not found: $LLM_BENCH_MODEL_PATH"
+        return 1
+    fi
+    LLM_BENCH_MODEL_PATH="${LLM_BENCH_DIR}/${LLM_BENCH_MODEL_URL##*/}"
+    [[ -f "$LLM_BENCH_MODEL_PATH" ]] && return 0
+    info "Downloading the bench model (${LLM_BENCH_MODEL_URL##*/})..."
+    mkdir -p "$LLM_BENCH_DIR"
+    if ! fetch_file "$LLM_BENCH_MODEL_URL" "$LLM_BENCH_MODEL_PATH.part"; then
+        rm -f "$LLM_BENCH_MODEL_PATH.part"
+        error "Could not download the bench model; use --model PATH"
+        return 1
+    fi
+    mv "$LLM_BENCH_MODEL_PATH.part" "$LLM_BENCH_MODEL_PATH"
+    chmod 644 "$LLM_BENCH_MODEL_PATH"
+}
+
+# Benchmark one llama.cpp build with llama-bench
+# Args: $1 = llama-bench path
+# Returns: 0 if recorded, 1 on failure
+llm_bench_llamacpp() {
+    local bench="$1" tmp pp tg ttft variant
+    tmp=$(mktemp -d)
+    info "llama.cpp: llama-bench pp${LLM_BENCH_PROMPT_TOKENS}/tg${LLM_BENCH_GEN_TOKENS} x${LLM_BENCH_REPS} ($bench)"
+    llm_mem_watch_start "$tmp/peak"
+    if ! "$bench" -m "$LLM_BENCH_MODEL_PATH" -p "$LLM_BENCH_PROMPT_TOKENS" -n "$LLM_BENCH_GEN_TOKENS" \
+            -r "$LLM_BENCH_REPS" -ngl 999 -o json > "$tmp/out.json" 2> "$tmp/err.log"; then
+        llm_mem_watch_stop "$tmp/peak"
+        warning "llama-bench failed:"
+        tail -n 3 "$tmp/err.log" >&2
+        rm -rf "$tmp"
+        return 1
+    fi
+    llm_mem_watch_stop "$tmp/peak"
+
+    # Builds in LLAMACPP_ROOT are named after their prefix
+    local build=""
+    [[ "$bench" == "${LLAMACPP_ROOT}/"*/bin/llama-bench ]] && build="${bench#"${LLAMACPP_ROOT}/"}" && build="${build%%/*}"
+
+    # llama-bench does not measure TTFT: prompt time plus one decode step
+    if ! read -r pp tg ttft variant < <(python3 - "$tmp/out.json" "$LLM_BENCH_PROMPT_TOKENS" <<'PY'
+import json, sys
+rows = json.load(open(sys.argv[1]))
+pp = next(r for r in rows if r.get("n_prompt") and not r.get("n_gen"))
+tg = next(r for r in rows if r.get("n_gen") and not r.get("n_prompt"))
+ttft = int(sys.argv[2]) / pp["avg_ts"] * 1000 + 1000 / tg["avg_ts"]
+variant = (pp.get("backends") or "CPU").replace(" ", "") + "@" + (pp.get("build_commit") or "?")
+print(f'{pp["avg_ts"]:.1f} {tg["avg_ts"]:.1f} {ttft:.0f} {variant}')
+PY
+    ); then
+        warning "Could not parse llama-bench output"
+        rm -rf "$tmp"
+        return 1
+    fi
+    rm -rf "$tmp"
+    [[ -n "$build" ]] && variant="${build}:${variant%@*}"
+    llm_bench_record llama.cpp "$variant" "${LLM_BENCH_MODEL_PATH##*/}" "$pp" "$tg" "$ttft" \
+        "$LLM_BENCH_PEAK_MIB" "http://localhost:${LLAMA_SERVER_PORT}/v1"
+}
+
+# Benchmark Ollama with the bench GGUF imported as gz302-bench
+# Returns: 0 if recorded, 1 on failure
+llm_bench_ollama() {
+    local tmp pp tg ttft _model version
+    if ! curl -fsS "${LLM_OLLAMA_URL}/api/version" >/dev/null 2>&1; then
+        warning "Ollama is installed but not running (systemctl start ollama)"
+        return 1
+    fi
+    tmp=$(mktemp -d)
+    printf 'FROM %s\n' "$LLM_BENCH_MODEL_PATH" > "$tmp/Modelfile"
+    if ! ollama create gz302-bench -f "$tmp/Modelfile" >/dev/null 2>&1; then
+        warning "Could not import the bench model into Ollama"
+        rm -rf "$tmp"
+        return 1
+    fi
+    version=$(ollama --version 2>/dev/null | grep -oE '[0-9]+(\.[0-9]+)+' | head -1) || true
+    info "Ollama ${version:-?}: pp${LLM_BENCH_PROMPT_TOKENS}/tg${LLM_BENCH_GEN_TOKENS} x${LLM_BENCH_REPS}"
+    llm_mem_watch_start "$tmp/peak"
+    if ! read -r pp tg ttft _model < <(python3 -c "$(llm_bench_client_py)" ollama "$LLM_OLLAMA_URL" \
+            gz302-bench "$LLM_BENCH_PROMPT_TOKENS" "$LLM_BENCH_GEN_TOKENS" "$LLM_BENCH_REPS" 2>/dev/null); then
+        llm_mem_watch_stop "$tmp/peak"
+        warning "Ollama benchmark failed"
+        rm -rf "$tmp"
+        return 1
+    fi
+    llm_mem_watch_stop "$tmp/peak"
+    rm -rf "$tmp"
+    llm_bench_record ollama "${version:-?}" "${LLM_BENCH_MODEL_PATH##*/}" "$pp" "$tg" "$ttft" \
+        "$LLM_BENCH_PEAK_MIB" "${LLM_OLLAMA_URL}/v1"
+}
+
+# Benchmark a running OpenAI-compatible server with the model it serves
+# Args: $1 = NAME=URL[@MODEL] (URL up to /v1)
+# Returns: 0 if recorded, 1 on failure
+llm_bench_endpoint() {
+    local name="${1%%=*}" url="${1#*=}" model="-" tmp pp tg ttft
+    if [[ "$url" == *@* ]]; then
+        model="${url##*@}"
+        url="${url%@*}"
+    fi
+    info "${name}: pp${LLM_BENCH_PROMPT_TOKENS}/tg${LLM_BENCH_GEN_TOKENS} x${LLM_BENCH_REPS} ($url)"
+    tmp=$(mktemp -d)
+    llm_mem_watch_start "$tmp/peak"
+    if ! read -r pp tg ttft model < <(python3 -c "$(llm_bench_client_py)" openai "$url" "$model" \
+            "$LLM_BENCH_PROMPT_TOKENS" "$LLM_BENCH_GEN_TOKENS" "$LLM_BENCH_REPS" 2>/dev/null); then
+        llm_mem_watch_stop "$tmp/peak"
+        warning "${name}: no response from $url"
+        rm -rf "$tmp"
+        return 1
+    fi
+    llm_mem_watch_stop "$tmp/peak"
+    rm -rf "$tmp"
+    # The server loaded its model before the run, so the peak misses the weights
+    llm_bench_record "$name" openai "$model" "$pp" "$tg" "$ttft" "$LLM_BENCH_PEAK_MIB" "$url"
+}
+
+# Serve LLAMA_SERVER_MODEL with llama-server on LLAMA_SERVER_PORT. The unit
+# is only enabled once a model is configured.
+# Args: $1 = LLAMA_SERVER_MODEL from LLM_BACKEND_CONF (may be empty)
+llm_enable_llama_server() {
+    local model="$1" server env
+    if ! server=$(type -P llama-server); then
+        warning "llama-server not found"
+        return 1
+    fi
+    # Same GPU environment as the Ollama drop-in: HIP builds for ROCm < 7.2
+    # target gfx1100, and systemd does not read /etc/profile.d
+    env='Environment="HIP_VISIBLE_DEVICES=0"'$'\n''Environment="GPU_MAX_HW_QUEUES=8"'$'\n'
+    rocm_has_native_gfx1151 || env='Environment="HSA_OVERRIDE_GFX_VERSION=11.0.0"'$'\n'"$env"
+    cat > /etc/systemd/system/gz302-llama-server.service <<UNIT
+[Unit]
+Description=GZ302 llama.cpp server (OpenAI-compatible API on port ${LLAMA_SERVER_PORT})
+After=network-online.target
+
+[Service]
+EnvironmentFile=${LLM_BACKEND_CONF}
+${env}ExecStart=${server} --host 0.0.0.0 --port ${LLAMA_SERVER_PORT} -ngl 999 -m \${LLAMA_SERVER_MODEL}
+DynamicUser=yes
+SupplementaryGroups=render video
+Restart=on-failure
+
+[Install]
+WantedBy=multi-user.target
+UNIT
+    systemctl daemon-reload
+    if [[ -z "$model" ]]; then
+        warning "No model for gz302-llama-server: set LLAMA_SERVER_MODEL in $LLM_BACKEND_CONF"
+        info "Then run: systemctl enable --now gz302-llama-server.service"
+        return 0
+    fi
+    systemctl enable gz302-llama-server.service >/dev/null 2>&1 || true
+    if ! systemctl restart gz302-llama-server.service; then
+        warning "gz302-llama-server did not start; check LLAMA_SERVER_MODEL in $LLM_BACKEND_CONF"
+    fi
+}
+
+# Write LLM_BACKEND_CONF
+# Args: $1 = backend the frontends use, $2 = its base URL, $3 = LLAMA_SERVER_MODEL
+llm_write_backend_conf() {
+    mkdir -p "${LLM_BACKEND_CONF%/*}"
+    {
+        echo "# GZ302 LLM backend, chosen by 'gz302-llm.sh bench' (fastest generation)"
+        echo "BACKEND=$1"
+        echo "OPENAI_BASE_URL=$2"
+        echo "# Model (GGUF path) served by gz302-llama-server.service when BACKEND=llama.cpp"
+        echo "LLAMA_SERVER_MODEL=$3"
+    } > "$LLM_BACKEND_CONF"
+}
+
+# Wait for an OpenAI-compatible server to answer (llama-server returns 503
+# while it loads the model)
+# Args: $1 = base URL, $2 = seconds to wait
+# Returns: 0 once /models answers, 1 on timeout
+llm_backend_serving() {
+    local i
+    for ((i = 0; i <= $2; i += 2)); do
+        curl -fsS --max-time 2 "$1/models" >/dev/null 2>&1 && return 0
+        sleep 2
+    done
+    return 1
+}
+
+# Record the selected backend and point the frontends at it. A backend that
+# is not serving (llama.cpp without LLAMA_SERVER_MODEL) leaves the frontends
+# on the previous one.
+# Args: $1 = backend, $2 = OpenAI-compatible base URL
+llm_select_backend() {
+    local backend="$1" url="$2" llama_model="" prev_backend="" prev_url=""
+    if [[ -f "$LLM_BACKEND_CONF" ]]; then
+        llama_model=$(sed -n 's/^LLAMA_SERVER_MODEL=//p' "$LLM_BACKEND_CONF")
+        prev_backend=$(sed -n 's/^BACKEND=//p' "$LLM_BACKEND_CONF")
+        prev_url=$(sed -n 's/^OPENAI_BASE_URL=//p' "$LLM_BACKEND_CONF")
+    fi
+    # The unit reads LLAMA_SERVER_MODEL from the file before the switch
+    llm_write_backend_conf "$prev_backend" "$prev_url" "$llama_model"
+
+    if [[ "$backend" == "llama.cpp" ]]; then
+        llm_enable_llama_server "$llama_model" || true
+    elif [[ -f /etc/systemd/system/gz302-llama-server.service ]]; then
+        systemctl disable --now gz302-llama-server.service >/dev/null 2>&1 || true
+    fi
+    if [[ "$backend" == "llama.cpp" && -z "$llama_model" ]] || ! llm_backend_serving "$url" 60; then
+        warning "$backend is not serving at $url; the frontends stay on ${prev_backend:-ollama}"
+        info "Once it serves, re-run: $0 bench"
+        return 0
+    fi
+    llm_write_backend_conf "$backend" "$url" "$llama_model"
+    info "Selected $backend ($url) - $LLM_BACKEND_CONF"
+
+    if command -v docker &>/dev/null && docker ps -a --format '{{.Names}}' 2>/dev/null | grep -q "^open-webui$"; then
+        info "Pointing Open WebUI at $backend..."
+        run_openwebui_container
+        info "Open WebUI prefers connections saved in Admin Settings; change them there if it still uses the old backend"
+    fi
+    if [[ -d /opt/librechat ]]; then
+        info "LibreChat: add a custom endpoint with baseURL $url"
+    fi
+    if docker ps --format '{{.Names}}' 2>/dev/null | grep -q "^sillytavern$"; then
+        info "SillyTavern: use the Chat Completion API at $url"
+    fi
+    return 0
+}
+
+# Whether a result was measured on the bench model: same file name, ignoring
+# directory, .gguf suffix and case (servers report ids such as the file name)
+# Args: $1 = model column of a result
+# Returns: 0 if it is the bench model
+llm_bench_is_bench_model() {
+    local model="${1##*/}" bench="${LLM_BENCH_MODEL_PATH##*/}"
+    model="${model%.gguf}" bench="${bench%.gguf}"
+    [[ "${model,,}" == "${bench,,}" ]]
+}
+
+# Print the results of this run, fastest generation first. Only results on
+# the bench model compete; an --endpoint serving another model is shown but
+# never selected.
+# Sets: LLM_BENCH_BEST (backend<TAB>variant<TAB>endpoint, empty if none)
+llm_bench_report() {
+    local backend variant model pp tg ttft peak endpoint other=false
+    LLM_BENCH_BEST=""
+    echo
+    printf '%-12s %-24s %9s %9s %9s %9s\n' BACKEND VARIANT "PP t/s" "TG t/s" "TTFT ms" "PEAK MiB"
+    while IFS=$'\t' read -r backend variant model pp tg ttft peak endpoint; do
+        if ! llm_bench_is_bench_model "$model"; then
+            printf '%-12s %-24s %9s %9s %9s %9s  (%s)\n' "$backend" "${variant:0:24}" "$pp" "$tg" "$ttft" "$peak" "$model"
+            other=true
+            continue
+        fi
+        printf '%-12s %-24s %9s %9s %9s %9s\n' "$backend" "${variant:0:24}" "$pp" "$tg" "$ttft" "$peak"
+        [[ -n "$LLM_BENCH_BEST" ]] || LLM_BENCH_BEST="$backend"$'\t'"$variant"$'\t'"$endpoint"
+    done < <(printf '%s\n' "${LLM_BENCH_RUN[@]}" | sort -t $'\t' -k5,5gr)
+    echo
+    if [[ "$other" == true ]]; then
+        info "Rows with a model in brackets ran another model and are not compared; serve ${LLM_BENCH_MODEL_PATH##*/} and pass NAME=URL@MODEL to include them"
+    fi
+    info "Results appended to $LLM_BENCH_RESULTS"
+}
+
+# gz302-llm.sh bench [--model PATH] [--endpoint NAME=URL[@MODEL]]... [--reps N] [--no-select]
+llm_bench() {
+    local select=true bench endpoint
+    local -a endpoints=()
+    LLM_BENCH_RUN=()
+    while [[ $# -gt 0 ]]; do
+        case "$1" in
+            --model) LLM_BENCH_MODEL_PATH="${2:?--model needs a path}"; shift ;;
+            --endpoint) endpoints+=("${2:?--endpoint needs NAME=URL}"); shift ;;
+            --reps) LLM_BENCH_REPS="${2:?--reps needs a number}"; shift ;;
+            --no-select) select=false ;;
+            *) error "Unknown bench option: $1"; return 1 ;;
+        esac
+        shift
+    done
+    if ! command -v python3 &>/dev/null; then
+        error "python3 is required for the benchmark"
+        return 1
+    fi
+
+    print_section "LLM Backend Benchmark"
+    llm_bench_model || return 1
+    info "Model: $LLM_BENCH_MODEL_PATH"
+
+    # Every llama.cpp build in LLAMACPP_ROOT, plus one installed elsewhere
+    for bench in "${LLAMACPP_ROOT}"/*/bin/llama-bench; do
+        [[ -x "$bench" && "$bench" != "${LLAMACPP_ROOT}/current/"* ]] || continue
+        llm_bench_llamacpp "$bench" || true
+    done
+    if bench=$(type -P llama-bench) && [[ "$(readlink -f "$bench")" != "${LLAMACPP_ROOT}/"* ]]; then
+        llm_bench_llamacpp "$bench" || true
+    elif [[ ! -e "${LLAMACPP_ROOT}/current" ]] && command -v llama-server &>/dev/null; then
+        warning "llama.cpp is installed without llama-bench - skipped"
+    fi
+    if command -v ollama &>/dev/null; then
+        llm_bench_ollama || true
+    fi
+    for endpoint in "${endpoints[@]}"; do
+        llm_bench_endpoint "$endpoint" || true
+    done
+    if [[ ${#endpoints[@]} -eq 0 ]] && { command -v lemonade-server &>/dev/null || [[ -d "$VLLM_VENV" || -f "$LMSTUDIO_APPIMAGE" ]]; }; then
+        info "Lemonade, vLLM and LM Studio are measured while serving: --endpoint NAME=http://localhost:PORT/v1"
+    fi
+
+    if [[ ${#LLM_BENCH_RUN[@]} -eq 0 ]]; then
+        warning "No backend could be benchmarked"
+        return 1
+    fi
+    llm_bench_report
+    if [[ "$select" == true && -z "$LLM_BENCH_BEST" ]]; then
+        warning "No backend ran the bench model - nothing selected"
+    elif [[ "$select" == true ]]; then
+        local best_backend best_variant best_url
+        IFS=$'\t' read -r best_backend best_variant best_url <<< "$LLM_BENCH_BEST"
+        # The fastest llama.cpp build becomes the one llama-server runs
+        if [[ "$best_backend" == "llama.cpp" && -d "${LLAMACPP_ROOT}/${best_variant%%:*}/bin" ]]; then
+            llamacpp_use "${best_variant%%:*}"
+        fi
+        llm_select_backend "$best_backend" "$best_url"
+    fi
+}
+
+# =============================================================================
+# MODEL STORE
+# =============================================================================
+
+# One copy of each GGUF, named by its SHA-256, with hardlinked views for every
+# backend. Ollama gets the blob linked into its own store before `ollama
+# create`, which then finds the layer present and copies nothing.
+
+# Backend model directories: the ones that exist get a view
+# Sets: LLM_STORE_VIEW_DIRS (label -> directory)
+llm_store_view_dirs() {
+    declare -gA LLM_STORE_VIEW_DIRS=()
+    LLM_STORE_VIEW_DIRS[llama.cpp]="${LLM_MODEL_STORE}/gguf"
+    local home
+    home=$(getent passwd "$(get_real_user)" | cut -d: -f6)
+    if [[ -d "${home}/.cache/lm-studio/models" ]]; then
+        LLM_STORE_VIEW_DIRS[lmstudio]="${home}/.cache/lm-studio/models/gz302"
+    elif [[ -d "${home}/.lmstudio" || -f "$LMSTUDIO_APPIMAGE" ]]; then
+        LLM_STORE_VIEW_DIRS[lmstudio]="${home}/.lmstudio/models/gz302"
+    fi
+    if [[ -d /opt/text-generation-webui/user_data/models ]]; then
+        LLM_STORE_VIEW_DIRS[textgen]="/opt/text-generation-webui/user_data/models"
+    elif [[ -d /opt/text-generation-webui/models ]]; then
+        LLM_STORE_VIEW_DIRS[textgen]="/opt/text-generation-webui/models"
+    fi
+    if command -v ollama &>/dev/null && [[ -d "$LLM_OLLAMA_MODELS" ]]; then
+        LLM_STORE_VIEW_DIRS[ollama]="${LLM_OLLAMA_MODELS}/blobs"
+    fi
+}
+
+# Path of a model's view in one backend directory
+# Args: $1 = label, $2 = model name, $3 = sha256
+# Output: path
+llm_store_view_path() {
+    local dir="${LLM_STORE_VIEW_DIRS[$1]}"
+    case "$1" in
+        ollama)   echo "${dir}/sha256-$3" ;;
+        lmstudio) echo "${dir}/$2/$2.gguf" ;;
+        *)        echo "${dir}/$2.gguf" ;;
+    esac
+}
+
+# Hardlink a blob to a path, replacing what is there
+# Args: $1 = blob, $2 = destination
+# Returns: 0 if hardlinked, 1 if only a symlink was possible (another filesystem)
+llm_store_link() {
+    local blob="$1" dest="$2"
+    mkdir -p "${dest%/*}"
+    [[ "$dest" -ef "$blob" ]] && return 0
+    if ln -f "$blob" "${dest}.gz302-link" 2>/dev/null; then
+        mv -f "${dest}.gz302-link" "$dest"
+        return 0
+    fi
+    ln -sfn "$blob" "$dest"
+    return 1
+}
+
+# Serialise index.tsv updates: two imports (or an import and gc) finishing
+# together would otherwise lose one of the rewrites
+# Sets: LLM_STORE_LOCK_FD
+# Returns: 0 when locked, 1 on timeout
+llm_store_lock() {
+    mkdir -p "$LLM_MODEL_STORE"
+    exec {LLM_STORE_LOCK_FD}>>"${LLM_MODEL_STORE}/.index.lock"
+    if ! flock -w 60 "$LLM_STORE_LOCK_FD"; then
+        error "Another models command is still running"
+        exec {LLM_STORE_LOCK_FD}>&-
+        return 1
+    fi
+}
+
+llm_store_unlock() {
+    exec {LLM_STORE_LOCK_FD}>&-
+}
+
+# Look up a model in the index
+# Args: $1 = name
+# Sets: LLM_STORE_SHA, LLM_STORE_SIZE
+# Returns: 0 if indexed, 1 if not
+llm_store_lookup() {
+    local name sha size _source
+    LLM_STORE_SHA=""
+    LLM_STORE_SIZE=""
+    [[ -f "${LLM_MODEL_STORE}/index.tsv" ]] || return 1
+    while IFS=$'\t' read -r name sha size _source; do
+        if [[ "$name" == "$1" ]]; then
+            LLM_STORE_SHA="$sha"
+            LLM_STORE_SIZE="$size"
+            return 0
+        fi
+    done < "${LLM_MODEL_STORE}/index.tsv"
+    return 1
+}
+
+# Create the backend views of a stored model
+# Args: $1 = name, $2 = sha256
+llm_store_publish() {
+    local name="$1" sha="$2"
+    local blob="${LLM_MODEL_STORE}/blobs/sha256-${sha}"
+    local label dest
+    llm_store_view_dirs
+    for label in "${!LLM_STORE_VIEW_DIRS[@]}"; do
+        dest=$(llm_store_view_path "$label" "$name" "$sha")
+        if ! llm_store_link "$blob" "$dest"; then
+            # Ollama must own a real file; its create would copy the blob instead
+            if [[ "$label" == "ollama" ]]; then
+                rm -f "$dest"
+                warning "Ollama models are on another filesystem; it will keep its own copy of $name"
+            else
+                warning "$label: symlinked $name (the models are on another filesystem)"
+            fi
+        fi
+        # Directories only: the files share the store's inode
+        if [[ "$label" == "lmstudio" ]]; then
+            chown "$(get_real_user):" "${LLM_STORE_VIEW_DIRS[lmstudio]}" "${dest%/*}" 2>/dev/null || true
+        fi
+    done
+
+    if [[ -n "${LLM_STORE_VIEW_DIRS[ollama]:-}" ]]; then
+        local modelfile
+        modelfile=$(mktemp /tmp/gz302-modelfile.XXXXXX)
+        echo "FROM ${blob}" > "$modelfile"
+        if ! OLLAMA_HOST="$LLM_OLLAMA_URL" ollama create "$name" -f "$modelfile" >/dev/null 2>&1; then
+            warning "ollama create $name failed (is the service running?)"
+        fi
+        rm -f "$modelfile"
+    fi
+}
+
+# Remove the backend views of a model
+# Args: $1 = name, $2 = sha256
+llm_store_unpublish() {
+    local name="$1" sha="$2"
+    local blob="${LLM_MODEL_STORE}/blobs/sha256-${sha}"
+    local label dest
+    llm_store_view_dirs
+    for label in "${!LLM_STORE_VIEW_DIRS[@]}"; do
+        # Ollama drops its blob itself once no model uses it
+        [[ "$label" == "ollama" ]] && continue
+        dest=$(llm_store_view_path "$label" "$name" "$sha")
+        [[ "$dest" -ef "$blob" ]] && rm -f "$dest"
+    done
+    rmdir "${LLM_STORE_VIEW_DIRS[lmstudio]:-/nonexistent}/${name}" 2>/dev/null || true
+    if [[ -n "${LLM_STORE_VIEW_DIRS[ollama]:-}" ]]; then
+        OLLAMA_HOST="$LLM_OLLAMA_URL" ollama rm "$name" >/dev/null 2>&1 || true
+    fi
+}
+
+# gz302-llm.sh models import PATH|URL [--name NAME] [--sha256 SUM] [--replace]
+# --replace turns PATH itself into a hardlink to the stored copy
+llm_store_import() {
+    local src="" name="" expected="" replace=false
+    while [[ $# -gt 0 ]]; do
+        case "$1" in
+            --name)    name="${2:-}"; shift ;;
+            --sha256)  expected="${2:-}"; shift ;;
+            --replace) replace=true ;;
+            -*)        error "Unknown option: $1"; return 1 ;;
+            *)         src="$1" ;;
+        esac
+        shift
+    done
+    if [[ -z "$src" ]]; then
+        error "Usage: $0 models import PATH|URL [--name NAME] [--sha256 SUM] [--replace]"
+        return 1
+    fi
+    local origin="$src"
+    [[ -n "$name" ]] || { name="${src##*/}"; name="${name%%\?*}"; name="${name%.gguf}"; }
+    name="${name,,}"
+    name="${name//[^a-z0-9._-]/-}"
+    # The name becomes a file name in every view directory
+    if [[ -z "$name" || "$name" == .* ]]; then
+        error "Invalid model name '${name}': it must not be empty or start with '.' (use --name)"
+        return 1
+    fi
+
+    local blobs="${LLM_MODEL_STORE}/blobs"
+    mkdir -p "$blobs"
+    local part="" sum
+    if [[ "$src" == http://* || "$src" == https://* ]]; then
+        # Straight into the store: fetch_file would keep a second copy in its cache
+        part="${blobs}/.part-$(printf '%s' "$src" | sha256sum | cut -c1-16)"
+        info "Downloading ${src##*/}..."
+        if ! fetch_download "$src" "$part" resume; then
+            error "Download failed: $src (run again to resume)"
+            return 1
+        fi
+        src="$part"
+        replace=false
+    elif [[ ! -f "$src" ]]; then
+        error "Model not found: $src"
+        return 1
+    fi
+
+    if [[ "$(head -c 4 "$src")" != "GGUF" ]]; then
+        error "Not a GGUF file: $src"
+        [[ -z "$part" ]] || rm -f "$part"
+        return 1
+    fi
+    info "Hashing ${src##*/}..."
+    sum=$(sha256sum "$src")
+    sum="${sum%% *}"
+    if [[ -n "$expected" && "$sum" != "${expected,,}" ]]; then
+        error "Checksum mismatch (expected ${expected:0:12}, got ${sum:0:12})"
+        [[ -z "$part" ]] || rm -f "$part"
+        return 1
+    fi
+
+    # From here on gc must not see the blob without its index line
+    llm_store_lock || { [[ -z "$part" ]] || rm -f "$part"; return 1; }
+    local blob="${blobs}/sha256-${sum}"
+    if [[ -f "$blob" ]]; then
+        info "Already stored as sha256-${sum:0:12}"
+        [[ -z "$part" ]] || rm -f "$part"
+    elif [[ -n "$part" ]]; then
+        mv -f "$part" "$blob"
+        chmod a+r "$blob"
+    elif ! ln "$src" "$blob" 2>/dev/null; then
+        # Another filesystem: this is the one copy the store keeps
+        cp --reflink=auto "$src" "${blob}.part" && mv -f "${blob}.part" "$blob" || {
+            rm -f "${blob}.part"
+            llm_store_unlock
+            error "Could not copy $src into $LLM_MODEL_STORE"
+            return 1
+        }
+        chmod a+r "$blob"
+    else
+        # A hardlink shares the mode of the user's file: a private model
+        # stays private (and out of reach of the backends' service users)
+        [[ "$(stat -c %A "$blob")" == ???????r?? ]] || \
+            warning "$src is not world-readable; backends running as other users cannot load it"
+    fi
+    if [[ "$replace" == true ]] && ! [[ "$src" -ef "$blob" ]]; then
+        if ln -f "$blob" "${src}.gz302-link" 2>/dev/null; then
+            mv -f "${src}.gz302-link" "$src"
+            info "Replaced $src with a link to the store"
+        else
+            warning "$src is on another filesystem; remove it to free the space"
+        fi
+    fi
+
+    # Re-importing a name points it at the new content
+    local old_sha=""
+    if llm_store_lookup "$name"; then
+        old_sha="$LLM_STORE_SHA"
+        [[ "$old_sha" == "$sum" ]] || llm_store_unpublish "$name" "$old_sha"
+        local index="${LLM_MODEL_STORE}/index.tsv"
+        awk -F'\t' -v n="$name" '$1 != n' "$index" > "${index}.tmp" && mv -f "${index}.tmp" "$index"
+    fi
+    printf '%s\t%s\t%s\t%s\n' "$name" "$sum" "$(stat -c %s "$blob")" "$origin" >> "${LLM_MODEL_STORE}/index.tsv"
+    llm_store_publish "$name" "$sum"
+    llm_store_unlock
+    success "Imported $name (sha256-${sum:0:12})"
+    info "llama.cpp: llama-server -m ${LLM_MODEL_STORE}/gguf/${name}.gguf"
+    [[ -z "$old_sha" || "$old_sha" == "$sum" ]] || info "The previous content stays until: $0 models gc"
+}
+
+# gz302-llm.sh models list
+llm_store_list() {
+    local index="${LLM_MODEL_STORE}/index.tsv"
+    if [[ ! -s "$index" ]]; then
+        info "No models in $LLM_MODEL_STORE (add one: $0 models import PATH|URL)"
+        return 0
+    fi
+    llm_store_view_dirs
+    local name sha size _source label views blob
+    printf '%-40s %9s  %-12s %s\n' NAME "SIZE GiB" SHA256 VIEWS
+    while IFS=$'\t' read -r name sha size _source; do
+        blob="${LLM_MODEL_STORE}/blobs/sha256-${sha}"
+        views=""
+        for label in llama.cpp lmstudio textgen ollama; do
+            [[ -n "${LLM_STORE_VIEW_DIRS[$label]:-}" ]] || continue
+            [[ "$(llm_store_view_path "$label" "$name" "$sha")" -ef "$blob" ]] && views+="${views:+,}${label}"
+        done
+        [[ -f "$blob" ]] || views="MISSING"
+        printf '%-40s %9s  %-12s %s\n' "${name:0:40}" \
+            "$(awk -v b="$size" 'BEGIN { printf "%.1f", b / 1073741824 }')" "${sha:0:12}" "${views:--}"
+    done < "$index"
+    echo
+    info "On disk: $(du -sh "${LLM_MODEL_STORE}/blobs" 2>/dev/null | cut -f1) (each model stored once)"
+}
+
+# gz302-llm.sh models remove NAME
+llm_store_remove() {
+    local name="${1:-}"
+    llm_store_lock || return 1
+    if ! llm_store_lookup "$name"; then
+        llm_store_unlock
+        error "No model named '${name}' (see: $0 models list)"
+        return 1
+    fi
+    llm_store_unpublish "$name" "$LLM_STORE_SHA"
+    local index="${LLM_MODEL_STORE}/index.tsv"
+    awk -F'\t' -v n="$name" '$1 != n' "$index" > "${index}.tmp" && mv -f "${index}.tmp" "$index"
+    llm_store_unlock
+    success "Removed $name (space is freed by: $0 models gc)"
+}
+
+# gz302-llm.sh models gc
+# Relinks duplicate copies in the backend directories to the stored blob and
+# deletes blobs no model refers to
+llm_store_gc() {
+    local blobs="${LLM_MODEL_STORE}/blobs"
+    [[ -d "$blobs" ]] || { info "The model store is empty"; return 0; }
+    # An import between reading the index and deleting blobs would lose its blob
+    llm_store_lock || return 1
+    local -A used=() by_size=()
+    local name sha size _source blob freed=0
+    if [[ -f "${LLM_MODEL_STORE}/index.tsv" ]]; then
+        while IFS=$'\t' read -r name sha size _source; do
+            used[$sha]=1
+        done < "${LLM_MODEL_STORE}/index.tsv"
+    fi
+
+    # Views of names that were removed or re-imported
+    local view
+    for view in "${LLM_MODEL_STORE}"/gguf/*.gguf; do
+        [[ -e "$view" ]] || continue
+        name="${view##*/}"
+        if ! llm_store_lookup "${name%.gguf}" || ! [[ "$view" -ef "${blobs}/sha256-${LLM_STORE_SHA}" ]]; then
+            rm -f "$view"
+        fi
+    done
+
+    for blob in "$blobs"/sha256-*; do
+        [[ -f "$blob" ]] || continue
+        sha="${blob##*/sha256-}"
+        if [[ -z "${used[$sha]:-}" ]]; then
+            freed=$((freed + $(stat -c %s "$blob")))
+            rm -f "$blob"
+        else
+            # Models can share a size: keep every hash for it
+            size=$(stat -c %s "$blob")
+            by_size[$size]+="${by_size[$size]:+ }$sha"
+        fi
+    done
+    rm -f "$blobs"/.part-*
+
+    # Copies the backends made themselves: only same-size files are hashed
+    llm_store_view_dirs
+    local label dir file file_sha candidate
+    for label in "${!LLM_STORE_VIEW_DIRS[@]}"; do
+        dir="${LLM_STORE_VIEW_DIRS[$label]}"
+        [[ "$label" == "lmstudio" ]] && dir="${dir%/gz302}"
+        [[ -d "$dir" ]] || continue
+        while IFS= read -r -d '' file; do
+            size=$(stat -c %s "$file")
+            [[ -n "${by_size[$size]:-}" ]] || continue
+            sha=""
+            for candidate in ${by_size[$size]}; do
+                [[ "$file" -ef "${blobs}/sha256-${candidate}" ]] && continue 2
+                # Ollama names its blobs by hash
+                [[ "$label" == "ollama" && "${file##*/}" == "sha256-${candidate}" ]] && sha="$candidate"
+            done
+            if [[ -z "$sha" ]]; then
+                # Hashed once, however many stored models share the size
+                [[ "$(head -c 4 "$file")" == "GGUF" ]] || continue
+                file_sha=$(sha256sum "$file" | cut -d' ' -f1)
+                [[ " ${by_size[$size]} " == *" $file_sha "* ]] || continue
+                sha="$file_sha"
+            fi
+            blob="${blobs}/sha256-${sha}"
+            # Hardlinks only: a copy on another filesystem is left alone
+            if ln -f "$blob" "${file}.gz302-link" 2>/dev/null && mv -f "${file}.gz302-link" "$file"; then
+                freed=$((freed + size))
+                info "Deduplicated ${file}"
+            fi
+        done < <(find "$dir" -type f \( -name '*.gguf' -o -name 'sha256-*' \) -print0 2>/dev/null)
+    done
+
+    llm_store_unlock
+    success "Freed $(awk -v b="$freed" 'BEGIN { printf "%.1f", b / 1073741824 }') GiB"
+}
+
+# gz302-llm.sh models import|list|remove|gc
+llm_models_command() {
+    case "${1:-list}" in
+        import) shift; llm_store_import "$@" ;;
+        list)   llm_store_list ;;
+        remove) llm_store_remove "${2:-}" ;;
+        gc)     llm_store_gc ;;
+        *)
+            echo "Usage: $0 models [import PATH|URL [--name NAME] [--sha256 SUM] [--replace] | list | remove NAME | gc]"
+            return 1
+            ;;
+    esac
+}
+
 # =============================================================================
 # MENU FUNCTIONS
 # =============================================================================
@@ -642,6 +1914,32 @@ ask_libraries() {
     fi
 }
 
+ask_benchmark() {
+    command -v llama-bench &>/dev/null || command -v ollama &>/dev/null || return 0
+    echo
+    print_section "Step 5: Backend Benchmark"
+    echo
+    echo "Measure the installed backends on a small model (downloads ~400 MB)"
+    echo "and point the frontends at the fastest one?"
+    echo
+    read -r -p "Run the benchmark? (y/N): " choice || choice="n"
+    
+    if [[ "$choice" =~ ^[Yy] ]]; then
+        llm_bench || warning "Benchmark did not complete"
+    else
+        info "Later: sudo $0 bench"
+    fi
+}
+
+ask_unified_memory() {
+    echo
+    print_section "Step 4: GPU Memory for Large Models"
+    echo
+    echo "The iGPU maps system RAM through GTT, which the kernel caps at half"
+    echo "of RAM. Models larger than that fail to load or run on the CPU."
+    configure_unified_memory
+}
+
 show_summary() {
     echo
     print_box "Installation Complete"
@@ -652,7 +1950,7 @@ show_summary() {
     command -v lemonade-server &>/dev/null && echo "  ✓ Lemonade SDK: lemonade-desktop"
     command -v ollama &>/dev/null && echo "  ✓ Ollama: ollama run llama3.2"
     [[ -f "$LMSTUDIO_APPIMAGE" ]] && echo "  ✓ LM Studio: $LMSTUDIO_APPIMAGE"
-    command -v llama-cli &>/dev/null && echo "  ✓ llama.cpp: llama-cli / llama-server"
+    command -v llama-cli &>/dev/null && echo "  ✓ llama.cpp: llama-cli / llama-server ($(readlink "${LLAMACPP_ROOT}/current" 2>/dev/null || echo system))"
     [[ -d "$VLLM_VENV" ]] && echo "  ✓ vLLM: source ${VLLM_VENV}/activate-vllm"
     
     # Frontends
@@ -664,6 +1962,13 @@ show_summary() {
     # Libraries
     [[ -d "${HOME}/.gz302-ai" ]] && echo "  ✓ Python AI: source ~/.gz302-ai/activate-ai"
     
+    # GPU memory
+    [[ -f /etc/modprobe.d/gz302-gtt.conf ]] && echo "  ✓ GPU memory plan: gz302-gpu memory"
+    [[ -s "${LLM_MODEL_STORE}/index.tsv" ]] && echo "  ✓ Model store: $(wc -l < "${LLM_MODEL_STORE}/index.tsv") models (sudo $0 models list)"
+    if [[ -f "$LLM_BACKEND_CONF" ]]; then
+        echo "  ✓ Fastest backend: $(sed -n 's/^BACKEND=//p' "$LLM_BACKEND_CONF") (results: $LLM_BENCH_RESULTS)"
+    fi
+    
     echo
     info "GPU configured for AMD Radeon 8060S (Strix Halo)"
     echo
@@ -676,6 +1981,34 @@ main() {
         exit 1
     fi
     
+    # Subcommands: bench, build, use BUILD, builds, models
+    case "${1:-}" in
+        bench)
+            shift
+            configure_amd_gpu_env
+            llm_bench "$@"
+            return
+            ;;
+        build)
+            shift
+            llamacpp_build_command "$@"
+            return
+            ;;
+        use)
+            llamacpp_use "${2:-}"
+            return
+            ;;
+        builds)
+            llamacpp_list
+            return
+            ;;
+        models)
+            shift
+            llm_models_command "$@"
+            return
+            ;;
+    esac
+    
     print_box "GZ302 LLM/AI Module v${LLM_VERSION}"
     echo
     
@@ -686,6 +2019,8 @@ main() {
     ask_backends
     ask_frontends
     ask_libraries
+    ask_unified_memory
+    ask_benchmark
     
     # Summary
     show_summary
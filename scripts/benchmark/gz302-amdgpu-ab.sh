@@ -0,0 +1,728 @@
+#!/bin/bash
+# shellcheck disable=SC1091
+set -euo pipefail
+
+# ==============================================================================
+# GZ302 amdgpu Parameter A/B Harness
+# Version: 1.0.0
+#
+# Measures whether the amdgpu module options in /etc/modprobe.d/amdgpu.conf
+# are still needed on the running kernel, and what they cost. The installer
+# disables GFXOFF (ppfeaturemask bit 15) and CWSR (cwsr_enable=0) against
+# hangs seen on early 2026 kernels. GFXOFF off costs idle power on every boot.
+#
+# Each candidate is the installed amdgpu.conf with some options replaced or
+# removed. amdgpu drives the panel on this APU, so it cannot be reloaded in a
+# running session: every candidate needs a boot. "plan" writes the first
+# candidate and rebuilds the initramfs. After each reboot, "run" checks that
+# the booted parameters match the candidate. It then measures idle power
+# (battery and SoC socket power), runs a GPU stress loop and counts ring
+# timeouts, resets and page faults in the kernel log. Finally it queues the
+# next candidate. A run that started but never finished is recorded as a hang
+# on the next boot, and the candidate's remaining rounds are dropped. When the
+# queue is empty the original amdgpu.conf is put back and the report is
+# printed.
+#
+# Rounds interleave the candidates in a rotated order so that battery wear
+# and ambient temperature affect all of them alike.
+#
+# Usage:
+#   sudo scripts/benchmark/gz302-amdgpu-ab.sh plan                 # current gfxoff cwsr stock
+#   sudo scripts/benchmark/gz302-amdgpu-ab.sh plan -c current -c gfxoff -r 3 --reboot
+#   sudo -E scripts/benchmark/gz302-amdgpu-ab.sh run --reboot      # after each boot, on battery
+#   scripts/benchmark/gz302-amdgpu-ab.sh status
+#   scripts/benchmark/gz302-amdgpu-ab.sh report /var/log/gz302/amdgpu-ab/*.tsv
+#   sudo scripts/benchmark/gz302-amdgpu-ab.sh abort                # restore amdgpu.conf
+# ==============================================================================
+
+BENCH_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+LIB_DIR="$(cd "$BENCH_DIR/../.." && pwd)/gz302-lib"
+[[ -d "$LIB_DIR" ]] || LIB_DIR="/usr/local/share/gz302/gz302-lib"
+
+MODPROBE_CONF="/etc/modprobe.d/amdgpu.conf"
+STATE_DIR="/var/lib/gz302/amdgpu-ab"
+OUTPUT_DIR="/var/log/gz302/amdgpu-ab"
+
+# Candidate presets: comma-separated option overrides, "-" removes the option
+# so the driver default applies. "current" is the installed file unchanged.
+declare -A PRESETS=(
+    [current]=""
+    [gfxoff]="ppfeaturemask=0xffffffff"
+    [cwsr]="cwsr_enable=1"
+    [stock]="ppfeaturemask=-,cwsr_enable=-"
+)
+DEFAULT_CANDIDATES="current gfxoff cwsr stock"
+
+ROUNDS=2
+SETTLE_S=120
+IDLE_S=120
+STRESS_S=300
+STRESS_CMD=""
+REBOOT=false
+
+# Kernel log lines that count as GPU instability
+GPU_ERROR_RE='amdgpu.*(timeout|timed out|gpu reset|gpu recovery|mes failed|page fault|protection_fault|hang)'
+
+usage() {
+    cat <<'USAGE'
+Usage: gz302-amdgpu-ab.sh plan [-c CANDIDATE]... [-r N] [--reboot]
+       gz302-amdgpu-ab.sh run [--settle S] [--idle S] [--stress S] [--stress-cmd CMD] [--reboot]
+       gz302-amdgpu-ab.sh status | abort
+       gz302-amdgpu-ab.sh report FILE...
+
+Candidates (-c, repeatable; default: current gfxoff cwsr stock):
+  current                    Installed amdgpu.conf unchanged (the baseline)
+  gfxoff                     GFXOFF allowed (ppfeaturemask=0xffffffff)
+  cwsr                       CWSR enabled (cwsr_enable=1)
+  stock                      Driver defaults for ppfeaturemask and cwsr_enable
+  LABEL:KEY=VAL[,KEY=VAL]    Custom overrides; VAL "-" removes the option
+
+Options:
+  -r, --rounds N       Boots per candidate, interleaved (default: 2)
+      --settle S       Seconds to wait after login before measuring (default: 120)
+      --idle S         Idle measurement seconds (default: 120)
+      --stress S       GPU stress seconds (default: 300)
+      --stress-cmd CMD Stress command, restarted until time is up
+                       (default: glmark2 --run-forever, vkmark or vkcube)
+      --reboot         Reboot into the next candidate without asking
+  -h, --help           Show this help
+
+Run "run" on battery from the desktop session after each boot; the stress
+command needs the session's display.
+USAGE
+}
+
+COMMAND="${1:-}"
+[[ $# -gt 0 ]] && shift
+ORIG_ARGS=("$@")
+
+declare -a CANDIDATE_ARGS=() REPORT_FILES=()
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        -c|--candidate) CANDIDATE_ARGS+=("$2"); shift 2 ;;
+        -r|--rounds) ROUNDS="$2"; shift 2 ;;
+        --settle) SETTLE_S="$2"; shift 2 ;;
+        --idle) IDLE_S="$2"; shift 2 ;;
+        --stress) STRESS_S="$2"; shift 2 ;;
+        --stress-cmd) STRESS_CMD="$2"; shift 2 ;;
+        --reboot) REBOOT=true; shift ;;
+        -h|--help) usage; exit 0 ;;
+        *)
+            if [[ "$COMMAND" == "report" ]]; then
+                REPORT_FILES+=("$1"); shift
+            else
+                echo "Unknown option: $1" >&2; usage >&2; exit 2
+            fi
+            ;;
+    esac
+done
+
+for value in "$ROUNDS" "$SETTLE_S" "$IDLE_S" "$STRESS_S"; do
+    [[ "$value" =~ ^[0-9]+$ ]] || { echo "ERROR: '$value' is not a number of rounds/seconds" >&2; exit 2; }
+done
+
+# --- Report ---
+
+# Summarise result files per kernel and candidate: boots, hangs, GPU errors,
+# idle and stress power, and the idle difference to the kernel's first
+# candidate with a 95% Welch confidence interval
+# Args: result files
+report() {
+    awk -F '\t' '
+        function tcrit(df) {
+            if (df < 1) return 0
+            if (df > 30) return 1.96
+            return T[int(df)]
+        }
+        function ci(g, key,    m, v) {
+            if (cnt[key, g] < 2) return 0
+            m = s[key, g] / cnt[key, g]
+            v = (q[key, g] - cnt[key, g] * m * m) / (cnt[key, g] - 1)
+            return v > 0 ? tcrit(cnt[key, g] - 1) * sqrt(v / cnt[key, g]) : 0
+        }
+        function add(g, key, val) {
+            if (val == "" || val == "-") return
+            cnt[key, g]++; s[key, g] += val; q[key, g] += val * val
+        }
+        function mean(g, key) { return cnt[key, g] ? s[key, g] / cnt[key, g] : -1 }
+        function w(g, key) {
+            return cnt[key, g] ? sprintf("%.2f±%.2f", mean(g, key) / 1000, ci(g, key) / 1000) : "-"
+        }
+        BEGIN {
+            split("12.706 4.303 3.182 2.776 2.571 2.447 2.365 2.306 2.262 2.228 " \
+                  "2.201 2.179 2.160 2.145 2.131 2.120 2.110 2.101 2.093 2.086 " \
+                  "2.080 2.074 2.069 2.064 2.060 2.056 2.052 2.048 2.045 2.042", T, " ")
+        }
+        /^#/ || NF < 13 { next }
+        {
+            kernel = $1; label = $2
+            if (!(kernel in seen_kernel)) { seen_kernel[kernel] = 1; kernels[++nk] = kernel }
+            g = kernel SUBSEP label
+            if (!(g in boots)) { order[kernel, ++nl[kernel]] = label; params[g] = $3 }
+            boots[g]++
+            if ($13 == "hung") hung[g]++
+            if ($13 == "mismatch") mism[g]++
+            if ($10 != "-") errors[g] += $10 + 0
+            if ($11 != "-") errors[g] += $11 + 0
+            if ($12 != "-" && $12 + 0 > 0) fails[g] += $12
+            if ($13 == "ok" || $13 == "errors") {
+                add(g, "ib", $6); add(g, "is", $7); add(g, "ss", $8); add(g, "sc", $9)
+            }
+        }
+        END {
+            if (nk == 0) { print "No results found"; exit 1 }
+            for (k = 1; k <= nk; k++) {
+                kernel = kernels[k]
+                base = kernel SUBSEP order[kernel, 1]
+                printf "Kernel %s\n", kernel
+                printf "  %-10s %5s %5s %6s %13s %13s %13s %7s  %s\n", "CANDIDATE", "BOOTS", "HUNG", "ERRORS", \
+                    "IDLE_BAT_W", "IDLE_SOC_W", "STRESS_SOC_W", "GFXCLK", "IDLE DELTA_W (95% CI)"
+                for (i = 1; i <= nl[kernel]; i++) {
+                    label = order[kernel, i]; g = kernel SUBSEP label
+                    key = cnt["ib", base] ? "ib" : "is"
+                    delta = "-"
+                    if (i > 1 && cnt[key, g] && cnt[key, base]) {
+                        d = (mean(g, key) - mean(base, key)) / 1000
+                        if (cnt[key, g] > 1 && cnt[key, base] > 1) {
+                            # Welch: combine the variances of the two means
+                            va = (q[key, g] - cnt[key, g] * mean(g, key) ^ 2) / (cnt[key, g] - 1) / cnt[key, g]
+                            vb = (q[key, base] - cnt[key, base] * mean(base, key) ^ 2) / (cnt[key, base] - 1) / cnt[key, base]
+                            if (va < 0) va = 0
+                            if (vb < 0) vb = 0
+                            df = (va + vb) > 0 ? (va + vb) ^ 2 / (va * va / (cnt[key, g] - 1) + vb * vb / (cnt[key, base] - 1)) : 30
+                            h = tcrit(df) * sqrt(va + vb) / 1000
+                            delta = sprintf("%+.2f [%+.2f, %+.2f]", d, d - h, d + h)
+                        } else {
+                            delta = sprintf("%+.2f (n<2, no CI)", d)
+                        }
+                    }
+                    printf "  %-10s %5d %5d %6d %13s %13s %13s %7s  %s\n", label, boots[g], hung[g], errors[g], \
+                        w(g, "ib"), w(g, "is"), w(g, "ss"), \
+                        cnt["sc", g] ? sprintf("%.0f", mean(g, "sc")) : "-", delta
+                }
+                for (i = 1; i <= nl[kernel]; i++) {
+                    label = order[kernel, i]; g = kernel SUBSEP label
+                    printf "  %-10s %s\n", label ":", params[g]
+                    if (mism[g]) printf "  %-10s ⚠ %d boot(s) did not have the candidate parameters\n", "", mism[g]
+                    if (fails[g]) printf "  %-10s ⚠ stress command failed %d time(s)\n", "", fails[g]
+                }
+                print ""
+            }
+            print "A candidate is only safe to adopt with zero hangs and errors over several boots."
+        }
+    ' "$@"
+}
+
+if [[ "$COMMAND" == "report" ]]; then
+    [[ ${#REPORT_FILES[@]} -gt 0 ]] || { echo "ERROR: report needs result files" >&2; exit 2; }
+    report "${REPORT_FILES[@]}"
+    exit $?
+fi
+
+# --- State ---
+# plan.tsv    label<TAB>overrides
+# queue.tsv   round<TAB>label, head = candidate written to amdgpu.conf
+# running     boot_id<TAB>round<TAB>label while "run" is measuring
+# results     path of this plan's result file
+
+# Read the plan and queue
+# Sets: PLAN (label -> overrides), PLAN_ORDER, QUEUE (round<TAB>label lines),
+#       RESULT_FILE
+load_state() {
+    local label overrides line
+    declare -gA PLAN=()
+    declare -ga PLAN_ORDER=() QUEUE=()
+    RESULT_FILE=""
+    [[ -r "$STATE_DIR/plan.tsv" ]] || return 1
+    while IFS=$'\t' read -r label overrides; do
+        PLAN[$label]="$overrides"
+        PLAN_ORDER+=("$label")
+    done < "$STATE_DIR/plan.tsv"
+    while IFS= read -r line; do
+        [[ -n "$line" ]] && QUEUE+=("$line")
+    done < "$STATE_DIR/queue.tsv"
+    read -r RESULT_FILE < "$STATE_DIR/results"
+}
+
+save_queue() {
+    if [[ ${#QUEUE[@]} -gt 0 ]]; then
+        printf '%s\n' "${QUEUE[@]}" > "$STATE_DIR/queue.tsv"
+    else
+        : > "$STATE_DIR/queue.tsv"
+    fi
+}
+
+# --- Candidate Files ---
+
+# Write amdgpu.conf for a candidate: the original file without the options
+# the candidate overrides, then the overrides
+# Args: $1 = label, $2 = overrides
+write_candidate() {
+    local label="$1" overrides="$2"
+    local line token kept
+    local -a tokens pairs
+    local -A replaced=()
+
+    IFS=',' read -ra pairs <<< "$overrides"
+    for token in "${pairs[@]}"; do
+        replaced[${token%%=*}]=1
+    done
+
+    {
+        if [[ -f "$STATE_DIR/amdgpu.conf.orig" ]]; then
+            while IFS= read -r line || [[ -n "$line" ]]; do
+                if [[ "$line" =~ ^[[:space:]]*options[[:space:]]+amdgpu[[:space:]] ]]; then
+                    read -ra tokens <<< "$line"
+                    kept=""
+                    for token in "${tokens[@]:2}"; do
+                        [[ -n "${replaced[${token%%=*}]:-}" ]] || kept+=" $token"
+                    done
+                    [[ -n "$kept" ]] && echo "options amdgpu${kept}"
+                    continue
+                fi
+                echo "$line"
+            done < "$STATE_DIR/amdgpu.conf.orig"
+        fi
+        echo "# gz302-amdgpu-ab candidate: ${label}${overrides:+ (${overrides})}"
+        for token in "${pairs[@]}"; do
+            [[ "${token#*=}" == "-" ]] || echo "options amdgpu ${token}"
+        done
+    } > "$MODPROBE_CONF.tmp"
+    mv "$MODPROBE_CONF.tmp" "$MODPROBE_CONF"
+}
+
+# Write the queue head's candidate and rebuild the initramfs
+install_head() {
+    local round label
+    IFS=$'\t' read -r round label <<< "${QUEUE[0]}"
+    write_candidate "$label" "${PLAN[$label]}"
+    if ! GZ302_GPU_INITRAMFS_DONE=false gpu_regenerate_initramfs >/dev/null; then
+        echo "ERROR: could not rebuild the initramfs; amdgpu options apply from there at boot" >&2
+        return 1
+    fi
+    echo "Next boot: round $round, candidate '$label'${PLAN[$label]:+ (${PLAN[$label]})}"
+}
+
+# Put the original amdgpu.conf back and rebuild the initramfs
+restore_original() {
+    if [[ -f "$STATE_DIR/amdgpu.conf.orig" ]]; then
+        cp -p "$STATE_DIR/amdgpu.conf.orig" "$MODPROBE_CONF"
+    else
+        rm -f "$MODPROBE_CONF"
+    fi
+    GZ302_GPU_INITRAMFS_DONE=false gpu_regenerate_initramfs >/dev/null || \
+        echo "WARNING: rebuild the initramfs manually to restore the original amdgpu options" >&2
+    echo "Restored the original $MODPROBE_CONF"
+}
+
+next_boot() {
+    if [[ "$REBOOT" == true ]]; then
+        echo "Rebooting in 10 seconds (Ctrl+C to cancel)..."
+        sleep 10
+        systemctl reboot
+    else
+        echo "Reboot, log in, and run: sudo -E $0 run"
+    fi
+}
+
+# --- Measurement ---
+
+BATTERY=""
+for psu in /sys/class/power_supply/*; do
+    [[ -r "$psu/type" ]] || continue
+    read -r type < "$psu/type"
+    if [[ "$type" == "Battery" ]]; then
+        BATTERY="$psu"
+        break
+    fi
+done
+
+# Read the battery's discharge power
+# Sets: POWER_MW
+# Returns: 1 if the battery is not discharging or reports no power
+POWER_MW=0
+read_power() {
+    local status value current voltage
+    [[ -n "$BATTERY" ]] || return 1
+    read -r status < "$BATTERY/status" || return 1
+    [[ "$status" == "Discharging" ]] || return 1
+    if [[ -r "$BATTERY/power_now" ]]; then
+        read -r value < "$BATTERY/power_now" || return 1
+        POWER_MW=$((value / 1000))
+    else
+        read -r current < "$BATTERY/current_now" || return 1
+        read -r voltage < "$BATTERY/voltage_now" || return 1
+        POWER_MW=$((current * voltage / 1000000000))
+    fi
+    POWER_MW="${POWER_MW#-}"
+    (( POWER_MW > 0 ))
+}
+
+# Sleep without forking
+exec {SLEEP_FD}<> <(:)
+pause() {
+    read -rt "$1" -u "$SLEEP_FD" || true
+}
+
+# Count GPU error lines in a boot's kernel log
+# Args: $1 = journalctl boot offset (0 = this boot, -1 = previous)
+# Output: count, or "-" when that boot's log is not available
+count_gpu_errors() {
+    local log
+    if [[ "$1" == "0" ]]; then
+        log=$(dmesg 2>/dev/null) || { echo "-"; return 0; }
+    else
+        log=$(journalctl -k -b "$1" -q --no-pager 2>/dev/null) || { echo "-"; return 0; }
+        [[ -n "$log" ]] || { echo "-"; return 0; }
+    fi
+    grep -ciE "$GPU_ERROR_RE" <<< "$log" || true
+}
+
+# Sample battery and telemetry once per second for a duration
+# Args: $1 = seconds
+# Sets: SAMPLE_BAT_MW, SAMPLE_SOC_MW, SAMPLE_GFXCLK ("-" when never read)
+sample() {
+    local seconds="$1" i bat=0 nbat=0 soc=0 nsoc=0 clk=0 nclk=0
+    for ((i = 0; i < seconds; i++)); do
+        pause 1
+        if read_power; then
+            bat=$((bat + POWER_MW)); nbat=$((nbat + 1))
+        fi
+        gpu_read_telemetry || continue
+        if [[ -n "$GPU_SOCKET_POWER_MW" ]]; then
+            soc=$((soc + GPU_SOCKET_POWER_MW)); nsoc=$((nsoc + 1))
+        fi
+        if [[ -n "$GPU_GFXCLK_MHZ" ]]; then
+            clk=$((clk + GPU_GFXCLK_MHZ)); nclk=$((nclk + 1))
+        fi
+    done
+    SAMPLE_BAT_MW="-" SAMPLE_SOC_MW="-" SAMPLE_GFXCLK="-"
+    (( nbat > 0 )) && SAMPLE_BAT_MW=$((bat / nbat))
+    (( nsoc > 0 )) && SAMPLE_SOC_MW=$((soc / nsoc))
+    (( nclk > 0 )) && SAMPLE_GFXCLK=$((clk / nclk))
+    return 0
+}
+
+# Pick a stress command that keeps the GPU busy until killed
+# Output: command line
+default_stress_cmd() {
+    local cmd
+    for cmd in glmark2 glmark2-wayland glmark2-es2-wayland; do
+        command -v "$cmd" >/dev/null 2>&1 && { echo "$cmd --run-forever"; return 0; }
+    done
+    command -v vkmark >/dev/null 2>&1 && { echo "vkmark"; return 0; }
+    command -v vkcube >/dev/null 2>&1 && { echo "vkcube"; return 0; }
+    return 1
+}
+
+# Run the stress command as the desktop user, restarting it until time is up
+# Args: $1 = seconds
+# Sets: STRESS_FAILURES (exits other than the timeout)
+STRESS_FAILURES=0
+stress_loop() {
+    local seconds="$1" end rc child=""
+    local -a as_user=()
+    # timeout runs in its own process group, out of reach of Ctrl+C and of
+    # a kill of this subshell: pass the TERM from interrupt_run on to it
+    trap '[[ -n "$child" ]] && kill -TERM "$child" 2>/dev/null; exit 143' TERM
+    if [[ -n "${SUDO_USER:-}" ]]; then
+        as_user=(sudo -u "$SUDO_USER" --preserve-env=DISPLAY,WAYLAND_DISPLAY,XAUTHORITY,XDG_RUNTIME_DIR,XDG_SESSION_TYPE)
+    fi
+    end=$((EPOCHSECONDS + seconds))
+    while (( EPOCHSECONDS < end )); do
+        rc=0
+        "${as_user[@]}" timeout "$((end - EPOCHSECONDS))" bash -c "$STRESS_CMD" >/dev/null 2>&1 &
+        child=$!
+        wait "$child" || rc=$?
+        child=""
+        if (( rc != 0 && rc != 124 )); then
+            STRESS_FAILURES=$((STRESS_FAILURES + 1))
+            pause 2
+        fi
+    done
+    echo "$STRESS_FAILURES" > "$STATE_DIR/stress-failures"
+}
+
+# Check the booted amdgpu parameters against a candidate's overrides
+# Args: $1 = overrides
+# Sets: MISMATCH (description, empty when all match)
+check_params() {
+    local token key want have
+    local -a pairs
+    MISMATCH=""
+    IFS=',' read -ra pairs <<< "$1"
+    for token in "${pairs[@]}"; do
+        key="${token%%=*}" want="${token#*=}"
+        [[ "$want" == "-" ]] && continue
+        if ! read -r have 2>/dev/null < "/sys/module/amdgpu/parameters/$key"; then
+            MISMATCH+=" $key=unreadable"
+            continue
+        fi
+        if [[ "$want" =~ ^(0x[0-9A-Fa-f]+|-?[0-9]+)$ && "$have" =~ ^(0x[0-9A-Fa-f]+|-?[0-9]+)$ ]]; then
+            (( want == have )) && continue
+        elif [[ "$want" == "$have" ]]; then
+            continue
+        fi
+        MISMATCH+=" $key=$have"
+    done
+    MISMATCH="${MISMATCH# }"
+}
+
+# Append one boot's row to the result file
+# Args: round label idle_bat idle_soc stress_soc stress_clk boot_err stress_err failures outcome
+record() {
+    local boot_id
+    read -r boot_id < /proc/sys/kernel/random/boot_id
+    printf '%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n' \
+        "$(uname -r)" "$2" "${PLAN[$2]:-none}" "$1" "$boot_id" "$3" "$4" "$5" "$6" "$7" "$8" "$9" "${10}" \
+        >> "$RESULT_FILE"
+}
+
+# --- Commands ---
+
+require_root() {
+    if [[ ${EUID:-$(id -u)} -ne 0 ]]; then
+        exec sudo --preserve-env=DISPLAY,WAYLAND_DISPLAY,XAUTHORITY,XDG_RUNTIME_DIR,XDG_SESSION_TYPE \
+            "$0" "$COMMAND" "${ORIG_ARGS[@]}"
+    fi
+}
+
+cmd_plan() {
+    local arg label overrides token key round i n rc
+    local -a labels=() order=()
+
+    if [[ -f "$STATE_DIR/plan.tsv" ]]; then
+        echo "ERROR: a plan is already running (see: $0 status, or $0 abort)" >&2
+        exit 1
+    fi
+    [[ ${#CANDIDATE_ARGS[@]} -gt 0 ]] || read -ra CANDIDATE_ARGS <<< "$DEFAULT_CANDIDATES"
+    (( ROUNDS > 0 )) || { echo "ERROR: --rounds must be at least 1" >&2; exit 2; }
+
+    declare -gA PLAN=()
+    for arg in "${CANDIDATE_ARGS[@]}"; do
+        if [[ "$arg" == *:* ]]; then
+            label="${arg%%:*}" overrides="${arg#*:}"
+        elif [[ -n "${PRESETS[$arg]+set}" ]]; then
+            label="$arg" overrides="${PRESETS[$arg]}"
+        else
+            echo "ERROR: unknown candidate '$arg' (presets: ${!PRESETS[*]}, or LABEL:KEY=VAL)" >&2
+            exit 2
+        fi
+        [[ "$label" =~ ^[A-Za-z0-9_.-]+$ ]] || { echo "ERROR: invalid label '$label'" >&2; exit 2; }
+        [[ -z "${PLAN[$label]+set}" ]] || { echo "ERROR: duplicate candidate '$label'" >&2; exit 2; }
+        IFS=',' read -ra order <<< "$overrides"
+        for token in "${order[@]}"; do
+            key="${token%%=*}"
+            if [[ ! "$token" =~ ^[a-z_0-9]+=[^[:space:]]+$ ]]; then
+                echo "ERROR: '$token' is not KEY=VALUE" >&2
+                exit 2
+            fi
+            # modinfo may be unavailable (rc 2); only a definite "absent" is fatal
+            rc=0
+            kernel_module_has_param amdgpu "$key" || rc=$?
+            if (( rc == 1 )); then
+                echo "ERROR: amdgpu has no parameter '$key'" >&2
+                exit 2
+            fi
+        done
+        PLAN[$label]="$overrides"
+        labels+=("$label")
+    done
+
+    mkdir -p "$STATE_DIR" "$OUTPUT_DIR"
+    [[ -f "$MODPROBE_CONF" ]] && cp -p "$MODPROBE_CONF" "$STATE_DIR/amdgpu.conf.orig"
+    for label in "${labels[@]}"; do
+        printf '%s\t%s\n' "$label" "${PLAN[$label]}"
+    done > "$STATE_DIR/plan.tsv"
+
+    # Rotate the order each round so no candidate always boots first
+    QUEUE=()
+    n=${#labels[@]}
+    for ((round = 1; round <= ROUNDS; round++)); do
+        for ((i = 0; i < n; i++)); do
+            QUEUE+=("$round"$'\t'"${labels[(i + round - 1) % n]}")
+        done
+    done
+    save_queue
+    RESULT_FILE="$OUTPUT_DIR/amdgpu-ab-$(date +%Y%m%d-%H%M%S).tsv"
+    echo "$RESULT_FILE" > "$STATE_DIR/results"
+    printf '# kernel\tlabel\toverrides\tround\tboot_id\tidle_bat_mw\tidle_soc_mw\tstress_soc_mw\tstress_gfxclk_mhz\tboot_errors\tstress_errors\tstress_failures\toutcome\n' \
+        > "$RESULT_FILE"
+
+    echo "amdgpu A/B plan: ${#QUEUE[@]} boots (${#labels[@]} candidates, $ROUNDS rounds)"
+    if kernel_list_obsolete_workarounds 2>/dev/null | grep -qx gpu_stability_workarounds; then
+        echo "kernel-compat lists the GPU stability workarounds as obsolete on $(uname -r); this plan checks that."
+    fi
+    install_head || { restore_original; rm -rf "$STATE_DIR"; exit 1; }
+    next_boot
+}
+
+cmd_run() {
+    local round label boot_id run_boot run_round run_label boot_errors stress_errors outcome
+    local idle_bat idle_soc
+
+    load_state || { echo "ERROR: no plan (start one with: $0 plan)" >&2; exit 1; }
+    if [[ ${#QUEUE[@]} -eq 0 ]]; then
+        echo "The plan is complete."
+        report "$RESULT_FILE"
+        exit 0
+    fi
+    IFS=$'\t' read -r round label <<< "${QUEUE[0]}"
+    read -r boot_id < /proc/sys/kernel/random/boot_id
+
+    # A run that started in an earlier boot and never finished froze or
+    # crashed the machine under this candidate
+    if [[ -r "$STATE_DIR/running" ]]; then
+        IFS=$'\t' read -r run_boot run_round run_label < "$STATE_DIR/running"
+        if [[ "$run_boot" != "$boot_id" ]]; then
+            echo "⚠ The last run of '$run_label' (round $run_round) did not finish - recording it as a hang"
+            record "$run_round" "$run_label" - - - - "$(count_gpu_errors -1)" - "-" hung
+            rm -f "$STATE_DIR/running"
+            # This boot still has the hung candidate: do not measure it again
+            drop_candidate "$run_label"
+            advance_queue
+            return 0
+        fi
+        rm -f "$STATE_DIR/running"
+    fi
+
+    check_params "${PLAN[$label]}"
+    if [[ -n "$MISMATCH" ]]; then
+        echo "ERROR: this boot does not have candidate '$label' (${MISMATCH})." >&2
+        echo "       Rebuild the initramfs and reboot, or skip it with: $0 abort" >&2
+        record "$round" "$label" - - - - - - "-" mismatch
+        exit 1
+    fi
+    [[ -n "$STRESS_CMD" ]] || STRESS_CMD=$(default_stress_cmd) || {
+        echo "ERROR: no GPU stress command found; install glmark2 or vkmark, or pass --stress-cmd" >&2
+        exit 1
+    }
+    if [[ -z "${DISPLAY:-}${WAYLAND_DISPLAY:-}" ]]; then
+        echo "WARNING: no display session in the environment; run with sudo -E from the desktop" >&2
+    fi
+    read_power || echo "NOTE: not on battery - idle power comes from the SoC sensor only"
+
+    printf '%s\t%s\t%s\n' "$boot_id" "$round" "$label" > "$STATE_DIR/running"
+    # Ctrl+C or a shutdown is not a hang
+    trap 'interrupt_run 130' INT
+    trap 'interrupt_run 143' TERM
+    echo "Round $round, candidate '$label': settling ${SETTLE_S}s, idle ${IDLE_S}s, stress ${STRESS_S}s ($STRESS_CMD)"
+    echo "Leave the machine alone until it finishes."
+    pause "$SETTLE_S"
+
+    boot_errors=$(count_gpu_errors 0)
+    sample "$IDLE_S"
+    idle_bat="$SAMPLE_BAT_MW" idle_soc="$SAMPLE_SOC_MW"
+    echo "  idle: battery ${idle_bat} mW, SoC ${idle_soc} mW"
+
+    STRESS_FAILURES=0
+    stress_loop "$STRESS_S" &
+    sample "$STRESS_S"
+    wait || true
+    read -r STRESS_FAILURES < "$STATE_DIR/stress-failures" || STRESS_FAILURES=0
+    rm -f "$STATE_DIR/stress-failures"
+    stress_errors=$(count_gpu_errors 0)
+    [[ "$boot_errors" == "-" ]] || stress_errors=$((stress_errors - boot_errors))
+    echo "  stress: SoC ${SAMPLE_SOC_MW} mW at ${SAMPLE_GFXCLK} MHz, ${STRESS_FAILURES} command failure(s)"
+    echo "  kernel log: ${boot_errors} GPU error(s) before stress, ${stress_errors} during"
+
+    outcome=ok
+    if [[ "$boot_errors" != "-" ]] && (( boot_errors + stress_errors > 0 )); then
+        outcome=errors
+    fi
+    record "$round" "$label" "$idle_bat" "$idle_soc" "$SAMPLE_SOC_MW" "$SAMPLE_GFXCLK" \
+        "$boot_errors" "$stress_errors" "$STRESS_FAILURES" "$outcome"
+    rm -f "$STATE_DIR/running"
+    trap - INT TERM
+
+    QUEUE=("${QUEUE[@]:1}")
+    advance_queue
+}
+
+# Stop an interrupted measurement without recording it; the same candidate
+# is measured again on the next "run"
+# Args: $1 = exit status
+interrupt_run() {
+    trap - INT TERM
+    local job
+    for job in $(jobs -p); do
+        kill -TERM "$job" 2>/dev/null || true
+        wait "$job" 2>/dev/null || true
+    done
+    rm -f "$STATE_DIR/running" "$STATE_DIR/stress-failures"
+    echo
+    echo "Interrupted - nothing recorded; run again to measure '${QUEUE[0]#*$'\t'}'"
+    exit "$1"
+}
+
+# Remove every queued round of a candidate (after it hung the machine)
+# Args: $1 = label
+drop_candidate() {
+    local line dropped=0
+    local -a kept=()
+    for line in "${QUEUE[@]}"; do
+        if [[ "${line#*$'\t'}" == "$1" ]]; then
+            dropped=$((dropped + 1))
+        else
+            kept+=("$line")
+        fi
+    done
+    QUEUE=("${kept[@]}")
+    (( dropped > 0 )) && echo "Dropped '$1' from the plan (${dropped} queued boot(s))"
+    return 0
+}
+
+# Save the queue, then install the next candidate or finish the plan
+advance_queue() {
+    save_queue
+    if [[ ${#QUEUE[@]} -gt 0 ]]; then
+        install_head
+        next_boot
+    else
+        echo "All boots done."
+        restore_original
+        rm -rf "$STATE_DIR"
+        report "$RESULT_FILE"
+        echo "Results: $RESULT_FILE"
+        if [[ "$REBOOT" == true ]]; then
+            next_boot
+        fi
+    fi
+}
+
+cmd_status() {
+    local line round label
+    if ! load_state 2>/dev/null; then
+        echo "No amdgpu A/B plan is running."
+        return 0
+    fi
+    echo "amdgpu A/B plan (results: $RESULT_FILE)"
+    for label in "${PLAN_ORDER[@]}"; do
+        printf '  %-10s %s\n' "$label" "${PLAN[$label]:-installed amdgpu.conf}"
+    done
+    echo "Boots left: ${#QUEUE[@]}"
+    for line in "${QUEUE[@]}"; do
+        IFS=$'\t' read -r round label <<< "$line"
+        echo "  round $round: $label"
+    done
+    [[ -r "$RESULT_FILE" ]] && report "$RESULT_FILE" 2>/dev/null || true
+}
+
+cmd_abort() {
+    load_state || { echo "No amdgpu A/B plan is running."; return 0; }
+    restore_original
+    rm -rf "$STATE_DIR"
+    echo "Plan aborted; results so far: $RESULT_FILE"
+}
+
+case "$COMMAND" in
+    plan|run|abort) require_root ;;
+    status) ;;
+    ""|help|-h|--help) usage; exit 0 ;;
+    *) echo "Unknown command: $COMMAND" >&2; usage >&2; exit 2 ;;
+esac
+
+source "$LIB_DIR/kernel-compat.sh"
+source "$LIB_DIR/gpu-manager.sh"
+
+"cmd_${COMMAND}"
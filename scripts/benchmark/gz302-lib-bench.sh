@@ -0,0 +1,312 @@
+#!/bin/bash
+# shellcheck disable=SC2034,SC2059,SC1090
+set -euo pipefail
+
+# ==============================================================================
+# GZ302 Library Micro-Benchmark Harness
+# Version: 1.0.0
+#
+# Times every public *_get_*, *_detect_* and *_is_* helper in gz302-lib/ and
+# counts the processes each call forks. External tools (lspci, lsusb, dmesg,
+# xrandr, uname, ...) are replaced by fixture stubs and the state store is
+# pointed at a fixture tree, so numbers are comparable between machines.
+#
+# Fork counts come from the kernel's global "processes" counter in /proc/stat
+# and timings from $EPOCHREALTIME - the harness itself forks nothing while a
+# sample is being taken. The minimum fork delta over all iterations is used,
+# which filters out unrelated processes started elsewhere on the system.
+#
+# Parsers of recorded API responses (fixtures/github) are checked first; a
+# wrong result fails the run.
+#
+# Results are compared with scripts/benchmark/baselines.tsv:
+#   - more forks per call than the baseline is always a regression
+#   - a median time above baseline * tolerance (and +500us) is a regression
+#
+# Usage:
+#   scripts/benchmark/gz302-lib-bench.sh                 # compare to baselines
+#   scripts/benchmark/gz302-lib-bench.sh --update        # rewrite baselines
+#   scripts/benchmark/gz302-lib-bench.sh --filter '^kernel_' -n 50
+#   scripts/benchmark/gz302-lib-bench.sh --forks-only    # ignore timings
+# ==============================================================================
+
+BENCH_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_DIR="$(cd "$BENCH_DIR/../.." && pwd)"
+LIB_DIR="$REPO_DIR/gz302-lib"
+FIXTURE_DIR="$BENCH_DIR/fixtures"
+BASELINE_FILE="$BENCH_DIR/baselines.tsv"
+
+ITERATIONS=20
+FILTER=""
+UPDATE=false
+FORKS_ONLY=false
+TOLERANCE="3.0"
+TIME_FLOOR_US=500
+
+# Arguments passed to helpers that need them (everything else is called bare)
+declare -A BENCH_ARGS=(
+    [state_get_component_file]="wifi"
+    [state_is_applied]="wifi aspm_workaround"
+    [state_get_metadata]="wifi aspm_workaround"
+    [state_get_timestamp]="wifi aspm_workaround"
+    [state_get_component_state]="wifi"
+    [state_get_log]="10"
+    [display_get_current_refresh]="eDP-1"
+    [display_get_supported_rates]="eDP-1"
+    [is_step_completed]="hardware-fixes"
+)
+
+# Libraries in the order gz302-setup.sh loads them
+BENCH_LIBS=(
+    utils.sh
+    kernel-compat.sh
+    state-manager.sh
+    wifi-manager.sh
+    gpu-manager.sh
+    input-manager.sh
+    audio-manager.sh
+    display-fix.sh
+    display-manager.sh
+    envelope-manager.sh
+    distro-manager.sh
+)
+
+usage() {
+    cat <<'USAGE'
+Usage: gz302-lib-bench.sh [options]
+
+Options:
+  -n, --iterations N   Calls per function (default: 20)
+  -f, --filter REGEX   Only benchmark functions matching REGEX
+  -u, --update         Write results to baselines.tsv instead of comparing
+  -t, --tolerance X    Allowed slowdown factor for timings (default: 3.0)
+      --forks-only     Compare fork counts only (for noisy/shared machines)
+  -h, --help           Show this help
+USAGE
+}
+
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        -n|--iterations) ITERATIONS="$2"; shift 2 ;;
+        -f|--filter) FILTER="$2"; shift 2 ;;
+        -u|--update) UPDATE=true; shift ;;
+        -t|--tolerance) TOLERANCE="$2"; shift 2 ;;
+        --forks-only) FORKS_ONLY=true; shift ;;
+        -h|--help) usage; exit 0 ;;
+        *) echo "Unknown option: $1" >&2; usage >&2; exit 2 ;;
+    esac
+done
+
+if [[ ! -r /proc/stat ]]; then
+    echo "ERROR: /proc/stat is not readable; fork counting requires Linux procfs" >&2
+    exit 1
+fi
+
+# --- Fixture environment ---
+export GZ302_BENCH_FIXTURES="$FIXTURE_DIR"
+export GZ302_STATE_STORE_DIR="$FIXTURE_DIR/state"
+export PATH="$FIXTURE_DIR/bin:$PATH"
+export DISPLAY=":0"
+export GPU_DRM_ROOT="$FIXTURE_DIR/sys/class/drm"
+read -r GZ302_KERNEL_RELEASE < "$FIXTURE_DIR/data/uname_r.txt"
+export GZ302_KERNEL_RELEASE
+unset WAYLAND_DISPLAY SUDO_USER XDG_CURRENT_DESKTOP GZ302_KERNEL_CAPS
+# Session caches (display backend) go to a private runtime dir
+XDG_RUNTIME_DIR=$(mktemp -d /tmp/gz302-bench-run.XXXXXX)
+export XDG_RUNTIME_DIR
+trap 'rm -rf "$XDG_RUNTIME_DIR"' EXIT
+
+for lib in "${BENCH_LIBS[@]}"; do
+    source "$LIB_DIR/$lib"
+done
+
+# Libraries enable errexit/nounset; a helper tripping either must not abort
+# the run - correctness is not what is being measured here.
+set +eu
+
+# --- Measurement primitives (builtins only) ---
+
+BENCH_FORKS=0
+BENCH_NOW_US=0
+
+# Read the global fork counter from /proc/stat into BENCH_FORKS
+bench_read_forks() {
+    local key value rest
+    while read -r key value rest; do
+        if [[ "$key" == "processes" ]]; then
+            BENCH_FORKS="$value"
+            return 0
+        fi
+    done < /proc/stat
+    return 1
+}
+
+# Current wall clock in microseconds into BENCH_NOW_US
+bench_now_us() {
+    local now="$EPOCHREALTIME"
+    BENCH_NOW_US="${now/[.,]/}"
+}
+
+bench_noop() {
+    :
+}
+
+# Run one function ITERATIONS times
+# Args: $1 = function name, remaining = arguments
+# Output: "<min forks> <median us>"
+bench_function() {
+    local fn="$1"
+    shift
+    local -a times=()
+    local min_forks=-1
+    local i f0 t0 forks
+
+    for ((i = 0; i < ITERATIONS; i++)); do
+        bench_read_forks; f0="$BENCH_FORKS"
+        bench_now_us; t0="$BENCH_NOW_US"
+        "$fn" "$@" >/dev/null 2>&1 </dev/null
+        bench_now_us
+        bench_read_forks
+        forks=$((BENCH_FORKS - f0))
+        times+=($((BENCH_NOW_US - t0)))
+        if [[ $min_forks -lt 0 || $forks -lt $min_forks ]]; then
+            min_forks=$forks
+        fi
+    done
+
+    local median
+    median=$(printf '%s\n' "${times[@]}" | sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }')
+    echo "$min_forks $median"
+}
+
+# List benchmarkable functions defined by the libraries
+bench_list_functions() {
+    declare -F | awk '{ print $3 }' \
+        | grep -E '(^|_)(get|detect|is)_' \
+        | grep -v '^bench_' \
+        | { if [[ -n "$FILTER" ]]; then grep -E -- "$FILTER" || true; else cat; fi; }
+}
+
+# --- Baselines ---
+
+declare -A BASE_FORKS=()
+declare -A BASE_US=()
+
+if [[ -f "$BASELINE_FILE" ]]; then
+    while IFS=$'\t' read -r name forks us; do
+        [[ -z "$name" || "$name" == \#* ]] && continue
+        BASE_FORKS["$name"]="$forks"
+        BASE_US["$name"]="$us"
+    done < "$BASELINE_FILE"
+fi
+
+# --- Fixture checks ---
+# Parsers of fetched responses are also checked against recorded ones
+# (fixtures/github mirrors the GitHub REST API layout); a wrong answer fails
+# the run like a regression does.
+
+CHECK_FAILURES=0
+
+# Args: $1 = label, $2 = expected, $3 = actual
+bench_check() {
+    [[ "$3" == "$2" ]] && return 0
+    printf 'CHECK FAILED: %s\n  expected: %s\n  actual:   %s\n' "$1" "$2" "$3"
+    CHECK_FAILURES=$((CHECK_FAILURES + 1))
+}
+
+bench_run_checks() {
+    local GZ302_GITHUB_API="file://${FIXTURE_DIR}/github"
+    local CACHE_DIR url sum
+    CACHE_DIR=$(mktemp -d /tmp/gz302-bench-cache.XXXXXX) || return 1
+    local base="https://github.com/dahui/z13ctl/releases/download"
+
+    read -r url sum <<< "$(github_release_asset dahui/z13ctl _linux_amd64.tar.gz)"
+    bench_check "github_release_asset latest tarball" \
+        "${base}/v1.4.0/z13ctl_1.4.0_linux_amd64.tar.gz 3f2a9c4e5b6d7081920a1b2c3d4e5f60718293a4b5c6d7e8f9012345678abcde" \
+        "$url $sum"
+    read -r url sum <<< "$(github_release_asset dahui/z13ctl _amd64.deb)"
+    bench_check "github_release_asset digest of a later asset" \
+        "${base}/v1.4.0/z13ctl_1.4.0_amd64.deb 9e8d7c6b5a4f3e2d1c0b9a8f7e6d5c4b3a2f1e0d9c8b7a6f5e4d3c2b1a0f9e8d" \
+        "$url $sum"
+    read -r url sum <<< "$(github_release_asset dahui/z13ctl _linux_amd64.tar.gz v1.2.0)"
+    bench_check "github_release_asset tag without digests" \
+        "${base}/v1.2.0/z13ctl_1.2.0_linux_amd64.tar.gz " "$url $sum"
+    bench_check "github_release_asset missing asset" \
+        "" "$(github_release_asset dahui/z13ctl _arm64.deb)"
+
+    rm -rf "$CACHE_DIR"
+}
+
+bench_run_checks
+
+# --- Run ---
+
+mapfile -t FUNCTIONS < <(bench_list_functions)
+if [[ ${#FUNCTIONS[@]} -eq 0 ]]; then
+    echo "No functions matched" >&2
+    exit 1
+fi
+
+read -r overhead_forks _ <<< "$(bench_function bench_noop)"
+
+printf "%-36s %6s %10s %6s %10s  %s\n" "FUNCTION" "FORKS" "MEDIAN_US" "BASE" "BASE_US" "STATUS"
+
+declare -a RESULTS=()
+regressions=0
+
+for fn in "${FUNCTIONS[@]}"; do
+    read -ra args <<< "${BENCH_ARGS[$fn]:-}"
+    read -r forks us <<< "$(bench_function "$fn" "${args[@]}")"
+    forks=$((forks - overhead_forks))
+    [[ $forks -lt 0 ]] && forks=0
+    RESULTS+=("${fn}"$'\t'"${forks}"$'\t'"${us}")
+
+    status="ok"
+    base_forks="${BASE_FORKS[$fn]:--}"
+    base_us="${BASE_US[$fn]:--}"
+    if [[ "$base_forks" == "-" ]]; then
+        status="new"
+    elif [[ $forks -gt $base_forks ]]; then
+        status="REGRESSION (forks)"
+    elif [[ "$FORKS_ONLY" != true ]] && awk -v c="$us" -v b="$base_us" -v t="$TOLERANCE" -v f="$TIME_FLOOR_US" \
+            'BEGIN { exit !(c > b * t && c > b + f) }'; then
+        status="REGRESSION (time)"
+    elif [[ $forks -lt $base_forks ]]; then
+        status="improved"
+    fi
+    [[ "$status" == REGRESSION* ]] && regressions=$((regressions + 1))
+
+    printf "%-36s %6s %10s %6s %10s  %s\n" "$fn" "$forks" "$us" "$base_forks" "$base_us" "$status"
+done
+
+if [[ "$UPDATE" == true ]]; then
+    # Keep baselines for functions outside the current filter
+    for fn in "${FUNCTIONS[@]}"; do
+        unset "BASE_FORKS[$fn]" "BASE_US[$fn]"
+    done
+    {
+        echo "# GZ302 gz302-lib micro-benchmark baselines"
+        echo "# Regenerate with: scripts/benchmark/gz302-lib-bench.sh --update"
+        echo "# function	forks_per_call	median_us"
+        {
+            for fn in "${!BASE_FORKS[@]}"; do
+                printf '%s\t%s\t%s\n' "$fn" "${BASE_FORKS[$fn]}" "${BASE_US[$fn]}"
+            done
+            printf '%s\n' "${RESULTS[@]}"
+        } | sort
+    } > "$BASELINE_FILE"
+    echo
+    echo "Baselines written to ${BASELINE_FILE#"$REPO_DIR"/}"
+    exit 0
+fi
+
+echo
+if [[ $CHECK_FAILURES -gt 0 ]]; then
+    echo "$CHECK_FAILURES fixture check(s) failed"
+    exit 1
+fi
+if [[ $regressions -gt 0 ]]; then
+    echo "$regressions regression(s) against ${BASELINE_FILE#"$REPO_DIR"/}"
+    exit 1
+fi
+echo "No regressions (${#FUNCTIONS[@]} functions, $ITERATIONS iterations each)"
@@ -0,0 +1,405 @@
+#!/bin/bash
+# shellcheck disable=SC1091
+set -euo pipefail
+
+# ==============================================================================
+# GZ302 Panel Power A/B Benchmark
+# Version: 1.0.0
+#
+# Measures the battery cost of the OLED display workaround. The workaround
+# sets amdgpu.dcdebugmask bits that turn off PSR, PSR-SU, Panel Replay, IPS
+# and stutter.
+#
+# For each candidate mask the benchmark runs a static-desktop idle interval
+# and a scrolling interval, sampling the battery's power_now once per second.
+# It reports each mask's mean draw and its difference from the first mask,
+# with 95% confidence intervals. The CIs use Welch's t over rounds.
+#
+# Where the kernel exposes the debugfs mask, masks are switched at runtime. A
+# refresh rate bounce forces the modeset that makes the panel pick up the
+# change. Rounds interleave the masks so battery and thermal drift affect all
+# of them alike.
+#
+# Other kernels can only measure the booted mask. Boot with each candidate,
+# run the benchmark once per boot, then combine the result files with
+# --report.
+#
+# Run it on battery, from a terminal maximised on the internal panel, with
+# nothing else running and a fixed brightness.
+#
+# Usage:
+#   sudo -E scripts/benchmark/gz302-panel-power.sh
+#   sudo -E scripts/benchmark/gz302-panel-power.sh --masks "stock 0x210 fix" --rounds 5
+#   scripts/benchmark/gz302-panel-power.sh --report /var/log/gz302/panel-power/*.tsv
+# ==============================================================================
+
+BENCH_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+LIB_DIR="$(cd "$BENCH_DIR/../.." && pwd)/gz302-lib"
+[[ -d "$LIB_DIR" ]] || LIB_DIR="/usr/local/share/gz302/gz302-lib"
+
+# Bits of the display workaround (see display-fix.sh)
+FIX_BITS=$((0xe12))
+
+MASKS="stock fix"
+ROUNDS=3
+IDLE_S=60
+SCROLL_S=60
+WARMUP_S=10
+SCROLL_HZ=60
+OUTPUT_DIR="/var/log/gz302/panel-power"
+REPORT_ONLY=false
+
+usage() {
+    cat <<'USAGE'
+Usage: gz302-panel-power.sh [options]
+       gz302-panel-power.sh --report FILE...
+
+Options:
+  -m, --masks LIST     Candidate masks, first is the baseline (default: "stock fix")
+                       stock = booted mask without the fix bits (0xe12)
+                       fix   = booted mask with the fix bits
+                       boot  = the booted mask; or any value such as 0x210
+  -r, --rounds N       Rounds per mask, interleaved (default: 3)
+      --idle S         Static desktop seconds per interval (default: 60)
+      --scroll S       Scrolling seconds per interval (default: 60)
+      --warmup S       Unsampled seconds before each interval (default: 10)
+  -o, --output DIR     Where result files go (default: /var/log/gz302/panel-power)
+      --report FILE... Summarise existing result files and exit
+  -h, --help           Show this help
+USAGE
+}
+
+declare -a REPORT_FILES=()
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        -m|--masks) MASKS="$2"; shift 2 ;;
+        -r|--rounds) ROUNDS="$2"; shift 2 ;;
+        --idle) IDLE_S="$2"; shift 2 ;;
+        --scroll) SCROLL_S="$2"; shift 2 ;;
+        --warmup) WARMUP_S="$2"; shift 2 ;;
+        -o|--output) OUTPUT_DIR="$2"; shift 2 ;;
+        --report) REPORT_ONLY=true; shift; REPORT_FILES=("$@"); break ;;
+        -h|--help) usage; exit 0 ;;
+        *) echo "Unknown option: $1" >&2; usage >&2; exit 2 ;;
+    esac
+done
+
+for value in "$ROUNDS" "$IDLE_S" "$SCROLL_S" "$WARMUP_S"; do
+    [[ "$value" =~ ^[0-9]+$ ]] || { echo "ERROR: '$value' is not a number of rounds/seconds" >&2; exit 2; }
+done
+
+# --- Report ---
+
+# Summarise result files: mean draw per kernel, workload and mask, and the
+# difference to the kernel's first mask with 95% Welch confidence intervals
+# Args: result files
+report() {
+    awk -F '\t' '
+        function tcrit(df) {
+            if (df < 1) return 0
+            if (df > 30) return 1.96
+            return T[int(df)]
+        }
+        BEGIN {
+            split("12.706 4.303 3.182 2.776 2.571 2.447 2.365 2.306 2.262 2.228 " \
+                  "2.201 2.179 2.160 2.145 2.131 2.120 2.110 2.101 2.093 2.086 " \
+                  "2.080 2.074 2.069 2.064 2.060 2.056 2.052 2.048 2.045 2.042", T, " ")
+        }
+        /^#/ || NF < 8 { next }
+        {
+            kernel = $1; label = $2 " (" $3 ")"; work = $5; mw = $6
+            if (!(kernel in seen_kernel)) { seen_kernel[kernel] = 1; kernels[++nk] = kernel }
+            g = kernel SUBSEP work SUBSEP label
+            if (!(g in n)) {
+                order[kernel, work, ++nl[kernel, work]] = label
+                if (!((kernel, work) in seen_work)) { seen_work[kernel, work] = 1; works[kernel, ++nw[kernel]] = work }
+            }
+            n[g]++; sum[g] += mw; sq[g] += mw * mw
+            if (psr[g] == "" ) psr[g] = $8
+            if ($9 != "") { bl[kernel, $9] = 1 }
+        }
+        END {
+            if (nk == 0) { print "No results found"; exit 1 }
+            for (k = 1; k <= nk; k++) {
+                kernel = kernels[k]
+                printf "Kernel %s\n", kernel
+                printf "  %-7s %-22s %8s %8s %5s  %-26s %s\n", "LOAD", "MASK", "MEAN_W", "+-95%", "N", "DELTA_W (95% CI)", "PSR"
+                for (w = 1; w <= nw[kernel]; w++) {
+                    work = works[kernel, w]
+                    base = kernel SUBSEP work SUBSEP order[kernel, work, 1]
+                    for (i = 1; i <= nl[kernel, work]; i++) {
+                        label = order[kernel, work, i]
+                        g = kernel SUBSEP work SUBSEP label
+                        m = sum[g] / n[g]
+                        v[g] = n[g] > 1 ? (sq[g] - n[g] * m * m) / (n[g] - 1) : 0
+                        if (v[g] < 0) v[g] = 0
+                        mean[g] = m
+                        half = n[g] > 1 ? tcrit(n[g] - 1) * sqrt(v[g] / n[g]) / 1000 : 0
+                        delta = "-"
+                        if (i > 1) {
+                            d = (m - mean[base]) / 1000
+                            if (n[g] > 1 && n[base] > 1) {
+                                a = v[g] / n[g]; b = v[base] / n[base]
+                                df = (a + b) > 0 ? (a + b) ^ 2 / (a * a / (n[g] - 1) + b * b / (n[base] - 1)) : 30
+                                h = tcrit(df) * sqrt(a + b) / 1000
+                                delta = sprintf("%+.2f [%+.2f, %+.2f]", d, d - h, d + h)
+                            } else {
+                                delta = sprintf("%+.2f (n<2, no CI)", d)
+                            }
+                        }
+                        printf "  %-7s %-22s %8.2f %8.2f %5d  %-26s %s\n", work, label, m / 1000, half, n[g], delta, psr[g]
+                    }
+                }
+                levels = 0
+                for (key in bl) { split(key, parts, SUBSEP); if (parts[1] == kernel) levels++ }
+                if (levels > 1) print "  ⚠ Backlight brightness changed between intervals; results are not comparable"
+                print ""
+            }
+        }
+    ' "$@"
+}
+
+if [[ "$REPORT_ONLY" == true ]]; then
+    [[ ${#REPORT_FILES[@]} -gt 0 ]] || { echo "ERROR: --report needs result files" >&2; exit 2; }
+    report "${REPORT_FILES[@]}"
+    exit $?
+fi
+
+# debugfs and the result directory need root; keep the session variables the
+# refresh rate bounce needs
+if [[ ${EUID:-$(id -u)} -ne 0 ]]; then
+    exec sudo --preserve-env=DISPLAY,WAYLAND_DISPLAY,XAUTHORITY,XDG_RUNTIME_DIR,XDG_SESSION_TYPE,XDG_CURRENT_DESKTOP,DBUS_SESSION_BUS_ADDRESS \
+        "$0" --masks "$MASKS" --rounds "$ROUNDS" --idle "$IDLE_S" --scroll "$SCROLL_S" --warmup "$WARMUP_S" --output "$OUTPUT_DIR"
+fi
+
+source "$LIB_DIR/display-fix.sh"
+source "$LIB_DIR/display-manager.sh"
+
+# --- Battery Sampling ---
+
+BATTERY=""
+BACKLIGHT=""
+POWER_MW=0
+
+for psu in /sys/class/power_supply/*; do
+    [[ -r "$psu/type" ]] || continue
+    read -r type < "$psu/type"
+    if [[ "$type" == "Battery" ]]; then
+        BATTERY="$psu"
+        break
+    fi
+done
+for bl in /sys/class/backlight/*; do
+    [[ -r "$bl/brightness" ]] && { BACKLIGHT="$bl/brightness"; break; }
+done
+
+# Read the battery's discharge power
+# Sets: POWER_MW
+# Returns: 1 if the battery is not discharging or reports no power
+read_power() {
+    local status value current voltage
+    read -r status < "$BATTERY/status" || return 1
+    [[ "$status" == "Discharging" ]] || return 1
+    if [[ -r "$BATTERY/power_now" ]]; then
+        read -r value < "$BATTERY/power_now" || return 1
+        POWER_MW=$((value / 1000))
+    else
+        read -r current < "$BATTERY/current_now" || return 1
+        read -r voltage < "$BATTERY/voltage_now" || return 1
+        POWER_MW=$((current * voltage / 1000000000))
+    fi
+    POWER_MW="${POWER_MW#-}"
+    (( POWER_MW > 0 ))
+}
+
+NOW_US=0
+now_us() {
+    local now="$EPOCHREALTIME"
+    NOW_US="${now/[.,]/}"
+}
+
+# Sleep without forking (sleep(1) per scrolled line would add its own load)
+exec {SLEEP_FD}<> <(:)
+pause() {
+    read -rt "$1" -u "$SLEEP_FD" || true
+}
+
+# --- Masks ---
+
+BOOT_MASK=$(display_get_boot_debug_mask)
+ORIGINAL_MASK=$(display_get_runtime_debug_mask)
+RUNTIME=false
+if [[ -n "$ORIGINAL_MASK" ]] && kernel_cap amdgpu_runtime_debug_mask; then
+    RUNTIME=true
+fi
+
+# Resolve a candidate name to a mask value
+# Args: $1 = stock, fix, boot or a number
+# Output: mask in hex
+resolve_mask() {
+    case "$1" in
+        stock) printf '0x%x\n' $((BOOT_MASK & ~FIX_BITS)) ;;
+        fix)   printf '0x%x\n' $((BOOT_MASK | FIX_BITS)) ;;
+        boot)  echo "$BOOT_MASK" ;;
+        *)
+            # Globs would let "12abc" through to $(( )), which aborts
+            if [[ "$1" =~ ^0x[0-9A-Fa-f]+$ ]]; then
+                printf '0x%x\n' $(($1))
+            elif [[ "$1" =~ ^[0-9]+$ ]]; then
+                printf '0x%x\n' $((10#$1))
+            else
+                return 1
+            fi
+            ;;
+    esac
+}
+
+declare -a LABELS=() VALUES=()
+read -ra LABELS <<< "$MASKS"
+for label in "${LABELS[@]}"; do
+    if ! value=$(resolve_mask "$label"); then
+        echo "ERROR: unknown mask '$label'" >&2
+        exit 2
+    fi
+    VALUES+=("$value")
+done
+
+# Force a modeset of the internal panel so a new debug mask is picked up
+# Returns: 1 without a display session to do it through
+MODESET_OUTPUT=""
+bounce_panel() {
+    local current rate other=""
+    [[ -n "${DISPLAY:-}${WAYLAND_DISPLAY:-}" ]] || return 1
+    MODESET_OUTPUT=$(display_get_primary)
+    current=$(display_get_current_refresh "$MODESET_OUTPUT")
+    for rate in $(display_get_supported_rates "$MODESET_OUTPUT"); do
+        [[ "$rate" != "$current" ]] && { other="$rate"; break; }
+    done
+    [[ -n "$other" ]] || return 1
+    display_set_rate "$MODESET_OUTPUT" "$other" || return 1
+    pause 1
+    display_set_rate "$MODESET_OUTPUT" "$current"
+}
+
+# Switch to a mask (runtime only)
+# Returns: 1 if it could not be applied
+apply_mask() {
+    [[ "$RUNTIME" == true ]] || return 0
+    display_set_runtime_debug_mask "$1" || return 1
+    if ! bounce_panel; then
+        echo "  ⚠ Could not force a modeset; mask $1 may not reach the panel until it is re-enabled" >&2
+    fi
+}
+
+restore() {
+    if [[ "$RUNTIME" == true && -n "$ORIGINAL_MASK" ]]; then
+        display_set_runtime_debug_mask "$ORIGINAL_MASK" || true
+        bounce_panel >/dev/null 2>&1 || true
+    fi
+    printf '\n' >&"$TTY_FD" 2>/dev/null || true
+}
+
+# --- Preflight ---
+
+if [[ -z "$BATTERY" ]]; then
+    echo "ERROR: no battery found in /sys/class/power_supply" >&2
+    exit 1
+fi
+if ! read_power; then
+    echo "ERROR: the battery is not discharging - unplug AC and run again" >&2
+    exit 1
+fi
+if [[ "$RUNTIME" != true ]]; then
+    if [[ ${#LABELS[@]} -gt 1 ]]; then
+        echo "NOTE: this kernel has no runtime display debug mask; measuring the booted mask ($BOOT_MASK) only."
+        echo "      Reboot with each candidate in amdgpu.dcdebugmask, run again, then combine with --report."
+    fi
+    LABELS=("boot")
+    VALUES=("$BOOT_MASK")
+fi
+if pgrep -f gz302-adaptive-refresh >/dev/null 2>&1; then
+    echo "WARNING: gz302-adaptive-refresh is running and will change the refresh rate between intervals."
+    echo "         Stop it first: systemctl --user stop gz302-adaptive-refresh"
+fi
+
+# Workload output goes to the terminal even when stdout is redirected
+TTY_FD=1
+if ! { exec {TTY_FD}>/dev/tty; } 2>/dev/null; then
+    TTY_FD=1
+fi
+
+KERNEL="$(uname -r)"
+mkdir -p "$OUTPUT_DIR"
+RESULT_FILE="$OUTPUT_DIR/panel-power-$(date +%Y%m%d-%H%M%S).tsv"
+printf '# kernel\tlabel\tmask\tround\tworkload\tmean_mw\tsamples\tpsr_state\tbacklight\n' > "$RESULT_FILE"
+
+per_mask=$(( 2 * WARMUP_S + IDLE_S + SCROLL_S ))
+echo "Panel power benchmark on $KERNEL (battery: ${BATTERY##*/}, runtime masks: $RUNTIME)"
+echo "Masks: $(for i in "${!LABELS[@]}"; do printf '%s=%s ' "${LABELS[i]}" "${VALUES[i]}"; done)"
+echo "About $(( per_mask * ${#LABELS[@]} * ROUNDS / 60 )) minutes. Keep this terminal maximised and do not touch the machine."
+pause 5
+
+trap restore EXIT
+trap 'exit 130' INT TERM
+
+# --- Intervals ---
+
+SCROLL_TEXT="The quick brown fox jumps over the lazy dog while the panel redraws this line - 0123456789 abcdefghijklmnopqrstuvwxyz"
+
+# Run one interval and append its mean draw to the result file
+# Args: $1 = round, $2 = label, $3 = mask, $4 = idle|scroll, $5 = seconds
+run_interval() {
+    local round="$1" label="$2" mask="$3" workload="$4" seconds="$5"
+    local start end next_sample step line=0 sum=0 samples=0 brightness=""
+    printf -v step '0.%06d' $(( 1000000 / SCROLL_HZ ))
+
+    printf '\033[2J\033[H%s interval, mask %s (%s), round %s - hands off\n' "$workload" "$label" "$mask" "$round" >&"$TTY_FD"
+    pause "$WARMUP_S"
+
+    now_us; start="$NOW_US"
+    end=$(( start + seconds * 1000000 ))
+    next_sample=$(( start + 1000000 ))
+    while (( NOW_US < end )); do
+        if [[ "$workload" == "scroll" ]]; then
+            printf '%8d  %s\n' "$line" "$SCROLL_TEXT" >&"$TTY_FD"
+            line=$((line + 1))
+            pause "$step"
+        else
+            pause 1
+        fi
+        now_us
+        if (( NOW_US >= next_sample )); then
+            next_sample=$(( next_sample + 1000000 ))
+            if read_power; then
+                sum=$((sum + POWER_MW))
+                samples=$((samples + 1))
+            fi
+        fi
+    done
+
+    [[ -n "$BACKLIGHT" ]] && read -r brightness < "$BACKLIGHT"
+    if (( samples == 0 )); then
+        echo "  ✗ round $round $label $workload: no samples (AC plugged in?)" >&2
+        return 1
+    fi
+    printf '%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n' "$KERNEL" "$label" "$mask" "$round" "$workload" \
+        "$((sum / samples))" "$samples" "$(display_get_psr_state)" "$brightness" >> "$RESULT_FILE"
+    RESULTS+=("  round $round  $(printf '%-8s %-6s' "$label" "$workload") $((sum / samples)) mW over $samples samples")
+}
+
+declare -a RESULTS=()
+for ((round = 1; round <= ROUNDS; round++)); do
+    for i in "${!LABELS[@]}"; do
+        apply_mask "${VALUES[i]}" || { echo "ERROR: could not set mask ${VALUES[i]}" >&2; exit 1; }
+        run_interval "$round" "${LABELS[i]}" "${VALUES[i]}" idle "$IDLE_S" || exit 1
+        run_interval "$round" "${LABELS[i]}" "${VALUES[i]}" scroll "$SCROLL_S" || exit 1
+    done
+done
+
+restore
+trap - EXIT
+printf '\033[2J\033[H' >&"$TTY_FD"
+printf '%s\n' "${RESULTS[@]}"
+echo
+report "$RESULT_FILE"
+echo "Results: $RESULT_FILE"
@@ -4,14 +4,14 @@
 #   - s2idle hang on Strix Halo (Thunderbolt/xHCI wakeup, ASUS HID ENOMEM)
 #   - "mmc0: error -110 writing Power Off Notify bit" blocking suspend
 #   - Touchpad/RGB not working after resume
-# v3.0 - Comprehensive s2idle fix for AMD Strix Halo
+# v3.2 - Comprehensive s2idle fix for AMD Strix Halo
 
 set -euo pipefail
 
 HOOK_PATH="/usr/lib/systemd/system-sleep/gz302-reset.sh"
 
 echo "========================================="
-echo " GZ302 Suspend Fix Installer (v3.0)"
+echo " GZ302 Suspend Fix Installer (v3.2)"
 echo "========================================="
 echo ""
 echo "This fixes intermittent s2idle hangs that require a hard power-off."
@@ -24,25 +24,114 @@ echo "  4. MMC 'Power Off Notify' timeout blocking suspend entry"
 echo "  5. Touchpad/RGB not working after successful resume"
 echo ""
 echo "Will install: $HOOK_PATH"
+echo "              /usr/local/bin/gz302-suspend-report (gz302 suspend-report)"
+echo "              /usr/local/bin/gz302-wakeup-policy (gz302 wakeup-policy)"
+echo "              /usr/local/bin/gz302-hibernate-policy (gz302 hibernate-policy)"
+echo "              /etc/gz302/wakeup-policy.conf (kept if it already exists)"
+echo "              /etc/gz302/hibernate-policy.conf (kept if it already exists)"
 echo ""
 
+# --- Install the default wakeup-source policy (user edits are kept) ---
+POLICY_PATH="/etc/gz302/wakeup-policy.conf"
+# The default written by earlier installs, which kept keyboard wake only for
+# product 0b05:1a30. Replaced only while it is still unmodified.
+POLICY_OLD_DEFAULT_SHA256="37ed400c6b022504b6c30854bd5b5aafe2e8fb8d63f3ae360a01155f8924c4c2"
+policy_sum=""
+if [[ -f "$POLICY_PATH" ]]; then
+    policy_sum=$(sha256sum < "$POLICY_PATH")
+    policy_sum="${policy_sum%% *}"
+    if [[ "$policy_sum" == "$POLICY_OLD_DEFAULT_SHA256" ]]; then
+        echo "Updating the unmodified default $POLICY_PATH (keyboard wake for all ASUS keyboard IDs)"
+    fi
+fi
+if [[ ! -f "$POLICY_PATH" || "$policy_sum" == "$POLICY_OLD_DEFAULT_SHA256" ]]; then
+    sudo mkdir -p "${POLICY_PATH%/*}"
+    sudo tee "$POLICY_PATH" > /dev/null << 'POLICYEOF'
+# GZ302 wakeup-source policy, applied by the sleep hook before every suspend
+# and reverted on resume. Preview the effect with: gz302 wakeup-policy
+#
+# One rule per line: <action> <match>...
+#   action  disable | enable | keep (leave as it is)
+#   match   class=<PCI class>       e.g. class=0x0c0330 (xHCI)
+#           pci=<vendor>:<device>   e.g. pci=1022:15b6
+#           usb=<vendor>:<product>  a USB device below the controller
+#           addr=<PCI address>      e.g. addr=0000:c4:00.4 (changes with
+#                                   firmware; prefer the matches above)
+# All matches of a rule must hold; values may use shell globs (0x0c03*).
+# The first matching rule wins; devices no rule matches are left alone.
+
+# Thunderbolt/USB4 NHI: spurious wakeups leave s2idle half-resumed
+disable class=0x0c0340
+
+# Keep wakeup on the xHCI controller hosting the detachable keyboard
+# (any ASUS device: the keyboard's product ID differs between variants)
+keep    class=0x0c0330 usb=0b05:*
+# Example: also wake from a keyboard on a dock (Logitech receiver)
+#keep   class=0x0c0330 usb=046d:*
+
+# Other xHCI controllers race during s2idle resume
+disable class=0x0c0330
+POLICYEOF
+fi
+
+# --- Install the suspend-then-hibernate settings (off until enabled) ---
+HIBERNATE_CONF_PATH="/etc/gz302/hibernate-policy.conf"
+if [[ ! -f "$HIBERNATE_CONF_PATH" ]]; then
+    sudo mkdir -p "${HIBERNATE_CONF_PATH%/*}"
+    sudo tee "$HIBERNATE_CONF_PATH" > /dev/null << 'HIBERNATECONFEOF'
+# GZ302 suspend-then-hibernate policy, read by the sleep hook.
+# When enabled, a suspend on battery hibernates once the battery would reach
+# the reserve at the measured sleep drain (see gz302 suspend-report).
+# Check readiness and swap sizing with: gz302 hibernate-policy
+
+# off | auto (gz302 hibernate-policy enable/disable)
+HIBERNATE_POLICY=off
+
+# Hibernate before the battery falls below this charge (%)
+HIBERNATE_RESERVE_PCT=10
+
+# Bounds for the time spent in s2idle before hibernating
+HIBERNATE_MIN_DELAY_MIN=30
+HIBERNATE_MAX_DELAY_H=24
+
+# Drain assumed until HIBERNATE_MIN_SAMPLES sleeps of 10+ minutes on battery
+# are logged; afterwards the median of the last HIBERNATE_DRAIN_WINDOW is used
+HIBERNATE_FALLBACK_DRAIN_MW=2000
+HIBERNATE_MIN_SAMPLES=3
+HIBERNATE_DRAIN_WINDOW=20
+
+# Stay in s2idle while more GPU memory (VRAM + GTT) than this is allocated,
+# e.g. a loaded model; swap is then planned without it. 0 = no limit.
+HIBERNATE_GPU_MAX_MB=4096
+
+# /sys/power/image_size before hibernating: 0 = as small as possible (page
+# cache is dropped, fastest resume), empty = kernel default (2/5 of RAM)
+HIBERNATE_IMAGE_SIZE_MB=0
+HIBERNATECONFEOF
+fi
+
 # --- Install the systemd sleep hook ---
 sudo tee "$HOOK_PATH" > /dev/null << 'HOOKEOF'
 #!/bin/bash
 # GZ302 Suspend/Resume Hook
-# v3.0 - Comprehensive s2idle fix for Strix Halo
+# v3.2 - Comprehensive s2idle fix for Strix Halo
 #
 # Pre-suspend:
-#   - Disable Thunderbolt (NHI) wakeup to prevent s2idle hang
-#   - Disable non-essential xHCI wakeup sources
+#   - Apply the wakeup-source policy (/etc/gz302/wakeup-policy.conf):
+#     by default Thunderbolt (NHI) wakeup and every xHCI controller that
+#     does not host the internal keyboard are disabled
 #   - Unbind ASUS HID devices to prevent ENOMEM on resume re-probe
 #   - Unbind MMC to prevent "Power Off Notify" timeout
 #
 # Post-resume:
+#   - Restore wakeup sources changed by the policy
 #   - Rebind MMC devices
+#   - Reset USB keyboard/touchpad/lightbar (in parallel)
 #   - Rebind ASUS HID devices
-#   - Reset USB keyboard/touchpad/lightbar
 #   - Restore RGB settings
+#
+# Resume waits on udev add/bind events with per-device timeouts instead of
+# fixed sleeps, so the keyboard is usable as soon as it has re-enumerated.
 
 set -euo pipefail
 
@@ -50,70 +139,627 @@ LOG_TAG="gz302-reset"
 MMC_DRIVER_PATH="/sys/bus/mmc/drivers/mmcblk"
 STATE_DIR="/run/gz302-suspend"
 
+# Upper bounds for one USB device reset (de-authorize, re-enumerate, bind)
+KEYBOARD_RESET_TIMEOUT_MS=3000
+LIGHTBAR_RESET_TIMEOUT_MS=2000
+
 log() { logger -t "$LOG_TAG" "$*"; }
 
+# --- Phase timing (read by gz302-suspend-report) ---
+# One line per record: <cycle>|<pre|post>|<phase>|<start us>|<duration us>
+# or <cycle>|stat|<counter>@<pre|post>|<value>. Times are wall-clock
+# microseconds: CLOCK_MONOTONIC stops during s2idle, so it cannot measure
+# the time spent asleep, and reading it from bash would need a fork.
+TIMING_LOG="/var/log/gz302/suspend-timing.log"
+TIMING_LOG_MAX_LINES=4000
+HOOK_DIRECTION="${1:-}"
+SLEEP_TYPE="${2:-}"
+CYCLE=""
+PHASE=""
+PHASE_START=0
+
+record() {
+    [[ -d "${TIMING_LOG%/*}" ]] || mkdir -p "${TIMING_LOG%/*}" 2>/dev/null || return 0
+    local IFS='|'
+    echo "${CYCLE}|$*" >> "$TIMING_LOG" 2>/dev/null || true
+}
+
+phase_begin() {
+    now_us
+    PHASE="$1"
+    PHASE_START="$NOW_US"
+}
+
+phase_end() {
+    [[ -n "$PHASE" ]] || return 0
+    now_us
+    record "$HOOK_DIRECTION" "$PHASE" "$PHASE_START" $(( NOW_US - PHASE_START ))
+    PHASE=""
+}
+
+# Snapshot suspend counters and s0ix residency
+# Args: $1 = pre or post
+record_stats() {
+    local f value
+    for f in /sys/power/suspend_stats/success /sys/power/suspend_stats/fail \
+             /sys/power/suspend_stats/last_hw_sleep /sys/power/suspend_stats/total_hw_sleep; do
+        [[ -r "$f" ]] && read -r value < "$f" && record stat "${f##*/}@$1" "$value"
+    done
+    # amd_pmc debugfs: "Residency Time: <us>" for the last s0ix cycle
+    local line
+    if [[ "$1" == "post" && -r /sys/kernel/debug/amd_pmc/s0ix_stats ]]; then
+        while IFS= read -r line; do
+            [[ "$line" == "Residency Time: "* ]] && record stat "s0ix_residency@post" "${line#Residency Time: }"
+        done < /sys/kernel/debug/amd_pmc/s0ix_stats
+    fi
+    return 0
+}
+
+# Keep a log small (rolling): once over the limit, keep the newer half
+# Args: $1 = log file, $2 = maximum lines
+trim_log() {
+    [[ -f "$1" ]] || return 0
+    local lines
+    lines=$(wc -l < "$1")
+    if (( lines > $2 )); then
+        tail -n $(( $2 / 2 )) "$1" > "${1}.tmp" && mv -f "${1}.tmp" "$1"
+    fi
+    return 0
+}
+
+# --- Sleep drain (read by gz302-suspend-report) ---
+# One line per cycle: <cycle>|<asleep s>|<capacity before>|<capacity after>|
+# <energy before uWh>|<energy after uWh>|<drain mW>|<%/h x100>|<battery|ac>|
+# <wake sources "name+N,...">|<wake irq>
+DRAIN_LOG="/var/log/gz302/sleep-drain.log"
+DRAIN_LOG_MAX_LINES=500
+
+# Read the battery into BAT_ENERGY/BAT_FULL (uWh), BAT_CAPACITY, BAT_STATUS
+# Returns: 1 if there is no battery
+read_battery() {
+    BAT_ENERGY=""
+    BAT_FULL=""
+    BAT_CAPACITY=""
+    BAT_STATUS=""
+    local bat type charge voltage full
+    for bat in /sys/class/power_supply/*; do
+        [[ -r "$bat/type" ]] && read -r type < "$bat/type" && [[ "$type" == "Battery" ]] || continue
+        [[ -r "$bat/capacity" ]] && read -r BAT_CAPACITY < "$bat/capacity"
+        [[ -r "$bat/status" ]] && read -r BAT_STATUS < "$bat/status"
+        if [[ -r "$bat/energy_now" ]]; then
+            read -r BAT_ENERGY < "$bat/energy_now"
+            [[ -r "$bat/energy_full" ]] && read -r BAT_FULL < "$bat/energy_full"
+        elif [[ -r "$bat/charge_now" && -r "$bat/voltage_now" ]]; then
+            # uAh * uV / 1e6 = uWh
+            read -r charge < "$bat/charge_now"
+            read -r voltage < "$bat/voltage_now"
+            BAT_ENERGY=$(( charge * voltage / 1000000 ))
+            if [[ -r "$bat/charge_full" ]]; then
+                read -r full < "$bat/charge_full"
+                BAT_FULL=$(( full * voltage / 1000000 ))
+            fi
+        fi
+        [[ -n "$BAT_ENERGY" ]] && return 0
+    done
+    return 1
+}
+
+# Print "<name>|<event count>" for every wakeup source
+snapshot_wakeups() {
+    local src name count
+    if [[ -d /sys/class/wakeup ]]; then
+        for src in /sys/class/wakeup/wakeup*; do
+            [[ -r "$src/name" && -r "$src/event_count" ]] || continue
+            read -r name < "$src/name"
+            read -r count < "$src/event_count"
+            echo "${name//[|,]/_}|${count}"
+        done
+    elif [[ -r /sys/kernel/debug/wakeup_sources ]]; then
+        # name active_count event_count wakeup_count ...
+        while read -r name _ count _; do
+            [[ "$name" == "name" ]] && continue
+            echo "${name//[|,]/_}|${count}"
+        done < /sys/kernel/debug/wakeup_sources
+    fi
+}
+
+# Snapshot battery and wakeup counters on the way into sleep
+save_sleep_snapshot() {
+    read_battery || return 0
+    now_us
+    echo "${NOW_US}|${BAT_ENERGY}|${BAT_FULL}|${BAT_CAPACITY}|${BAT_STATUS}" > "$STATE_DIR/battery"
+    snapshot_wakeups > "$STATE_DIR/wakeups"
+}
+
+# Compare with the snapshot on the way out and append one drain record
+record_sleep_drain() {
+    [[ -f "$STATE_DIR/battery" ]] || return 0
+    local slept_at energy_pre full cap_pre status_pre
+    IFS='|' read -r slept_at energy_pre full cap_pre status_pre < "$STATE_DIR/battery"
+    read_battery || return 0
+    now_us
+    local asleep_us=$(( NOW_US - slept_at ))
+    (( asleep_us > 0 )) || return 0
+
+    local used=$(( energy_pre - BAT_ENERGY ))
+    local drain_mw=$(( used * 3600000 / asleep_us ))
+    local pct_h=0
+    if [[ -n "$full" && "$full" -gt 0 ]]; then
+        # Parts per million of a full battery, scaled to hundredths of % per hour
+        local ppm=$(( used * 1000000 / full ))
+        pct_h=$(( ppm * 3600000000 / asleep_us / 100 ))
+    fi
+    local power="battery"
+    if [[ "$status_pre" != "Discharging" || "$BAT_STATUS" == "Charging" ]] || (( used < 0 )); then
+        power="ac"
+    fi
+
+    # Wakeup sources whose event counts changed while asleep
+    local -A before=()
+    local name count prev sources=""
+    while IFS='|' read -r name count; do
+        before["$name"]="$count"
+    done < "$STATE_DIR/wakeups"
+    while IFS='|' read -r name count; do
+        prev="${before["$name"]:-}"
+        if [[ -n "$prev" ]] && (( count > prev )); then
+            sources+="${sources:+,}${name}+$(( count - prev ))"
+        fi
+    done < <(snapshot_wakeups)
+
+    # The interrupt that ended s2idle, named from /proc/interrupts
+    local irq="" line
+    if [[ -r /sys/power/pm_wakeup_irq ]] && read -r irq < /sys/power/pm_wakeup_irq 2>/dev/null && [[ -n "$irq" ]]; then
+        while read -r line; do
+            if [[ "$line" == "${irq}:"* ]]; then
+                irq="${irq} ${line##* }"
+                break
+            fi
+        done < /proc/interrupts
+    fi
+
+    [[ -d "${DRAIN_LOG%/*}" ]] || mkdir -p "${DRAIN_LOG%/*}" 2>/dev/null || return 0
+    echo "${CYCLE}|$(( asleep_us / 1000000 ))|${cap_pre}|${BAT_CAPACITY}|${energy_pre}|${BAT_ENERGY}|${drain_mw}|${pct_h}|${power}|${sources}|${irq}" \
+        >> "$DRAIN_LOG" 2>/dev/null || true
+    [[ -n "$sources" ]] && log "Woken by: ${sources//,/, }${irq:+ (irq ${irq})}"
+    log "Sleep drain: ${drain_mw} mW over $(( asleep_us / 1000000 )) s (${power})"
+    return 0
+}
+
+# Set to true when "udevadm wait" (systemd 251+) is available
+UDEV_WAIT=false
+
+# Current time in microseconds into NOW_US (no fork)
+now_us() { NOW_US="${EPOCHREALTIME/[.,]/}"; }
+
+# Poll a condition every 10 ms until it holds or the deadline passes
+# Args: $1 = deadline (us), remaining = condition command
+wait_until() {
+    local deadline="$1"
+    shift
+    until "$@"; do
+        now_us
+        (( NOW_US < deadline )) || return 1
+        sleep 0.01
+    done
+}
+
+# Wait until udev has processed a device's add event
+# Args: $1 = deadline (us), $2 = sysfs path
+wait_device() {
+    if [[ "$UDEV_WAIT" == "true" ]]; then
+        now_us
+        (( NOW_US < $1 )) || return 1
+        udevadm wait --timeout="$(( ($1 - NOW_US) / 1000 ))ms" "$2" >/dev/null 2>&1
+    else
+        wait_until "$1" test -e "$2"
+    fi
+}
+
+# Wait until a device has been removed
+# Args: $1 = deadline (us), $2 = sysfs path
+wait_removed() {
+    if [[ "$UDEV_WAIT" == "true" ]]; then
+        now_us
+        (( NOW_US < $1 )) || return 1
+        udevadm wait --removed --timeout="$(( ($1 - NOW_US) / 1000 ))ms" "$2" >/dev/null 2>&1
+    else
+        wait_until "$1" test ! -e "$2"
+    fi
+}
+
+# Re-authorize a USB device and wait until its interfaces are bound again
+# and udev has set up their hidraw nodes (used by z13ctl)
+# Args: $1 = sysfs path, $2 = label, $3 = timeout (ms)
+reset_usb_device() {
+    local dev="$1"
+    local label="$2"
+    local name="${dev##*/}"
+    local -a ifaces=()
+    local iface node
+    for iface in "$dev/$name":*; do
+        [[ -d "$iface" ]] && ifaces+=("$iface")
+    done
+
+    now_us
+    local start="$NOW_US"
+    local deadline=$(( start + $3 * 1000 ))
+
+    log "Resetting $label at $dev"
+    echo 0 > "$dev/authorized" 2>/dev/null || true
+    if [[ ${#ifaces[@]} -gt 0 ]]; then
+        wait_removed "$deadline" "${ifaces[0]}" || log "$label: interfaces still present after de-authorize"
+    fi
+    echo 1 > "$dev/authorized" 2>/dev/null || true
+
+    local ready=true
+    for iface in "${ifaces[@]}"; do
+        if ! wait_device "$deadline" "$iface" || ! wait_until "$deadline" test -e "$iface/driver"; then
+            ready=false
+            continue
+        fi
+        for node in "$iface"/*/hidraw/hidraw*; do
+            [[ -e "$node" ]] || continue
+            wait_device "$deadline" "$node" || ready=false
+        done
+    done
+
+    now_us
+    record post "usb-reset:${label}" "$start" $(( NOW_US - start ))
+    if [[ "$ready" == "true" ]]; then
+        log "$label ready after $(( (NOW_US - start) / 1000 )) ms"
+    else
+        log "$label not fully re-bound within $3 ms"
+    fi
+}
+
+# --- Wakeup-source policy ---
+# Rules are read from POLICY_FILE, one per line: "<action> <match>...".
+# Actions: disable, enable, keep. Matches (all must hold, shell globs allowed):
+#   class=0x0c0330   PCI class        pci=1022:15b6  PCI vendor:device
+#   usb=0b05:1a30    USB device (vendor:product) anywhere below the controller
+#   addr=0000:c4:*   PCI address
+# The first matching rule wins; devices no rule matches are left alone.
+POLICY_FILE="/etc/gz302/wakeup-policy.conf"
+DEFAULT_POLICY="disable class=0x0c0340
+keep class=0x0c0330 usb=0b05:*
+disable class=0x0c0330"
+POLICY_RULES=()
+POLICY_ACTION=""
+POLICY_RULE=""
+
+# Load POLICY_RULES from POLICY_FILE (built-in default if it is missing)
+load_policy() {
+    local line
+    POLICY_RULES=()
+    if [[ -r "$POLICY_FILE" ]]; then
+        while IFS= read -r line || [[ -n "$line" ]]; do
+            line="${line%%#*}"
+            [[ -n "${line//[[:space:]]/}" ]] && POLICY_RULES+=("$line")
+        done < "$POLICY_FILE"
+    else
+        while IFS= read -r line; do
+            POLICY_RULES+=("$line")
+        done <<< "$DEFAULT_POLICY"
+    fi
+}
+
+# Check whether a USB device below a PCI controller matches vendor:product
+# (root hub ports and up to two levels of hubs)
+# Args: $1 = PCI sysfs path, $2 = vendor:product pattern
+usb_descendant() {
+    local id vid pid
+    for id in "$1"/usb*/*-*/idVendor "$1"/usb*/*-*/*-*/idVendor "$1"/usb*/*-*/*-*/*-*/idVendor; do
+        [[ -r "$id" && -r "${id%/*}/idProduct" ]] || continue
+        read -r vid < "$id"
+        read -r pid < "${id%/*}/idProduct"
+        # shellcheck disable=SC2053 # rule values are glob patterns
+        [[ "${vid}:${pid}" == $2 ]] && return 0
+    done
+    return 1
+}
+
+# Find the first policy rule matching a PCI device
+# Args: $1 = sysfs path, $2 = class, $3 = vendor:device
+# Sets: POLICY_ACTION, POLICY_RULE
+# Returns: 1 if no rule matches
+policy_match() {
+    local rule action cond value
+    local -a conds
+    POLICY_ACTION=""
+    POLICY_RULE=""
+    for rule in "${POLICY_RULES[@]}"; do
+        read -r action rule <<< "$rule"
+        read -ra conds <<< "$rule"
+        [[ ${#conds[@]} -gt 0 ]] || continue
+        for cond in "${conds[@]}"; do
+            value="${cond#*=}"
+            # shellcheck disable=SC2053 # rule values are glob patterns
+            case "$cond" in
+                class=*) [[ "$2" == $value ]] ;;
+                pci=*) [[ "$3" == $value ]] ;;
+                addr=*) [[ "${1##*/}" == $value ]] ;;
+                usb=*) usb_descendant "$1" "$value" ;;
+                *) false ;;
+            esac || continue 2
+        done
+        POLICY_ACTION="$action"
+        POLICY_RULE="$action $rule"
+        return 0
+    done
+    return 1
+}
+
+# Apply the policy to every wakeup-capable PCI device in one sysfs pass.
+# Changed devices are recorded in STATE_DIR/wakeup-changes as
+# "<address>|<previous state>" so post-resume can put them back.
+# Args: $1 = apply or dry-run (print a table, change nothing)
+apply_wakeup_policy() {
+    local dev name class vendor device current want result
+    load_policy
+    [[ "$1" == "apply" ]] && : > "$STATE_DIR/wakeup-changes"
+    [[ "$1" == "dry-run" ]] && printf "%-14s %-10s %-9s %-9s %-16s %s\n" \
+        "DEVICE" "ID" "CLASS" "WAKEUP" "RESULT" "RULE"
+    for dev in /sys/bus/pci/devices/*; do
+        [[ -f "$dev/power/wakeup" && -r "$dev/class" ]] || continue
+        name="${dev##*/}"
+        read -r class < "$dev/class"
+        read -r vendor < "$dev/vendor"
+        read -r device < "$dev/device"
+        read -r current < "$dev/power/wakeup"
+        policy_match "$dev" "$class" "${vendor#0x}:${device#0x}" || POLICY_ACTION=""
+
+        case "$POLICY_ACTION" in
+            disable) want="disabled" ;;
+            enable) want="enabled" ;;
+            *) want="$current" ;;
+        esac
+
+        if [[ "$1" == "dry-run" ]]; then
+            result="unchanged"
+            [[ "$want" != "$current" ]] && result="would ${POLICY_ACTION}"
+            [[ "$POLICY_ACTION" == "keep" ]] && result="kept"
+            printf "%-14s %-10s %-9s %-9s %-16s %s\n" "${name#0000:}" "${vendor#0x}:${device#0x}" \
+                "${class#0x}" "$current" "$result" "${POLICY_RULE:--}"
+        elif [[ "$want" != "$current" ]]; then
+            log "Wakeup on $name ($class ${vendor#0x}:${device#0x}): $current -> $want (${POLICY_RULE})"
+            echo "${name}|${current}" >> "$STATE_DIR/wakeup-changes"
+            echo "$want" > "$dev/power/wakeup" 2>/dev/null || true
+        fi
+    done
+    return 0
+}
+
+# --- Suspend-then-hibernate policy ---
+# Optional (HIBERNATE_POLICY=auto in HIBERNATE_CONF). A plain suspend on
+# battery arms the RTC to wake the machine when, at the median sleep drain
+# measured in DRAIN_LOG, the battery would reach the reserve; if that alarm
+# ends the sleep, the machine hibernates. Nothing is armed without a resume
+# target and enough free swap for the image, or while more GPU memory than
+# HIBERNATE_GPU_MAX_MB is allocated: large GTT/VRAM buffers (a loaded model)
+# end up in the image and make hibernation slow or impossible.
+HIBERNATE_CONF="/etc/gz302/hibernate-policy.conf"
+HIBERNATE_POLICY="off"
+HIBERNATE_RESERVE_PCT=10
+HIBERNATE_MIN_DELAY_MIN=30
+HIBERNATE_MAX_DELAY_H=24
+HIBERNATE_FALLBACK_DRAIN_MW=2000
+HIBERNATE_MIN_SAMPLES=3
+HIBERNATE_DRAIN_WINDOW=20
+HIBERNATE_GPU_MAX_MB=4096
+HIBERNATE_IMAGE_SIZE_MB=0
+HIBERNATE_REASON=""
+HIBERNATE_DELAY=0
+DRAIN_MW=""
+DRAIN_SAMPLES=0
+IMAGE_MB=0
+SWAP_FREE_MB=0
+VRAM_USED_MB=0
+GTT_USED_MB=0
+RTC_WAKEALARM="/sys/class/rtc/rtc0/wakealarm"
+
+# Read KEY=value settings from HIBERNATE_CONF (unknown keys are ignored)
+load_hibernate_conf() {
+    local key value
+    [[ -r "$HIBERNATE_CONF" ]] || return 0
+    while IFS='=' read -r key value || [[ -n "$key" ]]; do
+        key="${key//[[:space:]]/}"
+        value="${value%%#*}"
+        value="${value//[[:space:]\"\']/}"
+        case "$key" in
+            HIBERNATE_POLICY) HIBERNATE_POLICY="$value" ;;
+            # Empty leaves /sys/power/image_size at the kernel default
+            HIBERNATE_IMAGE_SIZE_MB) [[ "$value" =~ ^[0-9]*$ ]] && HIBERNATE_IMAGE_SIZE_MB="$value" ;;
+            HIBERNATE_RESERVE_PCT|HIBERNATE_MIN_DELAY_MIN|HIBERNATE_MAX_DELAY_H|\
+            HIBERNATE_FALLBACK_DRAIN_MW|HIBERNATE_MIN_SAMPLES|HIBERNATE_DRAIN_WINDOW|\
+            HIBERNATE_GPU_MAX_MB)
+                [[ "$value" =~ ^[0-9]+$ ]] && printf -v "$key" '%s' "$value" ;;
+        esac
+    done < "$HIBERNATE_CONF"
+    return 0
+}
+
+# Median drain (mW) of recent sleeps of 10+ minutes on battery
+# Sets: DRAIN_MW (fallback until enough samples exist), DRAIN_SAMPLES
+median_drain() {
+    local -a samples=()
+    local cycle asleep cap_pre cap_post e_pre e_post mw power rest
+    if [[ -r "$DRAIN_LOG" ]]; then
+        while IFS='|' read -r cycle asleep cap_pre cap_post e_pre e_post mw _ power rest; do
+            [[ "$power" == "battery" ]] && (( asleep >= 600 && mw > 0 )) && samples+=("$mw")
+        done < "$DRAIN_LOG"
+    fi
+    if (( ${#samples[@]} > HIBERNATE_DRAIN_WINDOW )); then
+        samples=("${samples[@]: -HIBERNATE_DRAIN_WINDOW}")
+    fi
+    DRAIN_SAMPLES=${#samples[@]}
+    DRAIN_MW="$HIBERNATE_FALLBACK_DRAIN_MW"
+    if (( DRAIN_SAMPLES > 0 && DRAIN_SAMPLES >= HIBERNATE_MIN_SAMPLES )); then
+        mapfile -t samples < <(printf '%s\n' "${samples[@]}" | sort -n)
+        DRAIN_MW="${samples[(DRAIN_SAMPLES - 1) / 2]}"
+    fi
+}
+
+# GPU memory in use across amdgpu devices
+# Sets: VRAM_USED_MB, GTT_USED_MB
+read_gpu_memory() {
+    local card value
+    VRAM_USED_MB=0
+    GTT_USED_MB=0
+    for card in /sys/class/drm/card*; do
+        [[ "${card##*/}" == *-* ]] && continue
+        if [[ -r "$card/device/mem_info_vram_used" ]]; then
+            read -r value < "$card/device/mem_info_vram_used"
+            VRAM_USED_MB=$(( VRAM_USED_MB + value / 1048576 ))
+        fi
+        if [[ -r "$card/device/mem_info_gtt_used" ]]; then
+            read -r value < "$card/device/mem_info_gtt_used"
+            GTT_USED_MB=$(( GTT_USED_MB + value / 1048576 ))
+        fi
+    done
+}
+
+# Check that hibernating now could succeed and resume
+# Sets: HIBERNATE_REASON, IMAGE_MB, SWAP_FREE_MB (and the GPU memory counters)
+# Returns: 1 if not
+hibernate_ready() {
+    local key value unit state="" resume="0:0" cmdline=""
+    local mem_total=0 mem_available=0 swap_free=0
+    while read -r key value unit; do
+        case "$key" in
+            MemTotal:) mem_total="$value" ;;
+            MemAvailable:) mem_available="$value" ;;
+            SwapFree:) swap_free="$value" ;;
+        esac
+    done < /proc/meminfo
+    read_gpu_memory
+    # Unreclaimable RAM (GTT included) plus VRAM, which is evicted into the image
+    IMAGE_MB=$(( (mem_total - mem_available) / 1024 + VRAM_USED_MB ))
+    SWAP_FREE_MB=$(( swap_free / 1024 ))
+
+    [[ -r /sys/power/state ]] && read -r state < /sys/power/state
+    if [[ " $state " != *" disk "* ]]; then
+        HIBERNATE_REASON="kernel cannot hibernate (no 'disk' in /sys/power/state)"
+        return 1
+    fi
+
+    [[ -r /sys/power/resume ]] && read -r resume < /sys/power/resume
+    [[ -r /proc/cmdline ]] && read -r cmdline < /proc/cmdline
+    if [[ "$resume" == "0:0" && " $cmdline" != *" resume="* ]]; then
+        HIBERNATE_REASON="no resume target (resume= is not set)"
+        return 1
+    fi
+    if (( HIBERNATE_GPU_MAX_MB > 0 && VRAM_USED_MB + GTT_USED_MB > HIBERNATE_GPU_MAX_MB )); then
+        HIBERNATE_REASON="$(( VRAM_USED_MB + GTT_USED_MB )) MB of GPU memory in use (limit ${HIBERNATE_GPU_MAX_MB} MB)"
+        return 1
+    fi
+    if (( IMAGE_MB > SWAP_FREE_MB )); then
+        HIBERNATE_REASON="image of ~${IMAGE_MB} MB does not fit in ${SWAP_FREE_MB} MB of free swap"
+        return 1
+    fi
+    HIBERNATE_REASON=""
+    return 0
+}
+
+# Time asleep until the battery reaches the reserve at the median drain
+# Sets: HIBERNATE_DELAY (seconds), DRAIN_MW, DRAIN_SAMPLES, HIBERNATE_REASON
+# Returns: 1 if the machine is not running on its battery
+hibernate_delay() {
+    HIBERNATE_DELAY=0
+    if ! read_battery || [[ -z "$BAT_FULL" ]]; then
+        HIBERNATE_REASON="no battery energy readings"
+        return 1
+    fi
+    if [[ "$BAT_STATUS" != "Discharging" ]]; then
+        HIBERNATE_REASON="on AC power"
+        return 1
+    fi
+    median_drain
+    local usable=$(( BAT_ENERGY - BAT_FULL * HIBERNATE_RESERVE_PCT / 100 ))
+    local min_s=$(( HIBERNATE_MIN_DELAY_MIN * 60 ))
+    local max_s=$(( HIBERNATE_MAX_DELAY_H * 3600 ))
+    # uWh / mW = ms * 3.6
+    if (( DRAIN_MW <= 0 )); then
+        HIBERNATE_DELAY=$max_s
+    elif (( usable > 0 )); then
+        HIBERNATE_DELAY=$(( usable * 18 / (DRAIN_MW * 5) ))
+    fi
+    (( HIBERNATE_DELAY < min_s )) && HIBERNATE_DELAY=$min_s
+    (( HIBERNATE_DELAY > max_s )) && HIBERNATE_DELAY=$max_s
+    return 0
+}
+
+# Arm the RTC for the hibernate deadline (pre-suspend, plain suspend only)
+hibernate_arm() {
+    load_hibernate_conf
+    [[ "$HIBERNATE_POLICY" == "auto" && -w "$RTC_WAKEALARM" ]] || return 0
+    if ! hibernate_ready || ! hibernate_delay; then
+        log "Hibernate policy: not armed, ${HIBERNATE_REASON}"
+        return 0
+    fi
+    local alarm=""
+    read -r alarm < "$RTC_WAKEALARM" 2>/dev/null || true
+    if [[ -n "$alarm" ]]; then
+        log "Hibernate policy: not armed, RTC alarm already set for $alarm"
+        return 0
+    fi
+    now_us
+    local deadline=$(( NOW_US / 1000000 + HIBERNATE_DELAY ))
+    if ! echo "$deadline" > "$RTC_WAKEALARM" 2>/dev/null; then
+        log "Hibernate policy: cannot set $RTC_WAKEALARM"
+        return 0
+    fi
+    echo "$deadline" > "$STATE_DIR/hibernate-alarm"
+    log "Hibernate policy: hibernating after $(( HIBERNATE_DELAY / 60 )) min asleep" \
+        "(${BAT_CAPACITY}% left, ${DRAIN_MW} mW drain over ${DRAIN_SAMPLES} sleeps)"
+}
+
+# Clear the alarm on resume and decide whether to hibernate now
+# Returns: 0 if the policy's alarm ended the sleep and there is still no AC
+hibernate_due() {
+    [[ -f "$STATE_DIR/hibernate-alarm" ]] || return 1
+    local deadline
+    read -r deadline < "$STATE_DIR/hibernate-alarm"
+    echo 0 > "$RTC_WAKEALARM" 2>/dev/null || true
+    now_us
+    (( NOW_US / 1000000 >= deadline - 60 )) || return 1
+    if read_battery && [[ "$BAT_STATUS" != "Discharging" ]]; then
+        log "Hibernate policy: deadline reached but on AC power, staying awake"
+        return 1
+    fi
+    return 0
+}
+
 case "$1" in
     pre)
         log "=== Pre-suspend hook starting ==="
         mkdir -p "$STATE_DIR"
+        now_us
+        CYCLE="$NOW_US"
+        echo "$CYCLE" > "$STATE_DIR/cycle"
+        record pre begin "$CYCLE" 0
+        record_stats pre
 
         # ---------------------------------------------------------------
-        # 1. Disable Thunderbolt/NHI wakeup (primary cause of s2idle hang)
+        # 1. Apply the wakeup-source policy
         # ---------------------------------------------------------------
         # NHI controllers can send spurious wakeup signals that cause the
-        # SoC to exit s2idle but fail to fully resume, resulting in a hang.
-        log "Disabling Thunderbolt/NHI wakeup sources..."
-        : > "$STATE_DIR/nhi-wakeup"
-        for dev in /sys/bus/pci/devices/*; do
-            [[ -f "$dev/class" ]] || continue
-            local_class=$(<"$dev/class")
-            # 0x0c0340 = Thunderbolt NHI (USB4 host)
-            if [[ "$local_class" == "0x0c0340" ]]; then
-                dev_name=$(basename "$dev")
-                if [[ -f "$dev/power/wakeup" ]]; then
-                    current=$(<"$dev/power/wakeup")
-                    if [[ "$current" == "enabled" ]]; then
-                        log "Disabling wakeup on NHI $dev_name"
-                        echo "$dev_name" >> "$STATE_DIR/nhi-wakeup"
-                        echo "disabled" > "$dev/power/wakeup" 2>/dev/null || true
-                    fi
-                fi
-            fi
-        done
+        # SoC to exit s2idle but fail to fully resume, and multiple xHCI
+        # controllers can race during resume. The default policy disables
+        # both, except the xHCI controller the internal keyboard hangs off.
+        phase_begin wakeup-policy
+        log "Applying wakeup policy..."
+        apply_wakeup_policy apply
 
-        # ---------------------------------------------------------------
-        # 2. Disable non-essential xHCI wakeup sources
-        # ---------------------------------------------------------------
-        # On Strix Halo, multiple xHCI controllers can race during s2idle
-        # resume. Keep only the controller hosting the internal keyboard
-        # (c4:00.4) wakeup-enabled; disable the rest.
-        log "Constraining xHCI wakeup sources..."
-        : > "$STATE_DIR/xhc-wakeup"
-        for dev in /sys/bus/pci/devices/*; do
-            [[ -f "$dev/class" ]] || continue
-            local_class=$(<"$dev/class")
-            # 0x0c0330 = xHCI USB controller
-            if [[ "$local_class" == "0x0c0330" ]]; then
-                dev_name=$(basename "$dev")
-                # Keep wakeup on the internal USB controller (keyboard lives here)
-                [[ "$dev_name" == *"c4:00.4"* ]] && continue
-                if [[ -f "$dev/power/wakeup" ]]; then
-                    current=$(<"$dev/power/wakeup")
-                    if [[ "$current" == "enabled" ]]; then
-                        log "Disabling wakeup on xHCI $dev_name"
-                        echo "$dev_name" >> "$STATE_DIR/xhc-wakeup"
-                        echo "disabled" > "$dev/power/wakeup" 2>/dev/null || true
-                    fi
-                fi
-            fi
-        done
+        phase_end
 
         # ---------------------------------------------------------------
-        # 3. Unbind ASUS HID devices to prevent ENOMEM on resume
+        # 2. Unbind ASUS HID devices to prevent ENOMEM on resume
         # ---------------------------------------------------------------
         # The asus HID driver tries to re-probe on resume and fails with
         # ENOMEM (-12), which can cascade into a hung resume. Unbinding
         # before suspend and rebinding after avoids this entirely.
+        phase_begin hid-unbind
         log "Unbinding ASUS HID devices..."
         : > "$STATE_DIR/asus-hid"
         for hid_dev in /sys/bus/hid/devices/0003:0B05:*; do
@@ -127,9 +773,12 @@ case "$1" in
             fi
         done
 
+        phase_end
+
         # ---------------------------------------------------------------
-        # 4. Unbind MMC to prevent "Power Off Notify" timeout
+        # 3. Unbind MMC to prevent "Power Off Notify" timeout
         # ---------------------------------------------------------------
+        phase_begin mmc-unbind
         log "Unbinding MMC devices..."
         : > "$STATE_DIR/mmc-devices"
         if [[ -d "$MMC_DRIVER_PATH" ]]; then
@@ -144,37 +793,44 @@ case "$1" in
             done
         fi
 
+        phase_end
+        save_sleep_snapshot
+        # systemd runs suspend-then-hibernate and hibernate itself
+        [[ "$SLEEP_TYPE" == "suspend" ]] && hibernate_arm
+        now_us
+        record pre end "$NOW_US" 0
         log "=== Pre-suspend hook complete ==="
         ;;
 
     post)
         log "=== Post-resume hook starting ==="
+        now_us
+        [[ -f "$STATE_DIR/cycle" ]] && read -r CYCLE < "$STATE_DIR/cycle"
+        CYCLE="${CYCLE:-$NOW_US}"
+        record post begin "$NOW_US" 0
+        record_sleep_drain
+        load_hibernate_conf
+        HIBERNATE_NOW=false
+        hibernate_due && HIBERNATE_NOW=true
+        phase_begin wakeup-restore
 
         # ---------------------------------------------------------------
-        # 1. Restore NHI wakeup state
+        # 1. Restore wakeup sources changed by the policy
         # ---------------------------------------------------------------
-        if [[ -f "$STATE_DIR/nhi-wakeup" ]]; then
-            while IFS= read -r dev_name; do
+        if [[ -f "$STATE_DIR/wakeup-changes" ]]; then
+            while IFS='|' read -r dev_name previous; do
                 [[ -n "$dev_name" ]] || continue
-                log "Re-enabling wakeup on NHI $dev_name"
-                echo "enabled" > "/sys/bus/pci/devices/$dev_name/power/wakeup" 2>/dev/null || true
-            done < "$STATE_DIR/nhi-wakeup"
+                log "Restoring wakeup on $dev_name to $previous"
+                echo "$previous" > "/sys/bus/pci/devices/$dev_name/power/wakeup" 2>/dev/null || true
+            done < "$STATE_DIR/wakeup-changes"
         fi
 
-        # ---------------------------------------------------------------
-        # 2. Restore xHCI wakeup state
-        # ---------------------------------------------------------------
-        if [[ -f "$STATE_DIR/xhc-wakeup" ]]; then
-            while IFS= read -r dev_name; do
-                [[ -n "$dev_name" ]] || continue
-                log "Re-enabling wakeup on xHCI $dev_name"
-                echo "enabled" > "/sys/bus/pci/devices/$dev_name/power/wakeup" 2>/dev/null || true
-            done < "$STATE_DIR/xhc-wakeup"
-        fi
+        phase_end
 
         # ---------------------------------------------------------------
-        # 3. Rebind MMC devices
+        # 2. Rebind MMC devices
         # ---------------------------------------------------------------
+        phase_begin mmc-rebind
         if [[ -f "$STATE_DIR/mmc-devices" ]]; then
             while IFS= read -r dev_name; do
                 [[ -n "$dev_name" ]] || continue
@@ -183,10 +839,16 @@ case "$1" in
             done < "$STATE_DIR/mmc-devices"
         fi
 
+        phase_end
+
         # ---------------------------------------------------------------
-        # 4. Reset USB ASUS devices (keyboard/touchpad/lightbar)
+        # 3. Reset USB ASUS devices (keyboard/touchpad/lightbar)
         # ---------------------------------------------------------------
+        # The devices are independent, so they are reset in parallel; each
+        # reset returns once udev has bound the device again (or times out).
+        phase_begin usb-reset
         log "Resetting ASUS USB devices..."
+        udevadm wait --help >/dev/null 2>&1 && UDEV_WAIT=true
         for dev in /sys/bus/usb/devices/*; do
             [[ -f "$dev/idVendor" && -f "$dev/idProduct" ]] || continue
             vid=$(<"$dev/idVendor")
@@ -194,26 +856,21 @@ case "$1" in
             [[ "$vid" == "0b05" ]] || continue
 
             case "$pid" in
-                1a30)
-                    log "Resetting keyboard/touchpad at $dev"
-                    echo 0 > "$dev/authorized" 2>/dev/null || true
-                    sleep 0.1
-                    echo 1 > "$dev/authorized" 2>/dev/null || true
-                    ;;
-                18c6)
-                    log "Resetting lightbar at $dev"
-                    echo 0 > "$dev/authorized" 2>/dev/null || true
-                    sleep 0.1
-                    echo 1 > "$dev/authorized" 2>/dev/null || true
-                    ;;
+                18c6) reset_usb_device "$dev" "lightbar" "$LIGHTBAR_RESET_TIMEOUT_MS" & ;;
+                # The keyboard's product ID differs between variants (1a30 on
+                # most); same 0b05:* set the wakeup policy keeps
+                *) reset_usb_device "$dev" "keyboard/touchpad ($pid)" "$KEYBOARD_RESET_TIMEOUT_MS" & ;;
             esac
         done
+        wait
+
+        phase_end
 
         # ---------------------------------------------------------------
-        # 5. Rebind ASUS HID devices
+        # 4. Rebind ASUS HID devices
         # ---------------------------------------------------------------
-        # Wait for USB devices to settle after reset before rebinding HID
-        sleep 1
+        # The resets above have already waited for re-enumeration
+        phase_begin hid-rebind
         if [[ -f "$STATE_DIR/asus-hid" ]]; then
             while IFS=: read -r dev_name driver_name; do
                 [[ -n "$dev_name" ]] || continue
@@ -228,19 +885,90 @@ case "$1" in
             done < "$STATE_DIR/asus-hid"
         fi
 
+        phase_end
+
         # ---------------------------------------------------------------
-        # 6. Restore RGB settings (via z13ctl if available)
+        # 5. Restore RGB settings (via z13ctl if available)
         # ---------------------------------------------------------------
-        sleep 0.5
+        # The lightbar's hidraw node is ready once its reset has returned
+        phase_begin rgb-restore
         if command -v z13ctl >/dev/null 2>&1; then
             log "Restoring RGB settings via z13ctl..."
             z13ctl apply 2>&1 | logger -t gz302-rgb-restore || true
         fi
 
+        phase_end
+        record_stats post
+        now_us
+        record post end "$NOW_US" 0
+        trim_log "$TIMING_LOG" "$TIMING_LOG_MAX_LINES"
+        trim_log "$DRAIN_LOG" "$DRAIN_LOG_MAX_LINES"
+
         # Clean up state dir
         rm -rf "$STATE_DIR"
 
         log "=== Post-resume hook complete ==="
+
+        # Battery reserve reached while asleep: continue into hibernation.
+        # logind refuses a hibernate request while this suspend job is still
+        # running, so a transient timer makes it once the hook has returned.
+        if [[ "$HIBERNATE_NOW" == "true" ]]; then
+            log "Hibernate policy: battery reserve reached, hibernating after resume"
+            if ! out=$(systemd-run --quiet --unit="gz302-hibernate-${CYCLE}" --on-active=2 \
+                    "$0" hibernate "$CYCLE" "$HIBERNATE_IMAGE_SIZE_MB" 2>&1); then
+                log "Hibernate policy: could not schedule hibernation: $out"
+            fi
+        fi
+        ;;
+
+    hibernate)
+        # Run by the timer post-resume arms: $2 = cycle, $3 = image size (MB)
+        CYCLE="${2:-}"
+        if [[ -n "${3:-}" ]]; then
+            echo $(( $3 * 1048576 )) > /sys/power/image_size 2>/dev/null || true
+        fi
+        # Retry while the previous sleep operation is still finishing
+        for _ in 1 2 3 4 5 6 7 8 9 10; do
+            if out=$(systemctl hibernate 2>&1); then
+                record stat "hibernate@post" 1
+                log "Hibernate policy: hibernation accepted"
+                exit 0
+            fi
+            sleep 1
+        done
+        log "Hibernate policy: hibernation refused, staying awake: $out"
+        ;;
+
+    policy)
+        # Dry run for "gz302 wakeup-policy": show what pre-suspend would change
+        apply_wakeup_policy dry-run
+        ;;
+
+    hibernate-plan)
+        # For "gz302 hibernate-policy": what pre-suspend would decide now
+        load_hibernate_conf
+        ready=yes
+        hibernate_ready || ready=no
+        reason="$HIBERNATE_REASON"
+        if ! hibernate_delay; then
+            [[ -n "$reason" ]] || reason="$HIBERNATE_REASON"
+        fi
+        [[ -n "$DRAIN_MW" ]] || median_drain
+        echo "policy=$HIBERNATE_POLICY"
+        echo "ready=$ready"
+        echo "reason=$reason"
+        echo "delay_s=$HIBERNATE_DELAY"
+        echo "drain_mw=$DRAIN_MW"
+        echo "samples=$DRAIN_SAMPLES"
+        echo "min_samples=$HIBERNATE_MIN_SAMPLES"
+        echo "reserve_pct=$HIBERNATE_RESERVE_PCT"
+        echo "capacity=$BAT_CAPACITY"
+        echo "status=$BAT_STATUS"
+        echo "image_mb=$IMAGE_MB"
+        echo "swap_free_mb=$SWAP_FREE_MB"
+        echo "vram_used_mb=$VRAM_USED_MB"
+        echo "gtt_used_mb=$GTT_USED_MB"
+        echo "gpu_max_mb=$HIBERNATE_GPU_MAX_MB"
         ;;
 esac
 exit 0
@@ -248,6 +976,395 @@ HOOKEOF
 
 sudo chmod +x "$HOOK_PATH"
 
+# --- Install the suspend report, policy commands and gz302 dispatcher ---
+REPORT_PATH="/usr/local/bin/gz302-suspend-report"
+POLICY_CMD_PATH="/usr/local/bin/gz302-wakeup-policy"
+HIBERNATE_CMD_PATH="/usr/local/bin/gz302-hibernate-policy"
+DISPATCHER_PATH="/usr/local/bin/gz302"
+
+sudo tee "$REPORT_PATH" > /dev/null << 'REPORTEOF'
+#!/bin/bash
+# GZ302 Suspend Report
+# Per-cycle suspend entry/exit latency from the sleep hook's phase timings,
+# joined with /sys/power/suspend_stats and amd_pmc s0ix residency, to show
+# whether the SoC actually reached hardware deep idle (s0i3), followed by
+# the battery drain of each sleep and the wakeup sources that fired.
+#
+# Usage: gz302 suspend-report [-n CYCLES] [--phases]
+
+set -euo pipefail
+
+TIMING_LOG="${GZ302_SUSPEND_LOG:-/var/log/gz302/suspend-timing.log}"
+DRAIN_LOG="${GZ302_DRAIN_LOG:-/var/log/gz302/sleep-drain.log}"
+CYCLES=10
+PHASES=false
+
+usage() {
+    cat << 'EOF'
+Usage: gz302 suspend-report [options]
+
+Options:
+  -n, --cycles N   Show the last N suspend cycles (default: 10)
+  -p, --phases     Break every cycle down into hook phases
+  -h, --help       Show this help
+
+Columns:
+  ENTRY_MS   Pre-suspend hook duration (wakeup setup, HID/MMC unbind)
+  ASLEEP_S   Time between the end of the pre hook and the start of resume
+  HW_SLEEP_S Time the SoC spent in hardware sleep (last_hw_sleep / s0ix)
+  DEEP       yes: >= 90% of the time asleep was hardware sleep
+             partial: some, but less; NO: none; n/a: no counters
+  EXIT_MS    Post-resume hook duration
+  KBD_MS     Time until the keyboard was re-enumerated and bound
+
+Sleep drain (battery energy before/after each sleep):
+  DRAIN_MW   Average power drawn while asleep
+  WOKEN BY   Wakeup sources whose event counts rose while asleep, and
+             the interrupt that ended s2idle
+EOF
+}
+
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        -n|--cycles) CYCLES="$2"; shift 2 ;;
+        -p|--phases) PHASES=true; shift ;;
+        -h|--help) usage; exit 0 ;;
+        *) usage >&2; exit 2 ;;
+    esac
+done
+
+echo "Suspend statistics since boot:"
+mem_sleep=$(cat /sys/power/mem_sleep 2>/dev/null || echo "unknown")
+printf "  %-16s %s\n" "mem_sleep" "$mem_sleep"
+for counter in success fail last_hw_sleep total_hw_sleep; do
+    if [[ -r "/sys/power/suspend_stats/$counter" ]]; then
+        printf "  %-16s %s\n" "$counter" "$(cat "/sys/power/suspend_stats/$counter")"
+    fi
+done
+echo
+
+if [[ ! -s "$TIMING_LOG" ]]; then
+    echo "No suspend cycles recorded yet (${TIMING_LOG})"
+    exit 0
+fi
+
+awk -F'|' -v cycles="$CYCLES" -v phases="$PHASES" '
+    function ms(us) { return sprintf("%.0f", us / 1000) }
+    {
+        c = $1
+        if (!(c in seen)) { seen[c] = 1; order[++n] = c }
+    }
+    $2 == "stat" { stat[c, $3] = $4; next }
+    $3 == "begin" { begin[c, $2] = $4; next }
+    $3 == "end"   { end_[c, $2] = $4; next }
+    $3 ~ /^usb-reset:keyboard/ { kbd[c] = $5 }
+    { detail[c] = detail[c] sprintf("      %-4s %-30s %8.1f ms\n", $2, $3, $5 / 1000) }
+    END {
+        printf "%-19s  %8s  %9s  %10s  %-7s  %7s  %6s  %s\n", \
+            "CYCLE", "ENTRY_MS", "ASLEEP_S", "HW_SLEEP_S", "DEEP", "EXIT_MS", "KBD_MS", "RESULT"
+        first = n - cycles + 1
+        if (first < 1) first = 1
+        for (i = first; i <= n; i++) {
+            c = order[i]
+            entry = ((c, "pre") in begin && (c, "pre") in end_) ? ms(end_[c, "pre"] - begin[c, "pre"]) : "-"
+            exit_ = ((c, "post") in begin && (c, "post") in end_) ? ms(end_[c, "post"] - begin[c, "post"]) : "-"
+            asleep = -1
+            if ((c, "pre") in end_ && (c, "post") in begin)
+                asleep = (begin[c, "post"] - end_[c, "pre"]) / 1000000
+
+            hw = -1
+            if ((c, "last_hw_sleep@post") in stat) hw = stat[c, "last_hw_sleep@post"] / 1000000
+            else if ((c, "s0ix_residency@post") in stat) hw = stat[c, "s0ix_residency@post"] / 1000000
+
+            deep = "n/a"
+            if (hw == 0) deep = "NO"
+            else if (hw > 0 && asleep > 0) deep = (hw / asleep >= 0.9) ? "yes" : "partial"
+            else if (hw > 0) deep = "yes"
+
+            result = "ok"
+            if ((c, "fail@pre") in stat && (c, "fail@post") in stat && stat[c, "fail@post"] > stat[c, "fail@pre"])
+                result = "FAILED"
+            if ((c, "hibernate@post") in stat) result = "hibernated"
+            if (!((c, "post") in begin)) result = "no resume"
+
+            printf "%-19s  %8s  %9s  %10s  %-7s  %7s  %6s  %s\n", \
+                strftime("%Y-%m-%d %H:%M:%S", int(c / 1000000)), entry, \
+                (asleep >= 0 ? sprintf("%.1f", asleep) : "-"), \
+                (hw >= 0 ? sprintf("%.1f", hw) : "-"), deep, exit_, \
+                ((c in kbd) ? ms(kbd[c]) : "-"), result
+            if (phases == "true" && (c in detail)) printf "%s", detail[c]
+        }
+    }' "$TIMING_LOG"
+
+[[ -s "$DRAIN_LOG" ]] || exit 0
+echo
+echo "Sleep drain:"
+awk -F'|' -v cycles="$CYCLES" '
+    function duration(s) { return (s >= 3600) ? sprintf("%.1fh", s / 3600) : sprintf("%dm", s / 60) }
+    {
+        row[++n] = $0
+        # Typical drain: battery cycles long enough for energy_now to move
+        if ($9 == "battery" && $2 >= 600) drain[++m] = $7
+        k = split($10, woke, ",")
+        for (i = 1; i <= k; i++) {
+            name = woke[i]; sub(/\+[0-9]+$/, "", name)
+            if (name != "" && !(name in wakes)) nw++
+            if (name != "") wakes[name]++
+        }
+    }
+    END {
+        printf "%-19s  %7s  %9s  %8s  %6s  %-7s  %s\n", "CYCLE", "ASLEEP", "CAPACITY", "DRAIN_MW", "%/H", "POWER", "WOKEN BY"
+        first = n - cycles + 1
+        if (first < 1) first = 1
+        for (i = first; i <= n; i++) {
+            split(row[i], f, "|")
+            woken = f[10]; gsub(/,/, ", ", woken)
+            if (f[11] != "") woken = woken (woken != "" ? " " : "") "(irq " f[11] ")"
+            printf "%-19s  %7s  %9s  %8s  %6.2f  %-7s  %s\n", \
+                strftime("%Y-%m-%d %H:%M:%S", int(f[1] / 1000000)), duration(f[2]), \
+                f[3] "->" f[4] "%", (f[9] == "battery" ? f[7] : "-"), f[8] / 100, f[9], woken
+        }
+        if (m > 0) {
+            for (i = 2; i <= m; i++) {
+                v = drain[i]
+                for (j = i - 1; j >= 1 && drain[j] > v; j--) drain[j + 1] = drain[j]
+                drain[j + 1] = v
+            }
+            printf "\nMedian drain on battery: %d mW over %d sleeps of 10+ minutes\n", drain[int((m + 1) / 2)], m
+        }
+        if (nw > 0) {
+            printf "Wakeup sources that fired during sleep (all recorded cycles):\n"
+            for (name in wakes) printf "  %-32s %d cycle(s)\n", name, wakes[name]
+        }
+    }' "$DRAIN_LOG"
+REPORTEOF
+
+sudo chmod +x "$REPORT_PATH"
+
+sudo tee "$POLICY_CMD_PATH" > /dev/null << 'POLICYCMDEOF'
+#!/bin/bash
+# GZ302 Wakeup Policy preview
+# Shows, for every wakeup-capable PCI device, which rule of
+# /etc/gz302/wakeup-policy.conf matches and what the sleep hook would
+# change before suspend. Nothing is modified.
+#
+# Usage: gz302 wakeup-policy [--dry-run]
+
+set -euo pipefail
+
+HOOK="/usr/lib/systemd/system-sleep/gz302-reset.sh"
+
+case "${1:---dry-run}" in
+    --dry-run) ;;
+    -h|--help)
+        echo "Usage: gz302 wakeup-policy [--dry-run]"
+        echo "Preview the pre-suspend wakeup policy (always a dry run)."
+        echo "Edit /etc/gz302/wakeup-policy.conf to change it."
+        exit 0
+        ;;
+    *) echo "Usage: gz302 wakeup-policy [--dry-run]" >&2; exit 2 ;;
+esac
+
+if [[ ! -x "$HOOK" ]]; then
+    echo "Suspend hook not installed ($HOOK)" >&2
+    exit 1
+fi
+exec "$HOOK" policy
+POLICYCMDEOF
+
+sudo chmod +x "$POLICY_CMD_PATH"
+
+sudo tee "$HIBERNATE_CMD_PATH" > /dev/null << 'HIBERNATECMDEOF'
+#!/bin/bash
+# GZ302 Hibernate Policy
+# Shows what the sleep hook's suspend-then-hibernate policy would decide
+# now (measured drain, time until the battery reserve, blockers) and plans
+# a swap/resume target sized for RAM; enables or disables the policy.
+#
+# Usage: gz302 hibernate-policy [plan|enable|disable]
+
+set -euo pipefail
+
+HOOK="/usr/lib/systemd/system-sleep/gz302-reset.sh"
+CONF="/etc/gz302/hibernate-policy.conf"
+
+usage() {
+    cat << 'EOF'
+Usage: gz302 hibernate-policy [command]
+
+Commands:
+  plan      Show the current decision and the swap plan (default)
+  enable    Hibernate from s2idle on battery before the reserve is reached
+  disable   Only ever use s2idle
+
+Settings: /etc/gz302/hibernate-policy.conf
+EOF
+}
+
+# Format MB as GiB with one decimal
+gib() { printf '%d.%d GiB' $(( $1 / 1024 )) $(( $1 % 1024 * 10 / 1024 )); }
+
+# Read the hook's decision into PLAN[key]
+declare -A PLAN=()
+read_plan() {
+    local key value
+    while IFS='=' read -r key value; do
+        PLAN["$key"]="$value"
+    done < <("$HOOK" hibernate-plan)
+}
+
+set_policy() {
+    if [[ $EUID -ne 0 ]]; then
+        echo "gz302 hibernate-policy $1: run with sudo" >&2
+        exit 1
+    fi
+    [[ -f "$CONF" ]] || { echo "$CONF is missing; re-run fix-suspend.sh" >&2; exit 1; }
+    if grep -q '^HIBERNATE_POLICY=' "$CONF"; then
+        sed -i "s/^HIBERNATE_POLICY=.*/HIBERNATE_POLICY=$2/" "$CONF"
+    else
+        echo "HIBERNATE_POLICY=$2" >> "$CONF"
+    fi
+    echo "Hibernate policy: $2"
+}
+
+plan() {
+    read_plan
+    local mem_total_mb=0 vram_total_mb=0 gtt_total_mb=0 swap_total_mb=0
+    local key value unit card bytes
+    while read -r key value unit; do
+        [[ "$key" == "MemTotal:" ]] && mem_total_mb=$(( value / 1024 ))
+    done < /proc/meminfo
+    for card in /sys/class/drm/card*; do
+        [[ "${card##*/}" == *-* ]] && continue
+        if [[ -r "$card/device/mem_info_vram_total" ]]; then
+            read -r bytes < "$card/device/mem_info_vram_total"
+            vram_total_mb=$(( vram_total_mb + bytes / 1048576 ))
+        fi
+        if [[ -r "$card/device/mem_info_gtt_total" ]]; then
+            read -r bytes < "$card/device/mem_info_gtt_total"
+            gtt_total_mb=$(( gtt_total_mb + bytes / 1048576 ))
+        fi
+    done
+
+    echo "Policy:        ${PLAN[policy]}"
+    if [[ "${PLAN[ready]}" == "yes" && -z "${PLAN[reason]}" ]]; then
+        echo "Decision:      hibernate after $(( PLAN[delay_s] / 60 )) min asleep" \
+            "(${PLAN[capacity]}% left, reserve ${PLAN[reserve_pct]}%)"
+    else
+        echo "Decision:      stay in s2idle - ${PLAN[reason]}"
+    fi
+    if (( PLAN[samples] >= PLAN[min_samples] && PLAN[samples] > 0 )); then
+        echo "Sleep drain:   ${PLAN[drain_mw]} mW (median of ${PLAN[samples]} sleeps on battery)"
+    else
+        echo "Sleep drain:   ${PLAN[drain_mw]} mW assumed (${PLAN[samples]} of ${PLAN[min_samples]} sleeps of 10+ min on battery logged)"
+    fi
+    echo
+
+    echo "Memory:"
+    printf "  %-20s %s\n" "RAM" "$(gib "$mem_total_mb")"
+    printf "  %-20s %s total, %s in use\n" "VRAM (carve-out)" "$(gib "$vram_total_mb")" "$(gib "${PLAN[vram_used_mb]}")"
+    printf "  %-20s %s limit, %s in use\n" "GTT" "$(gib "$gtt_total_mb")" "$(gib "${PLAN[gtt_used_mb]}")"
+    printf "  %-20s %s (unreclaimable RAM + VRAM in use)\n" "Image now (est.)" "$(gib "${PLAN[image_mb]}")"
+    echo
+
+    echo "Resume target:"
+    local name type size used prio
+    while read -r name type size used prio; do
+        [[ "$name" == "Filename" ]] && continue
+        printf "  %-20s %s (%s)\n" "$name" "$(gib $(( size / 1024 )))" "$type"
+        swap_total_mb=$(( swap_total_mb + size / 1024 ))
+    done < /proc/swaps
+    (( swap_total_mb > 0 )) || echo "  no swap configured"
+    local resume="0:0" cmdline=""
+    [[ -r /sys/power/resume ]] && read -r resume < /sys/power/resume
+    read -r cmdline < /proc/cmdline
+    if [[ "$resume" != "0:0" || " $cmdline" == *" resume="* ]]; then
+        echo "  resume device set ($resume)"
+    else
+        echo "  resume= is not set on the kernel command line"
+    fi
+
+    # Sized for RAM; GPU memory counts only up to the policy's limit, since
+    # larger allocations keep the machine in s2idle instead
+    local gpu_mb="$vram_total_mb" note="GPU memory included"
+    if (( PLAN[gpu_max_mb] > 0 && PLAN[gpu_max_mb] < vram_total_mb )); then
+        gpu_mb="${PLAN[gpu_max_mb]}"
+        note="GPU allocations above ${PLAN[gpu_max_mb]} MB excluded"
+    fi
+    local want_mb=$(( mem_total_mb + gpu_mb ))
+    printf "  %-20s %s (RAM, %s)\n" "Recommended swap" "$(gib "$want_mb")" "$note"
+
+    if (( swap_total_mb < want_mb )); then
+        local size_g=$(( (want_mb + 1023) / 1024 ))
+        echo
+        echo "To add a swap file of that size:"
+        echo "  ext4/xfs: sudo fallocate -l ${size_g}G /swapfile && sudo chmod 600 /swapfile \\"
+        echo "              && sudo mkswap /swapfile && sudo swapon /swapfile"
+        echo "  btrfs:    sudo btrfs filesystem mkswapfile --size ${size_g}g /swap/swapfile \\"
+        echo "              && sudo swapon /swap/swapfile"
+        echo "Add it to /etc/fstab, then put resume=UUID=<filesystem UUID> and"
+        echo "resume_offset=<offset> on the kernel command line. The offset comes from"
+        echo "'sudo btrfs inspect-internal map-swapfile -r <file>' (btrfs) or the first"
+        echo "physical_offset in 'sudo filefrag -v <file>' (ext4/xfs)."
+    fi
+}
+
+if [[ ! -x "$HOOK" ]]; then
+    echo "Suspend hook not installed ($HOOK)" >&2
+    exit 1
+fi
+
+case "${1:-plan}" in
+    plan) plan ;;
+    enable)
+        set_policy enable auto
+        read_plan
+        [[ "${PLAN[ready]}" == "yes" ]] || echo "Not armed until fixed: ${PLAN[reason]}"
+        ;;
+    disable) set_policy disable off ;;
+    -h|--help) usage ;;
+    *) usage >&2; exit 2 ;;
+esac
+HIBERNATECMDEOF
+
+sudo chmod +x "$HIBERNATE_CMD_PATH"
+
+sudo tee "$DISPATCHER_PATH" > /dev/null << 'DISPATCHEOF'
+#!/bin/bash
+# gz302 - runs the GZ302 helper commands: "gz302 <command> [args]"
+# executes /usr/local/bin/gz302-<command>.
+
+set -euo pipefail
+
+BIN_DIR="/usr/local/bin"
+
+usage() {
+    echo "Usage: gz302 <command> [args]"
+    echo
+    echo "Commands:"
+    local cmd
+    for cmd in "$BIN_DIR"/gz302-*; do
+        [[ -x "$cmd" && "$cmd" != *.sh ]] || continue
+        echo "  ${cmd##*/gz302-}"
+    done
+}
+
+case "${1:-}" in
+    ""|-h|--help|help) usage; exit 0 ;;
+esac
+
+cmd="$1"
+shift
+if [[ ! -x "$BIN_DIR/gz302-$cmd" ]]; then
+    echo "gz302: unknown command '$cmd'" >&2
+    usage >&2
+    exit 1
+fi
+exec "$BIN_DIR/gz302-$cmd" "$@"
+DISPATCHEOF
+
+sudo chmod +x "$DISPATCHER_PATH"
+
 # --- Kernel parameter recommendations ---
 echo ""
 echo "✓ Suspend hook installed!"
@@ -271,6 +1388,10 @@ if [[ -n "$SUGGEST_PARAMS" ]]; then
     echo -e "$SUGGEST_PARAMS"
     echo "To add these on CachyOS/Arch, edit /etc/default/grub or your"
     echo "bootloader config, then regenerate (e.g., sudo grub-mkconfig -o /boot/grub/grub.cfg)"
+    if [[ "$SUGGEST_PARAMS" == *dcdebugmask* ]]; then
+        echo "The dcdebugmask costs idle panel power; measure it on this kernel with"
+        echo "scripts/benchmark/gz302-panel-power.sh from the repository."
+    fi
 else
     echo "  All recommended parameters already present."
 fi
@@ -282,16 +1403,34 @@ echo ""
 echo "=== What This Fix Does ==="
 echo ""
 echo "  PRE-SUSPEND:"
-echo "    • Disables Thunderbolt (NHI) controller wakeup"
-echo "    • Limits xHCI wakeup to internal keyboard controller only"
+echo "    • Applies the wakeup policy in /etc/gz302/wakeup-policy.conf"
+echo "      (default: no Thunderbolt wakeup, xHCI wakeup only on the"
+echo "      controller hosting the keyboard; preview: gz302 wakeup-policy)"
 echo "    • Unbinds ASUS HID devices (prevents ENOMEM on re-probe)"
 echo "    • Unbinds internal SD card (prevents Power Off Notify timeout)"
 echo ""
 echo "  POST-RESUME:"
-echo "    • Restores all wakeup sources"
+echo "    • Restores wakeup sources changed by the policy"
 echo "    • Rebinds MMC and ASUS HID devices"
-echo "    • Resets keyboard/touchpad/lightbar USB"
+echo "    • Resets keyboard/touchpad/lightbar USB in parallel, waiting on udev"
+echo "      events instead of fixed delays"
 echo "    • Restores RGB settings"
 echo ""
+echo "  EVERY CYCLE:"
+echo "    • Times each hook phase into /var/log/gz302/suspend-timing.log"
+echo "    • Records suspend_stats and amd_pmc s0ix residency counters"
+echo "    • Logs battery drain per sleep and the wakeup sources that fired"
+echo "      (/var/log/gz302/sleep-drain.log)"
+echo ""
+echo "  OPTIONAL (gz302 hibernate-policy enable):"
+echo "    • Hibernates from s2idle on battery before the reserve is reached,"
+echo "      timed from the measured sleep drain and the remaining charge"
+echo ""
 echo "Test by suspending and resuming. Check logs with:"
 echo "  journalctl -b -t gz302-reset"
+echo ""
+echo "Per-cycle latency and s2idle residency:"
+echo "  gz302 suspend-report --phases"
+echo ""
+echo "Suspend-then-hibernate readiness and swap plan:"
+echo "  gz302 hibernate-policy"
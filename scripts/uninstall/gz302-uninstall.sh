@@ -6,7 +6,9 @@
 # Author: th3cavalry using Copilot
 # Version: 6.0.0
 #
-# This script completely removes:
+# This script first restores every configuration file GZ302 modified (GRUB,
+# boot entries, mkinitcpio.conf, modprobe configs, ...) from the backup store
+# in /var/backups/gz302/store, then completely removes:
 # - z13ctl daemon, binary, and systemd units
 # - Hardware fixes (kernel parameters, modprobe configs)
 # - Power/Display management tools (pwrcfg, rrcfg wrappers)
@@ -36,6 +38,9 @@ success() { echo -e "${C_GREEN}SUCCESS:${C_NC} $1"; }
 warning() { echo -e "${C_YELLOW}WARNING:${C_NC} $1"; }
 error() { echo -e "${C_RED}ERROR:${C_NC} $1" >&2; exit 1; }
 
+# Paths restored to a pre-GZ302 original; remove_file leaves these alone
+declare -A RESTORED_PATHS=()
+
 check_root() {
     if [[ ${EUID:-$(id -u)} -ne 0 ]]; then
         error "This script must be run as root."
@@ -43,6 +48,12 @@ check_root() {
 }
 
 remove_file() {
+    # Keep originals that existed before GZ302, unless the file is evidently
+    # one of ours (recorded by an older release after it was written)
+    if [[ -n "${RESTORED_PATHS[$1]:-}" ]] && ! grep -qi "gz302" "$1" 2>/dev/null; then
+        echo -e "  Kept original: $1"
+        return 0
+    fi
     if [[ -f "$1" ]]; then
         rm -f "$1"
         echo -e "  Removed file: $1"
@@ -65,6 +76,74 @@ disable_service() {
     remove_file "/etc/systemd/system/$1"
 }
 
+# Locate gz302-lib/state-manager.sh (repository checkout or installed copy)
+# Output: Library path
+find_state_manager() {
+    local script_dir candidate
+    script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+    for candidate in "${script_dir}/../../gz302-lib/state-manager.sh" \
+                     "/usr/local/share/gz302/gz302-lib/state-manager.sh"; do
+        if [[ -f "$candidate" ]]; then
+            echo "$candidate"
+            return 0
+        fi
+    done
+    return 1
+}
+
+# Put back the first recorded version of every file in the backup store and
+# regenerate boot artifacts that depend on restored files
+restore_original_configs() {
+    if [[ ! -f /var/backups/gz302/store/manifest ]]; then
+        info "No recorded configuration backups (installed before backup store existed)"
+        return 0
+    fi
+
+    local lib
+    if ! lib=$(find_state_manager); then
+        warning "state-manager.sh not found - modified configuration files were not restored"
+        return 0
+    fi
+    # shellcheck source=/dev/null
+    source "$lib"
+
+    state_restore_originals || warning "Some configuration files could not be restored"
+
+    # BACKUP_LATEST now holds what each tracked path contains on disk
+    local file_path
+    for file_path in "${!BACKUP_LATEST[@]}"; do
+        [[ "${BACKUP_LATEST[$file_path]}" == "absent" ]] || RESTORED_PATHS["$file_path"]=1
+    done
+
+    # Only paths whose content the restore changed affect the boot setup
+    local grub_changed=false initramfs_changed=false
+    for file_path in "${BACKUP_RESTORED[@]}"; do
+        case "$file_path" in
+            /etc/default/grub) grub_changed=true ;;
+            /etc/mkinitcpio.conf|/etc/kernel/cmdline|/etc/modprobe.d/*) initramfs_changed=true ;;
+        esac
+    done
+
+    if [[ "$grub_changed" == true ]]; then
+        info "Regenerating GRUB configuration..."
+        if command -v grub-mkconfig >/dev/null 2>&1; then
+            grub-mkconfig -o /boot/grub/grub.cfg >/dev/null 2>&1 || warning "grub-mkconfig failed"
+        elif command -v grub2-mkconfig >/dev/null 2>&1; then
+            grub2-mkconfig -o /boot/grub2/grub.cfg >/dev/null 2>&1 || warning "grub2-mkconfig failed"
+        fi
+    fi
+    if [[ "$initramfs_changed" == true ]]; then
+        info "Regenerating initramfs..."
+        if command -v mkinitcpio >/dev/null 2>&1; then
+            mkinitcpio -P >/dev/null 2>&1 || warning "mkinitcpio failed"
+        elif command -v dracut >/dev/null 2>&1; then
+            dracut -f --regenerate-all >/dev/null 2>&1 || warning "dracut failed"
+        elif command -v update-initramfs >/dev/null 2>&1; then
+            update-initramfs -u -k all >/dev/null 2>&1 || warning "update-initramfs failed"
+        fi
+    fi
+}
+
 # --- Main Uninstall Logic ---
 
 main() {
@@ -93,6 +172,10 @@ main() {
     disable_service "gz302-rgb-restore.service"
     disable_service "gz302-kbd-backlight-save.service"
     disable_service "gz302-lightbar-reset.service"
+
+    # GPU memory plan check, LLM server for the benchmarked backend
+    disable_service "gz302-gtt-verify.service"
+    disable_service "gz302-llama-server.service"
     
     # Legacy services
     disable_service "reload-hid_asus.service"
@@ -102,6 +185,10 @@ main() {
     # Reload systemd
     systemctl daemon-reload
     
+    echo
+    info "Restoring original configuration files..."
+    restore_original_configs
+    
     echo
     info "Removing z13ctl..."
     # Stop and disable z13ctl user daemon for all users
@@ -129,6 +216,14 @@ main() {
     remove_file "/usr/local/bin/pwrcfg-monitor"
     remove_file "/usr/local/bin/pwrcfg-restore"
     remove_file "/usr/local/bin/rrcfg"
+    systemctl --global disable gz302-adaptive-refresh.service >/dev/null 2>&1 || true
+    remove_file "/etc/systemd/user/gz302-adaptive-refresh.service"
+    remove_file "/usr/local/bin/gz302-adaptive-refresh"
+    remove_file "/usr/local/bin/gz302-envelope"
+    remove_file "/etc/tmpfiles.d/gz302-envelope.conf"
+    remove_file "/run/lock/gz302-envelope.lock"
+    remove_file "/usr/local/bin/gz302-game"
+    remove_file "/usr/local/bin/gz302-gpu"
     remove_file "/usr/share/icons/hicolor/scalable/apps/gz302-control-center.svg"
     remove_file "/usr/share/icons/hicolor/scalable/apps/gz302-power-manager.svg"
     
@@ -146,6 +241,10 @@ main() {
     remove_file "/usr/local/bin/gz302-folio-resume.sh"
     remove_file "/usr/lib/systemd/system-sleep/gz302-kbd-backlight"
     remove_file "/usr/lib/systemd/system-sleep/gz302-reset.sh"
+    remove_file "/usr/local/bin/gz302-suspend-report"
+    remove_file "/usr/local/bin/gz302-wakeup-policy"
+    remove_file "/usr/local/bin/gz302-hibernate-policy"
+    remove_file "/usr/local/bin/gz302"
     
     echo
     info "Removing Command Center / GUI..."
@@ -165,8 +264,17 @@ main() {
     echo
     info "Removing configuration..."
     remove_dir "/etc/gz302"
-    remove_dir "/var/lib/gz302"
+    if [[ -d /var/lib/gz302/models ]]; then
+        # Model weights are user data; the backends' views may link to them
+        find /var/lib/gz302 -mindepth 1 -maxdepth 1 ! -name models -exec rm -rf {} +
+        info "Keeping model store /var/lib/gz302/models (remove it to free space)"
+    else
+        remove_dir "/var/lib/gz302"
+    fi
     remove_dir "/var/log/gz302"
+    if [[ -d /var/cache/gz302 ]]; then
+        info "Keeping download cache /var/cache/gz302 for reinstalls (remove it to free space)"
+    fi
 
     # Remove legacy config dirs
     remove_dir "/etc/gz302-tdp"
@@ -195,6 +303,7 @@ main() {
     # Modprobe configs
     remove_file "/etc/modprobe.d/mt7925.conf"
     remove_file "/etc/modprobe.d/amdgpu.conf"
+    remove_file "/etc/modprobe.d/gz302-gtt.conf"
     remove_file "/etc/modprobe.d/hid-asus.conf"
     remove_file "/etc/modprobe.d/i2c-hid-acpi-gz302.conf"
     remove_file "/etc/modprobe.d/cs35l41.conf"
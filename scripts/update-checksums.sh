@@ -0,0 +1,50 @@
+#!/bin/bash
+set -euo pipefail
+
+# ==============================================================================
+# GZ302 Repository Checksum Manifest
+# Version: 1.0.0
+#
+# Regenerates SHA256SUMS at the repository root. gz302-setup.sh and the
+# modules download missing project files (libraries, modules, tray app,
+# suspend fix) from GITHUB_RAW_URL and verify them against this manifest,
+# so it must be regenerated whenever one of those files changes.
+#
+# Usage:
+#   scripts/update-checksums.sh           # rewrite SHA256SUMS
+#   scripts/update-checksums.sh --check   # exit 1 if SHA256SUMS is stale
+# ==============================================================================
+
+REPO_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+MANIFEST="SHA256SUMS"
+
+# Files the installer may fetch from the repository
+CHECKSUM_PATHS=(gz302-setup.sh gz302-lib modules scripts command-center)
+
+cd "$REPO_DIR"
+
+generate() {
+    git ls-files --cached --others --exclude-standard -- "${CHECKSUM_PATHS[@]}" \
+        | LC_ALL=C sort \
+        | while IFS= read -r path; do
+            [[ -f "$path" ]] && sha256sum "$path"
+        done
+}
+
+case "${1:-}" in
+    --check)
+        if ! diff -q <(generate) "$MANIFEST" >/dev/null 2>&1; then
+            echo "${MANIFEST} is out of date; run scripts/update-checksums.sh" >&2
+            exit 1
+        fi
+        echo "${MANIFEST} is up to date"
+        ;;
+    "")
+        generate > "$MANIFEST"
+        echo "Wrote ${MANIFEST} ($(wc -l < "$MANIFEST") files)"
+        ;;
+    *)
+        echo "Usage: $0 [--check]" >&2
+        exit 2
+        ;;
+esac
@@ -0,0 +1,44 @@
+#!/bin/bash
+set -euo pipefail
+
+# ==============================================================================
+# GZ302 llama.cpp Pin
+# Version: 1.0.0
+#
+# Moves the llama.cpp release that "modules/gz302-llm.sh build" compiles by
+# default. Downloads the release's source tarball, hashes it and rewrites
+# LLAMACPP_PIN_TAG/LLAMACPP_PIN_SHA256 in the module, then regenerates
+# SHA256SUMS. Build and bench the new tag on a GZ302 before committing.
+#
+# Usage:
+#   scripts/update-llamacpp-pin.sh          # pin the latest release
+#   scripts/update-llamacpp-pin.sh b6700    # pin a given tag
+# ==============================================================================
+
+REPO_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+MODULE="$REPO_DIR/modules/gz302-llm.sh"
+GZ302_GITHUB_API="${GZ302_GITHUB_API:-https://api.github.com}"
+
+tag="${1:-}"
+if [[ -z "$tag" ]]; then
+    tag=$(curl -fsSL "${GZ302_GITHUB_API}/repos/ggerganov/llama.cpp/releases/latest" \
+        | grep -oE '"tag_name": *"[^"]*"' | head -1 | sed -E 's/.*"([^"]*)"$/\1/')
+    if [[ -z "$tag" ]]; then
+        echo "Could not look up the latest llama.cpp release; pass a tag" >&2
+        exit 1
+    fi
+fi
+if [[ ! "$tag" =~ ^[A-Za-z0-9._-]+$ ]]; then
+    echo "Invalid tag: $tag" >&2
+    exit 2
+fi
+
+sum=$(curl -fsSL "https://github.com/ggerganov/llama.cpp/archive/refs/tags/${tag}.tar.gz" | sha256sum)
+sum="${sum%% *}"
+
+sed -i -E \
+    -e "s/^LLAMACPP_PIN_TAG=.*/LLAMACPP_PIN_TAG=\"${tag}\"/" \
+    -e "s/^LLAMACPP_PIN_SHA256=.*/LLAMACPP_PIN_SHA256=\"${sum}\"/" \
+    "$MODULE"
+echo "Pinned llama.cpp ${tag} (sha256 ${sum})"
+"$REPO_DIR/scripts/update-checksums.sh"